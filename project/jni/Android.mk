@@ -42,11 +42,14 @@ LOCAL_SRC_FILES := droidzebra-jni.c \
         zebra/myrandom.c \
         zebra/opname.c \
         zebra/osfbook.c \
+        zebra/parallel.c \
         zebra/patterns.c \
         zebra/pcstat.c \
+        zebra/ponder.c \
         zebra/probcut.c \
         zebra/safemem.c \
         zebra/search.c \
+        zebra/searchstat.c \
         zebra/stable.c \
         zebra/thordb.c \
         zebra/timer.c \
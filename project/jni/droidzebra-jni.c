@@ -24,6 +24,7 @@
 #include <math.h>
 #include <time.h>
 #include <setjmp.h>
+#include <pthread.h>
 #include <jni.h>
 
 #include "droidzebra.h"
@@ -46,6 +47,7 @@
 #include "zebra/midgame.h"
 #include "zebra/opname.h"
 #include "zebra/thordb.h"
+#include "zebra/ponder.h"
 /*--------- zebra ----------*/
 
 #define DEFAULT_HASH_BITS         18
@@ -57,6 +59,7 @@
 #define INFINIT_TIME              10000000.0
 
 #define USE_LOG					  FALSE
+#define USE_PONDER				  TRUE
 
 // --
 static double player_time[3], player_increment[3];
@@ -82,23 +85,39 @@ static int s_undo_stack_pointer = 0;
 // from deep within zebra code (with the context of outer JNI call)
 // if JNI function does not need to call "Callback" (like simple setters/getters)
 // then it should not use it. Nesting is explicitly disabled.
+// the environment is only valid on the thread of the outer JNI call, so
+// messages from the ponder thread are queued and passed on by that thread
 static JNIEnv* s_env = NULL;
 static jobject s_thiz = NULL;
+static pthread_t s_jni_thread;
 static jmp_buf s_err_jmp;
 #define DROIDZEBRA_JNI_SETUP \
 	assert(s_env==NULL && s_thiz==NULL); \
 	if( setjmp(s_err_jmp) ) return; \
 	s_env = env; \
-	s_thiz = thiz;
+	s_thiz = thiz; \
+	s_jni_thread = pthread_self();
 #define DROIDZEBRA_JNI_CLEAN \
 	s_env = NULL; \
 	s_thiz = NULL;
 #define DROIDZEBRA_JNI_BREAK longjmp(s_err_jmp, -1);
 #define DROIDZEBRA_CHECK_JNI { assert(s_env!=NULL); if(!s_env) exit( EXIT_FAILURE ); }
+#define DROIDZEBRA_ON_JNI_THREAD pthread_equal(pthread_self(), s_jni_thread)
 
 #define DROIDZEBRA_JNI_THROW(msg) \
 	{ _droidzebra_throw_engine_error(env, (msg)); return; }
 
+#define MSG_QUEUE_SIZE            64
+
+typedef struct {
+	int category;
+	char* json_str;
+} queued_msg_t;
+
+static pthread_mutex_t s_msg_queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+static queued_msg_t s_msg_queue[MSG_QUEUE_SIZE];
+static int s_msg_queue_count = 0;
+
 char android_files_dir[256];
 
 static void _droidzebra_undo_turn(int* side_to_move);
@@ -106,6 +125,8 @@ static void _droidzebra_redo_turn(int* side_to_move);
 static void _droidzebra_on_settings_change(void);
 static void _droidzebra_compute_evals(int side_to_move);
 static void _droidzebra_throw_engine_error(JNIEnv* env, const char* msg);
+static void _droidzebra_queue_message(int category, const char* json_str);
+static void _droidzebra_flush_messages(void);
 
 // undo stack helpers
 static void _droidzebra_undo_stack_push(int val);
@@ -162,6 +183,7 @@ JNIFn(droidzebra,ZebraEngine,zeGlobalInit)(
 
 	global_setup( DEFAULT_RANDOM, DEFAULT_HASH_BITS );
 	init_thor_database();
+	set_ponder_wait_handler( _droidzebra_flush_messages );
 
 	sprintf(cmpbookpath, "%s/book.cmp.z", android_files_dir);
 	sprintf(binbookpath, "%s/book.bin", android_files_dir);
@@ -191,14 +213,15 @@ JNIFn(droidzebra,ZebraEngine,zeGlobalTerminate)( JNIEnv* env, jobject thiz )
 JNIEXPORT void
 JNIFn(droidzebra,ZebraEngine,zeForceReturn)(JNIEnv* env, jobject thiz)
 {
-	force_return = 1;
+	// latched while pondering so the ponder thread can't swallow it
+	request_stop();
 }
 
 JNIEXPORT void
 JNIFn(droidzebra,ZebraEngine,zeForceExit)(JNIEnv* env, jobject thiz)
 {
-	force_return = 1;
 	force_exit = 1;
+	request_stop();
 }
 
 /* callback */
@@ -208,12 +231,17 @@ fatal_error( const char *format, ... ) {
 	va_list arg_ptr;
 	jobject json;
 
-	DROIDZEBRA_CHECK_JNI;
-
 	va_start( arg_ptr, format );
 	vsprintf( errmsg, format, arg_ptr );
 	va_end( arg_ptr );
 
+	// the ponder thread stops here; the error is raised again on the
+	// JNI thread once pondering has finished
+	if( !DROIDZEBRA_ON_JNI_THREAD )
+		fail_ponder( errmsg );
+
+	DROIDZEBRA_CHECK_JNI;
+
 	json = droidzebra_json_create(s_env, NULL);
 	if( !json ) exit( EXIT_FAILURE );
 	droidzebra_json_put_string(s_env, json, "error", errmsg);
@@ -270,6 +298,11 @@ void droidzebra_message(int category, const char* json_str)
 
 	if(!s_enable_msg) return;
 
+	if(!DROIDZEBRA_ON_JNI_THREAD) {
+		_droidzebra_queue_message(category, json_str);
+		return;
+	}
+
 	DROIDZEBRA_CHECK_JNI;
 
 	json = droidzebra_json_create(s_env, json_str);
@@ -290,6 +323,8 @@ int droidzebra_message_debug(const char* format, ...)
 	va_list arg_ptr;
 	jobject json;
 
+	if(!DROIDZEBRA_ON_JNI_THREAD) return -1;
+
 	DROIDZEBRA_CHECK_JNI;
 
 	va_start( arg_ptr, format );
@@ -401,16 +436,19 @@ JNIFn(droidzebra,ZebraEngine,zeGameInProgress)( JNIEnv* env, jobject thiz )
 JNIEXPORT void
 JNIFn(droidzebra,ZebraEngine,zePlay)( JNIEnv* env, jobject thiz, jint providedMoveCount, jbyteArray providedMoves )
 {
-	EvaluationType eval_info;
+	EvaluationType eval_info, ponder_eval;
 	const char *black_name;
 	const char *white_name;
 	const char *opening_name;
 	const char *op;
 	double move_start, move_stop;
+	double ponder_start, ponder_stop;
 	int i;
 	int side_to_move;
 	int curr_move;
 	int timed_search;
+	int pondering;
+	int ponder_reply = PASS;
 	int black_hash1, black_hash2, white_hash1, white_hash2;
 	ui_event_t evt;
 	int provided_move_count;
@@ -547,8 +585,30 @@ AGAIN:
 							if(force_return) force_return = 0; // interrupted by user input
 						}
 
+						// think about the replies to the likely moves while waiting
+						pondering = USE_PONDER && !s_practice_mode && skill[OPP(side_to_move)]>0
+							&& start_ponder( side_to_move, use_book, skill[OPP(side_to_move)],
+									exact_skill[OPP(side_to_move)], wld_skill[OPP(side_to_move)],
+									skill[OPP(side_to_move)] >= 60 );
+
 						// wait for user event
 						droidzebra_msg_get_user_input( side_to_move, &evt );
+
+						if( pondering ) {
+							// the board belongs to the ponder thread until it is done; on a hit
+							// the reply is ready when the computer's turn comes, and the search
+							// updates are passed on while it is being finished
+							ponder_start = get_real_timer();
+							ponder_reply = finish_ponder( evt.type==UI_EVENT_MOVE ? evt.evt_move.move : PASS,
+									player_time[OPP(side_to_move)], player_increment[OPP(side_to_move)],
+									&ponder_eval );
+							ponder_stop = get_real_timer();
+							// the wait is the computer's thinking time, not the player's
+							move_start += ponder_stop - ponder_start;
+							if( ponder_reply!=PASS && player_time[OPP(side_to_move)] != INFINIT_TIME )
+								player_time[OPP(side_to_move)] -= (ponder_stop - ponder_start);
+						}
+
 						if( evt.type== UI_EVENT_EXIT ) {
 							force_exit = 1;
 							break;
@@ -580,21 +640,32 @@ AGAIN:
 					assert(curr_move>=0);
 				}
 				else {
-					start_move( player_time[side_to_move],
-							player_increment[side_to_move],
-							disks_played + 4 );
-					determine_move_time( player_time[side_to_move],
-							player_increment[side_to_move],
-							disks_played + 4 );
-					timed_search = (skill[side_to_move] >= 60);
-					toggle_experimental( FALSE );
-
-					curr_move =
-							compute_move( side_to_move, TRUE, player_time[side_to_move],
-									player_increment[side_to_move], timed_search,
-									use_book, skill[side_to_move],
-									exact_skill[side_to_move], wld_skill[side_to_move],
-									FALSE, &eval_info );
+					if( ponder_reply!=PASS && valid_move( ponder_reply, side_to_move ) ) {
+						// found while pondering on the player's time
+						curr_move = ponder_reply;
+						eval_info = ponder_eval;
+						set_current_eval( eval_info );
+						complete_pv( side_to_move );
+						droidzebra_msg_eval();
+						droidzebra_msg_pv();
+					} else {
+						start_move( player_time[side_to_move],
+								player_increment[side_to_move],
+								disks_played + 4 );
+						determine_move_time( player_time[side_to_move],
+								player_increment[side_to_move],
+								disks_played + 4 );
+						timed_search = (skill[side_to_move] >= 60);
+						toggle_experimental( FALSE );
+
+						curr_move =
+								compute_move( side_to_move, TRUE, player_time[side_to_move],
+										player_increment[side_to_move], timed_search,
+										use_book, skill[side_to_move],
+										exact_skill[side_to_move], wld_skill[side_to_move],
+										FALSE, &eval_info );
+					}
+					ponder_reply = PASS;
 					if ( side_to_move == BLACKSQ )
 						set_evals( produce_compact_eval( eval_info ), 0.0 );
 					else
@@ -649,9 +720,7 @@ AGAIN:
 
 	/*
 	double node_val, eval_val;
-	adjust_counter( &total_nodes );
 	node_val = counter_value( &total_nodes );
-	adjust_counter( &total_evaluations );
 	eval_val = counter_value( &total_evaluations );
 	printf( "\nBlack: %d   White: %d\n", disc_count( BLACKSQ ),
 			disc_count( WHITESQ ) );
@@ -801,6 +870,39 @@ void _droidzebra_throw_engine_error(JNIEnv* env, const char* msg)
     if(exc) (*env)->ThrowNew(env, exc, msg);
 }
 
+// called on the ponder thread; the oldest message is dropped when full
+void _droidzebra_queue_message(int category, const char* json_str)
+{
+	pthread_mutex_lock(&s_msg_queue_mutex);
+	if( s_msg_queue_count==MSG_QUEUE_SIZE ) {
+		free(s_msg_queue[0].json_str);
+		memmove(s_msg_queue, s_msg_queue+1, (MSG_QUEUE_SIZE-1)*sizeof(queued_msg_t));
+		s_msg_queue_count--;
+	}
+	s_msg_queue[s_msg_queue_count].category = category;
+	s_msg_queue[s_msg_queue_count].json_str = json_str? strdup(json_str) : NULL;
+	s_msg_queue_count++;
+	pthread_mutex_unlock(&s_msg_queue_mutex);
+}
+
+// called on the JNI thread while it waits for the ponder thread
+void _droidzebra_flush_messages(void)
+{
+	queued_msg_t queue[MSG_QUEUE_SIZE];
+	int count, i;
+
+	pthread_mutex_lock(&s_msg_queue_mutex);
+	count = s_msg_queue_count;
+	memcpy(queue, s_msg_queue, count*sizeof(queued_msg_t));
+	s_msg_queue_count = 0;
+	pthread_mutex_unlock(&s_msg_queue_mutex);
+
+	for( i=0; i<count; i++ ) {
+		droidzebra_message(queue[i].category, queue[i].json_str);
+		free(queue[i].json_str);
+	}
+}
+
 void _droidzebra_undo_stack_push(int val)
 {
 	assert(s_undo_stack_pointer<64);
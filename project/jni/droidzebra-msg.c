@@ -37,6 +37,10 @@
 #include "droidzebra-json.h"
 #include "droidzebra-msg.h"
 
+// legal moves sent with the last MSG_CANDIDATE_MOVES; user input is checked
+// against these as the board may be in use by the ponder thread meanwhile
+static int s_legal_move[100];
+
 // MSG_ERROR
 // in droidzebra-jni.c
 
@@ -140,7 +144,7 @@ droidzebra_msg_get_user_input( int side_to_move, ui_event_t* ui_event )
 		case UI_EVENT_MOVE:
 			move = droidzebra_json_get_int(env, json_move, "move");
 			ui_event->evt_move.move = move;
-			ready = valid_move( move, side_to_move );
+			ready = move>=0 && move<100 && s_legal_move[move];
 			break;
 		}
 		(*env)->DeleteLocalRef(env, json_move);
@@ -157,10 +161,13 @@ droidzebra_msg_candidate_moves(void)
 	char buffer[128*60];
 	int buffer_pos = 0;
 
+	memset(s_legal_move, 0, sizeof(s_legal_move));
+
 	/* build list of alternative moves */
 	buffer_pos = sprintf(buffer, "{\"moves\":[ " );
 
 	for( i=0; i<move_count[disks_played]; i++ ) {
+		s_legal_move[move_list[disks_played][i]] = TRUE;
 		buffer_pos += sprintf(buffer+buffer_pos,
 				"{\"move\":%d},",
 				move_list[disks_played][i]
@@ -209,6 +216,7 @@ droidzebra_msg_game_start(void)
 void
 droidzebra_msg_game_over(void)
 {
+	memset(s_legal_move, 0, sizeof(s_legal_move));
 	droidzebra_message(MSG_GAME_OVER, NULL);
 }
 
@@ -0,0 +1,577 @@
+/*
+   File:         bench.c
+
+   Created:      October 19, 2026
+
+   Modified:
+
+   Contents:     Microbenchmarks for the kernels that dominate the
+                 search: the pattern evaluation, the hash table, the
+                 stability and mobility counts, the low-level endgame
+                 solver and the full endgame solver. The positions are
+                 generated by seeded random play, so every build
+                 times the same work. The report is written as JSON
+                 with one entry per kernel. The checksums are there
+                 to show that two builds computed the same results.
+*/
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bitbmob.h"
+#include "bitboard.h"
+#include "constant.h"
+#include "counter.h"
+#include "display.h"
+#include "end.h"
+#include "game.h"
+#include "getcoeff.h"
+#include "globals.h"
+#include "hash.h"
+#include "macros.h"
+#include "midgame.h"
+#include "moves.h"
+#include "myrandom.h"
+#include "search.h"
+#include "stable.h"
+#include "timer.h"
+#include "unflip.h"
+
+
+
+#define REPORT_VERSION        1
+
+#define DEFAULT_POSITIONS     1000
+#define DEFAULT_END_POSITIONS 20
+#define DEFAULT_END_EMPTIES   14
+#define HASH_BITS             20
+
+/* The number of times each position is run through the
+   cheap kernels */
+#define KERNEL_REPEATS        50
+
+#define HASH_KEYS             (1 << 16)
+#define HASH_ROUNDS           16
+
+/* The positions for SOLVE_PARITY; see LOW_LEVEL_DEPTH in end.c */
+#define SOLVE_EMPTIES         8
+
+#define MIN_EVAL_DISKS        8
+#define MAX_EVAL_DISKS        56
+
+
+
+typedef struct {
+  int board[64];
+  int disks_played;
+  int side_to_move;
+} Position;
+
+typedef struct {
+  const char *name;
+  double ops;
+  double nodes;  /* Negative unless the kernel is a search */
+  double seconds;
+  unsigned long long cycles;
+  long long checksum;
+} KernelResult;
+
+typedef struct {
+  double seconds;
+  unsigned long long cycles;
+} Stopwatch;
+
+
+
+/*
+   START_STOPWATCH
+   STOP_STOPWATCH
+   Measure the wall clock time and the processor cycles
+   spent between the two calls.
+*/
+
+static void
+start_stopwatch( Stopwatch *watch ) {
+  watch->seconds = get_real_timer();
+  watch->cycles = get_cycle_count();
+}
+
+
+static void
+stop_stopwatch( Stopwatch *watch, KernelResult *result ) {
+  result->cycles = get_cycle_count() - watch->cycles;
+  result->seconds = get_real_timer() - watch->seconds;
+}
+
+
+
+/*
+   RANDOM_POSITION
+   Plays random moves from the initial position until DISKS discs
+   have been played. Returns FALSE if the game ended first or if
+   nobody can move in the final position.
+*/
+
+static int
+random_position( Position *position, int disks ) {
+  int i, j;
+  int side_to_move;
+
+  game_init( NULL, &side_to_move );
+  while ( TRUE ) {
+    generate_all( side_to_move );
+    if ( move_count[disks_played] == 0 ) {
+      side_to_move = OPP( side_to_move );
+      generate_all( side_to_move );
+      if ( move_count[disks_played] == 0 )
+	return FALSE;
+    }
+    if ( disks_played == disks )
+      break;
+    (void) make_move( side_to_move,
+		      move_list[disks_played][(my_random() >> 4) %
+					      move_count[disks_played]],
+		      TRUE );
+    side_to_move = OPP( side_to_move );
+  }
+
+  for ( i = 1; i <= 8; i++ )
+    for ( j = 1; j <= 8; j++ )
+      position->board[8 * (i - 1) + (j - 1)] = board[10 * i + j];
+  position->disks_played = disks_played;
+  position->side_to_move = side_to_move;
+
+  return TRUE;
+}
+
+
+
+/*
+   MAKE_POSITIONS
+   Creates COUNT random positions with between MIN_DISKS and
+   MAX_DISKS discs played.
+*/
+
+static Position *
+make_positions( int count, int min_disks, int max_disks ) {
+  int i;
+  Position *position;
+
+  position = (Position *) malloc( count * sizeof( Position ) );
+  if ( position == NULL ) {
+    fputs( "Out of memory.\n", stderr );
+    exit( EXIT_FAILURE );
+  }
+  for ( i = 0; i < count; i++ )
+    while ( !random_position( &position[i],
+			      min_disks + i % (max_disks - min_disks + 1) ) )
+      ;
+
+  return position;
+}
+
+
+
+/*
+   LOAD_POSITION
+   Puts a position on the board and empties the flip stack.
+*/
+
+static void
+load_position( const Position *position ) {
+  int i, j;
+
+  for ( i = 1; i <= 8; i++ )
+    for ( j = 1; j <= 8; j++ )
+      board[10 * i + j] = position->board[8 * (i - 1) + (j - 1)];
+  disks_played = position->disks_played;
+  piece_count[BLACKSQ][disks_played] = disc_count( BLACKSQ );
+  piece_count[WHITESQ][disks_played] = disc_count( WHITESQ );
+  init_flip_stack();
+}
+
+
+
+/*
+   VERIFY_POSITION
+   Checks that the search KERNEL has left the board and the flip
+   stack as LOAD_POSITION set them up. If not, the kernel is
+   broken and its timings are meaningless, so bench stops.
+*/
+
+static void
+verify_position( const Position *position, const char *kernel ) {
+  int i, j;
+
+  for ( i = 1; i <= 8; i++ )
+    for ( j = 1; j <= 8; j++ )
+      if ( board[10 * i + j] != position->board[8 * (i - 1) + (j - 1)] ) {
+	fprintf( stderr, "%s did not restore the board.\n", kernel );
+	exit( EXIT_FAILURE );
+      }
+  if ( flip_stack != &global_flip_stack[0] ) {
+    fprintf( stderr, "%s did not restore the flip stack.\n", kernel );
+    exit( EXIT_FAILURE );
+  }
+}
+
+
+
+/*
+   BENCH_PATTERN_EVALUATION
+*/
+
+static void
+bench_pattern_evaluation( const Position *position, int count,
+			  KernelResult *result ) {
+  int i, j;
+  Stopwatch watch;
+
+  result->name = "pattern_evaluation";
+  result->checksum = 0;
+  start_stopwatch( &watch );
+  for ( i = 0; i < count; i++ ) {
+    load_position( &position[i] );
+    for ( j = 0; j < KERNEL_REPEATS; j++ )
+      result->checksum += pattern_evaluation( position[i].side_to_move );
+  }
+  stop_stopwatch( &watch, result );
+  result->ops = (double) count * KERNEL_REPEATS;
+}
+
+
+
+/*
+   BENCH_HASH
+   Times ADD_HASH on random keys into an empty table and then
+   FIND_HASH on the same keys.
+*/
+
+static void
+bench_hash( KernelResult *add_result, KernelResult *find_result ) {
+  int i, round;
+  unsigned int *key1, *key2;
+  HashEntry entry;
+  Stopwatch watch;
+
+  key1 = (unsigned int *) malloc( HASH_KEYS * sizeof( unsigned int ) );
+  key2 = (unsigned int *) malloc( HASH_KEYS * sizeof( unsigned int ) );
+  if ( (key1 == NULL) || (key2 == NULL) ) {
+    fputs( "Out of memory.\n", stderr );
+    exit( EXIT_FAILURE );
+  }
+  for ( i = 0; i < HASH_KEYS; i++ ) {
+    key1[i] = (my_random() << 3) ^ my_random();
+    key2[i] = (my_random() << 3) ^ my_random();
+  }
+  setup_hash( TRUE );
+
+  add_result->name = "add_hash";
+  add_result->checksum = 0;
+  start_stopwatch( &watch );
+  for ( round = 0; round < HASH_ROUNDS; round++ )
+    for ( i = 0; i < HASH_KEYS; i++ ) {
+      hash1 = key1[i];
+      hash2 = key2[i];
+      add_hash( MIDGAME_MODE, i & 63, 11 + (i & 7),
+		MIDGAME_SCORE | EXACT_VALUE, 1 + round, 0 );
+    }
+  stop_stopwatch( &watch, add_result );
+  add_result->ops = (double) HASH_ROUNDS * HASH_KEYS;
+
+  find_result->name = "find_hash";
+  find_result->checksum = 0;
+  start_stopwatch( &watch );
+  for ( round = 0; round < HASH_ROUNDS; round++ )
+    for ( i = 0; i < HASH_KEYS; i++ ) {
+      hash1 = key1[i];
+      hash2 = key2[i];
+      find_hash( &entry, MIDGAME_MODE );
+      find_result->checksum += entry.draft;
+    }
+  stop_stopwatch( &watch, find_result );
+  find_result->ops = (double) HASH_ROUNDS * HASH_KEYS;
+
+  free( key2 );
+  free( key1 );
+}
+
+
+
+/*
+   BENCH_BITBOARD_KERNELS
+   Times COUNT_STABLE and BITBOARD_MOBILITY, which both work on
+   the bitboards of a position.
+*/
+
+static void
+bench_bitboard_kernels( const Position *position, int count,
+			KernelResult *stable_result,
+			KernelResult *mobility_result ) {
+  int i, j;
+  BitBoard *my_bits, *opp_bits;
+  Stopwatch watch;
+
+  my_bits = (BitBoard *) malloc( count * sizeof( BitBoard ) );
+  opp_bits = (BitBoard *) malloc( count * sizeof( BitBoard ) );
+  if ( (my_bits == NULL) || (opp_bits == NULL) ) {
+    fputs( "Out of memory.\n", stderr );
+    exit( EXIT_FAILURE );
+  }
+  for ( i = 0; i < count; i++ ) {
+    load_position( &position[i] );
+    set_bitboards( board, position[i].side_to_move,
+		   &my_bits[i], &opp_bits[i] );
+  }
+
+  stable_result->name = "count_stable";
+  stable_result->checksum = 0;
+  start_stopwatch( &watch );
+  for ( j = 0; j < KERNEL_REPEATS; j++ )
+    for ( i = 0; i < count; i++ )
+      stable_result->checksum +=
+	count_stable( position[i].side_to_move, my_bits[i], opp_bits[i] );
+  stop_stopwatch( &watch, stable_result );
+  stable_result->ops = (double) count * KERNEL_REPEATS;
+
+  mobility_result->name = "bitboard_mobility";
+  mobility_result->checksum = 0;
+  start_stopwatch( &watch );
+  for ( j = 0; j < KERNEL_REPEATS; j++ )
+    for ( i = 0; i < count; i++ )
+      mobility_result->checksum +=
+	bitboard_mobility( my_bits[i], opp_bits[i] );
+  stop_stopwatch( &watch, mobility_result );
+  mobility_result->ops = (double) count * KERNEL_REPEATS;
+
+  free( opp_bits );
+  free( my_bits );
+}
+
+
+
+/*
+   BENCH_SOLVE_PARITY
+   Solves positions with SOLVE_EMPTIES empty squares with the
+   low-level solver alone.
+*/
+
+static void
+bench_solve_parity( const Position *position, int count,
+		    KernelResult *result ) {
+  int i;
+  Stopwatch watch;
+
+  result->name = "solve_parity";
+  result->checksum = 0;
+  result->nodes = 0.0;
+  start_stopwatch( &watch );
+  for ( i = 0; i < count; i++ ) {
+    load_position( &position[i] );
+    reset_counter( &nodes );
+    result->checksum +=
+      low_level_solve( position[i].side_to_move, -64, 64 );
+    result->nodes += counter_value( &nodes );
+    verify_position( &position[i], result->name );
+  }
+  stop_stopwatch( &watch, result );
+  result->ops = count;
+}
+
+
+
+/*
+   BENCH_END_GAME
+   Solves positions exactly with END_GAME, each with an empty
+   hash table.
+*/
+
+static void
+bench_end_game( const Position *position, int count,
+		KernelResult *result ) {
+  int i;
+  EvaluationType eval_info;
+  Stopwatch watch;
+
+  result->name = "end_game";
+  result->checksum = 0;
+  result->nodes = 0.0;
+  start_stopwatch( &watch );
+  for ( i = 0; i < count; i++ ) {
+    load_position( &position[i] );
+    generate_all( position[i].side_to_move );
+    setup_hash( TRUE );
+    determine_hash_values( position[i].side_to_move, board );
+    reset_counter( &nodes );
+    (void) end_game( position[i].side_to_move, FALSE, FALSE, FALSE, 0,
+		     &eval_info );
+    result->checksum += root_eval;
+    result->nodes += counter_value( &nodes );
+    verify_position( &position[i], result->name );
+  }
+  stop_stopwatch( &watch, result );
+  result->ops = count;
+}
+
+
+
+/*
+   WRITE_REPORT
+   Writes the results as a JSON document.
+*/
+
+static void
+write_report( FILE *stream, const KernelResult *result, int kernel_count,
+	      int seed, int position_count, int end_count,
+	      int end_empties ) {
+  int i;
+
+  fprintf( stream, "{\n" );
+  fprintf( stream, "  \"report\": \"zebra-bench\",\n" );
+  fprintf( stream, "  \"version\": %d,\n", REPORT_VERSION );
+  fprintf( stream, "  \"compiled\": \"%s %s\",\n", __DATE__, __TIME__ );
+  fprintf( stream, "  \"seed\": %d,\n", seed );
+  fprintf( stream, "  \"positions\": %d,\n", position_count );
+  fprintf( stream, "  \"end_positions\": %d,\n", end_count );
+  fprintf( stream, "  \"end_empties\": %d,\n", end_empties );
+  fprintf( stream, "  \"kernels\": [\n" );
+  for ( i = 0; i < kernel_count; i++ ) {
+    fprintf( stream, "    {\n" );
+    fprintf( stream, "      \"name\": \"%s\",\n", result[i].name );
+    fprintf( stream, "      \"ops\": %.0f,\n", result[i].ops );
+    fprintf( stream, "      \"seconds\": %.6f,\n", result[i].seconds );
+    fprintf( stream, "      \"ns_per_op\": %.2f,\n",
+	     1.0e9 * result[i].seconds / result[i].ops );
+    if ( result[i].cycles > 0 )
+      fprintf( stream, "      \"cycles_per_op\": %.1f,\n",
+	       result[i].cycles / result[i].ops );
+    else
+      fprintf( stream, "      \"cycles_per_op\": null,\n" );
+    if ( result[i].nodes >= 0.0 ) {
+      fprintf( stream, "      \"nodes\": %.0f,\n", result[i].nodes );
+      if ( result[i].seconds > 0.0 )
+	fprintf( stream, "      \"nodes_per_second\": %.0f,\n",
+		 result[i].nodes / result[i].seconds );
+      else
+	fprintf( stream, "      \"nodes_per_second\": null,\n" );
+    }
+    else {
+      fprintf( stream, "      \"nodes\": null,\n" );
+      fprintf( stream, "      \"nodes_per_second\": null,\n" );
+    }
+    fprintf( stream, "      \"checksum\": %lld\n", result[i].checksum );
+    fprintf( stream, "    }%s\n", (i < kernel_count - 1) ? "," : "" );
+  }
+  fprintf( stream, "  ]\n" );
+  fprintf( stream, "}\n" );
+}
+
+
+
+static void
+usage( void ) {
+  fputs( "Usage: bench [options]\n", stderr );
+  fputs( "  -seed <seed>           Seed for the positions (default 1)\n",
+	 stderr );
+  fputs( "  -positions <count>     Positions for the cheap kernels "
+	 "(default 1000)\n", stderr );
+  fputs( "  -end <count> <empty>   Positions and empty squares for "
+	 "end_game (default 20 14)\n", stderr );
+  fputs( "  -o <file>              Write the JSON report to a file "
+	 "instead of stdout\n", stderr );
+  fputs( "\nThe coefficient file must be in the current directory.\n",
+	 stderr );
+  exit( EXIT_FAILURE );
+}
+
+
+int
+main( int argc, char *argv[] ) {
+  const char *report_file_name;
+  int i;
+  int seed, position_count, end_count, end_empties;
+  int kernel_count;
+  KernelResult result[7];
+  Position *position;
+  FILE *stream;
+
+  seed = 1;
+  position_count = DEFAULT_POSITIONS;
+  end_count = DEFAULT_END_POSITIONS;
+  end_empties = DEFAULT_END_EMPTIES;
+  report_file_name = NULL;
+  for ( i = 1; i < argc; i++ ) {
+    if ( !strcmp( argv[i], "-seed" ) && (i + 1 < argc) )
+      seed = atoi( argv[++i] );
+    else if ( !strcmp( argv[i], "-positions" ) && (i + 1 < argc) )
+      position_count = atoi( argv[++i] );
+    else if ( !strcmp( argv[i], "-end" ) && (i + 2 < argc) ) {
+      end_count = atoi( argv[++i] );
+      end_empties = atoi( argv[++i] );
+    }
+    else if ( !strcmp( argv[i], "-o" ) && (i + 1 < argc) )
+      report_file_name = argv[++i];
+    else
+      usage();
+  }
+  if ( (position_count < 1) || (end_count < 1) ||
+       (end_empties < 1) || (end_empties > 40) )
+    usage();
+
+  global_setup( 0, HASH_BITS );
+  toggle_abort_check( FALSE );
+  toggle_perturbation_usage( FALSE );
+  echo = FALSE;
+
+  for ( i = 0; i < (int) (sizeof( result ) / sizeof( result[0] )); i++ )
+    result[i].nodes = -1.0;
+  kernel_count = 0;
+
+  my_srandom( seed );
+  position = make_positions( position_count, MIN_EVAL_DISKS,
+			     MAX_EVAL_DISKS );
+  fputs( "pattern_evaluation\n", stderr );
+  bench_pattern_evaluation( position, position_count,
+			    &result[kernel_count++] );
+  fputs( "add_hash, find_hash\n", stderr );
+  bench_hash( &result[kernel_count], &result[kernel_count + 1] );
+  kernel_count += 2;
+  fputs( "count_stable, bitboard_mobility\n", stderr );
+  bench_bitboard_kernels( position, position_count,
+			  &result[kernel_count], &result[kernel_count + 1] );
+  kernel_count += 2;
+  free( position );
+
+  position = make_positions( position_count, 60 - SOLVE_EMPTIES,
+			     60 - SOLVE_EMPTIES );
+  fputs( "solve_parity\n", stderr );
+  bench_solve_parity( position, position_count, &result[kernel_count++] );
+  free( position );
+
+  position = make_positions( end_count, 60 - end_empties,
+			     60 - end_empties );
+  fputs( "end_game\n", stderr );
+  bench_end_game( position, end_count, &result[kernel_count++] );
+  free( position );
+
+  if ( report_file_name != NULL ) {
+    stream = fopen( report_file_name, "w" );
+    if ( stream == NULL ) {
+      fprintf( stderr, "Cannot open %s for writing.\n", report_file_name );
+      exit( EXIT_FAILURE );
+    }
+  }
+  else
+    stream = stdout;
+  write_report( stream, result, kernel_count, seed, position_count,
+		end_count, end_empties );
+  if ( stream != stdout )
+    fclose( stream );
+
+  global_terminate();
+
+  return EXIT_SUCCESS;
+}
@@ -194,6 +194,17 @@ generate_all_c( const BitBoard my_bits,		// mm7
   return moves;
 }
 
+/*
+   BITBOARD_MOVES
+   Returns the squares where the player with MY_BITS can move.
+*/
+
+BitBoard
+bitboard_moves( const BitBoard my_bits,
+		const BitBoard opp_bits ) {
+  return generate_all_c( my_bits, opp_bits );
+}
+
 #ifdef USE_PENTIUM_ASM
 
 static void pseudo_mobility_mmx(unsigned int my_high, unsigned int opp_high) {
@@ -39,4 +39,10 @@ bitboard_mobility( const BitBoard my_bits,
 
 
 
+BitBoard
+bitboard_moves( const BitBoard my_bits,
+		const BitBoard opp_bits );
+
+
+
 #endif  /* BITBMOB_H */
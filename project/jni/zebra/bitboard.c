@@ -91,9 +91,13 @@ set_bitboards( int *board, int side_to_move,
 	       BitBoard *my_out, BitBoard *opp_out ) {
   int i, j;
   int pos;
+  int opp;
   unsigned int mask;
   BitBoard my_bits, opp_bits;
 
+  /* Branch-free, this is called at the root of every
+     fast_tree_search() */
+  opp = OPP( side_to_move );
   my_bits.high = 0;
   my_bits.low = 0;
   opp_bits.high = 0;
@@ -103,20 +107,16 @@ set_bitboards( int *board, int side_to_move,
   for ( i = 1; i <= 4; i++ )
     for ( j = 1; j <= 8; j++, mask <<= 1 ) {
       pos = 10 * i + j;
-      if ( board[pos] == side_to_move )
-	my_bits.low |= mask;
-      else if ( board[pos] == OPP( side_to_move ) )
-	opp_bits.low |= mask;
+      my_bits.low |= mask & -(unsigned int) (board[pos] == side_to_move);
+      opp_bits.low |= mask & -(unsigned int) (board[pos] == opp);
     }
 
   mask = 1;
   for ( i = 5; i <= 8; i++ )
     for ( j = 1; j <= 8; j++, mask <<= 1 ) {
       pos = 10 * i + j;
-      if ( board[pos] == side_to_move )
-	my_bits.high |= mask;
-      else if ( board[pos] == OPP( side_to_move ) )
-	opp_bits.high |= mask;
+      my_bits.high |= mask & -(unsigned int) (board[pos] == side_to_move);
+      opp_bits.high |= mask & -(unsigned int) (board[pos] == opp);
     }
 
   *my_out = my_bits;
@@ -208,14 +208,14 @@ static const unsigned int high_flip[56] = {
 #define bbFlips_Right_low(pos, mask)	\
   contig = right_contiguous[(opp_bits_low >> (pos + 1)) & mask];	\
   fl = 0x7F >> (6 - contig) << (pos + 1);				\
-  t = -(int)(my_bits_low & fl) >> 31;					\
+  t = 0u - ((my_bits_low & fl) != 0);					\
   my_bits_low |= fl & t;						\
   flipped = contig & t
 #else
 #define bbFlips_Right_low(pos, mask)	\
   contig = right_contiguous[(opp_bits_low >> (pos + 1)) & mask];	\
   fl = right_flip[contig] << (pos + 1);					\
-  t = -(int)(my_bits_low & fl) >> 31;					\
+  t = 0u - ((my_bits_low & fl) != 0);					\
   my_bits_low |= fl & t;						\
   flipped = contig & t
 #endif
@@ -223,7 +223,7 @@ static const unsigned int high_flip[56] = {
 #define bbFlips_Right_high(pos, mask)	\
   contig = right_contiguous[(opp_bits_high >> (pos + 1)) & mask];	\
   fl = right_flip[contig] << (pos + 1);					\
-  t = -(int)(my_bits_high & fl) >> 31;					\
+  t = 0u - ((my_bits_high & fl) != 0);					\
   my_bits_high |= fl & t;						\
   flipped = contig & t
 
@@ -231,14 +231,14 @@ static const unsigned int high_flip[56] = {
 #define bbFlips_Left_low(pos, mask)	\
   contig = left_contiguous[(opp_bits_low >> (pos - 6)) & mask];		\
   fl = (unsigned int)((int)0x80000000 >> contig) >> (32 - pos);		\
-  t = -(int)(my_bits_low & fl) >> 31;					\
+  t = 0u - ((my_bits_low & fl) != 0);					\
   my_bits_low |= fl & t;						\
   flipped = contig & t
 #else
 #define bbFlips_Left_low(pos, mask)	\
   contig = left_contiguous[(opp_bits_low >> (pos - 6)) & mask];		\
   fl = left_flip[contig] >> (32 - pos);					\
-  t = -(int)(my_bits_low & fl) >> 31;					\
+  t = 0u - ((my_bits_low & fl) != 0);					\
   my_bits_low |= fl & t;						\
   flipped = contig & t
 #endif
@@ -246,7 +246,7 @@ static const unsigned int high_flip[56] = {
 #define bbFlips_Left_high(pos, mask)	\
   contig = left_contiguous[(opp_bits_high >> (pos - 6)) & mask];	\
   fl = (unsigned int)((int)0x80000000 >> contig) >> (32 - pos);		\
-  t = -(int)(my_bits_high & fl) >> 31;					\
+  t = 0u - ((my_bits_high & fl) != 0);					\
   my_bits_high |= fl & t;						\
   flipped = contig & t
 
@@ -301,50 +301,50 @@ static const unsigned int high_flip[56] = {
 
 
 #define bbFlips_Down_1_low(pos, vec)	\
-  t = opp_bits_low & (my_bits_low >> vec) & (1 << (pos + vec));		\
+  t = opp_bits_low & (my_bits_low >> vec) & (1u << (pos + vec));		\
   my_bits_low |= t;							\
   flipped += t >> (pos + vec)
 
 #define bbFlips_Down_1_high(pos, vec)	\
-  t = opp_bits_high & (my_bits_high >> vec) & (1 << (pos + vec));	\
+  t = opp_bits_high & (my_bits_high >> vec) & (1u << (pos + vec));	\
   my_bits_high |= t;							\
   flipped += t >> (pos + vec)
 
 #define bbFlips_Up_1_low(pos, vec)	\
-  t = opp_bits_low & (my_bits_low << vec) & (1 << (pos - vec));		\
+  t = opp_bits_low & (my_bits_low << vec) & (1u << (pos - vec));		\
   my_bits_low |= t;							\
   flipped += t >> (pos - vec)
 
 #define bbFlips_Up_1_high(pos, vec)	\
-  t = opp_bits_high & (my_bits_high << vec) & (1 << (pos - vec));	\
+  t = opp_bits_high & (my_bits_high << vec) & (1u << (pos - vec));	\
   my_bits_high |= t;							\
   flipped += t >> (pos - vec)
 
 
 #if 1
 #define bbFlips_Down_2_low(pos, vec, mask)	\
-  if (opp_bits_low & (1 << (pos + vec))) {				\
+  if (opp_bits_low & (1u << (pos + vec))) {				\
     t = opp_bits_low & (my_bits_low >> vec) & mask;			\
     my_bits_low |= t + (t >> vec);					\
     flipped += ((t >> (pos + vec)) | (t >> (pos + vec * 2 - 1))) & 3;	\
   }
 
 #define bbFlips_Down_2_high(pos, vec, mask)	\
-  if (opp_bits_high & (1 << (pos + vec))) {				\
+  if (opp_bits_high & (1u << (pos + vec))) {				\
     t = opp_bits_high & (my_bits_high >> vec) & mask;			\
     my_bits_high |= t + (t >> vec);					\
     flipped += ((t >> (pos + vec)) | (t >> (pos + vec * 2 - 1))) & 3;	\
   }
 
 #define bbFlips_Up_2_low(pos, vec, mask)	\
-  if (opp_bits_low & (1 << (pos - vec))) {				\
+  if (opp_bits_low & (1u << (pos - vec))) {				\
     t = opp_bits_low & (my_bits_low << vec) & mask;			\
     my_bits_low |= t + (t << vec);					\
     flipped += ((t >> (pos - vec)) | (t >> (pos - vec * 2 - 1))) & 3;	\
   }
 
 #define bbFlips_Up_2_high(pos, vec, mask)	\
-  if (opp_bits_high & (1 << (pos - vec))) {				\
+  if (opp_bits_high & (1u << (pos - vec))) {				\
     t = opp_bits_high & (my_bits_high << vec) & mask;			\
     my_bits_high |= t + (t << vec);					\
     flipped += ((t >> (pos - vec)) | (t >> (pos - vec * 2 - 1))) & 3;	\
@@ -352,29 +352,29 @@ static const unsigned int high_flip[56] = {
 
 #else
 #define bbFlips_Down_2_low(pos, vec, mask)	\
-  t = opp_bits_low & ((opp_bits_low | (1 << pos)) << vec) & (my_bits_low >> vec) & mask;	\
+  t = opp_bits_low & ((opp_bits_low | (1u << pos)) << vec) & (my_bits_low >> vec) & mask;	\
   my_bits_low |= t + (t >> vec);					\
   flipped += ((t >> (pos + vec)) | (t >> (pos + vec * 2 - 1))) & 3
 
 #define bbFlips_Down_2_high(pos, vec, mask)	\
-  t = opp_bits_high & ((opp_bits_high | (1 << pos)) << vec) & (my_bits_high >> vec) & mask;	\
+  t = opp_bits_high & ((opp_bits_high | (1u << pos)) << vec) & (my_bits_high >> vec) & mask;	\
   my_bits_high |= t + (t >> vec);					\
   flipped += ((t >> (pos + vec)) | (t >> (pos + vec * 2 - 1))) & 3
 
 #define bbFlips_Up_2_low(pos, vec, mask)	\
-  t = opp_bits_low & ((opp_bits_low | (1 << pos)) >> vec) & (my_bits_low << vec) & mask;	\
+  t = opp_bits_low & ((opp_bits_low | (1u << pos)) >> vec) & (my_bits_low << vec) & mask;	\
   my_bits_low |= t + (t << vec);					\
   flipped += ((t >> (pos - vec)) | (t >> (pos - vec * 2 - 1))) & 3
 
 #define bbFlips_Up_2_high(pos, vec, mask)	\
-  t = opp_bits_high & ((opp_bits_high | (1 << pos)) >> vec) & (my_bits_high << vec) & mask;	\
+  t = opp_bits_high & ((opp_bits_high | (1u << pos)) >> vec) & (my_bits_high << vec) & mask;	\
   my_bits_high |= t + (t << vec);					\
   flipped += ((t >> (pos - vec)) | (t >> (pos - vec * 2 - 1))) & 3
 #endif
 
 
 #define bbFlips_Down_3_3(pos, vec, maskh, maskl)	\
-  if (opp_bits_low & (1 << (pos + vec))) {				\
+  if (opp_bits_low & (1u << (pos + vec))) {				\
     if ((~opp_bits_low & maskl) == 0) {					\
       t = (opp_bits_high >> (pos + vec * 4 - 32)) & 1;			\
       contig = 3 + t;							\
@@ -396,7 +396,7 @@ static const unsigned int high_flip[56] = {
   }
 
 #define bbFlips_Up_3_3(pos, vec, maskh, maskl)	\
-  if (opp_bits_high & (1 << (pos - vec))) {				\
+  if (opp_bits_high & (1u << (pos - vec))) {				\
     if ((~opp_bits_high & maskh) == 0) {				\
       t = (opp_bits_low >> (pos + 32 - vec * 4)) & 1;			\
       contig = 3 + t;							\
@@ -419,7 +419,7 @@ static const unsigned int high_flip[56] = {
 
 #if 1
 #define bbFlips_Down_3_2(pos, vec, maskh, maskl)	\
-  if (opp_bits_low & (1 << (pos + vec))) {				\
+  if (opp_bits_low & (1u << (pos + vec))) {				\
     if ((~opp_bits_low & maskl) == 0) {					\
       t = (opp_bits_high >> (pos + vec * 4 - 32)) & 1;			\
       contig = 3 + t;							\
@@ -439,11 +439,11 @@ static const unsigned int high_flip[56] = {
   }
 #else
 #define bbFlips_Down_3_2(pos, vec, maskh, maskl)	\
-  if (opp_bits_low & (1 << (pos + vec))) {				\
+  if (opp_bits_low & (1u << (pos + vec))) {				\
     if ((~opp_bits_low & maskl) == 0) {					\
       t = (opp_bits_high >> (pos + vec * 4 - 32)) & 1;			\
       contig = 3 + t;							\
-      fl = (t << (pos + vec * 5 - 32)) + (1 << (pos + vec * 4 - 32));	\
+      fl = (t << (pos + vec * 5 - 32)) + (1u << (pos + vec * 4 - 32));	\
       t &= (opp_bits_high >> (pos + vec * 5 - 32));			\
       contig += t;							\
       fl += (t << (pos + vec * 6 - 32));				\
@@ -461,7 +461,7 @@ static const unsigned int high_flip[56] = {
 #endif
 
 #define bbFlips_Up_3_2(pos, vec, maskh, maskl)	\
-  if (opp_bits_high & (1 << (pos - vec))) {				\
+  if (opp_bits_high & (1u << (pos - vec))) {				\
     if ((~opp_bits_high & maskh) == 0) {				\
       t = (opp_bits_low >> (pos + 32 - vec * 4)) & 1;			\
       contig = 3 + t;							\
@@ -481,11 +481,11 @@ static const unsigned int high_flip[56] = {
   }
 
 #define bbFlips_Down_3_1(pos, vec, maskl)	\
-  if (opp_bits_low & (1 << (pos + vec))) {				\
+  if (opp_bits_low & (1u << (pos + vec))) {				\
     if ((~opp_bits_low & maskl) == 0) {					\
       t = (opp_bits_high >> (pos + vec * 4 - 32)) & 1;			\
       contig = 3 + t;							\
-      t = (t << (pos + vec * 5 - 32)) | (1 << (pos + vec * 4 - 32));	\
+      t = (t << (pos + vec * 5 - 32)) | (1u << (pos + vec * 4 - 32));	\
       if (my_bits_high & t) {						\
         my_bits_high |= t;						\
         my_bits_low |= maskl;						\
@@ -499,11 +499,11 @@ static const unsigned int high_flip[56] = {
   }
 
 #define bbFlips_Up_3_1(pos, vec, maskh)	\
-  if (opp_bits_high & (1 << (pos - vec))) {				\
+  if (opp_bits_high & (1u << (pos - vec))) {				\
     if ((~opp_bits_high & maskh) == 0) {				\
       t = (opp_bits_low >> (pos + 32 - vec * 4)) & 1;			\
       contig = 3 + t;							\
-      t = (t << (pos + 32 - vec * 5)) | (1 << (pos + 32 - vec * 4));	\
+      t = (t << (pos + 32 - vec * 5)) | (1u << (pos + 32 - vec * 4));	\
       if (my_bits_low & t) {						\
         my_bits_low |= t;						\
         my_bits_high |= maskh;						\
@@ -517,7 +517,7 @@ static const unsigned int high_flip[56] = {
   }
 
 #define bbFlips_Down_3_0(pos, vec, maskl)	\
-  if (opp_bits_low & (1 << (pos + vec))) {				\
+  if (opp_bits_low & (1u << (pos + vec))) {				\
     if ((~opp_bits_low & maskl) == 0) {					\
       t = (int)(my_bits_high << (31 - (pos + vec * 4 - 32))) >> 31;	\
       my_bits_low |= maskl & t;						\
@@ -530,7 +530,7 @@ static const unsigned int high_flip[56] = {
   }
 
 #define bbFlips_Up_3_0(pos, vec, maskh)	\
-  if (opp_bits_high & (1 << (pos - vec))) {				\
+  if (opp_bits_high & (1u << (pos - vec))) {				\
     if ((~opp_bits_high & maskh) == 0) {				\
       t = (int)(my_bits_low << (31 - (pos + 32 - vec * 4))) >> 31;	\
       my_bits_high |= maskh & t;					\
@@ -544,8 +544,8 @@ static const unsigned int high_flip[56] = {
 
 
 #define bbFlips_Down_2_3(pos, vec, maskh)	\
-  if (opp_bits_low & (1 << (pos + vec))) {				\
-    if (opp_bits_low & (1 << (pos + vec * 2))) {			\
+  if (opp_bits_low & (1u << (pos + vec))) {				\
+    if (opp_bits_low & (1u << (pos + vec * 2))) {			\
       t = (opp_bits_high >> (pos + vec * 3 - 32)) & 1;			\
       contig = 2 + t;							\
       t &= (opp_bits_high >> (pos + vec * 4 - 32));			\
@@ -555,7 +555,7 @@ static const unsigned int high_flip[56] = {
       t = lsb_mask[contig - 2] & maskh;					\
       if (my_bits_high & t) {						\
         my_bits_high |= t;						\
-        my_bits_low |= (1 << (pos + vec)) | (1 << (pos + vec * 2));	\
+        my_bits_low |= (1u << (pos + vec)) | (1u << (pos + vec * 2));	\
         flipped += contig;						\
       }									\
     } else {								\
@@ -566,8 +566,8 @@ static const unsigned int high_flip[56] = {
   }
 
 #define bbFlips_Up_2_3(pos, vec, maskl)	\
-  if (opp_bits_high & (1 << (pos - vec))) {				\
-    if (opp_bits_high & (1 << (pos - vec * 2))) {			\
+  if (opp_bits_high & (1u << (pos - vec))) {				\
+    if (opp_bits_high & (1u << (pos - vec * 2))) {			\
       t = (opp_bits_low >> (pos + 32 - vec * 3)) & 1;			\
       contig = 2 + t;							\
       t &= (opp_bits_low >> (pos + 32 - vec * 4));			\
@@ -577,7 +577,7 @@ static const unsigned int high_flip[56] = {
       t = msb_mask[contig - 2] & maskl;					\
       if (my_bits_low & t) {						\
         my_bits_low |= t;						\
-        my_bits_high |= (1 << (pos - vec)) | (1 << (pos - vec * 2));	\
+        my_bits_high |= (1u << (pos - vec)) | (1u << (pos - vec * 2));	\
         flipped += contig;						\
       }									\
     } else {								\
@@ -588,8 +588,8 @@ static const unsigned int high_flip[56] = {
   }
 
 #define bbFlips_Down_2_2(pos, vec, maskh)	\
-  if (opp_bits_low & (1 << (pos + vec))) {				\
-    if (opp_bits_low & (1 << (pos + vec * 2))) {			\
+  if (opp_bits_low & (1u << (pos + vec))) {				\
+    if (opp_bits_low & (1u << (pos + vec * 2))) {			\
       t = (opp_bits_high >> (pos + vec * 3 - 32)) & 1;			\
       contig = 2 + t;							\
       t &= (opp_bits_high >> (pos + vec * 4 - 32));			\
@@ -597,7 +597,7 @@ static const unsigned int high_flip[56] = {
       t = lsb_mask[contig - 2] & maskh;					\
       if (my_bits_high & t) {						\
         my_bits_high |= t;						\
-        my_bits_low |= (1 << (pos + vec)) | (1 << (pos + vec * 2));	\
+        my_bits_low |= (1u << (pos + vec)) | (1u << (pos + vec * 2));	\
         flipped += contig;						\
       }									\
     } else {								\
@@ -608,8 +608,8 @@ static const unsigned int high_flip[56] = {
   }
 
 #define bbFlips_Up_2_2(pos, vec, maskl)	\
-  if (opp_bits_high & (1 << (pos - vec))) {				\
-    if (opp_bits_high & (1 << (pos - vec * 2))) {			\
+  if (opp_bits_high & (1u << (pos - vec))) {				\
+    if (opp_bits_high & (1u << (pos - vec * 2))) {			\
       t = (opp_bits_low >> (pos + 32 - vec * 3)) & 1;			\
       contig = 2 + t;							\
       t &= (opp_bits_low >> (pos + 32 - vec * 4));			\
@@ -617,7 +617,7 @@ static const unsigned int high_flip[56] = {
       t = msb_mask[contig - 2] & maskl;					\
       if (my_bits_low & t) {						\
         my_bits_low |= t;						\
-        my_bits_high |= (1 << (pos - vec)) | (1 << (pos - vec * 2));	\
+        my_bits_high |= (1u << (pos - vec)) | (1u << (pos - vec * 2));	\
         flipped += contig;						\
       }									\
     } else {								\
@@ -628,14 +628,14 @@ static const unsigned int high_flip[56] = {
   }
 
 #define bbFlips_Down_2_1(pos, vec)	\
-  if (opp_bits_low & (1 << (pos + vec))) {				\
-    if (opp_bits_low & (1 << (pos + vec * 2))) {			\
+  if (opp_bits_low & (1u << (pos + vec))) {				\
+    if (opp_bits_low & (1u << (pos + vec * 2))) {			\
       t = (opp_bits_high >> (pos + vec * 3 - 32)) & 1;			\
       contig = 2 + t;							\
-      t = (t << (pos + vec * 4 - 32)) | (1 << (pos + vec * 3 - 32));	\
+      t = (t << (pos + vec * 4 - 32)) | (1u << (pos + vec * 3 - 32));	\
       if (my_bits_high & t) {						\
         my_bits_high |= t;						\
-        my_bits_low |= (1 << (pos + vec)) | (1 << (pos + vec * 2));	\
+        my_bits_low |= (1u << (pos + vec)) | (1u << (pos + vec * 2));	\
         flipped += contig;						\
       }									\
     } else {								\
@@ -646,14 +646,14 @@ static const unsigned int high_flip[56] = {
   }
 
 #define bbFlips_Up_2_1(pos, vec)	\
-  if (opp_bits_high & (1 << (pos - vec))) {				\
-    if (opp_bits_high & (1 << (pos - vec * 2))) {			\
+  if (opp_bits_high & (1u << (pos - vec))) {				\
+    if (opp_bits_high & (1u << (pos - vec * 2))) {			\
       t = (opp_bits_low >> (pos + 32 - vec * 3)) & 1;			\
       contig = 2 + t;							\
-      t = (t << (pos + 32 - vec * 4)) | (1 << (pos + 32 - vec * 3));	\
+      t = (t << (pos + 32 - vec * 4)) | (1u << (pos + 32 - vec * 3));	\
       if (my_bits_low & t) {						\
         my_bits_low |= t;						\
-        my_bits_high |= (1 << (pos - vec)) | (1 << (pos - vec * 2));	\
+        my_bits_high |= (1u << (pos - vec)) | (1u << (pos - vec * 2));	\
         flipped += contig;						\
       }									\
     } else {								\
@@ -664,14 +664,14 @@ static const unsigned int high_flip[56] = {
   }
 
 #define bbFlips_Down_2_0(pos, vec, mask)	\
-  if (opp_bits_low & (1 << (pos + vec))) {				\
+  if (opp_bits_low & (1u << (pos + vec))) {				\
     t = opp_bits_low & ((my_bits_low >> vec) | (my_bits_high << (32 - vec))) & mask;	\
     my_bits_low |= t + (t >> vec);					\
     flipped += ((t >> (pos + vec)) | (t >> (pos + vec * 2 - 1))) & 3;	\
   }
 
 #define bbFlips_Up_2_0(pos, vec, mask)	\
-  if (opp_bits_high & (1 << (pos - vec))) {				\
+  if (opp_bits_high & (1u << (pos - vec))) {				\
     t = opp_bits_high & ((my_bits_high << vec) | (my_bits_low >> (32 - vec))) & mask;	\
     my_bits_high |= t + (t << vec);					\
     flipped += ((t >> (pos - vec)) | (t >> (pos - vec * 2 - 1))) & 3;	\
@@ -679,7 +679,7 @@ static const unsigned int high_flip[56] = {
 
 
 #define bbFlips_Down_1_3(pos, vec, maskh)	\
-  if (opp_bits_low & (1 << (pos + vec))) {				\
+  if (opp_bits_low & (1u << (pos + vec))) {				\
     t = (opp_bits_high >> (pos + vec * 2 - 32)) & 1;			\
     contig = 1 + t;							\
     t &= (opp_bits_high >> (pos + vec * 3 - 32));			\
@@ -689,13 +689,13 @@ static const unsigned int high_flip[56] = {
     t = lsb_mask[contig - 1] & maskh;					\
     if (my_bits_high & t) {						\
       my_bits_high |= t;						\
-      my_bits_low |= 1 << (pos + vec);					\
+      my_bits_low |= 1u << (pos + vec);					\
       flipped += contig;						\
     }									\
   }
 
 #define bbFlips_Up_1_3(pos, vec, maskl)	\
-  if (opp_bits_high & (1 << (pos - vec))) {				\
+  if (opp_bits_high & (1u << (pos - vec))) {				\
     t = (opp_bits_low >> (pos + 32 - vec * 2)) & 1;			\
     contig = 1 + t;							\
     t &= (opp_bits_low >> (pos + 32 - vec * 3));			\
@@ -705,13 +705,13 @@ static const unsigned int high_flip[56] = {
     t = msb_mask[contig - 1] & maskl;					\
     if (my_bits_low & t) {						\
       my_bits_low |= t;							\
-      my_bits_high |= 1 << (pos - vec);					\
+      my_bits_high |= 1u << (pos - vec);					\
       flipped += contig;						\
     }									\
   }
 
 #define bbFlips_Down_1_2(pos, vec, maskh)	\
-  if (opp_bits_low & (1 << (pos + vec))) {				\
+  if (opp_bits_low & (1u << (pos + vec))) {				\
     t = (opp_bits_high >> (pos + vec * 2 - 32)) & 1;			\
     contig = 1 + t;							\
     t &= (opp_bits_high >> (pos + vec * 3 - 32));			\
@@ -719,13 +719,13 @@ static const unsigned int high_flip[56] = {
     t = lsb_mask[contig - 1] & maskh;					\
     if (my_bits_high & t) {						\
       my_bits_high |= t;						\
-      my_bits_low |= 1 << (pos + vec);					\
+      my_bits_low |= 1u << (pos + vec);					\
       flipped += contig;						\
     }									\
   }
 
 #define bbFlips_Up_1_2(pos, vec, maskl)	\
-  if (opp_bits_high & (1 << (pos - vec))) {				\
+  if (opp_bits_high & (1u << (pos - vec))) {				\
     t = (opp_bits_low >> (pos + 32 - vec * 2)) & 1;			\
     contig = 1 + t;							\
     t &= (opp_bits_low >> (pos + 32 - vec * 3));			\
@@ -733,96 +733,96 @@ static const unsigned int high_flip[56] = {
     t = msb_mask[contig - 1] & maskl;					\
     if (my_bits_low & t) {						\
       my_bits_low |= t;							\
-      my_bits_high |= 1 << (pos - vec);					\
+      my_bits_high |= 1u << (pos - vec);					\
       flipped += contig;						\
     }									\
   }
 
 #define bbFlips_Down_1_1(pos, vec)	\
-  if (opp_bits_low & (1 << (pos + vec))) {				\
-    fl = (my_bits_high << (32 - vec)) & (1 << (pos + vec));		\
-    t = opp_bits_high & (my_bits_high >> vec) & (1 << (pos + vec * 2 - 32));	\
+  if (opp_bits_low & (1u << (pos + vec))) {				\
+    fl = (my_bits_high << (32 - vec)) & (1u << (pos + vec));		\
+    t = opp_bits_high & (my_bits_high >> vec) & (1u << (pos + vec * 2 - 32));	\
     my_bits_low |= fl + (t << (32 - vec));				\
     my_bits_high |= t;							\
     flipped += ((fl >> (pos + vec)) | (t >> (pos + vec * 2 - 32 - 1)));	\
   }
 
 #define bbFlips_Up_1_1(pos, vec)	\
-  if (opp_bits_high & (1 << (pos - vec))) {				\
-    fl = (my_bits_low >> (32 - vec)) & (1 << (pos - vec));		\
-    t = opp_bits_low & (my_bits_low << vec) & (1 << (pos + 32 - vec * 2));	\
+  if (opp_bits_high & (1u << (pos - vec))) {				\
+    fl = (my_bits_low >> (32 - vec)) & (1u << (pos - vec));		\
+    t = opp_bits_low & (my_bits_low << vec) & (1u << (pos + 32 - vec * 2));	\
     my_bits_high |= fl + (t >> (32 - vec));				\
     my_bits_low |= t;							\
     flipped += ((fl >> (pos - vec)) | (t >> (pos + 32 - vec * 2 - 1)));	\
   }
 
 #define bbFlips_Down_1_0(pos, vec)	\
-  t = opp_bits_low & (my_bits_high << (32 - vec)) & (1 << (pos + vec));	\
+  t = opp_bits_low & (my_bits_high << (32 - vec)) & (1u << (pos + vec));	\
   my_bits_low |= t;							\
   flipped += t >> (pos + vec)
 
 #define bbFlips_Up_1_0(pos, vec)	\
-  t = opp_bits_high & (my_bits_low >> (32 - vec)) & (1 << (pos - vec));	\
+  t = opp_bits_high & (my_bits_low >> (32 - vec)) & (1u << (pos - vec));	\
   my_bits_high |= t;							\
   flipped += t >> (pos - vec)
 
 
 #if 1
 #define bbFlips_Down_0_3(pos, vec, mask)	\
-  if (opp_bits_high & (1 << (pos + vec - 32))) {			\
+  if (opp_bits_high & (1u << (pos + vec - 32))) {			\
     t = (opp_bits_high >> (pos + vec * 2 - 32)) & 1;			\
     contig = 1 + t;							\
     t &= (opp_bits_high >> (pos + vec * 3 - 32));			\
     contig += t;							\
     fl = lsb_mask[contig] & mask;					\
-    t = -(int)(my_bits_high & fl) >> 31;				\
+    t = 0u - ((my_bits_high & fl) != 0);				\
     my_bits_high |= fl & t;						\
     flipped += contig & t;						\
   }
 #else
 #define bbFlips_Down_0_3(pos, vec, mask)	\
-  if (opp_bits_high & (1 << (pos + vec - 32))) {			\
-    t = opp_bits_high & (1 << (pos + vec * 2 - 32));			\
-    fl = t + (1 << (pos + vec - 32));					\
+  if (opp_bits_high & (1u << (pos + vec - 32))) {			\
+    t = opp_bits_high & (1u << (pos + vec * 2 - 32));			\
+    fl = t + (1u << (pos + vec - 32));					\
     contig = 1 + (t >> (pos + vec * 2 - 32));				\
     t = opp_bits_high & (t << vec);					\
     fl += t;								\
     contig += (t >> (pos + vec * 3 - 32));				\
-    t = -(int)(my_bits_high & (fl << vec)) >> 31;			\
+    t = 0u - ((my_bits_high & (fl << vec)) != 0);			\
     my_bits_high |= fl & t;						\
     flipped += contig & t;						\
   }
 #endif
 
 #define bbFlips_Up_0_3(pos, vec, mask)	\
-  if (opp_bits_low & (1 << (pos + 32 - vec))) {				\
+  if (opp_bits_low & (1u << (pos + 32 - vec))) {				\
     t = (opp_bits_low >> (pos + 32 - vec * 2)) & 1;			\
     contig = 1 + t;							\
     t &= (opp_bits_low >> (pos + 32 - vec * 3));			\
     contig += t;							\
     fl = msb_mask[contig] & mask;					\
-    t = -(int)(my_bits_low & fl) >> 31;					\
+    t = 0u - ((my_bits_low & fl) != 0);					\
     my_bits_low |= fl & t;						\
     flipped += contig & t;						\
   }
 
 #define bbFlips_Down_0_2(pos, vec, mask)	\
-  t = opp_bits_high & ((opp_bits_high << vec) | (1 << (pos + vec - 32))) & (my_bits_high >> vec) & mask;	\
+  t = opp_bits_high & ((opp_bits_high << vec) | (1u << (pos + vec - 32))) & (my_bits_high >> vec) & mask;	\
   my_bits_high |= t + (t >> vec);					\
   flipped += ((t >> (pos + vec - 32)) | (t >> (pos + vec * 2 - 32 - 1))) & 3
 
 #define bbFlips_Up_0_2(pos, vec, mask)	\
-  t = opp_bits_low & ((opp_bits_low >> vec) | (1 << (pos + 32 - vec))) & (my_bits_low << vec) & mask;	\
+  t = opp_bits_low & ((opp_bits_low >> vec) | (1u << (pos + 32 - vec))) & (my_bits_low << vec) & mask;	\
   my_bits_low |= t + (t << vec);					\
   flipped += ((t >> (pos + 32 - vec)) | (t >> (pos + 32 - vec * 2 - 1))) & 3
 
 #define bbFlips_Down_0_1(pos, vec)	\
-  t = opp_bits_high & (my_bits_high >> vec) & (1 << (pos + vec - 32));	\
+  t = opp_bits_high & (my_bits_high >> vec) & (1u << (pos + vec - 32));	\
   my_bits_high |= t;							\
   flipped += t >> (pos + vec - 32)
 
 #define bbFlips_Up_0_1(pos, vec)	\
-  t = opp_bits_low & (my_bits_low << vec) & (1 << (pos + 32 - vec));	\
+  t = opp_bits_low & (my_bits_low << vec) & (1u << (pos + 32 - vec));	\
   my_bits_low |= t;							\
   flipped += t >> (pos + 32 - vec)
 
@@ -846,7 +846,7 @@ TestFlips_bitboard_a1( unsigned int my_bits_high, unsigned int my_bits_low, unsi
     contig = right_contiguous[(((opp_bits_low & 0x01010100u) + ((opp_bits_high & 0x00010101u) << 4)) * 0x01020408u) >> 25];
     fh = top_flip[contig + 1].high & 0x01010101u;
     fl = top_flip[contig + 1].low & 0x01010100u;
-    t = -(int)((my_bits_low & fl) | (my_bits_high & fh)) >> 31;
+    t = 0u - (((my_bits_low & fl) | (my_bits_high & fh)) != 0);
     my_bits_high |= fh & t;
     my_bits_low |= fl & t;
     flipped += contig & t;
@@ -856,7 +856,7 @@ TestFlips_bitboard_a1( unsigned int my_bits_high, unsigned int my_bits_low, unsi
     contig = right_contiguous[(((opp_bits_low & 0x08040200u) + (opp_bits_high & 0x00402010u)) * 0x01010101u) >> 25];
     fh = top_flip[contig + 1].high & 0x80402010u;
     fl = top_flip[contig + 1].low & 0x08040200u;
-    t = -(int)((my_bits_low & fl) | (my_bits_high & fh)) >> 31;
+    t = 0u - (((my_bits_low & fl) | (my_bits_high & fh)) != 0);
     my_bits_high |= fh & t;
     my_bits_low |= fl & t;
     flipped += contig & t;
@@ -878,14 +878,14 @@ TestFlips_bitboard_a1( unsigned int my_bits_high, unsigned int my_bits_low, unsi
         flipped += contig;
       }
  #else
-      t = -(int)(my_bits_high & fl) >> 31;
+      t = 0u - ((my_bits_high & fl) != 0);
       my_bits_high |= fl & t;
       my_bits_low |= 0x01010100u & t;
       flipped += contig & t;
  #endif
     } else {
       fl = lsb_mask[contig + 1] & 0x01010100u;
-      t = -(int)(my_bits_low & fl) >> 31;
+      t = 0u - ((my_bits_low & fl) != 0);
       my_bits_low |= fl & t;
       flipped += contig & t;
     }
@@ -906,14 +906,14 @@ TestFlips_bitboard_a1( unsigned int my_bits_high, unsigned int my_bits_low, unsi
         flipped += contig;
       }
  #else
-      t = -(int)(my_bits_high & fl) >> 31;
+      t = 0u - ((my_bits_high & fl) != 0);
       my_bits_high |= fl & t;
       my_bits_low |= 0x08040200u & t;
       flipped += contig & t;
  #endif
     } else {
       fl = lsb_mask[contig + 1] & 0x08040200u;
-      t = -(int)(my_bits_low & fl) >> 31;
+      t = 0u - ((my_bits_low & fl) != 0);
       my_bits_low |= fl & t;
       flipped += contig & t;
     }
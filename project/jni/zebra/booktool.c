@@ -117,6 +117,25 @@ main( int argc, char *argv[] ) {
       max_game_count = atoi( argv[++arg_index] );
       build_tree( import_file_name, max_game_count, max_diff, cutoff );
     }
+    else if ( !strcasecmp( argv[arg_index], "-ib" ) ) {
+      import_games = TRUE;
+      import_file_name = argv[++arg_index];
+      max_game_count = atoi( argv[++arg_index] );
+      bulk_build_tree( import_file_name, max_game_count, max_diff, cutoff );
+    }
+    else if ( !strcasecmp( argv[arg_index], "-learn" ) ) {
+      int batch_size, max_full_solve, max_wld_solve;
+
+      import_games = TRUE;
+      import_file_name = argv[++arg_index];
+      batch_size = atoi( argv[++arg_index] );
+      max_full_solve = atoi( argv[++arg_index] );
+      max_wld_solve = atoi( argv[++arg_index] );
+      learn_game_list( import_file_name, batch_size, cutoff,
+		       max_full_solve, max_wld_solve,
+		       (output_database && !output_compressed) ?
+		       output_file_name : NULL, output_binary );
+    }
     else if ( !strcasecmp( argv[arg_index], "-r" ) ||
 	      !strcasecmp( argv[arg_index], "-rb" ) ) {
       if ( input_database ) {
@@ -208,6 +227,10 @@ main( int argc, char *argv[] ) {
     }
     else if ( !strcasecmp( argv[arg_index], "-script" ) )
       set_output_script_name( argv[++arg_index] );
+    else if ( !strcasecmp( argv[arg_index], "-workers" ) )
+      set_book_workers( atoi( argv[++arg_index] ) );
+    else if ( !strcasecmp( argv[arg_index], "-checkpoint" ) )
+      set_correction_checkpoint( argv[++arg_index] );
     else if ( !strcasecmp( argv[arg_index], "-private" ) )
       set_game_mode( PRIVATE_GAME );
     else if ( !strcasecmp( argv[arg_index], "-public" ) )
@@ -268,6 +291,8 @@ main( int argc, char *argv[] ) {
   if ( error || give_help ) {
     puts( "Usage:" );
     puts( "  osf [-i <game file> <max #games>]" );
+    puts( "      [-ib <game file> <max #games>]" );
+    puts( "      [-learn <game file> <batch size> <exact> <wld>]" );
     puts( "      [-r <database> | -rb <database>]" );
     puts( "      [-w <database> | -wb <database> | -wc <database>]" );
     puts( "      [-uc <compressed file> <binary database>]" );
@@ -279,6 +304,7 @@ main( int argc, char *argv[] ) {
     puts( "      [-negspan <min> <max>] [-evalspan <min> <max>]" );
     puts( "      [-end <max empty> <full>]" );
     puts( "      [-script <script name>]" );
+    puts( "      [-workers <count>] [-checkpoint <file>]" );
     puts( "      [-private] [-public]" );
     puts( "      [-keepdraw] [-draw2black] [-draw2white] [-draw2none]" );
     puts( "      [-opgen <opening list file>]" );
@@ -296,6 +322,14 @@ main( int argc, char *argv[] ) {
       puts( "Flags:" );
       puts( "  -i        Imports the game list in <game file>. "
 	    "At most <#games> are loaded." );
+      puts( "  -ib       Like -i, but hashes and solves the games in shards" );
+      puts( "            using the worker processes given by -workers." );
+      puts( "  -learn    Learns the games in <game file> with deviation searches" );
+      puts( "            to the '-l' depth, solving the last <exact> moves" );
+      puts( "            exactly and the last <wld> moves for win/loss/draw." );
+      puts( "            The searches of <batch size> games are shared by" );
+      puts( "            the workers and a preceding '-w' or '-wb' database" );
+      puts( "            is saved after each batch." );
       puts( "  -r/rb     Reads a database as text (-r) or binary (-rb)." );
       printf( "  -c        Import games up to <cutoff> empties. "
               "(Default: %d)\n", DEFAULT_CUTOFF );
@@ -325,6 +359,10 @@ main( int argc, char *argv[] ) {
       puts( "  -end      Corrects all nodes with <= <empty> disks." );
       puts( "            <full>=0 ==> WLD, otherwise exact score." );
       puts( "  -script   With -end: Positions are written to <script file>." );
+      puts( "  -workers  With -end and subsequent '-ib' and '-learn' commands:" );
+      puts( "            Use <count> worker processes." );
+      puts( "  -checkpoint  With -end: Save solved positions to <file> and" );
+      puts( "            resume from the positions already there." );
       puts( "  -private  Treats all draws as losses for both sides "
 	    "(default)." );
       puts( "  -public   No tweaking of draw scores." );
@@ -3,7 +3,7 @@
 
    Created:       March 29, 1999
 
-   Modified:      December 25, 1999
+   Modified:      October 19, 2026
    
    Author:        Gunnar Andersson (gunnar@radagast.se)
 
@@ -21,14 +21,19 @@
 
 
 
-#define INCREMENT_COUNTER( counter )              counter.lo++
-#define INCREMENT_COUNTER_BY( counter, term )     counter.lo += (term)
+#define INCREMENT_COUNTER( counter )              counter.count++
+#define INCREMENT_COUNTER_BY( counter, term )     counter.count += (term)
 
 
 
+/* A 64-bit count never needs normalizing; it wraps after ~10^19 nodes.
+   Counters are not atomic: the search counters belong to the thread
+   running the search. While pondering that is the worker thread, and
+   the front-end reads them only once FINISH_PONDER has joined it;
+   status messages sent meanwhile carry copies of the counts. */
+
 typedef struct {
-  unsigned int hi;
-  unsigned int lo;
+  unsigned long long count;
 } CounterType;
 
 
@@ -37,13 +42,10 @@ void
 reset_counter( CounterType *counter );
 
 double
-counter_value( CounterType *counter );
-
-void
-adjust_counter( CounterType *counter );
+counter_value( const CounterType *counter );
 
 void
-add_counter( CounterType *sum, CounterType *term );
+add_counter( CounterType *sum, const CounterType *term );
 
 
 
@@ -38,8 +38,10 @@
 #include "midgame.h"
 #include "moves.h"
 #include "osfbook.h"
+#include "ponder.h"
 #include "probcut.h"
 #include "search.h"
+#include "searchstat.h"
 #include "stable.h"
 #include "texts.h"
 #include "timer.h"
@@ -87,25 +89,6 @@
 
 
 
-#if 0
-
-// Profiling code
-
-static long long int
-rdtsc( void ) {
-#if defined(__GNUC__)
-  long long a;
-  asm volatile("rdtsc":"=A" (a));
-  return a;
-#else
-  return 0;
-#endif
-}
-
-#endif
-
-
-
 typedef enum {
   NOTHING,
   SELECTIVE_SCORE,
@@ -306,6 +289,7 @@ solve_two_empty( BitBoard my_bits,
   int ev;
 
   INCREMENT_COUNTER( nodes );
+  STAT_END_NODE( 2 );
 
   /* Overall strategy: Lazy evaluation whenever possible, i.e., don't
      update bitboards until they are used. Also look at alpha and beta
@@ -317,6 +301,7 @@ solve_two_empty( BitBoard my_bits,
   flipped = TestFlips_wrapper( sq1, my_bits, opp_bits );
   if ( flipped != 0 ) {  /* SQ1 feasible for me */
     INCREMENT_COUNTER( nodes );
+    STAT_END_NODE( 1 );
 
     ev = disc_diff + 2 * flipped;
 
@@ -379,6 +364,7 @@ solve_two_empty( BitBoard my_bits,
   flipped = TestFlips_wrapper( sq2, my_bits, opp_bits );
   if ( flipped != 0 ) {  /* SQ2 feasible for me */
     INCREMENT_COUNTER( nodes );
+    STAT_END_NODE( 1 );
 
     ev = disc_diff + 2 * flipped;
 #if 0
@@ -469,6 +455,7 @@ solve_three_empty( BitBoard my_bits,
   int ev;
 
   INCREMENT_COUNTER( nodes );
+  STAT_END_NODE( 3 );
 
   flipped = TestFlips_wrapper( sq1, my_bits, opp_bits );
   if ( flipped != 0 ) {
@@ -543,6 +530,7 @@ solve_four_empty( BitBoard my_bits,
   int ev;
 
   INCREMENT_COUNTER( nodes );
+  STAT_END_NODE( 4 );
 
   flipped = TestFlips_wrapper( sq1, my_bits, opp_bits );
   if ( flipped != 0 ) {
@@ -633,6 +621,7 @@ solve_parity( BitBoard my_bits,
   unsigned int parity_mask;
 
   INCREMENT_COUNTER( nodes );
+  STAT_END_NODE( empties );
 
   /* Check for stability cutoff */
 
@@ -640,13 +629,17 @@ solve_parity( BitBoard my_bits,
   if ( alpha >= stability_threshold[empties] ) {
     int stability_bound;
     stability_bound = 64 - 2 * count_edge_stable( oppcol, opp_bits, my_bits );
-    if ( stability_bound <= alpha )
+    if ( stability_bound <= alpha ) {
+      STAT_INCREMENT( stability_cutoffs );
       return alpha;
+    }
     stability_bound = 64 - 2 * count_stable( oppcol, opp_bits, my_bits );
     if ( stability_bound < beta )
       beta = stability_bound + 1;
-    if ( stability_bound <= alpha )
+    if ( stability_bound <= alpha ) {
+      STAT_INCREMENT( stability_cutoffs );
       return alpha;
+    }
   }
 #endif
 
@@ -782,6 +775,7 @@ solve_parity_hash( BitBoard my_bits,
   HashEntry entry;
 
   INCREMENT_COUNTER( nodes );
+  STAT_END_NODE( empties );
 
   find_hash( &entry, ENDGAME_MODE );
   if ( (entry.draft == empties) &&
@@ -792,6 +786,7 @@ solve_parity_hash( BitBoard my_bits,
 	((entry.flags & LOWER_BOUND) && entry.eval >= beta) ||
 	((entry.flags & UPPER_BOUND) && entry.eval <= alpha)) ) {
     best_move = entry.move[0];
+    STAT_INCREMENT( end_hash_cutoffs );
     return entry.eval;
   }
 
@@ -802,13 +797,17 @@ solve_parity_hash( BitBoard my_bits,
     int stability_bound;
 
     stability_bound = 64 - 2 * count_edge_stable( oppcol, opp_bits, my_bits );
-    if ( stability_bound <= alpha )
+    if ( stability_bound <= alpha ) {
+      STAT_INCREMENT( stability_cutoffs );
       return alpha;
+    }
     stability_bound = 64 - 2 * count_stable( oppcol, opp_bits, my_bits );
     if ( stability_bound < beta )
        beta = stability_bound + 1;
-    if ( stability_bound <= alpha )
+    if ( stability_bound <= alpha ) {
+      STAT_INCREMENT( stability_cutoffs );
       return alpha;
+    }
   }
 #endif
 
@@ -978,6 +977,7 @@ solve_parity_hash_high( BitBoard my_bits,
   HashEntry entry;
 
   INCREMENT_COUNTER( nodes );
+  STAT_END_NODE( empties );
 
   hash_move = -1;
   find_hash( &entry, ENDGAME_MODE );
@@ -989,6 +989,7 @@ solve_parity_hash_high( BitBoard my_bits,
 	  ((entry.flags & LOWER_BOUND) && entry.eval >= beta) ||
 	  ((entry.flags & UPPER_BOUND) && entry.eval <= alpha)) ) {
       best_move = entry.move[0];
+      STAT_INCREMENT( end_hash_cutoffs );
       return entry.eval;
     }
   }
@@ -1000,13 +1001,17 @@ solve_parity_hash_high( BitBoard my_bits,
     int stability_bound;
 
     stability_bound = 64 - 2 * count_edge_stable( oppcol, opp_bits, my_bits );
-    if ( stability_bound <= alpha )
+    if ( stability_bound <= alpha ) {
+      STAT_INCREMENT( stability_cutoffs );
       return alpha;
+    }
     stability_bound = 64 - 2 * count_stable( oppcol, opp_bits, my_bits );
     if ( stability_bound < beta )
       beta = stability_bound + 1;
-    if ( stability_bound <= alpha )
+    if ( stability_bound <= alpha ) {
+      STAT_INCREMENT( stability_cutoffs );
       return alpha;
+    }
   }
 #endif
 
@@ -1023,6 +1028,7 @@ solve_parity_hash_high( BitBoard my_bits,
     flipped = TestFlips_wrapper( sq, my_bits, opp_bits );
     if ( flipped != 0 ) {
       INCREMENT_COUNTER( nodes );
+      STAT_END_NODE( empties - 1 );
 
       FULL_ANDNOT( new_opp_bits, opp_bits, bb_flips );
       end_move_list[old_sq].succ = end_move_list[sq].succ;
@@ -1235,6 +1241,30 @@ end_solve( BitBoard my_bits,
 
 
 
+/*
+  LOW_LEVEL_SOLVE
+  Solves the position on the board with the bitboard solver used
+  in the last plies of END_TREE_SEARCH, without move ordering
+  searches or output. Meant for positions with few empty squares;
+  with at most LOW_LEVEL_DEPTH empties this is SOLVE_PARITY alone.
+*/
+
+int
+low_level_solve( int side_to_move, int alpha, int beta ) {
+  int my_discs, opp_discs;
+  BitBoard my_bits, opp_bits;
+
+  my_discs = disc_count( side_to_move );
+  opp_discs = disc_count( OPP( side_to_move ) );
+  set_bitboards( board, side_to_move, &my_bits, &opp_bits );
+  prepare_to_solve( board );
+
+  return end_solve( my_bits, opp_bits, alpha, beta, side_to_move,
+		    64 - my_discs - opp_discs, my_discs - opp_discs, TRUE );
+}
+
+
+
 /*
   UPDATE_BEST_LIST
 */
@@ -1310,6 +1340,7 @@ end_tree_search( int level,
   int mobility;
   int threshold;
   int best_list_index, best_list_length;
+  int multi, bound;
   int best_list[4];
   HashEntry entry, mid_entry;
 #if CHECK_HASH_CODES
@@ -1319,9 +1350,12 @@ end_tree_search( int level,
   int stability_bound;
 #endif
 
+  multi = (level == 0) && (get_multi_pv() > 1);
   if ( level == 0 ) {
     sprintf( buffer, "[%d,%d]:", alpha, beta );
     clear_sweep();
+    if ( multi )
+      clear_root_lines();
   }
   remains = max_depth - level;
   *selective_cutoff = FALSE;
@@ -1333,6 +1367,7 @@ end_tree_search( int level,
     stability_bound = 64 -
       2 * count_edge_stable( OPP( side_to_move ), opp_bits, my_bits );
     if ( stability_bound <= alpha ) {
+      STAT_INCREMENT( stability_cutoffs );
       pv_depth[level] = level;
       return alpha;
     }
@@ -1341,18 +1376,20 @@ end_tree_search( int level,
     if ( stability_bound < beta )
       beta = stability_bound + 1;
     if ( stability_bound <= alpha ) {
+      STAT_INCREMENT( stability_cutoffs );
       pv_depth[level] = level;
       return alpha;
     }
   }
 #endif
 
-  /* Check if the low-level code is to be invoked */
+  /* Check if the low-level code is to be invoked; it doesn't
+     score the moves individually so multi-PV roots can't use it */
 
   my_discs = piece_count[side_to_move][disks_played];
   opp_discs = piece_count[OPP( side_to_move )][disks_played];
   empties = 64 - my_discs - opp_discs;
-  if ( remains <= FASTEST_FIRST_DEPTH ) {
+  if ( (remains <= FASTEST_FIRST_DEPTH) && !multi ) {
     disk_diff = my_discs - opp_discs;
     if ( void_legal )  /* Is PASS legal or was last move a pass? */
       previous_move = 44;  /* d4, of course impossible */
@@ -1382,6 +1419,7 @@ end_tree_search( int level,
   /* Otherwise normal search */
 
   INCREMENT_COUNTER( nodes );
+  STAT_END_NODE( empties );
 
   use_hash = USE_HASH_TABLE;
   if ( use_hash ) {
@@ -1393,7 +1431,8 @@ end_tree_search( int level,
     /* Check for endgame hash table move */
 
     find_hash( &entry, ENDGAME_MODE );
-    if ( (entry.draft == remains) &&
+    if ( !multi &&
+	 (entry.draft == remains) &&
 	 (entry.selectivity <= selectivity) &&
 	 valid_move( entry.move[0], side_to_move ) &&
 	 (entry.flags & ENDGAME_SCORE) &&
@@ -1418,6 +1457,7 @@ end_tree_search( int level,
       }
       if ( entry.selectivity > 0 )
 	*selective_cutoff = TRUE;
+      STAT_INCREMENT( end_hash_cutoffs );
       return entry.eval;
     }
 
@@ -1450,17 +1490,20 @@ end_tree_search( int level,
       int shallow_remains = end_mpc_depth[disks_played][cut];
       int mpc_bias = ceil( end_mean[disks_played][shallow_remains] * 128.0 );
       int mpc_window = ceil( end_sigma[disks_played][shallow_remains] *
-			     end_percentile[selectivity] * 128.0 );
+			     end_percentile[selectivity] * end_mpc_scale *
+			     128.0 );
       int beta_bound = 128 * beta + mpc_bias + mpc_window;
       int alpha_bound = 128 * alpha + mpc_bias - mpc_window;
       int shallow_val =
 	tree_search( level, level + shallow_remains, side_to_move,
 		     alpha_bound, beta_bound, use_hash, FALSE, void_legal );
+      STAT_INCREMENT( end_mpc_tries );
       if ( shallow_val >= beta_bound ) {
 	if ( use_hash )
 	  add_hash( ENDGAME_MODE, alpha, pv[level][level],
 		    ENDGAME_SCORE | LOWER_BOUND, remains, selectivity );
 	*selective_cutoff = TRUE;
+	STAT_INCREMENT( end_mpc_cuts );
 	return beta;
       }
       if ( shallow_val <= alpha_bound ) {
@@ -1468,6 +1511,7 @@ end_tree_search( int level,
 	  add_hash( ENDGAME_MODE, beta, pv[level][level],
 		    ENDGAME_SCORE | UPPER_BOUND, remains, selectivity );
 	*selective_cutoff = TRUE;
+	STAT_INCREMENT( end_mpc_cuts );
 	return alpha;
       }
     }
@@ -1523,6 +1567,7 @@ end_tree_search( int level,
 	  HashEntry etc_entry;
 
           find_hash( &etc_entry, ENDGAME_MODE );
+	  STAT_INCREMENT( etc_probes );
 	  if ( (etc_entry.flags & ENDGAME_SCORE) &&
 	       (etc_entry.draft == empties - 1) &&
 	       (etc_entry.selectivity <= selectivity) &&
@@ -1531,6 +1576,8 @@ end_tree_search( int level,
 
 	    /* Immediate cutoff from this move, move it up front */
 
+	    STAT_INCREMENT( etc_hits );
+
 	    for ( j = best_list_length - 1; j >= 1; j-- )
 	      best_list[j] = best_list[j - 1];
 	    best_list[0] = entry.move[i];
@@ -1585,13 +1632,16 @@ end_tree_search( int level,
 	      HashEntry etc_entry;
 
               find_hash( &etc_entry, ENDGAME_MODE );
+	      STAT_INCREMENT( etc_probes );
 	      if ( (etc_entry.flags & ENDGAME_SCORE) &&
 		   (etc_entry.draft == empties - 1) ) {
 		curr_val += 384;
 		if ( etc_entry.selectivity <= selectivity ) {
 		  if ( (etc_entry.flags & (UPPER_BOUND | EXACT_VALUE)) &&
-		       (etc_entry.eval <= -beta) )
+		       (etc_entry.eval <= -beta) ) {
+		    STAT_INCREMENT( etc_hits );
 		    curr_val = GOOD_TRANSPOSITION_EVAL;
+		  }
 		  if ( (etc_entry.flags & LOWER_BOUND) &&
 		       (etc_entry.eval >= -alpha) )
 		    curr_val -= 640;
@@ -1642,8 +1692,9 @@ end_tree_search( int level,
 
     node_val = counter_value( &nodes );
     if ( node_val - last_panic_check >= EVENT_CHECK_INTERVAL) {
-      /* Check for time abort */
+      /* Check for time abort and for the opponent's move if pondering */
       last_panic_check = node_val;
+      check_ponder_hit();
       check_panic_abort();
 
       /* Output status buffers if in interactive mode */
@@ -1668,7 +1719,40 @@ end_tree_search( int level,
     FULL_ANDNOT( new_opp_bits, opp_bits, bb_flips );
 
     update_pv = FALSE;
-    if ( first ) {
+    if ( multi ) {
+      /* Multi-PV: only the moves which beat the worst of the best
+	 moves kept are searched for an exact score, cf. ROOT_TREE_SEARCH */
+
+      bound = root_line_bound( alpha );
+      if ( get_root_line_count() < get_multi_pv() )
+	curr_val =
+	  -end_tree_search( level + 1, level + exp_depth,
+			    new_opp_bits, new_my_bits, OPP( side_to_move ),
+			    -beta, -alpha, selectivity,
+			    &child_selective_cutoff, TRUE );
+      else {
+	curr_val =
+	  -end_tree_search( level + 1, level + exp_depth,
+			    new_opp_bits, new_my_bits, OPP( side_to_move ),
+			    -(bound + 1), -bound, selectivity,
+			    &child_selective_cutoff, TRUE );
+	if ( (curr_val > bound) && (curr_val < beta) )
+	  curr_val =
+	    -end_tree_search( level + 1, level + exp_depth,
+			      new_opp_bits, new_my_bits, OPP( side_to_move ),
+			      -beta, (selectivity > 0) ? INFINITE_EVAL : -bound,
+			      selectivity, &child_selective_cutoff, TRUE );
+      }
+      if ( !is_panic_abort() && !force_return )
+	add_root_line( side_to_move, move, curr_val );
+      if ( first || (curr_val > best) ) {
+	best = curr_val;
+	update_pv = TRUE;
+	if ( first || (!is_panic_abort() && !force_return) )
+	  best_end_root_move = move;
+      }
+    }
+    else if ( first ) {
       best = curr_val =
 	-end_tree_search( level + 1, level + exp_depth,
 			  new_opp_bits, new_my_bits, OPP( side_to_move ),
@@ -1750,7 +1834,10 @@ end_tree_search( int level,
       for ( i = level + 1; i < pv_depth[level + 1]; i++ )
 	pv[level][i] = pv[level + 1][i];
     }
-    if ( best >= beta ) {  /* Fail high */
+    if ( multi ? (root_line_bound( alpha ) >= beta) : (best >= beta) ) {
+      /* Fail high */
+      STAT_INCREMENT( end_fail_highs );
+      STAT_INCREMENT_IF( first, end_first_fail_highs );
       if ( use_hash )
 	add_hash_extended( ENDGAME_MODE, best, best_list,
 			   ENDGAME_SCORE | LOWER_BOUND, remains,
@@ -1919,6 +2006,38 @@ send_solve_status( int empties,
   if ( get_elapsed_time() > 0.0001 )
     send_status( "%6.0f %s  ", node_val / (get_elapsed_time() + 0.0001),
 		 NPS_ABBREV);
+  send_search_info( empties, *eval_info );
+}
+
+
+/*
+  PUBLISH_END_LINES
+  Converts the scores of the best root moves found by a completed
+  multi-PV solve into evaluations and publishes them. Selective
+  exact searches don't determine the outcome of the game.
+*/
+
+static void
+publish_end_lines( EvalType type, int wld, double confidence,
+		   int empties ) {
+  int i;
+  int score;
+  EvalResult res;
+
+  for ( i = 0; i < get_root_line_count(); i++ ) {
+    score = get_root_line_score( i ) + komi_shift;
+    if ( (type == SELECTIVE_EVAL) && !wld )
+      res = UNSOLVED_POSITION;
+    else if ( score < 0 )
+      res = LOST_POSITION;
+    else if ( score == 0 )
+      res = DRAWN_POSITION;
+    else
+      res = WON_POSITION;
+    set_root_line_eval( i, create_eval_info( type, res, score * 128,
+					     confidence, empties, FALSE ) );
+  }
+  publish_root_lines();
 }
 
 
@@ -1945,10 +2064,12 @@ end_game( int side_to_move,
   int long_selective_search;
   int old_depth, old_eval;
   int last_window_center;
+  int multi;
   int old_pv[MAX_SEARCH_DEPTH];
   EvaluationType book_eval_info;
 
   empties = 64 - disc_count( BLACKSQ ) - disc_count( WHITESQ );
+  multi = (get_multi_pv() > 1);
 
   /* In komi games, the WLD window is adjusted. */
 
@@ -2034,8 +2155,6 @@ end_game( int side_to_move,
 	root_eval = end_tree_wrapper( 0, empties, side_to_move,
 				      alpha, beta, selectivity, TRUE );
 
-	adjust_counter( &nodes );
-
 	if ( is_panic_abort() || force_return )
 	  break;
 
@@ -2057,6 +2176,9 @@ end_game( int side_to_move,
 	*eval_info =
 	  create_eval_info( SELECTIVE_EVAL, res, root_eval * 128,
 			    current_confidence, empties, FALSE );
+	if ( multi )
+	  publish_end_lines( SELECTIVE_EVAL, TRUE, current_confidence,
+			     empties );
 	if ( full_output_mode ) {
 	  hash_expand_pv( side_to_move, ENDGAME_MODE, flags, selectivity );
 	  send_solve_status( empties, side_to_move, eval_info );
@@ -2065,8 +2187,14 @@ end_game( int side_to_move,
     else
       for ( selectivity = MAX_SELECTIVITY; (selectivity > 0) &&
 	      !is_panic_abort() && !force_return; selectivity-- ) {
-	alpha = last_window_center - 1;
-	beta = last_window_center + 1;
+	if ( multi ) {  /* All lines need exact scores; no aspiration */
+	  alpha = -INFINITE_EVAL;
+	  beta = INFINITE_EVAL;
+	}
+	else {
+	  alpha = last_window_center - 1;
+	  beta = last_window_center + 1;
+	}
 
 	root_eval = end_tree_wrapper( 0, empties, side_to_move,
 				      alpha, beta, selectivity, TRUE );
@@ -2096,8 +2224,6 @@ end_game( int side_to_move,
 	  root_eval = last_window_center;
 	}
 
-	adjust_counter( &nodes );
-
 	if ( is_panic_abort() || force_return )
 	  break;
 
@@ -2113,6 +2239,9 @@ end_game( int side_to_move,
 	    create_eval_info( SELECTIVE_EVAL, UNSOLVED_POSITION,
 			      root_eval * 128, current_confidence,
 			      empties, FALSE );
+	  if ( multi )
+	    publish_end_lines( SELECTIVE_EVAL, FALSE, current_confidence,
+			       empties );
 	  if ( full_output_mode ) {
 	    hash_expand_pv( side_to_move, ENDGAME_MODE, EXACT_VALUE, selectivity );
 	    send_solve_status( empties, side_to_move, eval_info );
@@ -2190,6 +2319,10 @@ end_game( int side_to_move,
     alpha = -1;
     beta = +1;
   }
+  else if ( multi ) {
+    alpha = -INFINITE_EVAL;
+    beta = INFINITE_EVAL;
+  }
   else {
     alpha = last_window_center - 1;
     beta = last_window_center + 1;
@@ -2198,8 +2331,6 @@ end_game( int side_to_move,
   root_eval = end_tree_wrapper( 0, empties, side_to_move,
 				alpha, beta, 0, TRUE );
 
-  adjust_counter( &nodes );
-
   if ( !is_panic_abort() && !force_return ) {
     if ( !wld ) {
       if ( root_eval <= alpha ) {
@@ -2242,6 +2373,8 @@ end_game( int side_to_move,
 	res = DRAWN_POSITION;
       else
 	res = WON_POSITION;
+      if ( multi )
+	publish_end_lines( wld ? WLD_EVAL : EXACT_EVAL, wld, 0.0, empties );
       if ( wld ) {
 	unsigned int flags;
 
@@ -2268,8 +2401,6 @@ end_game( int side_to_move,
     }
   }
 
-  adjust_counter( &nodes );
-
   /* Check for abort. */
 
   if ( is_panic_abort() || force_return ) {
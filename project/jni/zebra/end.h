@@ -45,6 +45,9 @@ end_game( int side_to_move,
 	  int komi,
 	  EvaluationType *eval_info );
 
+int
+low_level_solve( int side_to_move, int alpha, int beta );
+
 void
 set_output_mode( int full );
 
@@ -3,11 +3,15 @@
 
    Created:      September 1, 2002
    
-   Modified:
+   Modified:     October 18, 2026
 
    Author:       Gunnar Andersson (gunnar@radagast.se)
 
-   Contents:
+   Contents:     Generates endgame training games by letting the
+                 engine deviate from the games in a game file.
+                 The games are shared between worker processes;
+                 the deviations are written to stdout in the order
+                 of the game file.
 */
 
 
@@ -29,227 +33,390 @@
 #include "moves.h"
 #include "myrandom.h"
 #include "osfbook.h"
+#include "parallel.h"
 #include "patterns.h"
 #include "search.h"
 #include "timer.h"
 
 
 
-static const int VERBOSE = 1;
+#define EARLIEST_DEV          38
+#define LATEST_DEV            52
+#define DEFAULT_HASH_BITS     20
 
+/* The number of games handed to the workers at a time */
+#define GAME_CHUNK_SIZE       1000
 
+/* Every branch starts after the previous one, so a game
+   can't give more deviations than this */
+#define MAX_BRANCH_COUNT      (LATEST_DEV - EARLIEST_DEV + 1)
+#define MAX_OUTPUT_LENGTH     (MAX_BRANCH_COUNT * 121 + 1)
 
-static void
+#define GAME_PENDING          0
+#define GAME_FINISHED         1
+
+
+
+typedef struct {
+  int game_number;
+  int game_length;
+  volatile int state;
+  char moves[60];
+  char output[MAX_OUTPUT_LENGTH];
+} DeviationJob;
+
+/* The games currently processed. JOB, NEXT_JOB and the job
+   states live in shared memory. */
+typedef struct {
+  DeviationJob *job;
+  int job_count;
+  int written_count;
+  volatile int *next_job;
+} DeviationChunk;
+
+
+
+static double rand_prob;
+static int verbose;
+static int base_seed;
+
+
+
+/*
+   READ_GAME
+   Reads a game (a move string such as f5d6c3...) from STREAM.
+   Returns FALSE at end of file.
+*/
+
+static int
 read_game( FILE *stream,
 	   int *game_moves,
 	   int *game_length ) {
   char buffer[1000];
+  int i;
+  char *ch = buffer;
 
   if ( fgets( buffer, sizeof buffer, stream ) == NULL )
-    return;
-  else {
-    int i;
-    char *ch = buffer;
-
-    while ( isalnum( *ch ) )
-      ch++;
-    *ch = 0;
-
-    *game_length = strlen( buffer ) / 2;
-    if ( (*game_length > 60) || (strlen( buffer ) % 2 == 1) ) {
-      fprintf( stderr, "Bad move string %s.\n", buffer );
-      exit( EXIT_FAILURE );
-    }
-    for ( i = 0; i < *game_length; i++ ) {
-      int col = tolower( buffer[2 * i] ) - 'a' + 1;
-      int row = buffer[2 * i + 1] - '0';
-      if ( (col < 1) || (col > 8) || (row < 1) || (row > 8) )
-	fprintf( stderr, "Unexpected character in move string" );
-      game_moves[i] = 10 * row + col;
-    }
+    return FALSE;
+
+  while ( isalnum( *ch ) )
+    ch++;
+  *ch = 0;
+
+  *game_length = strlen( buffer ) / 2;
+  if ( (*game_length > 60) || (strlen( buffer ) % 2 == 1) ) {
+    fprintf( stderr, "Bad move string %s.\n", buffer );
+    exit( EXIT_FAILURE );
+  }
+  for ( i = 0; i < *game_length; i++ ) {
+    int col = tolower( buffer[2 * i] ) - 'a' + 1;
+    int row = buffer[2 * i + 1] - '0';
+    if ( (col < 1) || (col > 8) || (row < 1) || (row > 8) )
+      fprintf( stderr, "Unexpected character in move string" );
+    game_moves[i] = 10 * row + col;
   }
-}
 
+  return TRUE;
+}
 
 
-int
-main( int argc, char *argv[] ) {
-  double rand_prob;
-  const int hash_bits = 20;
-  const int earliest_dev = 38;
-  const int latest_dev = 52;
-  int first_allowed_dev;
-  int side_to_move;
-  int last_was_pass;
-  int restart, in_branch;
-  int games_read;
-  int game_length;
-  int game_moves[60];
-  FILE *stream;
+/*
+   CHOOSE_DEVIATION
+   Evaluates all moves and picks one at random, favoring good
+   moves and moves other than GAME_MOVE, the move in the game.
+*/
 
-  if ( (argc != 3) ||
-       (sscanf( argv[2], "%lf", &rand_prob ) != 1) ) {
-    fputs( "Usage:\n  enddev <game file> <randomization prob.>\n", stderr );
-    exit( EXIT_FAILURE );
+static int
+choose_deviation( int side_to_move, int game_move, int game_number ) {
+  int i;
+  int best_score;
+  int accum_prob, total_prob;
+  int rand_val;
+  struct {
+    int move;
+    int score;
+    int prob;
+  } choices[60];
+
+  if ( verbose )
+    fprintf( stderr, "Evaluating moves in game %d after %d moves:\n",
+	     game_number, disks_played );
+
+  extended_compute_move( side_to_move, FALSE, FALSE, 8, 60, 60 );
+
+  assert( get_evaluated_count() == move_count[disks_played] );
+
+  best_score = -INFINITE_EVAL;
+  for ( i = 0; i < get_evaluated_count(); i++ ) {
+    EvaluatedMove ev_info = get_evaluated( i );
+    choices[i].move = ev_info.move;
+    choices[i].score = ev_info.eval.score / 128;
+
+    best_score = MAX( choices[i].score, best_score );
   }
 
-  stream = fopen( argv[1], "r" );
-  if ( stream == NULL ) {
-    fprintf( stderr, "Cannot open %s for reading.\n", argv[1] );
-    exit( EXIT_FAILURE );
+  total_prob = 0;
+  for ( i = 0; i < get_evaluated_count(); i++ ) {
+    choices[i].prob =
+      100000 * exp( (choices[i].score - best_score) * 0.2 ) + 1;
+    if ( choices[i].move == game_move )  /* Encourage deviations. */
+      choices[i].prob = choices[i].prob / 2;
+    total_prob += choices[i].prob;
   }
 
-  init_learn( "book.bin", TRUE );
-  global_setup( 0, hash_bits );
-  games_read = 0;
+  if ( verbose )
+    for ( i = 0; i < get_evaluated_count(); i++ )
+      fprintf( stderr, "  %c%c  %+3d    p=%.03f\n",
+	       TO_SQUARE( choices[i].move ), choices[i].score,
+	       choices[i].prob / (double) total_prob );
 
-  first_allowed_dev = earliest_dev;
-  last_was_pass = FALSE;
-  restart = TRUE;
-  in_branch = FALSE;
+  rand_val = (my_random() >> 4) % (total_prob + 1);
+  accum_prob = 0;
+  i = 0;
+  while ( (accum_prob += choices[i].prob) < rand_val )
+    i++;
 
-  while ( 1 ) {
-    if ( restart ) {
-      if ( in_branch )
-	game_length = disks_played;
-      else {
-	read_game( stream, game_moves, &game_length );
-	if ( games_read % 1000 == 0 )
-	  fprintf( stderr, "%d games processed\n", games_read );
-	if ( feof( stream ) )
-	  break;
-	games_read++;
-
-	first_allowed_dev = earliest_dev;
-      }
+  assert( i < move_count[disks_played] );
 
-      game_init( NULL, &side_to_move );
-      setup_hash( TRUE );
-      last_was_pass = FALSE;
-      restart = FALSE;
-      in_branch = FALSE;
-    }
+  if ( verbose )
+    fprintf( stderr, "  %c%c chosen, %c%c in game\n",
+	     TO_SQUARE( choices[i].move ), TO_SQUARE( game_move ) );
 
-    assert( disc_count( BLACKSQ ) + disc_count( WHITESQ ) ==
-	    disks_played + 4 );
+  return choices[i].move;
+}
 
-    determine_hash_values( side_to_move, board );
 
-    generate_all( side_to_move );
-    if ( move_count[disks_played] == 0 ) {
-      if ( last_was_pass ) {  /* Game over? */
-	restart = TRUE;
-	if ( in_branch ) {
-	  int i;
-	  for ( i = 0; i < disks_played; i++ )
-	    printf( "%c%c", TO_SQUARE( game_moves[i] ) );
-	  puts( "" );
+/*
+   PROCESS_GAME
+   Replays the game in JOB, branching off with probability
+   RAND_PROB at each move between EARLIEST_DEV and LATEST_DEV
+   and letting the engine play out the branch. Each branch is
+   then replayed in the same way from the move after the branch
+   point. The branches are stored in the output of JOB.
+   The random numbers only depend on the seed and the game number.
+*/
+
+static void
+process_game( DeviationJob *job ) {
+  char *output;
+  int i;
+  int first_allowed_dev;
+  int side_to_move;
+  int last_was_pass;
+  int in_branch, game_over;
+  int game_moves[60];
+
+  for ( i = 0; i < job->game_length; i++ )
+    game_moves[i] = job->moves[i];
+  output = job->output;
+  *output = 0;
+
+  my_srandom( base_seed + job->game_number );
+  first_allowed_dev = EARLIEST_DEV;
+
+  do {
+    game_init( NULL, &side_to_move );
+    setup_hash( TRUE );
+    last_was_pass = FALSE;
+    in_branch = FALSE;
+    game_over = FALSE;
+
+    while ( !game_over ) {
+      assert( disc_count( BLACKSQ ) + disc_count( WHITESQ ) ==
+	      disks_played + 4 );
+
+      determine_hash_values( side_to_move, board );
+
+      generate_all( side_to_move );
+      if ( move_count[disks_played] == 0 ) {
+	if ( last_was_pass ) {
+	  game_over = TRUE;
+	  if ( in_branch ) {
+	    for ( i = 0; i < disks_played; i++ )
+	      output += sprintf( output, "%c%c", TO_SQUARE( game_moves[i] ) );
+	    output += sprintf( output, "\n" );
+	  }
+	}
+	else {
+	  side_to_move = OPP( side_to_move );  /* Must pass. */
+	  last_was_pass = TRUE;
 	}
       }
       else {
-	side_to_move = OPP( side_to_move );  /* Must pass. */
-	last_was_pass = TRUE;
-      }
-    }
-    else {
-      int move;
+	int move;
 
-      start_move( 100000, 0, disks_played + 4 );
+	start_move( 100000, 0, disks_played + 4 );
 
-      if ( in_branch ) {
-	EvaluationType ev_info;
-	move = compute_move( side_to_move, FALSE, 100000, 0, FALSE,
-			     FALSE, 8, 60, 60, TRUE, &ev_info );
-      }
-      else {
-	move = game_moves[disks_played];
-
-	if ( (disks_played >= first_allowed_dev) &&
-	     (disks_played <= latest_dev) &&
-	     (0.0001 * ((my_random() >> 9) % 10000) < rand_prob) ) {
-	  int i;
-	  int best_score;
-	  int accum_prob, total_prob;
-	  int rand_val;
-	  struct {
-	    int move;
-	    int score;
-	    int prob;
-	  } choices[60];
-
-	  if ( VERBOSE )
-	    fprintf( stderr, "Evaluating moves in game %d after %d moves:\n",
-		     games_read, disks_played );
-
-	  extended_compute_move( side_to_move, FALSE, FALSE, 8, 60, 60 );
-
-	  assert( get_evaluated_count() == move_count[disks_played] );
-
-	  best_score = -INFINITE_EVAL;
-	  for ( i = 0; i < get_evaluated_count(); i++ ) {
-	    EvaluatedMove ev_info = get_evaluated( i );
-	    choices[i].move = ev_info.move;
-	    choices[i].score = ev_info.eval.score / 128;
-
-	    best_score = MAX( choices[i].score, best_score );
+	if ( in_branch ) {
+	  EvaluationType ev_info;
+	  move = compute_move( side_to_move, FALSE, 100000, 0, FALSE,
+			       FALSE, 8, 60, 60, TRUE, &ev_info );
+	}
+	else {
+	  move = game_moves[disks_played];
+
+	  if ( (disks_played >= first_allowed_dev) &&
+	       (disks_played <= LATEST_DEV) &&
+	       (0.0001 * ((my_random() >> 9) % 10000) < rand_prob) ) {
+	    move = choose_deviation( side_to_move, game_moves[disks_played],
+				     job->game_number );
+	    if ( move != game_moves[disks_played] ) {
+	      in_branch = TRUE;
+	      first_allowed_dev = disks_played + 1;
+	      if ( verbose )
+		fputs( "  branching\n", stderr );
+	    }
 	  }
+	}
 
-	  total_prob = 0;
-	  for ( i = 0; i < get_evaluated_count(); i++ ) {
-	    choices[i].prob =
-	      100000 * exp( (choices[i].score - best_score) * 0.2 ) + 1;
-	    if ( choices[i].move == move )  /* Encourage deviations. */
-	      choices[i].prob = choices[i].prob / 2;
-	    total_prob += choices[i].prob;
-	  }
+	if ( !valid_move( move, side_to_move ) ) {
+	  fprintf( stderr, "Game #%d contains illegal move %d @ #%d.\n",
+		   job->game_number, move, disks_played );
+	  display_board( stderr, board, side_to_move, FALSE, FALSE, FALSE );
+	  exit( EXIT_FAILURE );
+	}
 
-	  if ( VERBOSE )
-	    for ( i = 0; i < get_evaluated_count(); i++ )
-	      fprintf( stderr, "  %c%c  %+3d    p=%.03f\n",
-		       TO_SQUARE( choices[i].move ), choices[i].score,
-		       choices[i].prob / (double) total_prob );
-
-	  rand_val = (my_random() >> 4) % (total_prob + 1);
-	  accum_prob = 0;
-	  i = 0;
-	  while ( (accum_prob += choices[i].prob) < rand_val )
-	    i++;
-
-	  assert( i < move_count[disks_played] );
-
-	  move = choices[i].move;
-	  if ( VERBOSE )
-	    fprintf( stderr, "  %c%c chosen, %c%c in game\n",
-		     TO_SQUARE( move ),
-		     TO_SQUARE( game_moves[disks_played] ) );
-
-	  if ( move != game_moves[disks_played] ) {
-	    in_branch = TRUE;
-	    first_allowed_dev = disks_played + 1;
-	    if ( VERBOSE )
-	      fputs( "  branching\n", stderr );
-	  }
+	game_moves[disks_played] = move;
+
+	if ( make_move( side_to_move, move, TRUE ) == 0 ) {
+	  fprintf( stderr, "Internal error: 'Legal' move flips no discs.\n" );
+	  exit( EXIT_FAILURE );
 	}
-      }
 
-      if ( !valid_move( move, side_to_move ) ) {
-	fprintf( stderr, "Game #%d contains illegal move %d @ #%d.\n",
-		 games_read, move, disks_played );
-	display_board( stderr, board, side_to_move, FALSE, FALSE, FALSE );
-	exit( EXIT_FAILURE );
+	side_to_move = OPP( side_to_move );
+	last_was_pass = FALSE;
       }
+    }
+  } while ( in_branch );
+}
 
-      game_moves[disks_played] = move;
 
-      if ( make_move( side_to_move, move, TRUE ) == 0 ) {
-	fprintf( stderr, "Internal error: 'Legal' move flips no discs.\n" );
-	exit( EXIT_FAILURE );
-      }
+/*
+   DEVIATION_WORKER
+   Processes games from the chunk until there are none left.
+*/
 
-      side_to_move = OPP( side_to_move );
-      last_was_pass = FALSE;
-    }
+static void
+deviation_worker( int worker_index, void *context ) {
+  DeviationChunk *chunk = (DeviationChunk *) context;
+  int job_index;
+
+  while ( (job_index = claim_next_job( chunk->next_job )) <
+	  chunk->job_count ) {
+    process_game( &chunk->job[job_index] );
+    __sync_synchronize();
+    chunk->job[job_index].state = GAME_FINISHED;
   }
+}
+
+
+/*
+   WRITE_FINISHED_GAMES
+   Called regularly by the worker pool; writes the deviations of
+   the games which are finished, keeping the order of the game file.
+*/
+
+static void
+write_finished_games( void *context ) {
+  DeviationChunk *chunk = (DeviationChunk *) context;
+  DeviationJob *job;
+
+  while ( (chunk->written_count < chunk->job_count) &&
+	  (chunk->job[chunk->written_count].state == GAME_FINISHED) ) {
+    job = &chunk->job[chunk->written_count];
+    fputs( job->output, stdout );
+    if ( job->game_number % 1000 == 0 )
+      fprintf( stderr, "%d games processed\n", job->game_number );
+    chunk->written_count++;
+  }
+  fflush( stdout );
+}
+
+
+
+int
+main( int argc, char *argv[] ) {
+  DeviationChunk chunk;
+  int i;
+  int hash_bits;
+  int worker_count;
+  int games_read;
+  int game_length;
+  int game_moves[60];
+  int failed;
+  FILE *stream;
+
+  hash_bits = DEFAULT_HASH_BITS;
+  worker_count = 1;
+  base_seed = 0;
+  for ( i = 3; i < argc; i++ ) {
+    if ( !strcmp( argv[i], "-workers" ) && (i + 1 < argc) )
+      worker_count = atoi( argv[++i] );
+    else if ( !strcmp( argv[i], "-hash" ) && (i + 1 < argc) )
+      hash_bits = atoi( argv[++i] );
+    else if ( !strcmp( argv[i], "-seed" ) && (i + 1 < argc) )
+      base_seed = atoi( argv[++i] );
+    else
+      break;
+  }
+  if ( (argc < 3) || (i < argc) ||
+       (sscanf( argv[2], "%lf", &rand_prob ) != 1) ) {
+    fputs( "Usage:\n  enddev <game file> <randomization prob.> "
+	   "[-workers n] [-hash bits] [-seed s]\n\n", stderr );
+    fputs( "  -workers  Use n worker processes (default 1).\n", stderr );
+    fprintf( stderr, "  -hash     Use 2^bits hash table entries "
+	     "per worker (default %d).\n", DEFAULT_HASH_BITS );
+    fputs( "  -seed     Game n is played with random seed s+n "
+	   "(default s=0).\n", stderr );
+    fputs( "The deviations are written to stdout; the evaluations behind "
+	   "them are\nshown on stderr when one worker is used.\n", stderr );
+    exit( EXIT_FAILURE );
+  }
+  worker_count = MAX( 1, MIN( worker_count, MAX_WORKER_COUNT ) );
+  verbose = (worker_count == 1);
+
+  stream = fopen( argv[1], "r" );
+  if ( stream == NULL ) {
+    fprintf( stderr, "Cannot open %s for reading.\n", argv[1] );
+    exit( EXIT_FAILURE );
+  }
+
+  init_learn( "book.bin", TRUE );
+  global_setup( 0, hash_bits );
+
+  chunk.job = (DeviationJob *)
+    shared_malloc( GAME_CHUNK_SIZE * sizeof( DeviationJob ) );
+  chunk.next_job = (volatile int *) shared_malloc( sizeof( int ) );
+
+  games_read = 0;
+  do {
+    chunk.job_count = 0;
+    while ( (chunk.job_count < GAME_CHUNK_SIZE) &&
+	    read_game( stream, game_moves, &game_length ) ) {
+      DeviationJob *job = &chunk.job[chunk.job_count++];
+
+      job->game_number = ++games_read;
+      job->game_length = game_length;
+      job->state = GAME_PENDING;
+      for ( i = 0; i < game_length; i++ )
+	job->moves[i] = game_moves[i];
+    }
+    if ( chunk.job_count == 0 )
+      break;
+
+    chunk.written_count = 0;
+    *chunk.next_job = 0;
+    failed = run_workers( MIN( worker_count, chunk.job_count ),
+			  deviation_worker, write_finished_games, &chunk );
+    if ( failed > 0 ) {
+      fprintf( stderr, "%d workers failed\n", failed );
+      exit( EXIT_FAILURE );
+    }
+  } while ( chunk.job_count == GAME_CHUNK_SIZE );
+  fclose( stream );
+
+  shared_free( (void *) chunk.next_job, sizeof( int ) );
+  shared_free( chunk.job, GAME_CHUNK_SIZE * sizeof( DeviationJob ) );
 
   fprintf( stderr, "%d games processed\n", games_read );
 
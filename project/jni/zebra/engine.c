@@ -0,0 +1,789 @@
+/*
+   File:         engine.c
+
+   Created:      October 19, 2026
+
+   Modified:
+
+   Contents:     A persistent analysis engine driven by line-based
+                 commands on stdin, in the spirit of UCI and GTP.
+                 One process keeps its hash table and opening book
+                 warm between requests; the search streams an "info"
+                 line per completed iteration and ends with a
+                 "bestmove" line. Commands:
+
+                   hello
+                   isready
+                   newgame
+                   position startpos [moves <m> ...]
+                   position board <64 x/o/-> <x|o> [moves <m> ...]
+                   go [depth <n>] [exact <n>] [wld <n>] [time <s>]
+                      [inc <s>] [nodes <n>] [multipv <k>]
+                      [infinite]
+                   stop
+                   quit
+
+                 Moves are written as e.g. "f5", passes as "pass".
+                 Without a depth the search runs on the clock given
+                 by time/inc, or until "stop" if there is none.
+                 With multipv the search keeps the best k moves (at
+                 most MAX_MULTI_PV) with exact scores and each
+                 iteration reports all of them.
+
+                 While searching, "stop" and "quit" are acted upon
+                 wherever they are in the queued input, up to the
+                 next "go", and "isready" is answered unless other
+                 commands are queued before it. Everything else is
+                 run after the search, in order.
+
+                 There is no pondering: "go ponder" and "ponderhit"
+                 are not supported. The move after "ponder" in the
+                 "bestmove" line is only the expected reply; to use
+                 the opponent's time, search that position with
+                 "go infinite" and "stop" it when the move comes.
+*/
+
+
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/select.h>
+#include <sys/time.h>
+#include <sys/types.h>
+
+#include "autoplay.h"
+#include "constant.h"
+#include "counter.h"
+#include "display.h"
+#include "game.h"
+#include "globals.h"
+#include "hash.h"
+#include "learn.h"
+#include "macros.h"
+#include "moves.h"
+#include "osfbook.h"
+#include "search.h"
+#include "timer.h"
+
+
+
+#define PROTOCOL_VERSION          1
+
+#define DEFAULT_HASH_BITS         20
+
+/* The clock used when a search has no time limit */
+#define INFINITE_TIME             10000000.0
+
+#define INPUT_BUFFER_SIZE         4096
+#define MAX_TOKENS                128
+
+
+
+typedef struct {
+  int depth;
+  int exact;
+  int wld;
+  double time;
+  double increment;
+  double nodes;
+  int multi_pv;
+} SearchLimits;
+
+
+
+/* Local variables */
+
+static char input_buffer[INPUT_BUFFER_SIZE];
+static int input_length = 0;
+static int input_eof = FALSE;
+static int event_handling = TRUE;
+static int quit_requested = FALSE;
+static int use_book = TRUE;
+static int side_to_move;
+static double node_limit = 0.0;
+
+
+
+/*
+   READ_INPUT
+   Reads once from stdin into the buffer. If WAIT is FALSE and no
+   data is available, nothing is read and FALSE is returned.
+*/
+
+static int
+read_input( int wait ) {
+  int count;
+
+  if ( !wait ) {
+    fd_set read_set;
+    struct timeval timeout;
+
+    FD_ZERO( &read_set );
+    FD_SET( STDIN_FILENO, &read_set );
+    timeout.tv_sec = 0;
+    timeout.tv_usec = 0;
+    if ( select( STDIN_FILENO + 1, &read_set, NULL, NULL, &timeout ) <= 0 )
+      return FALSE;
+  }
+
+  do
+    count = read( STDIN_FILENO, input_buffer + input_length,
+		  INPUT_BUFFER_SIZE - input_length );
+  while ( (count < 0) && (errno == EINTR) );
+  if ( count <= 0 )
+    input_eof = TRUE;
+  else
+    input_length += count;
+
+  return TRUE;
+}
+
+
+/*
+   FILL_INPUT
+   Reads from stdin until a complete line is buffered. If WAIT is
+   FALSE, only the data already available is read. Returns TRUE
+   if a line (or the end of the input) is available.
+*/
+
+static int
+fill_input( int wait ) {
+  for (;;) {
+    if ( input_eof ||
+	 (memchr( input_buffer, '\n', input_length ) != NULL) ||
+	 (input_length == INPUT_BUFFER_SIZE) )
+      return TRUE;
+    if ( !read_input( wait ) )
+      return FALSE;
+  }
+}
+
+
+/*
+   READ_COMMAND
+   Copies the next input line, without the line terminator, to LINE.
+   Unless CONSUME is set the line is left in the buffer.
+   Returns FALSE at the end of the input.
+*/
+
+static int
+read_command( char *line, int wait, int consume ) {
+  char *newline;
+  int length, used;
+
+  if ( !fill_input( wait ) )
+    return FALSE;
+
+  newline = memchr( input_buffer, '\n', input_length );
+  if ( newline != NULL ) {
+    length = newline - input_buffer;
+    used = length + 1;
+  }
+  else if ( input_length > 0 ) {  /* Over-long or unterminated line */
+    length = MIN( input_length, INPUT_BUFFER_SIZE - 1 );
+    used = length;
+  }
+  else
+    return FALSE;
+
+  memcpy( line, input_buffer, length );
+  line[length] = 0;
+  if ( (length > 0) && (line[length - 1] == '\r') )
+    line[length - 1] = 0;
+  if ( !consume )
+    return TRUE;
+  memmove( input_buffer, input_buffer + used, input_length - used );
+  input_length -= used;
+
+  return TRUE;
+}
+
+
+/*
+   TOKENIZE
+   Splits LINE in place into at most MAX_TOKENS words.
+*/
+
+static int
+tokenize( char *line, char *token[] ) {
+  int count;
+  char *word;
+
+  count = 0;
+  for ( word = strtok( line, " \t" ); (word != NULL) && (count < MAX_TOKENS);
+	word = strtok( NULL, " \t" ) )
+    token[count++] = word;
+
+  return count;
+}
+
+
+/*
+   HANDLE_EVENT
+   TOGGLE_EVENT_STATUS
+   Called from inside the search. Answers the commands allowed
+   while searching and enforces the node limit. The whole queue
+   is scanned so that a "stop" behind a deferred command is still
+   seen; the scan ends at a deferred "go", as any later "stop"
+   is meant for that search.
+*/
+
+void
+handle_event( int only_passive_events, int allow_delay, int passive_mode ) {
+  char line[INPUT_BUFFER_SIZE];
+  char *token[MAX_TOKENS];
+  char *newline;
+  int offset, length, used;
+
+  if ( !event_handling )
+    return;
+
+  if ( (node_limit > 0.0) && (counter_value( &nodes ) >= node_limit) )
+    force_return = TRUE;
+
+  while ( !input_eof && (input_length < INPUT_BUFFER_SIZE) &&
+	  read_input( FALSE ) )
+    ;
+
+  offset = 0;
+  for (;;) {
+    newline = memchr( input_buffer + offset, '\n', input_length - offset );
+    if ( newline == NULL )
+      break;
+    length = newline - (input_buffer + offset);
+    used = length + 1;
+    memcpy( line, input_buffer + offset, length );
+    line[length] = 0;
+    if ( (length > 0) && (line[length - 1] == '\r') )
+      line[length - 1] = 0;
+
+    if ( tokenize( line, token ) > 0 ) {
+      if ( !strcmp( token[0], "quit" ) ) {  /* Left for the main loop */
+	force_return = TRUE;
+	break;
+      }
+      if ( !strcmp( token[0], "stop" ) )
+	force_return = TRUE;
+      else if ( !strcmp( token[0], "isready" ) && (offset == 0) )
+	puts( "readyok" );
+      else if ( !strcmp( token[0], "go" ) )
+	break;
+      else {  /* Run once the search is done */
+	offset += used;
+	continue;
+      }
+    }
+
+    memmove( input_buffer + offset, input_buffer + offset + used,
+	     input_length - offset - used );
+    input_length -= used;
+  }
+
+  if ( input_eof && (input_length == 0) ) {
+    force_return = TRUE;
+    quit_requested = TRUE;
+  }
+}
+
+void
+toggle_event_status( int allow_event_handling ) {
+  event_handling = allow_event_handling;
+}
+
+
+/*
+   WRITE_MOVE
+   Writes a move in the protocol notation.
+*/
+
+static void
+write_move( int move ) {
+  if ( move == PASS )
+    printf( "pass" );
+  else
+    printf( "%c%c", TO_SQUARE( move ) );
+}
+
+
+/*
+   WRITE_SCORE
+   Writes the "type" and "score" fields for an evaluation.
+*/
+
+static void
+write_score( EvaluationType eval_info ) {
+  static const char *result_text[] = { "win", "draw", "loss", "unknown" };
+
+  switch ( eval_info.type ) {
+  case MIDGAME_EVAL:
+    printf( " type midgame score %+.2f", eval_info.score / 128.0 );
+    break;
+  case EXACT_EVAL:
+    printf( " type exact score %+d", eval_info.score / 128 );
+    break;
+  case WLD_EVAL:
+    printf( " type wld result %s", result_text[eval_info.res] );
+    break;
+  case SELECTIVE_EVAL:
+    printf( " type selective score %+d confidence %d",
+	    eval_info.score / 128, (int) (100.0 * eval_info.confidence) );
+    break;
+  case FORCED_EVAL:
+    printf( " type forced" );
+    break;
+  case PASS_EVAL:
+    printf( " type pass" );
+    break;
+  default:
+    printf( " type none" );
+    break;
+  }
+  if ( eval_info.is_book )
+    printf( " book" );
+}
+
+
+/*
+   WRITE_INFO
+   Writes an "info" line. MULTI_PV is the rank of the line, or 0
+   when only the best line is searched.
+*/
+
+static void
+write_info( int multi_pv, int depth, EvaluationType eval_info,
+	    const int *line, int line_length ) {
+  double node_val, elapsed;
+  int i;
+
+  node_val = counter_value( &nodes );
+  elapsed = get_elapsed_time();
+  printf( "info" );
+  if ( multi_pv > 0 )
+    printf( " multipv %d", multi_pv );
+  printf( " depth %d", depth );
+  write_score( eval_info );
+  printf( " nodes %.0f time %.3f", node_val, elapsed );
+  if ( elapsed > 0.0 )
+    printf( " nps %.0f", node_val / elapsed );
+  if ( line_length > 0 ) {
+    printf( " pv" );
+    for ( i = 0; i < line_length; i++ ) {
+      putchar( ' ' );
+      write_move( line[i] );
+    }
+  }
+  puts( "" );
+}
+
+
+/*
+   REPORT_ITERATION
+   The search info handler used while searching for the best move.
+   In multi-PV mode every line kept by the search is reported.
+*/
+
+static void
+report_iteration( int depth, EvaluationType eval_info ) {
+  EvaluatedMove line;
+  int i;
+
+  if ( (get_multi_pv() == 1) || (get_multi_pv_count() == 0) ) {
+    write_info( 0, depth, eval_info, pv[0], pv_depth[0] );
+    return;
+  }
+
+  for ( i = 0; i < get_multi_pv_count(); i++ ) {
+    line = get_multi_pv_line( i );
+    write_info( i + 1, depth, line.eval, line.pv, line.pv_depth );
+  }
+}
+
+
+/*
+   SETUP_START_POSITION
+   Resets the board to the initial position.
+*/
+
+static void
+setup_start_position( void ) {
+  game_init( NULL, &side_to_move );
+  set_slack( 0 );
+  toggle_human_openings( FALSE );
+  reset_book_search();
+  set_deviation_value( 0, 60, 0.0 );
+}
+
+
+/*
+   SETUP_BOARD
+   Sets up the position described by a board string and a
+   side-to-move string. Returns FALSE if they are malformed.
+*/
+
+static int
+setup_board( const char *board_string, const char *stm_string ) {
+  int i, pos;
+  int disc_total;
+
+  if ( (strlen( board_string ) != 64) || (strlen( stm_string ) != 1) )
+    return FALSE;
+
+  switch ( stm_string[0] ) {
+  case 'X':
+  case 'x':
+  case '*':
+    side_to_move = BLACKSQ;
+    break;
+  case 'O':
+  case 'o':
+  case '0':
+    side_to_move = WHITESQ;
+    break;
+  default:
+    return FALSE;
+  }
+
+  for ( i = 0; i < 64; i++ ) {
+    pos = 10 * (i / 8 + 1) + (i % 8 + 1);
+    switch ( board_string[i] ) {
+    case 'X':
+    case 'x':
+    case '*':
+      board[pos] = BLACKSQ;
+      break;
+    case 'O':
+    case 'o':
+    case '0':
+      board[pos] = WHITESQ;
+      break;
+    case '-':
+    case '.':
+      board[pos] = EMPTY;
+      break;
+    default:
+      return FALSE;
+    }
+  }
+
+  /* DISKS_PLAYED indexes the move lists and can't be negative */
+
+  disc_total = disc_count( BLACKSQ ) + disc_count( WHITESQ );
+  if ( disc_total < 4 )
+    return FALSE;
+  disks_played = disc_total - 4;
+
+  return TRUE;
+}
+
+
+/*
+   PLAY_MOVE
+   Plays a move given in the protocol notation. A side without
+   legal moves passes automatically, so "pass" is only needed
+   for clarity. Returns FALSE if the move is illegal.
+*/
+
+static int
+play_move( const char *move_string ) {
+  int row, col, move;
+
+  generate_all( side_to_move );
+  if ( !strcmp( move_string, "pass" ) ) {
+    if ( move_count[disks_played] > 0 )
+      return FALSE;
+    side_to_move = OPP( side_to_move );
+    return TRUE;
+  }
+
+  if ( strlen( move_string ) != 2 )
+    return FALSE;
+  col = move_string[0] - 'a' + 1;
+  if ( (col < 1) || (col > 8) )
+    col = move_string[0] - 'A' + 1;
+  row = move_string[1] - '0';
+  if ( (col < 1) || (col > 8) || (row < 1) || (row > 8) )
+    return FALSE;
+  move = 10 * row + col;
+  if ( (move_count[disks_played] == 0) ||
+       !valid_move( move, side_to_move ) )
+    return FALSE;
+
+  (void) make_move( side_to_move, move, TRUE );
+  side_to_move = OPP( side_to_move );
+
+  generate_all( side_to_move );
+  if ( move_count[disks_played] == 0 ) {
+    generate_all( OPP( side_to_move ) );
+    if ( move_count[disks_played] > 0 )
+      side_to_move = OPP( side_to_move );
+  }
+
+  return TRUE;
+}
+
+
+/*
+   SET_POSITION
+   Handles the "position" command. On errors the engine is left
+   in the initial position.
+*/
+
+static void
+set_position( char *token[], int token_count ) {
+  int i;
+
+  setup_start_position();
+  if ( (token_count >= 2) && !strcmp( token[1], "startpos" ) )
+    i = 2;
+  else if ( (token_count >= 4) && !strcmp( token[1], "board" ) ) {
+    if ( !setup_board( token[2], token[3] ) ) {
+      puts( "error bad board" );
+      setup_start_position();
+      return;
+    }
+    i = 4;
+  }
+  else {
+    puts( "error usage: position startpos|board <board> <side> "
+	  "[moves ...]" );
+    return;
+  }
+
+  if ( i < token_count ) {
+    if ( strcmp( token[i], "moves" ) ) {
+      printf( "error unexpected %s\n", token[i] );
+      setup_start_position();
+      return;
+    }
+    for ( i++; i < token_count; i++ )
+      if ( !play_move( token[i] ) ) {
+	printf( "error illegal move %s\n", token[i] );
+	setup_start_position();
+	return;
+      }
+  }
+}
+
+
+/*
+   PARSE_LIMITS
+   Handles the arguments of the "go" command.
+   Returns FALSE if they are malformed.
+*/
+
+static int
+parse_limits( char *token[], int token_count, SearchLimits *limits ) {
+  int i;
+
+  limits->depth = 0;
+  limits->exact = -1;
+  limits->wld = -1;
+  limits->time = 0.0;
+  limits->increment = 0.0;
+  limits->nodes = 0.0;
+  limits->multi_pv = 1;
+
+  for ( i = 1; i < token_count; i++ ) {
+    if ( !strcmp( token[i], "infinite" ) )
+      continue;
+    if ( i + 1 == token_count )
+      return FALSE;
+    if ( !strcmp( token[i], "depth" ) )
+      limits->depth = atoi( token[++i] );
+    else if ( !strcmp( token[i], "exact" ) )
+      limits->exact = atoi( token[++i] );
+    else if ( !strcmp( token[i], "wld" ) )
+      limits->wld = atoi( token[++i] );
+    else if ( !strcmp( token[i], "time" ) )
+      limits->time = atof( token[++i] );
+    else if ( !strcmp( token[i], "inc" ) )
+      limits->increment = atof( token[++i] );
+    else if ( !strcmp( token[i], "nodes" ) )
+      limits->nodes = atof( token[++i] );
+    else if ( !strcmp( token[i], "multipv" ) )
+      limits->multi_pv = atoi( token[++i] );
+    else
+      return FALSE;
+  }
+
+  return (limits->depth >= 0) && (limits->depth <= 60) &&
+    (limits->exact <= 60) && (limits->wld <= 60) &&
+    (limits->time >= 0.0) && (limits->increment >= 0.0) &&
+    (limits->nodes >= 0.0) && (limits->multi_pv >= 1);
+}
+
+
+/*
+   SEARCH_BEST_MOVE
+   Searches for the best move within the limits, reporting each
+   completed iteration. Returns the best move.
+*/
+
+static int
+search_best_move( const SearchLimits *limits ) {
+  EvaluationType eval_info;
+  double my_time;
+  int move;
+  int timed_search, mid, exact, wld;
+
+  if ( limits->depth > 0 ) {
+    timed_search = FALSE;
+    mid = limits->depth;
+    exact = (limits->exact >= 0) ? limits->exact : mid;
+    wld = (limits->wld >= 0) ? limits->wld : mid;
+  }
+  else {
+    timed_search = TRUE;
+    mid = exact = wld = 60;
+  }
+  my_time = (limits->time > 0.0) ? limits->time : INFINITE_TIME;
+
+  start_move( my_time, limits->increment, disks_played + 4 );
+  determine_move_time( my_time, limits->increment, disks_played + 4 );
+
+  set_search_info_handler( report_iteration );
+  move = compute_move( side_to_move, TRUE, my_time, limits->increment,
+		       timed_search, use_book, mid, exact, wld, TRUE,
+		       &eval_info );
+  set_search_info_handler( NULL );
+
+  if ( eval_info.is_book )
+    write_info( 0, 0, eval_info, pv[0], pv_depth[0] );
+
+  return move;
+}
+
+
+/*
+   GO
+   Handles the "go" command.
+*/
+
+static void
+go( char *token[], int token_count ) {
+  SearchLimits limits;
+  int move;
+
+  if ( !parse_limits( token, token_count, &limits ) ) {
+    puts( "error usage: go [depth n] [exact n] [wld n] [time s] [inc s] "
+	  "[nodes n] [multipv k] [infinite]" );
+    return;
+  }
+
+  force_return = FALSE;
+  node_limit = limits.nodes;
+  clear_endgame_performed();
+
+  generate_all( side_to_move );
+  if ( move_count[disks_played] == 0 ) {
+    clear_pv();
+    move = PASS;
+  }
+  else {
+    set_multi_pv( limits.multi_pv );
+    move = search_best_move( &limits );
+    set_multi_pv( 1 );
+  }
+
+  force_return = FALSE;
+  node_limit = 0.0;
+
+  printf( "bestmove " );
+  write_move( move );
+  if ( (move != PASS) && (pv_depth[0] >= 2) && (pv[0][0] == move) ) {
+    printf( " ponder " );
+    write_move( pv[0][1] );
+  }
+  puts( "" );
+}
+
+
+/*
+   USAGE
+*/
+
+static void
+usage( void ) {
+  fputs( "Usage:\n"
+	 "  engine [-b <use book>] [-h <hash bits>]\n\n"
+	 "Reads commands from stdin; see engine.c for the protocol.\n",
+	 stderr );
+  exit( EXIT_FAILURE );
+}
+
+
+int
+main( int argc, char *argv[] ) {
+  char line[INPUT_BUFFER_SIZE];
+  char *token[MAX_TOKENS];
+  int i;
+  int hash_bits, token_count;
+
+  hash_bits = DEFAULT_HASH_BITS;
+  for ( i = 1; i < argc; i++ ) {
+    if ( !strcmp( argv[i], "-b" ) && (i + 1 < argc) )
+      use_book = atoi( argv[++i] );
+    else if ( !strcmp( argv[i], "-h" ) && (i + 1 < argc) )
+      hash_bits = atoi( argv[++i] );
+    else
+      usage();
+  }
+  if ( hash_bits < 1 )
+    usage();
+
+  setvbuf( stdout, NULL, _IOLBF, 0 );
+
+  echo = FALSE;
+  display_pv = FALSE;
+  toggle_status_log( FALSE );
+  global_setup( 0, hash_bits );
+  if ( use_book ) {
+    /* The book loader reports its progress on stdout, which is
+       reserved for the protocol */
+    int saved_stdout;
+
+    fflush( stdout );
+    saved_stdout = dup( STDOUT_FILENO );
+    dup2( STDERR_FILENO, STDOUT_FILENO );
+    init_learn( "book.bin", TRUE );
+    fflush( stdout );
+    dup2( saved_stdout, STDOUT_FILENO );
+    close( saved_stdout );
+  }
+  setup_start_position();
+  setup_hash( TRUE );
+
+  while ( !quit_requested && read_command( line, TRUE, TRUE ) ) {
+    token_count = tokenize( line, token );
+    if ( token_count == 0 )
+      continue;
+    if ( !strcmp( token[0], "hello" ) ) {
+      puts( "id name Zebra" );
+      printf( "id protocol %d\n", PROTOCOL_VERSION );
+      puts( "hellook" );
+    }
+    else if ( !strcmp( token[0], "isready" ) )
+      puts( "readyok" );
+    else if ( !strcmp( token[0], "newgame" ) ) {
+      setup_start_position();
+      setup_hash( TRUE );
+    }
+    else if ( !strcmp( token[0], "position" ) )
+      set_position( token, token_count );
+    else if ( !strcmp( token[0], "go" ) )
+      go( token, token_count );
+    else if ( !strcmp( token[0], "stop" ) )
+      continue;  /* No search is running */
+    else if ( !strcmp( token[0], "quit" ) )
+      break;
+    else
+      printf( "error unknown command %s\n", token[0] );
+  }
+
+  global_terminate();
+
+  return EXIT_SUCCESS;
+}
@@ -65,19 +65,14 @@ init_eval( void ) {
 
 
 /*
-  TERMINAL_EVALUATION
-  Evaluates the position when no player has any legal moves.
+  DISC_COUNT_EVALUATION
+  Scores a final position from the disc counts; empty squares
+  go to the winner.
 */
 
-INLINE int
-terminal_evaluation( int side_to_move ) {
+INLINE static int
+disc_count_evaluation( int my_discs, int opp_discs ) {
   int disc_diff;
-  int my_discs, opp_discs;
-
-  INCREMENT_COUNTER( evaluations );
-
-  my_discs = piece_count[side_to_move][disks_played];
-  opp_discs = piece_count[OPP( side_to_move )][disks_played];
 
   if ( my_discs > opp_discs )
     disc_diff = 64 - 2 * opp_discs;
@@ -93,3 +88,31 @@ terminal_evaluation( int side_to_move ) {
   else
     return -MIDGAME_WIN + disc_diff;
 }
+
+
+
+/*
+  TERMINAL_EVALUATION
+  BITBOARD_TERMINAL_EVALUATION
+  Evaluates the position when no player has any legal moves.
+*/
+
+INLINE int
+terminal_evaluation( int side_to_move ) {
+  INCREMENT_COUNTER( evaluations );
+
+  return disc_count_evaluation( piece_count[side_to_move][disks_played],
+				piece_count[OPP( side_to_move )][disks_played] );
+}
+
+
+INLINE int
+bitboard_terminal_evaluation( BitBoard my_bits, BitBoard opp_bits ) {
+  INCREMENT_COUNTER( evaluations );
+
+  return
+    disc_count_evaluation( non_iterative_popcount( my_bits.high,
+						   my_bits.low ),
+			   non_iterative_popcount( opp_bits.high,
+						   opp_bits.low ) );
+}
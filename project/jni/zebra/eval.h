@@ -17,6 +17,7 @@
 
 
 
+#include "bitboard.h"
 #include "search.h"
 
 
@@ -48,9 +49,17 @@ static_evaluation( int side_to_move );
   ( INCREMENT_COUNTER( evaluations ) ,           \
     pattern_evaluation( side_to_move ) )
 
+#define indexed_evaluation( my_bits, pattern_index, side_to_move, disks ) \
+  ( INCREMENT_COUNTER( evaluations ) ,                                 \
+    indexed_pattern_evaluation( my_bits, pattern_index, side_to_move,  \
+				disks ) )
+
 int
 terminal_evaluation( int side_to_move );
 
+int
+bitboard_terminal_evaluation( BitBoard my_bits, BitBoard opp_bits );
+
 
 
 #endif  /* EVAL_H */
@@ -0,0 +1,150 @@
+/*
+   File:         evalcheck.c
+
+   Created:      October 18, 2026
+
+   Modified:
+
+   Contents:     Verifies a coefficient file created by tune8dbs by
+                 comparing the scores from pattern_evaluation() with
+                 the scores expected by the tuner. The scores from
+                 bitboard_pattern_evaluation() must agree as well.
+*/
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bitboard.h"
+#include "constant.h"
+#include "game.h"
+#include "getcoeff.h"
+#include "globals.h"
+#include "macros.h"
+#include "moves.h"
+
+
+
+/* The maximum number of mismatches to display */
+#define MAX_REPORTED          10
+
+
+
+/*
+   SETUP_POSITION
+   Sets up the board described by the 64 characters in BUFFER
+   for DISKS disks played. Returns FALSE if the description
+   is invalid.
+*/
+
+static int
+setup_position( const char *buffer, int disks ) {
+  int i, j, pos;
+
+  if ( (disks < 0) || (disks > 60) )
+    return FALSE;
+
+  piece_count[BLACKSQ][disks] = 0;
+  piece_count[WHITESQ][disks] = 0;
+  for ( i = 1; i <= 8; i++ )
+    for ( j = 1; j <= 8; j++ ) {
+      pos = 10 * i + j;
+      switch ( buffer[8 * (i - 1) + (j - 1)] ) {
+      case 'X':
+	board[pos] = BLACKSQ;
+	piece_count[BLACKSQ][disks]++;
+	break;
+      case 'O':
+	board[pos] = WHITESQ;
+	piece_count[WHITESQ][disks]++;
+	break;
+      case '-':
+	board[pos] = EMPTY;
+	break;
+      default:
+	return FALSE;
+      }
+    }
+  disks_played = disks;
+
+  return TRUE;
+}
+
+
+
+int
+main( int argc, char *argv[] ) {
+  char buffer[100];
+  char squares[65];
+  char side;
+  const int hash_bits = 10;
+  int disks, expected, score;
+  int checked, mismatches;
+  int side_to_move;
+  int bitboard_score, bitboard_mismatches;
+  BitBoard my_bits, opp_bits;
+  FILE *stream;
+
+  if ( argc != 2 ) {
+    fputs( "Usage:\n  evalcheck <check file>\n\n", stderr );
+    fputs( "The coefficient file is read from coeffs2.bin.\n", stderr );
+    exit( EXIT_FAILURE );
+  }
+
+  stream = fopen( "adjust.txt", "r" );
+  if ( stream != NULL ) {
+    fclose( stream );
+    fputs( "adjust.txt changes the coefficients; remove it first.\n",
+	   stderr );
+    exit( EXIT_FAILURE );
+  }
+
+  stream = fopen( argv[1], "r" );
+  if ( stream == NULL ) {
+    fprintf( stderr, "Cannot open %s for reading.\n", argv[1] );
+    exit( EXIT_FAILURE );
+  }
+
+  global_setup( 0, hash_bits );
+
+  checked = 0;
+  mismatches = 0;
+  bitboard_mismatches = 0;
+  while ( fgets( buffer, sizeof buffer, stream ) != NULL ) {
+    if ( (sscanf( buffer, "%64s %c %d %d",
+		  squares, &side, &disks, &expected ) != 4) ||
+	 (strlen( squares ) != 64) || ((side != 'X') && (side != 'O')) ||
+	 !setup_position( squares, disks ) ) {
+      fprintf( stderr, "Bad line in check file: %s", buffer );
+      exit( EXIT_FAILURE );
+    }
+    side_to_move = (side == 'X') ? BLACKSQ : WHITESQ;
+    score = pattern_evaluation( side_to_move );
+    if ( score != expected ) {
+      if ( mismatches < MAX_REPORTED )
+	printf( "%s %c %d: expected %d, got %d\n",
+		squares, side, disks, expected, score );
+      mismatches++;
+    }
+    set_bitboards( board, side_to_move, &my_bits, &opp_bits );
+    bitboard_score = bitboard_pattern_evaluation( my_bits, opp_bits, disks );
+    if ( bitboard_score != score ) {
+      if ( bitboard_mismatches < MAX_REPORTED )
+	printf( "%s %c %d: bitboard evaluation %d, board evaluation %d\n",
+		squares, side, disks, bitboard_score, score );
+      bitboard_mismatches++;
+    }
+    checked++;
+  }
+  fclose( stream );
+
+  printf( "%d positions checked, %d mismatches, %d bitboard mismatches\n",
+	  checked, mismatches, bitboard_mismatches );
+
+  global_terminate();
+
+  return ((mismatches == 0) && (bitboard_mismatches == 0)) ?
+    EXIT_SUCCESS : EXIT_FAILURE;
+}
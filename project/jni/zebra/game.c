@@ -46,6 +46,7 @@
 #include "myrandom.h"
 #include "osfbook.h"
 #include "patterns.h"
+#include "ponder.h"
 #include "probcut.h"
 #include "search.h"
 #include "stable.h"
@@ -366,17 +367,19 @@ set_forced_opening( const char *opening_str ) {
 /*
   PONDER_MOVE
   Perform searches in response to the opponent's next move.
-  The results are not returned, but the hash table is filled
-  with useful scores and moves.
+  The hash table is filled with useful scores and moves, and
+  when run in the background (see ponder.c) the replies are
+  stored and the search stops once the opponent has moved.
 */
 
 void
-ponder_move( int side_to_move, int book, int mid, int exact, int wld ) {
+ponder_move( int side_to_move, int book, int mid, int exact, int wld,
+	     int timed_depth ) {
   EvaluationType eval_info;
   HashEntry entry;
   double move_start_time, move_stop_time;
   int i, j;
-  int this_move, hash_move;
+  int this_move, hash_move, reply;
   int expect_count;
   int stored_echo;
   int best_pv_depth;
@@ -426,12 +429,14 @@ ponder_move( int side_to_move, int book, int mid, int exact, int wld ) {
       expect_list[i] = move_list[disks_played][i];
 
 #if TEXT_BASED
-    printf( "%s=%d\n", HASH_MOVE_TEXT, hash_move );
-    for ( i = 0; i < expect_count; i++ ) {
-      printf( "%c%c %-6.2f  ", TO_SQUARE( move_list[disks_played][i] ),
-	      evals[disks_played][move_list[disks_played][i]] / 128.0 );
-      if ( (i % 7 == 6) || (i == expect_count - 1) )
-	puts( "" );
+    if ( echo ) {
+      printf( "%s=%d\n", HASH_MOVE_TEXT, hash_move );
+      for ( i = 0; i < expect_count; i++ ) {
+	printf( "%c%c %-6.2f  ", TO_SQUARE( move_list[disks_played][i] ),
+		evals[disks_played][move_list[disks_played][i]] / 128.0 );
+	if ( (i % 7 == 6) || (i == expect_count - 1) )
+	  puts( "" );
+      }
     }
 #endif
   }
@@ -439,14 +444,16 @@ ponder_move( int side_to_move, int book, int mid, int exact, int wld ) {
   /* Go through the expected moves in order and prepare responses. */
 
   best_pv_depth = 0;
-  for ( i = 0; !force_return && (i < expect_count); i++ ) {
+  for ( i = 0; !force_return && !ponder_hit_posted() &&
+	  (i < expect_count); i++ ) {
     move_start_time = get_real_timer();
     set_ponder_move( expect_list[i] );
     this_move = expect_list[i];
     prefix_move = this_move;
     (void) make_move( side_to_move, this_move, TRUE );
-    (void) compute_move( OPP( side_to_move ), FALSE, 0, 0, TRUE, FALSE,
-			 mid, exact, wld, FALSE, &eval_info );
+    reply = compute_move( OPP( side_to_move ), FALSE, 0, 0, timed_depth,
+			  book, mid, exact, wld, FALSE, &eval_info );
+    store_ponder_result( this_move, OPP( side_to_move ), reply, eval_info );
     unmake_move( side_to_move, this_move );
     clear_ponder_move();
     move_stop_time =  get_real_timer();
@@ -458,6 +465,7 @@ ponder_move( int side_to_move, int book, int mid, int exact, int wld ) {
       for ( j = 0; j < pv_depth[0]; j++ )
 	best_pv[j] = pv[0][j];
     }
+    check_ponder_hit();
   }
 
   /* Make sure the PV looks reasonable when leaving - either by
@@ -904,7 +912,8 @@ extended_compute_move( int side_to_move, int book_only,
 		evaluated_list[j + 1] = temp;
 	      }
 	  } while ( changed );
-	  display_status(stdout, FALSE);
+	if ( stored_echo )
+	  display_status( stdout, FALSE );
       }
 
       first_iteration = FALSE;
@@ -1556,7 +1565,6 @@ get_search_statistics( int *max_depth, double *node_count ) {
   *max_depth = max_depth_reached;
   if ( prefix_move != 0 )
     (*max_depth)++;
-  adjust_counter( &nodes );
   *node_count = counter_value( &nodes );
 }
 
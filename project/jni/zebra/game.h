@@ -27,16 +27,6 @@ extern "C" {
 
 
 
-typedef struct {
-  EvaluationType eval;
-  int side_to_move;
-  int move;
-  int pv_depth;
-  int pv[60];
-} EvaluatedMove;
-
-
-
 void
 toggle_status_log( int write_log );
 
@@ -71,7 +61,8 @@ ponder_move( int side_to_move,
 	     int book,
 	     int mid,
 	     int exact,
-	     int wld );
+	     int wld,
+	     int timed_depth );
 
 int
 extended_compute_move( int side_to_move,
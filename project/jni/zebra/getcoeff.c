@@ -33,6 +33,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "bitboard.h"
 #include "constant.h"
 #include "error.h"
 #include "eval.h"
@@ -44,6 +45,7 @@
 #include "safemem.h"
 #include "search.h"
 #include "texts.h"
+#include "timer.h"
 
 
 
@@ -99,6 +101,7 @@ static int block_allocated[MAX_BLOCKS], block_set[MAX_BLOCKS];
 static int eval_map[61];
 static AllocationBlock *block_list[MAX_BLOCKS];
 static CoeffSet set[61];
+static const char *pattern_file_name = PATTERN_FILE;
 
 
 
@@ -908,6 +911,108 @@ eval_adjustment( double disc_adjust, double edge_adjust,
 
 
 
+/*
+   SET_COEFF_FILE_NAME
+   Selects the coefficient file read by subsequent calls
+   to init_coeffs().
+*/
+
+void
+set_coeff_file_name( const char *file_name ) {
+  pattern_file_name = file_name;
+}
+
+
+
+/*
+   The bitboard pattern evaluation.
+   A bitboard is viewed as a 64-bit number with bit 8*(row-1)+(col-1)
+   for each square. Row, column and diagonal lines are extracted as
+   bytes where bit i corresponds to digit i of the pattern; mirrored
+   instances use REVERSED_BYTE to restore the digit order.
+*/
+
+#define ROW_BYTE( bits, row ) \
+  ((unsigned int) ((bits) >> (8 * (row))) & 0xff)
+
+#define COLUMN_BYTE( bits, col ) \
+  ((unsigned int) (((((bits) >> (col)) & 0x0101010101010101ULL) * \
+		    0x0102040810204080ULL) >> 56))
+
+#define DIAGONAL_BYTE( bits, mask ) \
+  ((unsigned int) ((((bits) & (mask)) * 0x0101010101010101ULL) >> 56))
+
+#define SQUARE_BIT( bits, row, col ) \
+  ((unsigned int) ((bits) >> (8 * (row) + (col))) & 1)
+
+#define MAIN_DIAGONAL         0x8040201008040201ULL
+#define ANTI_DIAGONAL         0x0102040810204080ULL
+
+/* The largest number of pattern instances containing a square */
+#define MAX_SQUARE_PATTERNS   8
+
+typedef struct {
+  int pattern;
+  int weight;
+} SquarePattern;
+
+/* Maps the top five bits of 0x077cb531 << n to n */
+static const unsigned char lowest_bit_index[32] = {
+  0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+  31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9
+};
+
+static unsigned char reversed_byte[256];
+static int ternary_value[1024];
+static int square_pattern_count[64];
+static SquarePattern square_pattern[64][MAX_SQUARE_PATTERNS];
+
+static void
+extract_pattern_bits( unsigned long long bits, unsigned int *pattern_bits );
+
+
+
+/*
+   INIT_BITBOARD_PATTERNS
+   Prepares the tables used to convert bitboard lines into
+   pattern indices and, for each square, the pattern instances
+   it belongs to along with the weight of its digit.
+*/
+
+static void
+init_bitboard_patterns( void ) {
+  int i, j;
+  unsigned int pattern_bits[PATTERN_COUNT];
+
+  for ( i = 0; i < 256; i++ ) {
+    reversed_byte[i] = 0;
+    for ( j = 0; j < 8; j++ )
+      if ( i & (1 << j) )
+	reversed_byte[i] |= 1 << (7 - j);
+  }
+
+  for ( i = 0; i < 1024; i++ ) {
+    ternary_value[i] = 0;
+    for ( j = 9; j >= 0; j-- )
+      ternary_value[i] = 3 * ternary_value[i] + ((i >> j) & 1);
+  }
+
+  for ( i = 0; i < 64; i++ ) {
+    extract_pattern_bits( 1ULL << i, pattern_bits );
+    square_pattern_count[i] = 0;
+    for ( j = 0; j < PATTERN_COUNT; j++ )
+      if ( pattern_bits[j] != 0 ) {
+	assert( square_pattern_count[i] < MAX_SQUARE_PATTERNS );
+	square_pattern[i][square_pattern_count[i]].pattern = j;
+	square_pattern[i][square_pattern_count[i]].weight =
+	  ternary_value[pattern_bits[j]];
+	square_pattern_count[i]++;
+      }
+  }
+}
+
+
+
 /*
    INIT_COEFFS
    Manages the initialization of all relevant tables.
@@ -924,19 +1029,21 @@ init_coeffs( void ) {
   char sPatternFile[260];
 
   init_memory_handler();
+  init_bitboard_patterns();
 
 #if defined( _WIN32_WCE )
   /* Special hack for CE. */
   getcwd(sPatternFile, sizeof(sPatternFile));
-  strcat(sPatternFile, PATTERN_FILE);
+  strcat(sPatternFile, pattern_file_name);
 #elif defined(ANDROID)
-  sprintf(sPatternFile, "%s/%s", android_files_dir, PATTERN_FILE);
+  sprintf(sPatternFile, "%s/%s", android_files_dir, pattern_file_name);
 #elif defined( __linux__ )
   /* Linux don't support current directory. */
-  strcpy( sPatternFile, PATTERN_FILE );
+  strcpy( sPatternFile, pattern_file_name );
 #else
   getcwd(sPatternFile, sizeof(sPatternFile));
-  strcat(sPatternFile, "/" PATTERN_FILE);
+  strcat(sPatternFile, "/");
+  strcat(sPatternFile, pattern_file_name);
 #endif
 
   coeff_stream = gzopen( sPatternFile, "rb" );
@@ -1045,19 +1152,6 @@ init_coeffs( void ) {
 
 
 
-static long long int
-rdtsc( void ) {
-#if defined(__GNUC__)
-  long long a;
-  asm volatile("rdtsc":"=A" (a));
-  return a;
-#else
-  return 0;
-#endif
-}
-
-
-
 /*
    PATTERN_EVALUATION
    Calculates the static evaluation of the position using
@@ -1075,7 +1169,7 @@ pattern_evaluation( int side_to_move ) {
   int eval_phase;
   short score;
 #if TIME_EVAL
-  long long t0 = rdtsc();
+  unsigned long long t0 = get_cycle_count();
 #endif
 
 #ifdef LOG_EVAL
@@ -3788,13 +3882,13 @@ pattern_evaluation( int side_to_move ) {
 
 #if TIME_EVAL
   {
-    static long long sum = 0;
+    static unsigned long long sum = 0;
     static int calls = 0;
 
     calls++;
-    sum += (rdtsc() - t0);
+    sum += get_cycle_count() - t0;
     if ( (calls & ((1 << 22) - 1)) == 0 ) {
-      printf( "%lld cycles / eval\n", sum / calls );
+      printf( "%llu cycles / eval\n", sum / calls );
     }
   }
 #endif
@@ -3803,6 +3897,277 @@ pattern_evaluation( int side_to_move ) {
 }
 
 
+/*
+   EXTRACT_PATTERN_BITS
+   Gathers the squares of all pattern instances from a bitboard.
+   Bit i of PATTERN_BITS[k] is the square which is digit i of
+   instance k, in the same order as in PATTERN_EVALUATION.
+*/
+
+static void
+extract_pattern_bits( unsigned long long bits, unsigned int *pattern_bits ) {
+  unsigned int row[8], col[8];
+  int i;
+
+  for ( i = 0; i < 8; i++ ) {
+    row[i] = ROW_BYTE( bits, i );
+    col[i] = COLUMN_BYTE( bits, i );
+  }
+
+  pattern_bits[AFILEX1] = col[0] | (SQUARE_BIT( bits, 1, 1 ) << 8) |
+    (SQUARE_BIT( bits, 6, 1 ) << 9);
+  pattern_bits[AFILEX2] = col[7] | (SQUARE_BIT( bits, 1, 6 ) << 8) |
+    (SQUARE_BIT( bits, 6, 6 ) << 9);
+  pattern_bits[AFILEX3] = row[0] | (SQUARE_BIT( bits, 1, 1 ) << 8) |
+    (SQUARE_BIT( bits, 1, 6 ) << 9);
+  pattern_bits[AFILEX4] = row[7] | (SQUARE_BIT( bits, 6, 1 ) << 8) |
+    (SQUARE_BIT( bits, 6, 6 ) << 9);
+
+  for ( i = 0; i < 3; i++ ) {
+    pattern_bits[BFILE1 + 4 * i] = col[i + 1];
+    pattern_bits[BFILE2 + 4 * i] = col[6 - i];
+    pattern_bits[BFILE3 + 4 * i] = row[i + 1];
+    pattern_bits[BFILE4 + 4 * i] = row[6 - i];
+  }
+
+  pattern_bits[DIAG8_1] = DIAGONAL_BYTE( bits, MAIN_DIAGONAL );
+  pattern_bits[DIAG8_2] = reversed_byte[DIAGONAL_BYTE( bits, ANTI_DIAGONAL )];
+  for ( i = 1; i <= 4; i++ ) {
+    pattern_bits[DIAG7_1 + 4 * (i - 1)] =
+      DIAGONAL_BYTE( bits, MAIN_DIAGONAL >> (8 * i) ) >> i;
+    pattern_bits[DIAG7_2 + 4 * (i - 1)] =
+      DIAGONAL_BYTE( bits, MAIN_DIAGONAL << (8 * i) );
+    pattern_bits[DIAG7_3 + 4 * (i - 1)] =
+      reversed_byte[DIAGONAL_BYTE( bits, ANTI_DIAGONAL >> (8 * i) )] >> i;
+    pattern_bits[DIAG7_4 + 4 * (i - 1)] =
+      reversed_byte[DIAGONAL_BYTE( bits, ANTI_DIAGONAL << (8 * i) )];
+  }
+
+  pattern_bits[CORNER33_1] = (row[0] & 7) | ((row[1] & 7) << 3) |
+    ((row[2] & 7) << 6);
+  pattern_bits[CORNER33_2] = (row[7] & 7) | ((row[6] & 7) << 3) |
+    ((row[5] & 7) << 6);
+  pattern_bits[CORNER33_3] = (reversed_byte[row[0]] & 7) |
+    ((reversed_byte[row[1]] & 7) << 3) | ((reversed_byte[row[2]] & 7) << 6);
+  pattern_bits[CORNER33_4] = (reversed_byte[row[7]] & 7) |
+    ((reversed_byte[row[6]] & 7) << 3) | ((reversed_byte[row[5]] & 7) << 6);
+
+  pattern_bits[CORNER52_1] = (row[0] & 31) | ((row[1] & 31) << 5);
+  pattern_bits[CORNER52_2] = (row[7] & 31) | ((row[6] & 31) << 5);
+  pattern_bits[CORNER52_3] = (reversed_byte[row[0]] & 31) |
+    ((reversed_byte[row[1]] & 31) << 5);
+  pattern_bits[CORNER52_4] = (reversed_byte[row[7]] & 31) |
+    ((reversed_byte[row[6]] & 31) << 5);
+  pattern_bits[CORNER52_5] = (col[0] & 31) | ((col[1] & 31) << 5);
+  pattern_bits[CORNER52_6] = (col[7] & 31) | ((col[6] & 31) << 5);
+  pattern_bits[CORNER52_7] = (reversed_byte[col[0]] & 31) |
+    ((reversed_byte[col[1]] & 31) << 5);
+  pattern_bits[CORNER52_8] = (reversed_byte[col[7]] & 31) |
+    ((reversed_byte[col[6]] & 31) << 5);
+}
+
+
+
+/*
+   BITBOARD_PATTERN_INDICES
+   Calculates the index of every pattern instance from the discs
+   of two players, using the same digits as PATTERN_EVALUATION:
+   0 for a disc in MY_BITS, 1 for an empty square and 2 for a disc
+   in OPP_BITS. The index is therefore the ternary value of the
+   empty squares plus twice that of the OPP_BITS discs.
+   With black as MY_BITS these are the indices PATTERN_EVALUATION
+   reads from board[].
+*/
+
+void
+bitboard_pattern_indices( BitBoard my_bits, BitBoard opp_bits,
+			  int *pattern_index ) {
+  int i;
+  unsigned long long my, opp;
+  unsigned int empty_pattern[PATTERN_COUNT];
+  unsigned int opp_pattern[PATTERN_COUNT];
+
+  my = ((unsigned long long) my_bits.high << 32) | my_bits.low;
+  opp = ((unsigned long long) opp_bits.high << 32) | opp_bits.low;
+  extract_pattern_bits( ~(my | opp), empty_pattern );
+  extract_pattern_bits( opp, opp_pattern );
+
+  for ( i = 0; i < PATTERN_COUNT; i++ )
+    pattern_index[i] = ternary_value[empty_pattern[i]] +
+      2 * ternary_value[opp_pattern[i]];
+}
+
+
+
+/*
+   INDEXED_PATTERN_SCORE
+   Sums the pattern values for SIDE_TO_MOVE with DISKS disks
+   played. PATTERN_INDEX holds the indices with black as the
+   first player; for white the tables are read backwards just
+   like in PATTERN_EVALUATION.
+*/
+
+static int
+indexed_pattern_score( const int *pattern_index, int side_to_move,
+		       int disks ) {
+  int i;
+  int eval_phase;
+  short score;
+  CoeffSet *coeffs;
+
+  /* Load and/or initialize the pattern coefficients */
+
+  eval_phase = eval_map[disks];
+  if ( !set[eval_phase].loaded )
+    load_set( eval_phase );
+  coeffs = &set[eval_phase];
+
+  /* The constant feature and the parity feature */
+
+  score = coeffs->parity_constant[disks & 1];
+
+  /* The pattern features */
+
+  if ( side_to_move == BLACKSQ ) {
+    for ( i = AFILEX1; i <= AFILEX4; i++ )
+      score += coeffs->afile2x[pattern_index[i]];
+    for ( i = BFILE1; i <= BFILE4; i++ )
+      score += coeffs->bfile[pattern_index[i]];
+    for ( i = CFILE1; i <= CFILE4; i++ )
+      score += coeffs->cfile[pattern_index[i]];
+    for ( i = DFILE1; i <= DFILE4; i++ )
+      score += coeffs->dfile[pattern_index[i]];
+    for ( i = DIAG8_1; i <= DIAG8_2; i++ )
+      score += coeffs->diag8[pattern_index[i]];
+    for ( i = DIAG7_1; i <= DIAG7_4; i++ )
+      score += coeffs->diag7[pattern_index[i]];
+    for ( i = DIAG6_1; i <= DIAG6_4; i++ )
+      score += coeffs->diag6[pattern_index[i]];
+    for ( i = DIAG5_1; i <= DIAG5_4; i++ )
+      score += coeffs->diag5[pattern_index[i]];
+    for ( i = DIAG4_1; i <= DIAG4_4; i++ )
+      score += coeffs->diag4[pattern_index[i]];
+    for ( i = CORNER33_1; i <= CORNER33_4; i++ )
+      score += coeffs->corner33[pattern_index[i]];
+    for ( i = CORNER52_1; i <= CORNER52_8; i++ )
+      score += coeffs->corner52[pattern_index[i]];
+  }
+  else {
+    for ( i = AFILEX1; i <= AFILEX4; i++ )
+      score += coeffs->afile2x_last[-pattern_index[i]];
+    for ( i = BFILE1; i <= BFILE4; i++ )
+      score += coeffs->bfile_last[-pattern_index[i]];
+    for ( i = CFILE1; i <= CFILE4; i++ )
+      score += coeffs->cfile_last[-pattern_index[i]];
+    for ( i = DFILE1; i <= DFILE4; i++ )
+      score += coeffs->dfile_last[-pattern_index[i]];
+    for ( i = DIAG8_1; i <= DIAG8_2; i++ )
+      score += coeffs->diag8_last[-pattern_index[i]];
+    for ( i = DIAG7_1; i <= DIAG7_4; i++ )
+      score += coeffs->diag7_last[-pattern_index[i]];
+    for ( i = DIAG6_1; i <= DIAG6_4; i++ )
+      score += coeffs->diag6_last[-pattern_index[i]];
+    for ( i = DIAG5_1; i <= DIAG5_4; i++ )
+      score += coeffs->diag5_last[-pattern_index[i]];
+    for ( i = DIAG4_1; i <= DIAG4_4; i++ )
+      score += coeffs->diag4_last[-pattern_index[i]];
+    for ( i = CORNER33_1; i <= CORNER33_4; i++ )
+      score += coeffs->corner33_last[-pattern_index[i]];
+    for ( i = CORNER52_1; i <= CORNER52_8; i++ )
+      score += coeffs->corner52_last[-pattern_index[i]];
+  }
+
+  return score;
+}
+
+
+
+/*
+   BITBOARD_PATTERN_EVALUATION
+   INDEXED_PATTERN_EVALUATION
+   Calculate the same static evaluation as PATTERN_EVALUATION
+   without reading board[] or piece_count[], either from the discs
+   of the player to move and the opponent or from MY_BITS, the
+   pattern indices of the position (see BITBOARD_PATTERN_INDICES)
+   and the color to move. DISKS is the number of disks played in
+   the position.
+*/
+
+int
+bitboard_pattern_evaluation( BitBoard my_bits, BitBoard opp_bits,
+			     int disks ) {
+  int pattern_index[PATTERN_COUNT];
+
+  /* Any player wiped out? Game over then... */
+
+  if ( (my_bits.high | my_bits.low) == 0 )
+    return -(MIDGAME_WIN + 64);
+  if ( (opp_bits.high | opp_bits.low) == 0 )
+    return +(MIDGAME_WIN + 64);
+
+  bitboard_pattern_indices( my_bits, opp_bits, pattern_index );
+
+  return indexed_pattern_score( pattern_index, BLACKSQ, disks );
+}
+
+
+int
+indexed_pattern_evaluation( BitBoard my_bits, const int *pattern_index,
+			    int side_to_move, int disks ) {
+  /* The player who just moved can't have been wiped out */
+
+  if ( (my_bits.high | my_bits.low) == 0 )
+    return -(MIDGAME_WIN + 64);
+
+  return indexed_pattern_score( pattern_index, side_to_move, disks );
+}
+
+
+
+/*
+   MOVE_PATTERN_INDICES
+   Calculates the pattern indices NEW_INDEX (with black as the first
+   player, see BITBOARD_PATTERN_INDICES) after SIDE_TO_MOVE plays
+   MOVE in the position with the indices PATTERN_INDEX, without
+   extracting the patterns again. CHANGED_BITS are the move and the
+   discs flipped by it.
+*/
+
+void
+move_pattern_indices( const int *pattern_index, BitBoard changed_bits,
+		      int move, int side_to_move, int *new_index ) {
+  int i, j;
+  int square;
+  int step;
+  unsigned int bits;
+  const SquarePattern *pattern;
+
+  memcpy( new_index, pattern_index, PATTERN_COUNT * sizeof( int ) );
+
+  /* Black discs are digit 0 and white discs digit 2, so a flipped
+     disc changes its digit by two units and the move square,
+     which was empty (digit 1), by one unit */
+
+  step = (side_to_move == BLACKSQ) ? -1 : +1;
+  for ( i = 0; i < 2; i++ ) {
+    bits = (i == 0) ? changed_bits.low : changed_bits.high;
+    while ( bits != 0 ) {
+      square = 32 * i + lowest_bit_index[((bits & (0u - bits)) *
+					  0x077cb531u) >> 27];
+      bits &= bits - 1;
+      pattern = square_pattern[square];
+      for ( j = 0; j < square_pattern_count[square]; j++ )
+	new_index[pattern[j].pattern] += 2 * step * pattern[j].weight;
+    }
+  }
+
+  square = 8 * (move / 10 - 1) + (move % 10 - 1);
+  pattern = square_pattern[square];
+  for ( j = 0; j < square_pattern_count[square]; j++ )
+    new_index[pattern[j].pattern] -= step * pattern[j].weight;
+}
+
+
 /*
    REMOVE_SPECIFIC_COEFFS
    Removes the interpolated coefficients for a
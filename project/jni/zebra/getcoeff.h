@@ -17,12 +17,19 @@
 
 
 
+#include "bitboard.h"
+
+
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 
 
+void
+set_coeff_file_name( const char *file_name );
+
 void
 init_coeffs( void );
 
@@ -35,6 +42,22 @@ clear_coeffs( void );
 int
 pattern_evaluation( int side_to_move );
 
+void
+bitboard_pattern_indices( BitBoard my_bits, BitBoard opp_bits,
+			  int *pattern_index );
+
+int
+bitboard_pattern_evaluation( BitBoard my_bits, BitBoard opp_bits,
+			     int disks );
+
+int
+indexed_pattern_evaluation( BitBoard my_bits, const int *pattern_index,
+			    int side_to_move, int disks );
+
+void
+move_pattern_indices( const int *pattern_index, BitBoard changed_bits,
+		      int move, int side_to_move, int *new_index );
+
 
 
 #ifdef __cplusplus
@@ -26,6 +26,7 @@
 #include "myrandom.h"
 #include "safemem.h"
 #include "search.h"
+#include "searchstat.h"
 
 
 
@@ -511,17 +512,24 @@ find_hash( HashEntry *entry, int reverse_mode ) {
 
   index1 = code1 & hash_mask;
   index2 = SECONDARY_HASH( index1 );
+  STAT_INCREMENT( hash_probes );
   if ( hash_table[index1].key2 == code2 ) {
     if ( ((hash_table[index1].key1_selectivity_flags_draft ^ code1) & KEY1_MASK) == 0 ) {
       compact_to_wide( &hash_table[index1], entry );
+      STAT_INCREMENT( hash_hits );
       return;
     }
   }
   else if ( (hash_table[index2].key2 == code2) &&
 	    (((hash_table[index2].key1_selectivity_flags_draft ^ code1) & KEY1_MASK) == 0) ) {
     compact_to_wide( &hash_table[index2], entry );
+    STAT_INCREMENT( hash_hits );
     return;
   }
+#ifdef SEARCH_STATS
+  if ( (hash_table[index1].key1_selectivity_flags_draft & DRAFT_MASK) != 0 )
+    search_stats.hash_collisions++;
+#endif
 
   entry->draft = NO_HASH_MOVE;
   entry->flags = UPPER_BOUND;
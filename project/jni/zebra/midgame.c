@@ -18,6 +18,8 @@
 #include <stdlib.h>
 
 #include "autoplay.h"
+#include "bitboard.h"
+#include "bitbtest.h"
 #include "constant.h"
 #include "display.h"
 #include "eval.h"
@@ -30,8 +32,10 @@
 #include "myrandom.h"
 #include "patterns.h"
 #include "pcstat.h"
+#include "ponder.h"
 #include "probcut.h"
 #include "search.h"
+#include "searchstat.h"
 #include "texts.h"
 #include "timer.h"
 
@@ -202,20 +206,19 @@ toggle_perturbation_usage( int toggle ) {
 
 /*
   ADVANCE_MOVE
-  Swaps a move and its predecessor in the move list if it's
-  not already first in the list.
+  Swaps a move and its predecessor in the move list for STAGE
+  if it's not already first in the list.
 */
 
 INLINE static
 void
-advance_move( int index ) {
+advance_move( int stage, int index ) {
   int temp_move;
 
   if ( index > 0 ) {
-    temp_move = sorted_move_order[disks_played][index];
-    sorted_move_order[disks_played][index] =
-      sorted_move_order[disks_played][index - 1];
-    sorted_move_order[disks_played][index - 1] = temp_move;
+    temp_move = sorted_move_order[stage][index];
+    sorted_move_order[stage][index] = sorted_move_order[stage][index - 1];
+    sorted_move_order[stage][index - 1] = temp_move;
   }
 }
 
@@ -238,54 +241,121 @@ static_or_terminal_evaluation( int side_to_move ) {
 
 
 /*
-   FAST_TREE_SEARCH
-   The recursive tree search function. It uses negascout for
-   tree pruning.
+   BITBOARD_VALID_MOVE
+   Determines if MOVE is legal for the player with MY_BITS.
+*/
+
+INLINE static int
+bitboard_valid_move( BitBoard my_bits, BitBoard opp_bits, int move ) {
+  if ( (move < 11) || (move > 88) ||
+       ((square_mask[move].high | square_mask[move].low) == 0) ||
+       (((my_bits.high | opp_bits.high) & square_mask[move].high) |
+	((my_bits.low | opp_bits.low) & square_mask[move].low)) )
+    return FALSE;
+
+  return TestFlips_bitboard[move - 11]( my_bits.high, my_bits.low,
+					opp_bits.high, opp_bits.low ) > 0;
+}
+
+
+
+/*
+   UPDATE_BITBOARD_HASH
+   Updates the hash codes for SIDE_TO_MOVE playing MOVE; the
+   bits in FLIPPED are the discs turned.
+*/
+
+INLINE static void
+update_bitboard_hash( BitBoard flipped, int side_to_move, int move ) {
+  int i;
+  int pos;
+  unsigned int bits;
+  unsigned int diff1, diff2;
+
+  diff1 = hash_put_value1[side_to_move][move];
+  diff2 = hash_put_value2[side_to_move][move];
+  for ( i = 0; i < 2; i++ ) {
+    bits = (i == 0) ? flipped.low : flipped.high;
+    for ( pos = 11 + 40 * i; bits != 0; bits >>= 8, pos += 10 ) {
+      int j;
+
+      for ( j = 0; j < 8; j++ )
+	if ( bits & (1 << j) ) {
+	  diff1 ^= hash_flip1[pos + j];
+	  diff2 ^= hash_flip2[pos + j];
+	}
+    }
+  }
+  hash1 ^= diff1;
+  hash2 ^= diff2;
+}
+
+
+
+/*
+   BITBOARD_TREE_SEARCH
+   The search performed by FAST_TREE_SEARCH. The position is passed
+   by value as the discs of the player to move and of the opponent
+   with DISKS disks played, so moves are made by the bitboard flip
+   functions and taken back by returning; neither board[] nor the
+   flip stack is touched. The hash codes are updated only where the
+   children use the hash table. PATTERN_INDEX holds the pattern
+   indices of the position (see BITBOARD_PATTERN_INDICES), or is
+   NULL if they haven't been extracted yet; the indices of the
+   children are then updated from them.
 */
 
 static int
-fast_tree_search( int level, int max_depth, int side_to_move, int alpha,
-		  int beta, int allow_hash, int void_legal ) {
+bitboard_tree_search( BitBoard my_bits, BitBoard opp_bits, int side_to_move,
+		      int disks, int remains, int alpha, int beta,
+		      int allow_hash, int void_legal,
+		      const int *pattern_index ) {
   int curr_val, best;
   int move_index, move;
   int best_move_index, best_move;
   int first;
-  int remains;
   int use_hash, new_use_hash;
   int curr_alpha;
   int empties_remaining;
+  int *move_order;
+  int own_index[PATTERN_COUNT], new_index[PATTERN_COUNT];
+  unsigned int stored_hash1, stored_hash2;
+  BitBoard occupied, changed, flipped, new_my_bits, new_opp_bits;
   HashEntry entry;
 
   INCREMENT_COUNTER( nodes );
-
-  if ( level >= max_depth )
-    return static_or_terminal_evaluation( side_to_move );
+  STAT_MID_NODE( remains );
 
   /* Check the hash table */
 
-  remains = max_depth - level;
-
   use_hash = (remains >= HASH_THRESHOLD) && USE_HASH_TABLE && allow_hash;
   if ( use_hash && allow_midgame_hash_probe ) {
     find_hash( &entry, MIDGAME_MODE );
     if ( (entry.draft >= remains) &&
 	 (entry.selectivity == 0) &&
-	 valid_move( entry.move[0], side_to_move ) &&
+	 bitboard_valid_move( my_bits, opp_bits, entry.move[0] ) &&
 	 (entry.flags & MIDGAME_SCORE) &&
 	 ((entry.flags & EXACT_VALUE) ||
 	  ((entry.flags & LOWER_BOUND) && entry.eval >= beta) ||
 	  ((entry.flags & UPPER_BOUND) && entry.eval <= alpha)) ) {
       best_mid_move = entry.move[0];
+      STAT_INCREMENT( mid_hash_cutoffs );
       return entry.eval;
     }
   }
 
-  /* Reorder the move lists now and then to keep the empty squares up front */
+  /* Search */
 
-  if ( (nodes.lo & 4095) == 0 )
-    reorder_move_list( disks_played );
+  FULL_OR( occupied, my_bits, opp_bits );
+  move_order = sorted_move_order[disks];
 
-  /* Search */
+  if ( pattern_index == NULL ) {
+    if ( side_to_move == BLACKSQ )
+      bitboard_pattern_indices( my_bits, opp_bits, own_index );
+    else
+      bitboard_pattern_indices( opp_bits, my_bits, own_index );
+    pattern_index = own_index;
+  }
 
   first = TRUE;
 
@@ -293,86 +363,88 @@ fast_tree_search( int level, int max_depth, int side_to_move, int alpha,
   best_move_index = -1;
   best = -INFINITE_EVAL;
 
-  if ( remains == 1 ) {  /* Plain alpha-beta last ply */
-    empties_remaining = 60 - disks_played;
-    for ( move_index = 0; move_index < MOVE_ORDER_SIZE; move_index++ ) {
-      move = sorted_move_order[disks_played][move_index];
-      if ( board[move] == EMPTY ) {
-	if ( make_move_no_hash( side_to_move, move ) != 0 ) {
-	  curr_val = -static_or_terminal_evaluation( OPP( side_to_move ) );
-	  unmake_move_no_hash( side_to_move, move );
-	  INCREMENT_COUNTER( nodes );
-	  if ( curr_val > best ) {
-	    best = curr_val;
-	    best_move_index = move_index;
-	    best_move = move;
-	    if ( curr_val >= beta ) {
-	      advance_move( move_index );
-	      best_mid_move = best_move;
-	      if ( use_hash && allow_midgame_hash_update )
-		add_hash( MIDGAME_MODE, best, best_move,
-			  MIDGAME_SCORE | LOWER_BOUND, remains, 0 );
-	      return best;
-	    }
+  new_use_hash = (remains >= HASH_THRESHOLD + 1) && use_hash;
+  stored_hash1 = hash1;
+  stored_hash2 = hash2;
+  empties_remaining = 60 - disks;
+  for ( move_index = 0; move_index < MOVE_ORDER_SIZE; move_index++ ) {
+    move = move_order[move_index];
+    if ( ((occupied.high & square_mask[move].high) |
+	  (occupied.low & square_mask[move].low)) == 0 ) {
+      if ( TestFlips_bitboard[move - 11]( my_bits.high, my_bits.low,
+					  opp_bits.high, opp_bits.low ) ) {
+	new_my_bits = bb_flips;
+	FULL_ANDNOT( new_opp_bits, opp_bits, new_my_bits );
+	FULL_XOR( changed, new_my_bits, my_bits );
+	if ( remains == 1 ) {  /* Plain alpha-beta last ply */
+	  if ( disks == 59 )
+	    curr_val = -bitboard_terminal_evaluation( new_opp_bits,
+						      new_my_bits );
+	  else {
+	    move_pattern_indices( pattern_index, changed, move, side_to_move,
+				  new_index );
+	    curr_val = -indexed_evaluation( new_opp_bits, new_index,
+					    OPP( side_to_move ), disks + 1 );
 	  }
-	  first = FALSE;
+	  INCREMENT_COUNTER( nodes );
+	  STAT_MID_NODE( 0 );
 	}
-	empties_remaining--;
-	if ( empties_remaining == 0 )
-	  break;
-      }
-    }
-  }
-  else {  /* Principal variation search for deeper searches */
-    new_use_hash = (remains >= HASH_THRESHOLD + 1) && use_hash;
-    curr_alpha = alpha;
-    empties_remaining = 60 - disks_played;
-    for ( move_index = 0; move_index < MOVE_ORDER_SIZE; move_index++ ) {
-      move = sorted_move_order[disks_played][move_index];
-      if ( board[move] == EMPTY ) {
-	if ( make_move( side_to_move, move, new_use_hash ) != 0 ) {
-	  if ( first ) {
-	    best = curr_val =
-	      -fast_tree_search( level + 1, max_depth, OPP( side_to_move ),
-				 -beta, -curr_alpha, allow_hash, TRUE );
-	    best_move = move;
-	    best_move_index = move_index;
+	else {  /* Principal variation search for deeper searches */
+	  move_pattern_indices( pattern_index, changed, move, side_to_move,
+				new_index );
+	  if ( new_use_hash ) {
+	    FULL_XOR( flipped, changed, square_mask[move] );
+	    update_bitboard_hash( flipped, side_to_move, move );
 	  }
+	  if ( first )
+	    curr_val =
+	      -bitboard_tree_search( new_opp_bits, new_my_bits,
+				     OPP( side_to_move ), disks + 1,
+				     remains - 1, -beta, -alpha,
+				     allow_hash, TRUE, new_index );
 	  else {
-	    curr_alpha = MAX( best, curr_alpha );
+	    curr_alpha = MAX( best, alpha );
 	    curr_val =
-	      -fast_tree_search( level + 1, max_depth, OPP( side_to_move ),
-				 -(curr_alpha + 1), -curr_alpha, allow_hash,
-				 TRUE );
+	      -bitboard_tree_search( new_opp_bits, new_my_bits,
+				     OPP( side_to_move ), disks + 1,
+				     remains - 1, -(curr_alpha + 1),
+				     -curr_alpha, allow_hash, TRUE,
+				     new_index );
 	    if ( (curr_val > curr_alpha) && (curr_val < beta) )
 	      curr_val =
-		-fast_tree_search( level + 1, max_depth, OPP( side_to_move ),
-				   -beta, INFINITE_EVAL, allow_hash, TRUE );
-	    if ( curr_val > best ) {
-	      best_move = move;
-	      best_move_index = move_index;
-	      best = curr_val;
-	    }
+		-bitboard_tree_search( new_opp_bits, new_my_bits,
+				       OPP( side_to_move ), disks + 1,
+				       remains - 1, -beta, INFINITE_EVAL,
+				       allow_hash, TRUE, new_index );
 	  }
-	  unmake_move( side_to_move, move );
-	  if ( best >= beta ) {
-	    advance_move( move_index );
+	  hash1 = stored_hash1;
+	  hash2 = stored_hash2;
+	}
+	if ( curr_val > best ) {
+	  best = curr_val;
+	  best_move_index = move_index;
+	  best_move = move;
+	  if ( curr_val >= beta ) {
+	    STAT_INCREMENT( mid_fail_highs );
+	    STAT_INCREMENT_IF( first, mid_first_fail_highs );
+	    advance_move( disks, move_index );
 	    best_mid_move = best_move;
 	    if ( use_hash && allow_midgame_hash_update )
 	      add_hash( MIDGAME_MODE, best, best_move,
 			MIDGAME_SCORE | LOWER_BOUND, remains, 0 );
 	    return best;
 	  }
-	  first = FALSE;
 	}
-	empties_remaining--;
-	if ( empties_remaining == 0 )
-	  break;
+	first = FALSE;
       }
+      empties_remaining--;
+      if ( empties_remaining == 0 )
+	break;
     }
   }
+
   if ( !first ) {
-    advance_move( best_move_index );
+    advance_move( disks, best_move_index );
     best_mid_move = best_move;
     if ( use_hash && allow_midgame_hash_update ) {
       if ( best > alpha )
@@ -387,16 +459,47 @@ fast_tree_search( int level, int max_depth, int side_to_move, int alpha,
   else if ( void_legal ) {  /* I pass, other player's turn now */
     hash1 ^= hash_flip_color1;
     hash2 ^= hash_flip_color2;
-    curr_val = -fast_tree_search( level, max_depth, OPP( side_to_move ),
-				  -beta, -alpha, allow_hash, FALSE );
+    curr_val = -bitboard_tree_search( opp_bits, my_bits, OPP( side_to_move ),
+				      disks, remains, -beta, -alpha,
+				      allow_hash, FALSE, pattern_index );
     hash1 ^= hash_flip_color1;
     hash2 ^= hash_flip_color2;
     return curr_val;
   }
-  else {  /* Both players had to pass ==> evaluate board as final */
-    curr_val = terminal_evaluation( side_to_move );
-    return curr_val;
+  else  /* Both players had to pass ==> evaluate board as final */
+    return bitboard_terminal_evaluation( my_bits, opp_bits );
+}
+
+
+
+/*
+   FAST_TREE_SEARCH
+   The recursive tree search function. It uses negascout for
+   tree pruning. The search itself is done on bitboards by
+   BITBOARD_TREE_SEARCH.
+*/
+
+static int
+fast_tree_search( int level, int max_depth, int side_to_move, int alpha,
+		  int beta, int allow_hash, int void_legal ) {
+  BitBoard my_bits, opp_bits;
+
+  if ( level >= max_depth ) {
+    INCREMENT_COUNTER( nodes );
+    STAT_MID_NODE( 0 );
+    return static_or_terminal_evaluation( side_to_move );
   }
+
+  /* Reorder the move lists now and then to keep the empty squares up front */
+
+  if ( (nodes.count & 4095) == 0 )
+    reorder_move_list( disks_played );
+
+  set_bitboards( board, side_to_move, &my_bits, &opp_bits );
+
+  return bitboard_tree_search( my_bits, opp_bits, side_to_move, disks_played,
+			       max_depth - level, alpha, beta, allow_hash,
+			       void_legal, NULL );
 }
 
 
@@ -474,6 +577,7 @@ tree_search( int level,
 
   if ( level >= max_depth ) {
     INCREMENT_COUNTER( nodes );
+    STAT_MID_NODE( 0 );
     return static_or_terminal_evaluation( side_to_move );
   }
 
@@ -488,6 +592,7 @@ tree_search( int level,
   }
 
   INCREMENT_COUNTER( nodes );
+  STAT_MID_NODE( remains );
 
   /* Check the hash table */
 
@@ -513,6 +618,7 @@ tree_search( int level,
 	  ((entry.flags & UPPER_BOUND) && entry.eval <= alpha)) ) {
       pv[level][level] = entry.move[0];
       pv_depth[level] = level + 1;
+      STAT_INCREMENT( mid_hash_cutoffs );
       return entry.eval;
     }
   }
@@ -546,6 +652,7 @@ tree_search( int level,
       shallow_remains = mpc_cut[remains].cut_depth[cut];
       if ( level + shallow_remains < FULL_WIDTH_DEPTH )
 	continue;
+      STAT_INCREMENT( mid_mpc_tries );
 
       if  ( shallow_remains > 1 ) {  /* "Deep" shallow search */
 	if ( cut == 0 ) {
@@ -572,12 +679,14 @@ tree_search( int level,
 	    if ( use_hash && allow_midgame_hash_update )
 	      add_hash( MIDGAME_MODE, beta, pv[level][level],
 			MIDGAME_SCORE | LOWER_BOUND, remains, selectivity );
+	    STAT_INCREMENT( mid_mpc_cuts );
 	    return beta;
 	  }
 	  else if ( shallow_val <= alpha_bound ) {
 	    if ( use_hash && allow_midgame_hash_update )
 	      add_hash( MIDGAME_MODE, alpha, pv[level][level],
 			MIDGAME_SCORE | UPPER_BOUND, remains, selectivity );
+	    STAT_INCREMENT( mid_mpc_cuts );
 	    return alpha;
 	  }
 	  else {
@@ -616,6 +725,7 @@ tree_search( int level,
 	    if ( use_hash && allow_midgame_hash_update )
 	      add_hash( MIDGAME_MODE, beta, pv[level][level],
 			MIDGAME_SCORE | LOWER_BOUND, remains, selectivity );
+	    STAT_INCREMENT( mid_mpc_cuts );
 	    return beta;
 	  }
 	}
@@ -627,6 +737,7 @@ tree_search( int level,
 	    if ( use_hash && allow_midgame_hash_update )
 	      add_hash( MIDGAME_MODE, alpha, pv[level][level],
 			MIDGAME_SCORE | UPPER_BOUND, remains, selectivity );
+	    STAT_INCREMENT( mid_mpc_cuts );
 	    return alpha;
 	  }
 	}
@@ -642,6 +753,7 @@ tree_search( int level,
 	      curr_val = -static_or_terminal_evaluation( OPP( side_to_move ) );
 	      unmake_move_no_hash( side_to_move, move );
 	      INCREMENT_COUNTER( nodes );
+	      STAT_MID_NODE( 0 );
 	      if ( curr_val > best ) {
 		best = curr_val;
 		if ( best >= beta_bound ) {
@@ -649,6 +761,7 @@ tree_search( int level,
 		    add_hash( MIDGAME_MODE, beta, pv[level][level],
 			      MIDGAME_SCORE | LOWER_BOUND, remains,
 			      selectivity );
+		  STAT_INCREMENT( mid_mpc_cuts );
 		  return beta;
 		}
 	      }
@@ -668,6 +781,7 @@ tree_search( int level,
 	  if ( use_hash && allow_midgame_hash_update )
 	    add_hash( MIDGAME_MODE, alpha, pv[level][level],
 		      MIDGAME_SCORE | UPPER_BOUND, remains, selectivity );
+	  STAT_INCREMENT( mid_mpc_cuts );
 	  return alpha;
 	}
 	pre_search_done = TRUE;
@@ -770,12 +884,12 @@ tree_search( int level,
     counter_phase = (counter_phase + 1) & 63;
     if ( counter_phase == 0 ) {
       double node_val;
-      adjust_counter( &nodes );
       node_val = counter_value( &nodes );
       if ( node_val - last_panic_check >= EVENT_CHECK_INTERVAL ) {
-	/* Time abort? */
+	/* Time abort? Has the opponent moved while we were pondering? */
 
 	last_panic_check = node_val;
+	check_ponder_hit();
 	check_panic_abort();
 
 	/* Display available search information */
@@ -842,7 +956,9 @@ tree_search( int level,
     }
 
     if ( best >= beta ) {
-      advance_move( move_index );
+      STAT_INCREMENT( mid_fail_highs );
+      STAT_INCREMENT_IF( searched == 0, mid_first_fail_highs );
+      advance_move( disks_played, move_index );
       if ( use_hash && allow_midgame_hash_update )
 	add_hash_extended( MIDGAME_MODE, best, best_list,
 			   MIDGAME_SCORE | LOWER_BOUND, remains, selectivity );
@@ -860,7 +976,7 @@ tree_search( int level,
 	      HASH_AFTER, hash1, hash2 );
 #endif
   if ( move_count[disks_played] > 0 ) {
-      advance_move( best_move_index );
+      advance_move( disks_played, best_move_index );
     if ( use_hash && allow_midgame_hash_update ) {
       if ( best > alpha )
 	add_hash_extended( MIDGAME_MODE, best, best_list,
@@ -929,6 +1045,7 @@ root_tree_search( int level, int max_depth, int side_to_move, int alpha,
   int best_list_index, best_list_length;
   int selectivity;
   int offset;
+  int multi, bound;
   int best_list[4];
   HashEntry entry;
 #if CHECK_HASH_CODES && defined( TEXT_BASED )
@@ -936,8 +1053,12 @@ root_tree_search( int level, int max_depth, int side_to_move, int alpha,
 #endif
 
   remains = max_depth - level;
+  multi = (get_multi_pv() > 1);
+  if ( multi )
+    clear_root_lines();
 
   INCREMENT_COUNTER( nodes );
+  STAT_MID_NODE( remains );
 
   use_hash = (remains >= HASH_THRESHOLD) && USE_HASH_TABLE && allow_hash;
   if ( USE_MPC && allow_mpc )
@@ -1071,7 +1192,46 @@ root_tree_search( int level, int max_depth, int side_to_move, int alpha,
     update_pv = FALSE;
     offset = score_perturbation[move];
 
-    if ( searched == 0 ) {
+    if ( multi ) {
+      /* Multi-PV: the moves are searched with a null window around
+	 the worst of the best moves kept, and only the ones which
+	 beat it are searched again for an exact score. */
+
+      bound = root_line_bound( alpha );
+      if ( get_root_line_count() < get_multi_pv() )
+	curr_val =
+	  perturb_score( -tree_search( level + 1, max_depth,
+				       OPP( side_to_move ),
+				       -(beta - offset), -(alpha - offset),
+				       allow_hash, allow_mpc, TRUE ),
+			 offset );
+      else {
+	curr_val =
+	  perturb_score( -tree_search( level + 1, max_depth,
+				       OPP( side_to_move ),
+				       -(bound - offset + 1),
+				       -(bound - offset), allow_hash,
+				       allow_mpc, TRUE ),
+			 offset );
+	if ( (curr_val > bound) && (curr_val < beta) )
+	  curr_val =
+	    perturb_score( -tree_search( level + 1, max_depth,
+					 OPP( side_to_move ),
+					 -(beta - offset), INFINITE_EVAL,
+					 allow_hash, allow_mpc, TRUE ),
+			   offset );
+      }
+      if ( !is_panic_abort() && !force_return )
+	add_root_line( side_to_move, move, curr_val );
+      if ( (searched == 0) || (curr_val > best) ) {
+	best = curr_val;
+	best_move_index = move_index;
+	update_pv = TRUE;
+	if ( (searched == 0) || (!is_panic_abort() && !force_return) )
+	  best_mid_root_move = move;
+      }
+    }
+    else if ( searched == 0 ) {
       best = curr_val =
 	perturb_score( -tree_search( level + 1, max_depth, OPP( side_to_move ),
 				     -(beta - offset), -(curr_alpha - offset),
@@ -1140,8 +1300,10 @@ root_tree_search( int level, int max_depth, int side_to_move, int alpha,
 	pv[level][j] = pv[level + 1][j];
     }
 
-    if ( best >= beta ) {
-      advance_move( move_index );
+    if ( multi ? (root_line_bound( alpha ) >= beta) : (best >= beta) ) {
+      STAT_INCREMENT( mid_fail_highs );
+      STAT_INCREMENT_IF( searched == 0, mid_first_fail_highs );
+      advance_move( disks_played, move_index );
       if ( use_hash && allow_midgame_hash_update )
 	add_hash_extended( MIDGAME_MODE, best, best_list,
 			   MIDGAME_SCORE | LOWER_BOUND, remains, selectivity );
@@ -1150,7 +1312,7 @@ root_tree_search( int level, int max_depth, int side_to_move, int alpha,
 
     /* For symmetry reasons, the score for any move is the score of the
        position for the initial position. */
-    if ( disks_played == 0 ) {
+    if ( (disks_played == 0) && !multi ) {
       add_hash_extended( MIDGAME_MODE, best, best_list,
 			 MIDGAME_SCORE | EXACT_VALUE, remains, selectivity );
       return best;
@@ -1168,7 +1330,7 @@ root_tree_search( int level, int max_depth, int side_to_move, int alpha,
 	      HASH_AFTER, hash1, hash2 );
 #endif
   if ( move_count[disks_played] > 0 ) {
-      advance_move( best_move_index );
+      advance_move( disks_played, best_move_index );
     if ( use_hash && allow_midgame_hash_update ) {
       if ( best > alpha )
 	add_hash_extended( MIDGAME_MODE, best, best_list,
@@ -1220,6 +1382,7 @@ protected_one_ply_search( int side_to_move ) {
 
   for ( i = 0; i < move_count[disks_played]; i++ ) {
     INCREMENT_COUNTER( nodes );
+    STAT_MID_NODE( 1 );
     move = move_list[disks_played][i];
     (void) make_move( side_to_move,  move, TRUE );
     depth_one_score = -static_evaluation( OPP( side_to_move ) );
@@ -1248,6 +1411,39 @@ protected_one_ply_search( int side_to_move ) {
 }
 
 
+/*
+  PUBLISH_MIDGAME_LINES
+  Converts the scores of the best root moves found by a completed
+  multi-PV search into evaluations, using endgame scores for lines
+  which reach the end of the game, and publishes them. Unlike the
+  score of the position, the scores aren't averaged over the last
+  two depths.
+*/
+
+static void
+publish_midgame_lines( int depth ) {
+  int i;
+  int score;
+
+  for ( i = 0; i < get_root_line_count(); i++ ) {
+    score = get_root_line_score( i );
+    if ( score >= MIDGAME_WIN )
+      set_root_line_eval( i, create_eval_info( EXACT_EVAL, WON_POSITION,
+					       (score - MIDGAME_WIN) * 128,
+					       0.0, depth, FALSE ) );
+    else if ( score <= -MIDGAME_WIN )
+      set_root_line_eval( i, create_eval_info( EXACT_EVAL, LOST_POSITION,
+					       (score + MIDGAME_WIN) * 128,
+					       0.0, depth, FALSE ) );
+    else
+      set_root_line_eval( i, create_eval_info( MIDGAME_EVAL,
+					       UNSOLVED_POSITION, score,
+					       0.0, depth, FALSE ) );
+  }
+  publish_root_lines();
+}
+
+
 /*
    MIDDLE_GAME
    side_to_move = the side whose turn it is to move
@@ -1265,6 +1461,7 @@ middle_game( int side_to_move, int max_depth,
   int enable_mpc;
   int base_stage;
   int full_length_line;
+  int multi;
   HashEntry entry;
 
   last_panic_check = 0.0;
@@ -1278,6 +1475,7 @@ middle_game( int side_to_move, int max_depth,
   old_val = -SEARCH_ABORT;
 
   enable_mpc = (max_depth >= MIN_MPC_DEPTH);
+  multi = (get_multi_pv() > 1);
   initial_depth = MAX( 1, max_depth - 2 );
   initial_depth = max_depth;  /* Disable I.D. in this function */
 
@@ -1305,12 +1503,16 @@ middle_game( int side_to_move, int max_depth,
     alpha = -INFINITE_EVAL;
     beta = +INFINITE_EVAL;
 #endif
+    if ( multi ) {  /* The scores of all lines kept must be exact */
+      alpha = -INFINITE_EVAL;
+      beta = +INFINITE_EVAL;
+    }
 
     inherit_move_lists( disks_played + max_depth );
 
     /* The actual search */
 
-    if ( depth == 1 )  /* Fix to make it harder to wipe out depth-1 Zebra */
+    if ( (depth == 1) && !multi )  /* Fix to make it harder to wipe out depth-1 Zebra */
       val = protected_one_ply_search( side_to_move );
     else if ( enable_mpc ) {
       val =  root_tree_search( 0, depth, side_to_move, alpha, beta, TRUE,
@@ -1408,6 +1610,9 @@ middle_game( int side_to_move, int max_depth,
       *eval_info = create_eval_info( MIDGAME_EVAL, UNSOLVED_POSITION,
 				     adjusted_val, 0.0, depth, FALSE );
 
+    if ( multi && !is_panic_abort() && !force_return )
+      publish_midgame_lines( depth );
+
     /* Display and store search info */
 
     if ( depth == max_depth ) {
@@ -1432,6 +1637,8 @@ middle_game( int side_to_move, int max_depth,
       if ( get_elapsed_time() != 0.0 )
 	send_status( "%6.0f %s", node_val / (get_elapsed_time() + 0.001),
 		     NPS_ABBREV );
+      if ( !is_panic_abort() && !force_return )
+	send_search_info( depth, *eval_info );
     }
 
     if ( is_panic_abort() || force_return )
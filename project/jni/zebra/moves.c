@@ -14,6 +14,8 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include "bitbmob.h"
+#include "bitboard.h"
 #include "cntflip.h"
 #include "constant.h"
 #include "doflip.h"
@@ -139,6 +141,36 @@ generate_move(int side_to_move) {
 
 
 
+/*
+   BITBOARD_MOVE_GENERATION
+   Generates the same move list as GENERATE_ALL, in the same order,
+   but finds the moves with the bitboard mobility function instead
+   of testing the squares one by one.
+*/
+
+void
+bitboard_move_generation( int side_to_move ) {
+  int i, count, move;
+  BitBoard my_bits, opp_bits, moves;
+
+  set_bitboards( board, side_to_move, &my_bits, &opp_bits );
+  moves = bitboard_moves( my_bits, opp_bits );
+
+  count = 0;
+  for ( i = 0; i < MOVE_ORDER_SIZE; i++ ) {
+    move = sorted_move_order[disks_played][i];
+    if ( (moves.high & square_mask[move].high) |
+	 (moves.low & square_mask[move].low) ) {
+      move_list[disks_played][count] = move;
+      count++;
+    }
+  }
+  move_list[disks_played][count] = ILLEGAL;
+  move_count[disks_played] = count;
+}
+
+
+
 /*
    GENERATE_ALL
    Generates a list containing all the moves possible in a position.
@@ -0,0 +1,667 @@
+/*
+   File:         mpcstat.c
+
+   Created:      October 18, 2026
+
+   Modified:
+
+   Contents:     Regenerates the Multi-ProbCut statistics. Positions
+                 sampled from a game file are searched to a range of
+                 depths (midgame) or solved and searched to shallow
+                 depths (endgame) by a pool of worker processes, and
+                 the mean and standard deviation of the error of each
+                 shallow search are computed per number of disks.
+                 The result is written as a statistics file which
+                 zebra loads with -mpc, and optionally as new
+                 pcstat.c and epcstat.c tables.
+*/
+
+
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "constant.h"
+#include "display.h"
+#include "end.h"
+#include "game.h"
+#include "globals.h"
+#include "hash.h"
+#include "macros.h"
+#include "midgame.h"
+#include "moves.h"
+#include "myrandom.h"
+#include "parallel.h"
+#include "probcut.h"
+#include "safemem.h"
+#include "search.h"
+#include "timer.h"
+
+
+
+#define MAX_MID_DEPTH         16
+#define DEFAULT_MID_DEPTH     10
+#define DEFAULT_MIN_EMPTY     12
+#define DEFAULT_MAX_EMPTY     18
+#define DEFAULT_PROBABILITY   0.1
+#define DEFAULT_MAX_DIFF      20
+
+/* Cells with fewer samples than this are left out of the output */
+#define MIN_SAMPLES           10
+
+#define HASH_BITS             20
+
+
+
+typedef enum { MIDGAME_JOB, ENDGAME_JOB } JobType;
+
+typedef struct {
+  char board[64];
+  char type;
+  char side_to_move;
+  char disks_played;
+  int exact_score;
+  int eval[MAX_MID_DEPTH + 1];
+} StatisticsJob;
+
+typedef struct {
+  StatisticsJob *job;
+  int job_count;
+  int mid_depth;
+  int end_depth;
+  volatile int *next_job;
+  volatile int *finished_count;
+  int reported_count;
+} StatisticsBatch;
+
+typedef struct {
+  int count;
+  double sum;
+  double square_sum;
+} Accumulator;
+
+
+
+static StatisticsJob *sampled_job = NULL;
+static int sampled_count = 0;
+static int sampled_size = 0;
+
+
+
+/*
+   READ_GAME
+   Reads a game (a move string such as f5d6c3...) from STREAM.
+   Returns FALSE at end of file.
+*/
+
+static int
+read_game( FILE *stream, int *game_moves, int *game_length ) {
+  char buffer[1000];
+  char *ch;
+  int i;
+
+  if ( fgets( buffer, sizeof buffer, stream ) == NULL )
+    return FALSE;
+
+  ch = buffer;
+  while ( isalnum( *ch ) )
+    ch++;
+  *ch = 0;
+
+  *game_length = strlen( buffer ) / 2;
+  if ( (*game_length > 60) || (strlen( buffer ) % 2 == 1) ) {
+    fprintf( stderr, "Bad move string %s.\n", buffer );
+    exit( EXIT_FAILURE );
+  }
+  for ( i = 0; i < *game_length; i++ ) {
+    int col = tolower( buffer[2 * i] ) - 'a' + 1;
+    int row = buffer[2 * i + 1] - '0';
+    if ( (col < 1) || (col > 8) || (row < 1) || (row > 8) ) {
+      fprintf( stderr, "Unexpected character in move string %s.\n",
+	       buffer );
+      exit( EXIT_FAILURE );
+    }
+    game_moves[i] = 10 * row + col;
+  }
+
+  return TRUE;
+}
+
+
+/*
+   RANDOM_EVENT
+   Returns TRUE with probability PROB.
+*/
+
+static int
+random_event( double prob ) {
+  return 0.0001 * ((my_random() >> 9) % 10000) < prob;
+}
+
+
+/*
+   ADD_JOB
+   Saves the current position for searching by the workers.
+*/
+
+static void
+add_job( JobType type, int side_to_move ) {
+  StatisticsJob *job;
+  int i, j;
+
+  if ( sampled_count == sampled_size ) {
+    sampled_size += 1000;
+    sampled_job = (StatisticsJob *)
+      safe_realloc( sampled_job, sampled_size * sizeof( StatisticsJob ) );
+  }
+  job = &sampled_job[sampled_count++];
+  memset( job, 0, sizeof( StatisticsJob ) );
+  job->type = type;
+  job->side_to_move = side_to_move;
+  job->disks_played = disks_played;
+  for ( i = 1; i <= 8; i++ )
+    for ( j = 1; j <= 8; j++ )
+      job->board[8 * (i - 1) + (j - 1)] = board[10 * i + j];
+}
+
+
+/*
+   COMPARE_JOBS
+   Orders sampled positions so that duplicates become adjacent.
+*/
+
+static int
+compare_jobs( const void *p1, const void *p2 ) {
+  const StatisticsJob *job1 = (const StatisticsJob *) p1;
+  const StatisticsJob *job2 = (const StatisticsJob *) p2;
+
+  if ( job1->type != job2->type )
+    return job1->type - job2->type;
+  if ( job1->side_to_move != job2->side_to_move )
+    return job1->side_to_move - job2->side_to_move;
+  return memcmp( job1->board, job2->board, sizeof job1->board );
+}
+
+
+/*
+   REMOVE_DUPLICATES
+   Makes sure that each position is only searched once; otherwise
+   common opening positions would dominate their cells.
+*/
+
+static void
+remove_duplicates( void ) {
+  int i, unique_count;
+
+  if ( sampled_count == 0 )
+    return;
+  qsort( sampled_job, sampled_count, sizeof( StatisticsJob ), compare_jobs );
+  unique_count = 1;
+  for ( i = 1; i < sampled_count; i++ )
+    if ( compare_jobs( &sampled_job[i], &sampled_job[unique_count - 1] ) )
+      sampled_job[unique_count++] = sampled_job[i];
+  sampled_count = unique_count;
+}
+
+
+/*
+   SAMPLE_GAME
+   Replays a game and picks positions for the midgame statistics
+   (more than MID_DEPTH empty squares) and the endgame statistics
+   (between MIN_EMPTY and MAX_EMPTY empty squares).
+*/
+
+static void
+sample_game( const int *game_moves, int game_length, int mid_depth,
+	     int min_empty, int max_empty, double prob ) {
+  int i;
+  int empty;
+  int side_to_move;
+
+  game_init( NULL, &side_to_move );
+  for ( i = 0; i < game_length; i++ ) {
+    if ( !valid_move( game_moves[i], side_to_move ) ) {
+      side_to_move = OPP( side_to_move );  /* Must pass */
+      if ( !valid_move( game_moves[i], side_to_move ) ) {
+	fprintf( stderr, "Illegal move %c%c in game, skipping the rest.\n",
+		 TO_SQUARE( game_moves[i] ) );
+	return;
+      }
+    }
+
+    empty = 60 - disks_played;
+    if ( (mid_depth > 0) && (empty > mid_depth) && random_event( prob ) )
+      add_job( MIDGAME_JOB, side_to_move );
+    if ( (empty >= min_empty) && (empty <= max_empty) &&
+	 random_event( prob ) )
+      add_job( ENDGAME_JOB, side_to_move );
+
+    (void) make_move( side_to_move, game_moves[i], TRUE );
+    side_to_move = OPP( side_to_move );
+  }
+}
+
+
+/*
+   SHALLOW_SEARCHES
+   Searches the current position to depths 1, 2, ..., MAX_DEPTH
+   without selectivity and stores the scores in EVAL.
+*/
+
+static void
+shallow_searches( int side_to_move, int max_depth, int *eval ) {
+  int depth;
+
+  setup_hash( TRUE );
+  determine_hash_values( side_to_move, board );
+  for ( depth = 1; depth <= max_depth; depth++ )
+    eval[depth] = tree_search( 0, depth, side_to_move, -INFINITE_EVAL,
+			       INFINITE_EVAL, TRUE, FALSE, TRUE );
+}
+
+
+/*
+   STATISTICS_WORKER
+   The body of the worker processes: searches sampled positions
+   until the queue is exhausted. Every position starts with an empty
+   hash table, so the scores don't depend on the number of workers.
+*/
+
+static void
+statistics_worker( int worker_index, void *context ) {
+  StatisticsBatch *batch = (StatisticsBatch *) context;
+  StatisticsJob *job;
+  EvaluationType dummy_info;
+  int i, j;
+  int job_index;
+  int side_to_move;
+
+  while ( (job_index = claim_next_job( batch->next_job )) <
+	  batch->job_count ) {
+    job = &batch->job[job_index];
+    for ( i = 1; i <= 8; i++ )
+      for ( j = 1; j <= 8; j++ )
+	board[10 * i + j] = job->board[8 * (i - 1) + (j - 1)];
+    disks_played = job->disks_played;
+    side_to_move = job->side_to_move;
+    piece_count[BLACKSQ][disks_played] = disc_count( BLACKSQ );
+    piece_count[WHITESQ][disks_played] = disc_count( WHITESQ );
+
+    if ( job->type == ENDGAME_JOB ) {
+      generate_all( side_to_move );
+      setup_hash( TRUE );
+      determine_hash_values( side_to_move, board );
+      (void) end_game( side_to_move, FALSE, FALSE, FALSE, 0, &dummy_info );
+      job->exact_score = root_eval;
+      shallow_searches( side_to_move, batch->end_depth, job->eval );
+    }
+    else
+      shallow_searches( side_to_move, batch->mid_depth, job->eval );
+
+    __sync_fetch_and_add( batch->finished_count, 1 );
+  }
+}
+
+
+/*
+   REPORT_PROGRESS
+   Called regularly by the worker pool.
+*/
+
+static void
+report_progress( void *context ) {
+  StatisticsBatch *batch = (StatisticsBatch *) context;
+  int finished;
+
+  finished = *batch->finished_count;
+  if ( finished != batch->reported_count ) {
+    fprintf( stderr, "\r%d of %d positions searched", finished,
+	     batch->job_count );
+    if ( finished == batch->job_count )
+      fputs( "\n", stderr );
+    batch->reported_count = finished;
+  }
+}
+
+
+/*
+   ADD_SAMPLE
+   Adds a score difference (in 1/128 discs) to an accumulator.
+*/
+
+static void
+add_sample( Accumulator *acc, int difference ) {
+  double value = difference / 128.0;
+
+  acc->count++;
+  acc->sum += value;
+  acc->square_sum += value * value;
+}
+
+
+/*
+   WRITE_CELL
+   Writes the mean and the standard deviation of one cell
+   in the format read by load_probcut_statistics().
+*/
+
+static void
+write_cell( FILE *stream, const char *kind, int disks, int depth,
+	    const Accumulator *acc ) {
+  double mean, variance;
+
+  if ( acc->count < MIN_SAMPLES )
+    return;
+  mean = acc->sum / acc->count;
+  variance = (acc->square_sum - acc->count * mean * mean) /
+    (acc->count - 1);
+  fprintf( stream, "%s %2d %d %7.3f %7.3f %6d\n", kind, disks, depth,
+	   mean, sqrt( MAX( variance, 0.0 ) ), acc->count );
+}
+
+
+/*
+   WRITE_STATISTICS
+   Computes the statistics per (disks, shallow depth) cell and
+   writes them to FILE_NAME. In midgame positions each shallow
+   search is compared to the deepest search of the same parity,
+   which is how the cut pairs in init_probcut() are chosen; in
+   endgame positions the shallow searches are compared to the
+   exact score. Positions where the reference score is more than
+   MAX_DIFF discs from a draw are ignored.
+*/
+
+static void
+write_statistics( const char *file_name, const char *game_file_name,
+		  const StatisticsJob *job, int job_count,
+		  int mid_depth, int end_depth, int max_diff ) {
+  static Accumulator mid_acc[61][MAX_SHALLOW_DEPTH + 1];
+  static Accumulator end_acc[61][MAX_END_CORR_DEPTH + 1];
+  int i, disks, depth, deep;
+  time_t now;
+  FILE *stream;
+
+  memset( mid_acc, 0, sizeof mid_acc );
+  memset( end_acc, 0, sizeof end_acc );
+
+  for ( i = 0; i < job_count; i++ ) {
+    disks = job[i].disks_played;
+    if ( job[i].type == MIDGAME_JOB ) {
+      for ( depth = 1; depth <= MIN( MAX_SHALLOW_DEPTH, mid_depth - 2 );
+	    depth++ ) {
+	deep = ((mid_depth - depth) % 2 == 0) ? mid_depth : mid_depth - 1;
+	if ( abs( job[i].eval[deep] ) <= 128 * max_diff )
+	  add_sample( &mid_acc[disks][depth],
+		      job[i].eval[depth] - job[i].eval[deep] );
+      }
+    }
+    else if ( abs( job[i].exact_score ) <= max_diff )
+      for ( depth = 1; depth <= end_depth; depth++ )
+	add_sample( &end_acc[disks][depth],
+		    job[i].eval[depth] - 128 * job[i].exact_score );
+  }
+
+  stream = fopen( file_name, "w" );
+  if ( stream == NULL ) {
+    fprintf( stderr, "Cannot open %s for writing.\n", file_name );
+    exit( EXIT_FAILURE );
+  }
+  time( &now );
+  fprintf( stream, "# Multi-ProbCut statistics for %s\n", game_file_name );
+  fprintf( stream, "# Created by mpcstat on %s", ctime( &now ) );
+  fprintf( stream, "# <kind> <disks> <shallow depth> <mean> <sigma> "
+	   "<samples>\n" );
+  for ( disks = 0; disks <= 60; disks++ )
+    for ( depth = 1; depth <= MAX_SHALLOW_DEPTH; depth++ )
+      write_cell( stream, "mid", disks, depth, &mid_acc[disks][depth] );
+  for ( disks = 0; disks <= 60; disks++ )
+    for ( depth = 1; depth <= MAX_END_CORR_DEPTH; depth++ )
+      write_cell( stream, "end", disks, depth, &end_acc[disks][depth] );
+  fclose( stream );
+}
+
+
+/*
+   WRITE_MIDGAME_SOURCE
+   Writes the current midgame statistics as a new pcstat.c.
+*/
+
+static void
+write_midgame_source( const char *file_name ) {
+  int i, j;
+  time_t now;
+  FILE *stream;
+
+  stream = fopen( file_name, "w" );
+  if ( stream == NULL ) {
+    fprintf( stderr, "Cannot open %s for writing.\n", file_name );
+    exit( EXIT_FAILURE );
+  }
+  time( &now );
+  fprintf( stream, "/*\n   pcstat.c\n\n   Automatically created by "
+	   "mpcstat on %s*/\n\n\n", ctime( &now ) );
+  fputs( "#include \"porting.h\"\n\n#include \"pcstat.h\"\n\n\n", stream );
+  fputs( "Correlation mid_corr[61][MAX_SHALLOW_DEPTH + 1] = \n", stream );
+  for ( i = 0; i <= 60; i++ )
+    for ( j = 0; j <= MAX_SHALLOW_DEPTH; j++ ) {
+      if ( j == 0 )
+	fputs( (i == 0) ? "   {{" : "    {", stream );
+      else
+	fputs( "     ", stream );
+      fprintf( stream, "{ %.3f, %.3f, %.3f, %.3f }",
+	       mid_corr[i][j].const_base, mid_corr[i][j].const_slope,
+	       mid_corr[i][j].sigma_base, mid_corr[i][j].sigma_slope );
+      if ( j < MAX_SHALLOW_DEPTH )
+	fputs( ",\n", stream );
+      else
+	fputs( (i < 60) ? "},\n" : "}};\n", stream );
+    }
+  fclose( stream );
+}
+
+
+/*
+   WRITE_END_TABLE
+   Writes one of the tables in epcstat.c. Exactly one of
+   FLOAT_TABLE and SHORT_TABLE is non-NULL.
+*/
+
+static void
+write_end_table( FILE *stream, const char *declaration,
+		 float float_table[61][MAX_END_CORR_DEPTH + 1],
+		 short short_table[61][MAX_END_CORR_DEPTH + 1] ) {
+  int i, j;
+
+  fprintf( stream, "%s[61][MAX_END_CORR_DEPTH+1] = \n", declaration );
+  for ( i = 0; i <= 60; i++ ) {
+    fputs( (i == 0) ? "   {{" : "    {", stream );
+    for ( j = 0; j <= MAX_END_CORR_DEPTH; j++ ) {
+      if ( j > 0 )
+	fputs( ", ", stream );
+      if ( short_table != NULL )
+	fprintf( stream, "%d", short_table[i][j] );
+      else if ( float_table[i][j] == 0.0 )
+	fputs( "0.0", stream );
+      else
+	fprintf( stream, "%5.2ff", float_table[i][j] );
+    }
+    fputs( (i < 60) ? "},\n" : "}};\n\n\n", stream );
+  }
+}
+
+
+/*
+   WRITE_ENDGAME_SOURCE
+   Writes the current endgame statistics as a new epcstat.c.
+*/
+
+static void
+write_endgame_source( const char *file_name ) {
+  time_t now;
+  FILE *stream;
+
+  stream = fopen( file_name, "w" );
+  if ( stream == NULL ) {
+    fprintf( stderr, "Cannot open %s for writing.\n", file_name );
+    exit( EXIT_FAILURE );
+  }
+  time( &now );
+  fprintf( stream, "/*\n   epcstat.c\n\n   Automatically created by "
+	   "mpcstat on %s*/\n\n\n", ctime( &now ) );
+  fputs( "#include \"epcstat.h\"\n\n\n", stream );
+  write_end_table( stream, "float end_mean", end_mean, NULL );
+  write_end_table( stream, "float end_sigma", end_sigma, NULL );
+  write_end_table( stream, "short end_stats_available",
+		   NULL, end_stats_available );
+  fclose( stream );
+}
+
+
+static void
+usage( void ) {
+  fputs( "Usage:\n", stderr );
+  fputs( "  mpcstat <game file> <statistics file> [options]\n\n", stderr );
+  fputs( "Options:\n", stderr );
+  fprintf( stderr, "  -mid <depth>           Deepest midgame search, "
+	   "0 = none (default %d)\n", DEFAULT_MID_DEPTH );
+  fprintf( stderr, "  -end <min> <max>       Range of empty squares "
+	   "for endgame positions (default %d-%d)\n",
+	   DEFAULT_MIN_EMPTY, DEFAULT_MAX_EMPTY );
+  fprintf( stderr, "  -prob <probability>    Fraction of the positions "
+	   "searched (default %.2f)\n", DEFAULT_PROBABILITY );
+  fprintf( stderr, "  -diff <discs>          Ignore positions further "
+	   "from a draw (default %d)\n", DEFAULT_MAX_DIFF );
+  fputs( "  -workers <count>       Number of worker processes "
+	 "(default: one per processor)\n", stderr );
+  fputs( "  -seed <seed>           Seed for the position sampling "
+	 "(default 1)\n", stderr );
+  fputs( "  -source                Also write pcstat.c and epcstat.c\n",
+	 stderr );
+  fputs( "\nThe statistics file is used with zebra -mpc.\n", stderr );
+  exit( EXIT_FAILURE );
+}
+
+
+int
+main( int argc, char *argv[] ) {
+  const char *game_file_name;
+  const char *statistics_file_name;
+  double prob;
+  int i;
+  int mid_depth, min_empty, max_empty, max_diff;
+  int worker_count, seed, write_source;
+  int game_length, games_read;
+  int game_moves[60];
+  int failed;
+  StatisticsBatch batch;
+  FILE *stream;
+
+  if ( argc < 3 )
+    usage();
+  game_file_name = argv[1];
+  statistics_file_name = argv[2];
+
+  mid_depth = DEFAULT_MID_DEPTH;
+  min_empty = DEFAULT_MIN_EMPTY;
+  max_empty = DEFAULT_MAX_EMPTY;
+  prob = DEFAULT_PROBABILITY;
+  max_diff = DEFAULT_MAX_DIFF;
+  worker_count = get_processor_count();
+  seed = 1;
+  write_source = FALSE;
+  for ( i = 3; i < argc; i++ ) {
+    if ( !strcmp( argv[i], "-mid" ) && (i + 1 < argc) )
+      mid_depth = atoi( argv[++i] );
+    else if ( !strcmp( argv[i], "-end" ) && (i + 2 < argc) ) {
+      min_empty = atoi( argv[++i] );
+      max_empty = atoi( argv[++i] );
+    }
+    else if ( !strcmp( argv[i], "-prob" ) && (i + 1 < argc) )
+      prob = atof( argv[++i] );
+    else if ( !strcmp( argv[i], "-diff" ) && (i + 1 < argc) )
+      max_diff = atoi( argv[++i] );
+    else if ( !strcmp( argv[i], "-workers" ) && (i + 1 < argc) )
+      worker_count = atoi( argv[++i] );
+    else if ( !strcmp( argv[i], "-seed" ) && (i + 1 < argc) )
+      seed = atoi( argv[++i] );
+    else if ( !strcmp( argv[i], "-source" ) )
+      write_source = TRUE;
+    else
+      usage();
+  }
+  if ( (mid_depth < 0) || (mid_depth > MAX_MID_DEPTH) ) {
+    fprintf( stderr, "The midgame depth must be between 0 and %d.\n",
+	     MAX_MID_DEPTH );
+    exit( EXIT_FAILURE );
+  }
+  if ( min_empty <= MAX_END_CORR_DEPTH )
+    min_empty = MAX_END_CORR_DEPTH + 1;
+
+  stream = fopen( game_file_name, "r" );
+  if ( stream == NULL ) {
+    fprintf( stderr, "Cannot open %s for reading.\n", game_file_name );
+    exit( EXIT_FAILURE );
+  }
+
+  global_setup( 0, HASH_BITS );
+  toggle_abort_check( FALSE );
+  toggle_perturbation_usage( FALSE );
+  echo = FALSE;
+
+  /* Pick the positions before any searching is done so that the
+     sample only depends on the seed */
+
+  my_srandom( seed );
+  games_read = 0;
+  while ( read_game( stream, game_moves, &game_length ) ) {
+    sample_game( game_moves, game_length, mid_depth,
+		 min_empty, max_empty, prob );
+    games_read++;
+  }
+  fclose( stream );
+  remove_duplicates();
+  fprintf( stderr, "%d positions sampled from %d games\n",
+	   sampled_count, games_read );
+
+  batch.job_count = sampled_count;
+  batch.mid_depth = mid_depth;
+  batch.end_depth = MAX_END_CORR_DEPTH;
+  batch.job = (StatisticsJob *)
+    shared_malloc( sampled_count * sizeof( StatisticsJob ) );
+  if ( sampled_count > 0 )
+    memcpy( batch.job, sampled_job, sampled_count * sizeof( StatisticsJob ) );
+  batch.next_job = (volatile int *) shared_malloc( sizeof( int ) );
+  batch.finished_count = (volatile int *) shared_malloc( sizeof( int ) );
+  batch.reported_count = 0;
+
+  failed = run_workers( worker_count, statistics_worker, report_progress,
+			&batch );
+  if ( failed > 0 ) {
+    fprintf( stderr, "%d workers failed\n", failed );
+    exit( EXIT_FAILURE );
+  }
+
+  write_statistics( statistics_file_name, game_file_name, batch.job,
+		    batch.job_count, mid_depth, batch.end_depth, max_diff );
+  if ( write_source ) {
+    if ( load_probcut_statistics( statistics_file_name ) < 0 ) {
+      fprintf( stderr, "Cannot open %s for reading.\n",
+	       statistics_file_name );
+      exit( EXIT_FAILURE );
+    }
+    write_midgame_source( "pcstat.c" );
+    write_endgame_source( "epcstat.c" );
+  }
+
+  shared_free( (void *) batch.finished_count, sizeof( int ) );
+  shared_free( (void *) batch.next_job, sizeof( int ) );
+  shared_free( batch.job, sampled_count * sizeof( StatisticsJob ) );
+  free( sampled_job );
+  global_terminate();
+
+  return EXIT_SUCCESS;
+}
@@ -46,6 +46,7 @@
 #include "myrandom.h"
 #include "opname.h"
 #include "osfbook.h"
+#include "parallel.h"
 #include "patterns.h"
 #include "safemem.h"
 #include "search.h"
@@ -72,6 +73,23 @@
 #define NOT_AVAILABLE             -1
 #define MAX_HASH_FILL             0.80
 
+/* The states of the positions solved by the endgame workers */
+#define JOB_PENDING               0
+#define JOB_SOLVED                1
+#define JOB_TRANSFERRED           2
+
+/* Bulk import parameters and game states */
+#define IMPORT_SHARD_SIZE         50000
+#define IMPORT_PENDING            0
+#define IMPORT_FINISHED           1
+#define IMPORT_NEEDS_SOLVE        2
+#define IMPORT_INVALID            3
+
+/* Searches performed by learn_game_list() */
+#define LEARN_FULL_SOLVE          0
+#define LEARN_WLD_SOLVE           1
+#define LEARN_EVALUATE            2
+
 /* Tree search parameters */
 #define HASH_BITS                 19
 #define RANDOMIZATION             0
@@ -106,6 +124,100 @@ typedef struct {
 } StatisticsSpec;
 
 
+/* A position queued by do_correct() for the endgame worker pool */
+typedef struct {
+  int index;
+  int hash_val1;
+  int hash_val2;
+  short side_to_move;
+  short disks_played;
+  char board[64];
+} CorrectionJob;
+
+
+/* The state shared between correct_tree() and the endgame workers.
+   JOB is private (but inherited by the workers), NEXT_JOB, OUTCOME
+   and STATE live in shared memory. */
+typedef struct {
+  int job_count;
+  int full_solve;
+  int solved_count;
+  FILE *checkpoint_stream;
+  CorrectionJob *job;
+  volatile int *next_job;
+  volatile int *outcome;
+  volatile char *state;
+} CorrectionBatch;
+
+
+/* A position met while replaying a game in bulk_build_tree() */
+typedef struct {
+  int hash_val1;
+  int hash_val2;
+  int game;
+  short ply;
+  unsigned short flags;
+} ImportPosition;
+
+
+/* A game in bulk_build_tree(). The outcome is from black's
+   perspective; for invalid games it holds the offending move number. */
+typedef struct {
+  int first_move;
+  short move_count;
+  short last_move_number;
+  short leaf_side_to_move;
+  short status;
+  int outcome;
+  int leaf_hash_val1;
+  int leaf_hash_val2;
+  int leaf_node;
+  int solver;
+} ImportGame;
+
+
+/* A batch of games imported together by bulk_build_tree().
+   GAME, POSITION and NEXT_JOB live in shared memory. */
+typedef struct {
+  int game_count;
+  int solve_count;
+  ImportGame *game;
+  ImportPosition *position;
+  short *move_buffer;
+  int *solve_game;
+  volatile int *next_job;
+} ImportShard;
+
+
+/* A search of a book node met on the path of a game learned by
+   learn_game_list(). OUTCOME, BEST_ALTERNATIVE_MOVE and
+   ALTERNATIVE_SCORE are filled in by the workers. */
+typedef struct {
+  int index;
+  int game;
+  int outcome;
+  short ply;
+  short side_to_move;
+  short kind;
+  short best_alternative_move;
+  short alternative_score;
+} LearnJob;
+
+
+/* A batch of games learned together by learn_game_list().
+   JOB and NEXT_JOB live in shared memory. */
+typedef struct {
+  int game_count;
+  int job_count;
+  short *move_buffer;
+  short *move_count;
+  short *last_move_number;
+  int *visited_node;
+  LearnJob *job;
+  volatile int *next_job;
+} LearnBatch;
+
+
 
 /* Local variables */
 
@@ -139,6 +251,19 @@ static GameMode game_mode = DEFAULT_GAME_MODE;
 static BookNode *node = NULL;
 static CandidateMove candidate_list[60];
 
+#ifdef INCLUDE_BOOKTOOL
+/* The worker pool used by book correction */
+static const char *correction_checkpoint_name = NULL;
+static FILE *correction_checkpoint_stream = NULL;
+static int book_workers = DEFAULT_WORKER_COUNT;
+static int collect_correction_jobs = FALSE;
+static int correction_job_count, correction_job_size;
+static CorrectionJob *correction_job = NULL;
+
+/* The shards of a bulk game import */
+static ImportShard *import_sort_shard = NULL;
+#endif
+
 
 
 /*
@@ -1292,6 +1417,39 @@ nega_scout( int depth, int allow_mpc, int side_to_move,
 
 
 
+/*
+   NODE_NEEDS_EVALUATION
+   Checks if evaluate_node() would search node INDEX.
+*/
+
+static int
+node_needs_evaluation( int index ) {
+  int depth;
+
+  /* Don't evaluate nodes that already have been searched deep enough */
+
+  depth = get_node_depth( index );
+  if ( (depth >= search_depth) &&
+       (node[index].alternative_score != NO_SCORE ) )
+    return FALSE;
+
+  /* If the node has been evaluated and its score is outside the
+     eval and minimax windows, bail out. */
+
+  if ( node[index].alternative_score != NO_SCORE ) {
+    if ( (abs( node[index].alternative_score ) < min_eval_span) ||
+	 (abs( node[index].alternative_score ) > max_eval_span) )
+      return FALSE;
+
+    if ( (abs( node[index].black_minimax_score ) < min_negamax_span) ||
+	 (abs( node[index].black_minimax_score ) > max_negamax_span) )
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+
 /*
    EVALUATE_NODE
    Applies a search to a predetermined depth to find the best
@@ -1308,32 +1466,14 @@ evaluate_node( int index ) {
   int this_move, best_move;
   int child;
   int allow_mpc;
-  int depth;
   int best_index;
   int slot, val1, val2, orientation;
   int feasible_move[64];
   int best_score;
 
-  /* Don't evaluate nodes that already have been searched deep enough */
-
-  depth = get_node_depth( index );
-  if ( (depth >= search_depth) &&
-       (node[index].alternative_score != NO_SCORE ) )
+  if ( !node_needs_evaluation( index ) )
     return;
 
-  /* If the node has been evaluated and its score is outside the
-     eval and minimax windows, bail out. */
-
-  if ( node[index].alternative_score != NO_SCORE ) {
-    if ( (abs( node[index].alternative_score ) < min_eval_span) ||
-	 (abs( node[index].alternative_score ) > max_eval_span) )
-      return;
-
-    if ( (abs( node[index].black_minimax_score ) < min_negamax_span) ||
-	 (abs( node[index].black_minimax_score ) > max_negamax_span) )
-      return;
-  }
-
   if ( node[index].flags & BLACK_TO_MOVE )
     side_to_move = BLACKSQ;
   else
@@ -1664,6 +1804,252 @@ clear_tree( int low, int high, int flags ) {
 
 
 
+/*
+   STORE_SOLVED_SCORE
+   Records the WLD or exact OUTCOME (from black's perspective)
+   of node INDEX.
+*/
+
+static void
+store_solved_score( int index, int outcome, int full_solve ) {
+  node[index].black_minimax_score = node[index].white_minimax_score =
+    outcome;
+  if ( outcome > 0 ) {
+    node[index].black_minimax_score += CONFIRMED_WIN;
+    node[index].white_minimax_score += CONFIRMED_WIN;
+  }
+  if ( outcome < 0 ) {
+    node[index].black_minimax_score -= CONFIRMED_WIN;
+    node[index].white_minimax_score -= CONFIRMED_WIN;
+  }
+  if ( full_solve )
+    node[index].flags |= FULL_SOLVED;
+  else
+    node[index].flags |= WLD_SOLVED;
+}
+
+
+/*
+   UPDATE_CORRECTION_PROGRESS
+   Extends the progress bar of correct_tree() after SOLVED_COUNT
+   out of MAX_EVAL_COUNT nodes have been handled.
+*/
+
+static void
+update_correction_progress( int solved_count ) {
+  while ( solved_count >= (evaluation_stage + 1) * max_eval_count / 25 ) {
+    evaluation_stage++;
+#ifdef TEXT_BASED
+    putc( '|', stdout );
+    if ( evaluation_stage % 5 == 0 )
+      printf( " %d%% ", 4 * evaluation_stage );
+    fflush( stdout );
+#endif
+    if ( evaluation_stage >= 25 )
+      break;
+  }
+}
+
+
+/*
+   WRITE_CORRECTION_CHECKPOINT
+   Appends a solved position to the checkpoint file so that an
+   interrupted correction run can be resumed.
+*/
+
+static void
+write_correction_checkpoint( FILE *stream, int val1, int val2,
+			     int outcome, int full_solve ) {
+  fprintf( stream, "%d %d %d %d\n", val1, val2, outcome, full_solve );
+}
+
+
+/*
+   READ_CORRECTION_CHECKPOINT
+   Transfers the scores stored in a checkpoint file by a previous
+   (possibly interrupted) correction run to the book.
+   Returns the number of nodes updated.
+*/
+
+static int
+read_correction_checkpoint( const char *file_name ) {
+  FILE *stream;
+  int val1, val2, outcome, full_solve;
+  int slot, index;
+  int restored_count;
+
+  stream = fopen( file_name, "r" );
+  if ( stream == NULL )
+    return 0;
+
+  restored_count = 0;
+  while ( fscanf( stream, "%d %d %d %d",
+		  &val1, &val2, &outcome, &full_solve ) == 4 ) {
+    slot = probe_hash_table( val1, val2 );
+    if ( slot == NOT_AVAILABLE )
+      break;
+    index = book_hash_table[slot];
+    if ( index == EMPTY_HASH_SLOT )
+      continue;
+    store_solved_score( index, outcome, full_solve );
+    restored_count++;
+  }
+  fclose( stream );
+
+  return restored_count;
+}
+
+
+/*
+   QUEUE_CORRECTION_JOB
+   Saves the current position, which corresponds to node INDEX,
+   for solving by the endgame workers. Transpositions all map to
+   the same node, and nodes are only traversed once, so every
+   position is queued at most once.
+*/
+
+static void
+queue_correction_job( int index, int side_to_move ) {
+  CorrectionJob *job;
+  int i, j;
+  int orientation;
+
+  if ( correction_job_count == correction_job_size ) {
+    correction_job_size += 1000;
+    correction_job = (CorrectionJob *)
+      safe_realloc( correction_job,
+		    correction_job_size * sizeof( CorrectionJob ) );
+  }
+  job = &correction_job[correction_job_count++];
+  job->index = index;
+  job->side_to_move = side_to_move;
+  job->disks_played = disks_played;
+  for ( i = 1; i <= 8; i++ )
+    for ( j = 1; j <= 8; j++ )
+      job->board[8 * (i - 1) + (j - 1)] = board[10 * i + j];
+  get_hash( &job->hash_val1, &job->hash_val2, &orientation );
+}
+
+
+/*
+   CORRECTION_WORKER
+   The body of the endgame worker processes: solves queued positions
+   until the queue is exhausted.
+*/
+
+static void
+correction_worker( int worker_index, void *context ) {
+  CorrectionBatch *batch = (CorrectionBatch *) context;
+  CorrectionJob *job;
+  EvaluationType dummy_info;
+  int i, j;
+  int job_index;
+  int side_to_move;
+
+  while ( (job_index = claim_next_job( batch->next_job )) <
+	  batch->job_count ) {
+    job = &batch->job[job_index];
+    for ( i = 1; i <= 8; i++ )
+      for ( j = 1; j <= 8; j++ )
+	board[10 * i + j] = job->board[8 * (i - 1) + (j - 1)];
+    disks_played = job->disks_played;
+    side_to_move = job->side_to_move;
+
+    generate_all( side_to_move );
+    determine_hash_values( side_to_move, board );
+    reset_counter( &nodes );
+
+    (void) end_game( side_to_move, !batch->full_solve, FALSE,
+		     TRUE, 0, &dummy_info );
+
+    if ( side_to_move == BLACKSQ )
+      batch->outcome[job_index] = +root_eval;
+    else
+      batch->outcome[job_index] = -root_eval;
+    __sync_synchronize();
+    batch->state[job_index] = JOB_SOLVED;
+  }
+}
+
+
+/*
+   COLLECT_CORRECTION_RESULTS
+   Called regularly by the worker pool: transfers newly solved
+   positions to the book and the checkpoint file.
+*/
+
+static void
+collect_correction_results( void *context ) {
+  CorrectionBatch *batch = (CorrectionBatch *) context;
+  CorrectionJob *job;
+  int i;
+  int outcome;
+  int new_results;
+
+  new_results = FALSE;
+  for ( i = 0; i < batch->job_count; i++ )
+    if ( batch->state[i] == JOB_SOLVED ) {
+      __sync_synchronize();
+      job = &batch->job[i];
+      outcome = batch->outcome[i];
+      store_solved_score( job->index, outcome, batch->full_solve );
+      if ( batch->checkpoint_stream != NULL )
+	write_correction_checkpoint( batch->checkpoint_stream,
+				     job->hash_val1, job->hash_val2,
+				     outcome, batch->full_solve );
+      batch->state[i] = JOB_TRANSFERRED;
+      batch->solved_count++;
+      new_results = TRUE;
+    }
+
+  if ( new_results ) {
+    if ( batch->checkpoint_stream != NULL )
+      fflush( batch->checkpoint_stream );
+    update_correction_progress( batch->solved_count );
+  }
+}
+
+
+/*
+   SOLVE_CORRECTION_JOBS
+   Solves the positions queued by do_correct() using the endgame
+   worker pool and returns the number of positions solved.
+*/
+
+static int
+solve_correction_jobs( int full_solve ) {
+  CorrectionBatch batch;
+  int failed;
+
+  batch.job_count = correction_job_count;
+  batch.full_solve = full_solve;
+  batch.solved_count = 0;
+  batch.checkpoint_stream = correction_checkpoint_stream;
+  batch.job = correction_job;
+  batch.next_job = (volatile int *) shared_malloc( sizeof( int ) );
+  batch.outcome = (volatile int *)
+    shared_malloc( MAX( correction_job_count, 1 ) * sizeof( int ) );
+  batch.state = (volatile char *)
+    shared_malloc( MAX( correction_job_count, 1 ) * sizeof( char ) );
+
+  failed = run_workers( MIN( book_workers, correction_job_count ),
+			correction_worker, collect_correction_results,
+			&batch );
+  if ( failed > 0 )
+    fprintf( stderr, "\n%d endgame workers failed; %d positions "
+	     "remain unsolved\n", failed,
+	     correction_job_count - batch.solved_count );
+
+  shared_free( (void *) batch.next_job, sizeof( int ) );
+  shared_free( (void *) batch.outcome,
+	       MAX( correction_job_count, 1 ) * sizeof( int ) );
+  shared_free( (void *) batch.state,
+	       MAX( correction_job_count, 1 ) * sizeof( char ) );
+
+  return batch.solved_count;
+}
+
+
 /*
    DO_CORRECT
    Performs endgame correction (WLD or full solve) of a node
@@ -1755,7 +2141,9 @@ do_correct( int index, int max_empty, int full_solve,
       really_evaluate = FALSE;
 
     if ( really_evaluate ) {
-      if ( target_name == NULL ) {  /* Solve now */
+      if ( (target_name == NULL) && collect_correction_jobs )
+	queue_correction_job( index, side_to_move );
+      else if ( target_name == NULL ) {  /* Solve now */
 	reset_counter( &nodes );
 
 	(void) end_game( side_to_move, !full_solve, FALSE,
@@ -1766,20 +2154,12 @@ do_correct( int index, int max_empty, int full_solve,
 	else
 	  outcome = -root_eval;
 
-	node[index].black_minimax_score = node[index].white_minimax_score =
-	  outcome;
-	if ( outcome > 0 ) {
-	  node[index].black_minimax_score += CONFIRMED_WIN;
-	  node[index].white_minimax_score += CONFIRMED_WIN;
-	}
-	if ( outcome < 0 ) {
-	  node[index].black_minimax_score -= CONFIRMED_WIN;
-	  node[index].white_minimax_score -= CONFIRMED_WIN;
+	store_solved_score( index, outcome, full_solve );
+	if ( correction_checkpoint_stream != NULL ) {
+	  get_hash( &val1, &val2, &orientation );
+	  write_correction_checkpoint( correction_checkpoint_stream,
+				       val1, val2, outcome, full_solve );
 	}
-	if ( full_solve )
-	  node[index].flags |= FULL_SOLVED;
-	else
-	  node[index].flags |= WLD_SOLVED;
       }
       else {  /* Defer solving to a standalone scripted solver */
 	FILE *target_file = fopen( target_name, "a" );
@@ -1811,15 +2191,8 @@ do_correct( int index, int max_empty, int full_solve,
     }
   }
 
-  if ( evaluated_count >= (evaluation_stage + 1) * max_eval_count / 25 ) {
-    evaluation_stage++;
-#ifdef TEXT_BASED
-    putc( '|', stdout );
-    if ( evaluation_stage % 5 == 0 )
-      printf( " %d%% ", 4 * evaluation_stage );
-    fflush( stdout );
-#endif
-  }
+  if ( !collect_correction_jobs )
+    update_correction_progress( evaluated_count );
 
   node[index].flags ^= NOT_TRAVERSED;
 }
@@ -1840,6 +2213,33 @@ set_output_script_name( const char *script_name ) {
 
 
 
+/*
+  SET_BOOK_WORKERS
+  Specifies the number of worker processes used by correct_tree()
+  and bulk_build_tree(). With one worker, correct_tree() solves
+  the positions in-process in tree order.
+*/
+
+void
+set_book_workers( int worker_count ) {
+  book_workers = MAX( 1, MIN( worker_count, MAX_WORKER_COUNT ) );
+}
+
+
+
+/*
+  SET_CORRECTION_CHECKPOINT
+  Makes correct_tree() record every solved position in FILE_NAME,
+  and restore the positions found there before starting.
+*/
+
+void
+set_correction_checkpoint( const char *file_name ) {
+  correction_checkpoint_name = file_name;
+}
+
+
+
 /*
    CORRECT_TREE
    Endgame-correct the lowest levels of the tree.
@@ -1850,6 +2250,7 @@ correct_tree( int max_empty, int full_solve ) {
   char move_buffer[150];
   int i;
   int feasible_count;
+  int restored_count;
   time_t start_time, stop_time;
 
   prepare_tree_traversal();
@@ -1857,6 +2258,17 @@ correct_tree( int max_empty, int full_solve ) {
   evaluated_count = 0;
   evaluation_stage = 0;
   time( &start_time );
+
+  restored_count = 0;
+  if ( correction_checkpoint_name != NULL ) {
+    restored_count = read_correction_checkpoint( correction_checkpoint_name );
+    correction_checkpoint_stream = fopen( correction_checkpoint_name, "a" );
+    if ( correction_checkpoint_stream == NULL )
+      fatal_error( "%s '%s'\n", DB_WRITE_ERROR, correction_checkpoint_name );
+  }
+  collect_correction_jobs =
+    (correction_script_name == NULL) && (book_workers > 1);
+  correction_job_count = 0;
   for ( i = 0; i < book_node_count; i++ )
     node[i].flags |= NOT_TRAVERSED;
   feasible_count = 0;
@@ -1886,7 +2298,12 @@ correct_tree( int max_empty, int full_solve ) {
     printf( "\n%d relevant nodes.", feasible_count );
   else
     printf( "\nMax batch size is %d.", max_batch_size );
+  if ( restored_count > 0 )
+    printf( "\n%d nodes restored from %s.", restored_count,
+	    correction_checkpoint_name );
   puts( "" );
+  if ( collect_correction_jobs )
+    printf( "Using %d endgame workers.\n", book_workers );
   printf( "Progress: " );
   fflush( stdout );
 #endif
@@ -1895,6 +2312,18 @@ correct_tree( int max_empty, int full_solve ) {
   do_correct( ROOT, max_empty, full_solve,
 	      correction_script_name, move_buffer );
 
+  if ( collect_correction_jobs ) {
+    evaluated_count = solve_correction_jobs( full_solve );
+    collect_correction_jobs = FALSE;
+    free( correction_job );
+    correction_job = NULL;
+    correction_job_count = correction_job_size = 0;
+  }
+  if ( correction_checkpoint_stream != NULL ) {
+    fclose( correction_checkpoint_stream );
+    correction_checkpoint_stream = NULL;
+  }
+
   time( &stop_time );
 #ifdef TEXT_BASED
   printf( "(took %d s)\n", (int) (stop_time - start_time) );
@@ -2740,6 +3169,34 @@ add_new_game( int move_count, short *game_move_list,
 }
 
 
+/*
+   PARSE_GAME_LINE
+   Converts a line on the form "+d3-c3+c4... <diff>" from a game
+   list to a move list where white's moves are negative.
+   Returns the number of moves.
+*/
+
+static int
+parse_game_line( const char *line_buffer, short *game_move_list,
+		 int *diff ) {
+  char move_string[200];
+  char sign, column, row;
+  int i;
+  int move_count;
+
+  sscanf( line_buffer, "%s %d", move_string, diff );
+  move_count = (strlen( move_string ) - 1) / 3;
+  for ( i = 0; i < move_count; i++ ) {
+    sscanf( move_string + 3 * i, "%c%c%c", &sign, &column, &row );
+    game_move_list[i] = 10 * (row - '0') + (column - 'a' + 1);
+    if ( sign == '-' )
+      game_move_list[i] = -game_move_list[i];
+  }
+
+  return move_count;
+}
+
+
 /*
    BUILD_TREE
    Reads games from the file pointed to by FILE_NAME and
@@ -2749,15 +3206,12 @@ add_new_game( int move_count, short *game_move_list,
 void
 build_tree( const char *file_name, int max_game_count,
 	    int max_diff, int min_empties ) {
-  char move_string[200];
   char line_buffer[1000];
-  char sign, column, row;
-  int i;
+  double start_time, stop_time;
   int games_parsed, games_imported;
   int move_count;
   int diff;
   short game_move_list[60];
-  time_t start_time, stop_time;
   FILE *stream;
 
 #ifdef TEXT_BASED
@@ -2769,21 +3223,14 @@ build_tree( const char *file_name, int max_game_count,
   if ( stream == NULL )
     fatal_error( "%s '%s'\n", NO_GAME_FILE_ERROR, file_name );
 
-  time( &start_time );
+  start_time = get_real_timer();
 
   games_parsed = 0;
   games_imported = 0;
   do {
     fgets( line_buffer, 998, stream );
-    sscanf( line_buffer, "%s %d", move_string, &diff );
-    move_count = (strlen( move_string ) - 1) / 3;
+    move_count = parse_game_line( line_buffer, game_move_list, &diff );
     games_parsed++;
-    for ( i = 0; i < move_count; i++ ) {
-      sscanf( move_string + 3 * i, "%c%c%c", &sign, &column, &row );
-      game_move_list[i] = 10 * (row - '0') + (column - 'a' + 1);
-      if ( sign == '-' )
-	game_move_list[i] = -game_move_list[i];
-    }
     if ( abs( diff ) <= max_diff ) {
       add_new_game( move_count, game_move_list, min_empties, 0, 0,
 		    FALSE, FALSE );
@@ -2797,13 +3244,17 @@ build_tree( const char *file_name, int max_game_count,
     }
   } while ( games_parsed < max_game_count );
 
-  time( &stop_time );
+  stop_time = get_real_timer();
 
   fclose( stream );
 
 #ifdef TEXT_BASED
   printf( "\ndone (took %d s)\n", (int) (stop_time - start_time) );
-  printf( "%d games read; %d games imported\n", games_parsed, games_imported );
+  printf( "%d games read; %d games imported", games_parsed, games_imported );
+  if ( stop_time > start_time )
+    printf( " (%.1f games/s)",
+	    games_imported / (stop_time - start_time) );
+  puts( "" );
   printf( "Games with final difference <= %d were read until %d empties.\n",
 	  max_diff, min_empties );
   puts( "" );
@@ -2811,6 +3262,846 @@ build_tree( const char *file_name, int max_game_count,
 }
 
 
+#ifdef INCLUDE_BOOKTOOL
+
+/*
+   UNDO_IMPORT_GAME
+   Takes back the moves made by replay_import_game().
+*/
+
+static void
+undo_import_game( const short *game_move_list, int move_count ) {
+  int i;
+
+  for ( i = move_count - 1; i >= 0; i-- )
+    unmake_move_no_hash( game_move_list[i] > 0 ? BLACKSQ : WHITESQ,
+			 abs( game_move_list[i] ) );
+}
+
+
+/*
+   REPLAY_IMPORT_GAME
+   Plays the first MOVE_COUNT moves of GAME_MOVE_LIST from the current
+   position and returns the side to move afterwards (determined as
+   in add_new_game()), or ILLEGAL if a move is invalid, in which
+   case the board is left unchanged.
+*/
+
+static int
+replay_import_game( const short *game_move_list, int move_count ) {
+  int i;
+  int side_to_move, this_move;
+
+  side_to_move = BLACKSQ;
+  for ( i = 0; i < move_count; i++ ) {
+    this_move = abs( game_move_list[i] );
+    if ( game_move_list[i] > 0 )
+      side_to_move = BLACKSQ;
+    else
+      side_to_move = WHITESQ;
+    if ( !generate_specific( this_move, side_to_move ) ) {
+      undo_import_game( game_move_list, i );
+      return ILLEGAL;
+    }
+    (void) make_move_no_hash( side_to_move, this_move );
+  }
+
+  return OPP( side_to_move );
+}
+
+
+/*
+   IMPORT_HASH_WORKER
+   The first pass of bulk_build_tree(): replays the games in the
+   shard and records the hash codes of all positions up to the
+   cutoff, and the outcome of games played to the end.
+*/
+
+static void
+import_hash_worker( int worker_index, void *context ) {
+  ImportShard *shard = (ImportShard *) context;
+  ImportGame *game;
+  ImportPosition *position;
+  const short *game_move_list;
+  int i;
+  int game_index;
+  int side_to_move;
+  int orientation;
+  int black_count, white_count;
+
+  while ( (game_index = claim_next_job( shard->next_job )) <
+	  shard->game_count ) {
+    game = &shard->game[game_index];
+    game_move_list = shard->move_buffer + game->first_move;
+    position = shard->position + game_index * 61;
+
+    /* Hash every position on the way to the cutoff */
+
+    side_to_move = BLACKSQ;
+    for ( i = 0; i <= game->last_move_number; i++ ) {
+      get_hash( &position[i].hash_val1, &position[i].hash_val2,
+		&orientation );
+      position[i].game = game_index;
+      position[i].ply = i;
+      if ( i == game->move_count )
+	position[i].flags = 0;
+      else if ( game_move_list[i] > 0 )
+	position[i].flags = BLACK_TO_MOVE;
+      else
+	position[i].flags = WHITE_TO_MOVE;
+      if ( i == game->last_move_number )
+	break;
+      side_to_move = (game_move_list[i] > 0) ? BLACKSQ : WHITESQ;
+      if ( !generate_specific( abs( game_move_list[i] ), side_to_move ) ) {
+	undo_import_game( game_move_list, i );
+	game->status = IMPORT_INVALID;
+	game->outcome = i;
+	break;
+      }
+      (void) make_move_no_hash( side_to_move, abs( game_move_list[i] ) );
+    }
+    if ( game->status == IMPORT_INVALID )
+      continue;
+    game->leaf_hash_val1 = position[game->last_move_number].hash_val1;
+    game->leaf_hash_val2 = position[game->last_move_number].hash_val2;
+    game->leaf_side_to_move = OPP( side_to_move );
+
+    if ( game->last_move_number == game->move_count ) {  /* No cutoff */
+      black_count = disc_count( BLACKSQ );
+      white_count = disc_count( WHITESQ );
+      if ( black_count > white_count )
+	game->outcome = 64 - 2 * white_count;
+      else if ( white_count > black_count )
+	game->outcome = 2 * black_count - 64;
+      else
+	game->outcome = 0;
+      game->status = IMPORT_FINISHED;
+    }
+    else
+      game->status = IMPORT_NEEDS_SOLVE;
+
+    undo_import_game( game_move_list, game->last_move_number );
+  }
+}
+
+
+/*
+   IMPORT_SOLVE_WORKER
+   The second pass of bulk_build_tree(): solves the distinct
+   cutoff positions exactly.
+*/
+
+static void
+import_solve_worker( int worker_index, void *context ) {
+  ImportShard *shard = (ImportShard *) context;
+  ImportGame *game;
+  EvaluationType dummy_info;
+  const short *game_move_list;
+  int job_index;
+  int side_to_move;
+
+  while ( (job_index = claim_next_job( shard->next_job )) <
+	  shard->solve_count ) {
+    game = &shard->game[shard->solve_game[job_index]];
+    game_move_list = shard->move_buffer + game->first_move;
+
+    (void) replay_import_game( game_move_list, game->last_move_number );
+    side_to_move = game->leaf_side_to_move;
+    generate_all( side_to_move );
+    determine_hash_values( side_to_move, board );
+    (void) end_game( side_to_move, FALSE, FALSE, TRUE, 0, &dummy_info );
+    if ( side_to_move == BLACKSQ )
+      game->outcome = +root_eval;
+    else
+      game->outcome = -root_eval;
+    __sync_synchronize();
+    game->status = IMPORT_FINISHED;
+    undo_import_game( game_move_list, game->last_move_number );
+  }
+}
+
+
+/*
+   IMPORT_POSITION_COMPARE
+   Sorts positions on hash code; for equal positions the first
+   occurrence (in game order) comes first.
+*/
+
+static int
+import_position_compare( const void *p1, const void *p2 ) {
+  const ImportPosition *pos1 = (const ImportPosition *) p1;
+  const ImportPosition *pos2 = (const ImportPosition *) p2;
+
+  if ( pos1->hash_val1 != pos2->hash_val1 )
+    return (pos1->hash_val1 < pos2->hash_val1) ? -1 : 1;
+  if ( pos1->hash_val2 != pos2->hash_val2 )
+    return (pos1->hash_val2 < pos2->hash_val2) ? -1 : 1;
+  if ( pos1->game != pos2->game )
+    return (pos1->game < pos2->game) ? -1 : 1;
+  return pos1->ply - pos2->ply;
+}
+
+
+/*
+   IMPORT_ORDER_COMPARE
+   Sorts positions in the order add_new_game() would meet them.
+*/
+
+static int
+import_order_compare( const void *p1, const void *p2 ) {
+  const ImportPosition *pos1 = (const ImportPosition *) p1;
+  const ImportPosition *pos2 = (const ImportPosition *) p2;
+
+  if ( pos1->game != pos2->game )
+    return (pos1->game < pos2->game) ? -1 : 1;
+  return pos1->ply - pos2->ply;
+}
+
+
+/*
+   IMPORT_SOLVE_COMPARE
+   Sorts games needing a solve on cutoff node, then game order.
+*/
+
+static int
+import_solve_compare( const void *p1, const void *p2 ) {
+  int game1 = *((const int *) p1);
+  int game2 = *((const int *) p2);
+  int node1 = import_sort_shard->game[game1].leaf_node;
+  int node2 = import_sort_shard->game[game2].leaf_node;
+
+  if ( node1 != node2 )
+    return node1 - node2;
+  return game1 - game2;
+}
+
+
+/*
+   IMPORT_SHARD
+   Adds the games in SHARD to the tree. The result is the same as
+   that of calling add_new_game() for each game, but the games are
+   hashed and solved by the worker pool and all new nodes are
+   created in one pass.
+   Returns the number of new nodes.
+*/
+
+static int
+import_shard( ImportShard *shard ) {
+  ImportGame *game;
+  ImportPosition *position;
+  int i, j;
+  int position_count, new_count;
+  int slot;
+  int failed;
+
+  import_sort_shard = shard;
+
+  /* Pass 1: Hash all positions in parallel */
+
+  prepare_tree_traversal();
+  *shard->next_job = 0;
+  failed = run_workers( MIN( book_workers, shard->game_count ),
+			import_hash_worker, NULL, shard );
+  if ( failed > 0 )
+    fatal_error( "%d %s\n", failed, IMPORT_WORKER_ERROR );
+
+  /* Gather the positions and drop duplicates; the first occurrence
+     of each new position becomes a book node */
+
+  position_count = 0;
+  for ( i = 0; i < shard->game_count; i++ ) {
+    game = &shard->game[i];
+    if ( game->status == IMPORT_INVALID )
+      fatal_error( "%s: %d\n", BOOK_INVALID_MOVE,
+		   abs( shard->move_buffer[game->first_move + game->outcome] ) );
+    for ( j = 0; j <= game->last_move_number; j++ )
+      shard->position[position_count++] = shard->position[61 * i + j];
+  }
+  qsort( shard->position, position_count, sizeof( ImportPosition ),
+	 import_position_compare );
+
+  new_count = 0;
+  for ( i = 0; i < position_count; i++ ) {
+    position = &shard->position[i];
+    if ( (i > 0) &&
+	 (position->hash_val1 == shard->position[i - 1].hash_val1) &&
+	 (position->hash_val2 == shard->position[i - 1].hash_val2) )
+      continue;
+    slot = probe_hash_table( position->hash_val1, position->hash_val2 );
+    if ( (slot == NOT_AVAILABLE) ||
+	 (book_hash_table[slot] == EMPTY_HASH_SLOT) )
+      shard->position[new_count++] = *position;
+  }
+  qsort( shard->position, new_count, sizeof( ImportPosition ),
+	 import_order_compare );
+
+  /* Allocate room for all new nodes at once and create them */
+
+  if ( book_node_count + new_count > node_table_size )
+    set_allocation( book_node_count + new_count + NODE_TABLE_SLACK );
+  for ( i = 0; i < new_count; i++ )
+    (void) create_BookNode( shard->position[i].hash_val1,
+			    shard->position[i].hash_val2,
+			    shard->position[i].flags );
+
+  /* Pass 2: Solve the distinct cutoff positions in parallel */
+
+  shard->solve_count = 0;
+  for ( i = 0; i < shard->game_count; i++ ) {
+    game = &shard->game[i];
+    slot = probe_hash_table( game->leaf_hash_val1, game->leaf_hash_val2 );
+    game->leaf_node = book_hash_table[slot];
+    game->solver = i;
+    if ( game->status == IMPORT_NEEDS_SOLVE )
+      shard->solve_game[shard->solve_count++] = i;
+  }
+  qsort( shard->solve_game, shard->solve_count, sizeof( int ),
+	 import_solve_compare );
+  for ( i = 0, j = 0; i < shard->solve_count; i++ ) {
+    game = &shard->game[shard->solve_game[i]];
+    if ( (j > 0) &&
+	 (game->leaf_node ==
+	  shard->game[shard->solve_game[j - 1]].leaf_node) )
+      game->solver = shard->solve_game[j - 1];
+    else
+      shard->solve_game[j++] = shard->solve_game[i];
+  }
+  shard->solve_count = j;
+
+  if ( shard->solve_count > 0 ) {
+    *shard->next_job = 0;
+    failed = run_workers( MIN( book_workers, shard->solve_count ),
+			  import_solve_worker, NULL, shard );
+    if ( failed > 0 )
+      fatal_error( "%d %s\n", failed, IMPORT_WORKER_ERROR );
+  }
+
+  /* Transfer the outcomes to the cutoff nodes in game order */
+
+  for ( i = 0; i < shard->game_count; i++ ) {
+    game = &shard->game[i];
+    store_solved_score( game->leaf_node,
+			shard->game[game->solver].outcome, TRUE );
+    total_game_count++;
+  }
+
+  return new_count;
+}
+
+
+/*
+   BULK_BUILD_TREE
+   Reads games from the file pointed to by FILE_NAME and
+   incorporates them into the game tree like build_tree(), but
+   processes the games in shards of IMPORT_SHARD_SIZE games using
+   the worker pool.
+*/
+
+void
+bulk_build_tree( const char *file_name, int max_game_count,
+		 int max_diff, int min_empties ) {
+  ImportShard shard;
+  char line_buffer[1000];
+  double start_time, stop_time;
+  int stored_echo;
+  int games_parsed, games_imported;
+  int move_count;
+  int diff;
+  int new_node_count;
+  short game_move_list[60];
+  FILE *stream;
+
+#ifdef TEXT_BASED
+  printf( "Importing game list using %d workers...\n", book_workers );
+  fflush( stdout );
+#endif
+
+  stream = fopen( file_name, "r" );
+  if ( stream == NULL )
+    fatal_error( "%s '%s'\n", NO_GAME_FILE_ERROR, file_name );
+
+  stored_echo = echo;
+  echo = FALSE;
+  toggle_event_status( FALSE );
+
+  shard.game = (ImportGame *)
+    shared_malloc( IMPORT_SHARD_SIZE * sizeof( ImportGame ) );
+  shard.position = (ImportPosition *)
+    shared_malloc( 61 * IMPORT_SHARD_SIZE * sizeof( ImportPosition ) );
+  shard.next_job = (volatile int *) shared_malloc( sizeof( int ) );
+  shard.move_buffer =
+    (short *) safe_malloc( 60 * IMPORT_SHARD_SIZE * sizeof( short ) );
+  shard.solve_game = (int *) safe_malloc( IMPORT_SHARD_SIZE * sizeof( int ) );
+
+  start_time = get_real_timer();
+
+  games_parsed = 0;
+  games_imported = 0;
+  new_node_count = 0;
+  shard.game_count = 0;
+  while ( (games_parsed < max_game_count) &&
+	  (fgets( line_buffer, 998, stream ) != NULL) ) {
+    move_count = parse_game_line( line_buffer, game_move_list, &diff );
+    games_parsed++;
+    if ( abs( diff ) <= max_diff ) {
+      ImportGame *game = &shard.game[shard.game_count];
+
+      game->first_move = 60 * shard.game_count;
+      game->move_count = move_count;
+      game->last_move_number = MIN( move_count, 60 - min_empties );
+      game->status = IMPORT_PENDING;
+      memcpy( shard.move_buffer + game->first_move, game_move_list,
+	      move_count * sizeof( short ) );
+      shard.game_count++;
+    }
+    if ( (shard.game_count == IMPORT_SHARD_SIZE) ||
+	 ((shard.game_count > 0) && (games_parsed == max_game_count)) ) {
+      new_node_count += import_shard( &shard );
+      games_imported += shard.game_count;
+      shard.game_count = 0;
+#ifdef TEXT_BASED
+      stop_time = get_real_timer();
+      printf( " --- %d games, %d new nodes (%.1f games/s) ---\n",
+	      games_imported, new_node_count,
+	      games_imported / MAX( stop_time - start_time, 0.001 ) );
+      fflush( stdout );
+#endif
+    }
+  }
+  if ( shard.game_count > 0 ) {
+    new_node_count += import_shard( &shard );
+    games_imported += shard.game_count;
+  }
+
+  stop_time = get_real_timer();
+
+  fclose( stream );
+  shared_free( shard.game, IMPORT_SHARD_SIZE * sizeof( ImportGame ) );
+  shared_free( shard.position,
+	       61 * IMPORT_SHARD_SIZE * sizeof( ImportPosition ) );
+  shared_free( (void *) shard.next_job, sizeof( int ) );
+  free( shard.move_buffer );
+  free( shard.solve_game );
+
+  toggle_event_status( TRUE );
+  echo = stored_echo;
+
+#ifdef TEXT_BASED
+  printf( "done (took %.1f s)\n", stop_time - start_time );
+  printf( "%d games read; %d games imported; %d new nodes",
+	  games_parsed, games_imported, new_node_count );
+  if ( stop_time > start_time )
+    printf( " (%.1f games/s)",
+	    games_imported / (stop_time - start_time) );
+  puts( "" );
+  printf( "Games with final difference <= %d were read until %d empties.\n",
+	  max_diff, min_empties );
+  puts( "" );
+#endif
+}
+
+
+/*
+   LEARN_WORKER
+   Performs the endgame solves and the deviation searches of a
+   batch in learn_game_list(). The book tree is not modified;
+   the results are returned in the job list.
+*/
+
+static void
+learn_worker( int worker_index, void *context ) {
+  LearnBatch *batch = (LearnBatch *) context;
+  LearnJob *job;
+  EvaluationType dummy_info;
+  const short *game_move_list;
+  int job_index;
+  int side_to_move;
+
+  while ( (job_index = claim_next_job( batch->next_job )) <
+	  batch->job_count ) {
+    job = &batch->job[job_index];
+    game_move_list = batch->move_buffer + 60 * job->game;
+
+    (void) replay_import_game( game_move_list, job->ply );
+    side_to_move = job->side_to_move;
+    generate_all( side_to_move );
+    determine_hash_values( side_to_move, board );
+    if ( job->kind == LEARN_EVALUATE ) {
+      evaluate_node( job->index );
+      job->best_alternative_move = node[job->index].best_alternative_move;
+      job->alternative_score = node[job->index].alternative_score;
+    }
+    else {
+      (void) end_game( side_to_move, job->kind == LEARN_WLD_SOLVE,
+		       FALSE, TRUE, 0, &dummy_info );
+      if ( side_to_move == BLACKSQ )
+	job->outcome = +root_eval;
+      else
+	job->outcome = -root_eval;
+    }
+    undo_import_game( game_move_list, job->ply );
+  }
+}
+
+
+/*
+   LEARN_JOB_COMPARE
+   Sorts searches on book node, then game order.
+*/
+
+static int
+learn_job_compare( const void *p1, const void *p2 ) {
+  const LearnJob *job1 = (const LearnJob *) p1;
+  const LearnJob *job2 = (const LearnJob *) p2;
+
+  if ( job1->index != job2->index )
+    return job1->index - job2->index;
+  if ( job1->game != job2->game )
+    return job1->game - job2->game;
+  return job1->ply - job2->ply;
+}
+
+
+/*
+   QUEUE_LEARN_JOB
+   Adds a search of book node INDEX, met at move PLY of game GAME,
+   to BATCH.
+*/
+
+static void
+queue_learn_job( LearnBatch *batch, int index, int game, int ply,
+		 int side_to_move, int kind ) {
+  LearnJob *job = &batch->job[batch->job_count++];
+
+  job->index = index;
+  job->game = game;
+  job->ply = ply;
+  job->side_to_move = side_to_move;
+  job->kind = kind;
+}
+
+
+/*
+   LEARN_BATCH
+   Adds the public games in BATCH to the tree. The nodes are
+   created and the searches add_new_game() would perform along
+   the game paths are collected in one pass; each distinct node
+   is then solved or evaluated once by the worker pool, and
+   finally the paths are minimaxed game by game.
+   The deviation searches see the tree with all games of the
+   batch added, so the result may differ slightly from calling
+   add_new_game() for one game at a time.
+   Returns the number of new nodes.
+*/
+
+static int
+learn_batch( LearnBatch *batch, int min_empties,
+	     int max_full_solve, int max_wld_solve ) {
+  LearnJob *job;
+  const short *game_move_list;
+  int i, j;
+  int *visited_node;
+  int side_to_move, this_move;
+  int this_node, slot;
+  int val1, val2, orientation;
+  int last_move_number, first_new_node;
+  int black_count, white_count;
+  int outcome, force_eval;
+  int dummy_black_score, dummy_white_score;
+  int failed;
+  int start_node_count;
+
+  start_node_count = book_node_count;
+  batch->job_count = 0;
+
+  /* Pass 1: Create the new nodes and queue the searches */
+
+  prepare_tree_traversal();
+  for ( i = 0; i < batch->game_count; i++ ) {
+    game_move_list = batch->move_buffer + 60 * i;
+    visited_node = batch->visited_node + 61 * i;
+    last_move_number = MIN( batch->move_count[i], 60 - min_empties );
+    batch->last_move_number[i] = last_move_number;
+
+    first_new_node = 61;
+    side_to_move = BLACKSQ;
+    for ( j = 0; j <= last_move_number; j++ ) {
+      get_hash( &val1, &val2, &orientation );
+      slot = probe_hash_table( val1, val2 );
+      if ( (slot == NOT_AVAILABLE) ||
+	   (book_hash_table[slot] == EMPTY_HASH_SLOT) ) {
+	if ( j == batch->move_count[i] )
+	  this_node = create_BookNode( val1, val2, 0 );
+	else
+	  this_node = create_BookNode( val1, val2,
+				       (game_move_list[j] > 0) ?
+				       BLACK_TO_MOVE : WHITE_TO_MOVE );
+	if ( j < first_new_node )
+	  first_new_node = j;
+      }
+      else
+	this_node = book_hash_table[slot];
+      visited_node[j] = this_node;
+      if ( j == last_move_number )
+	break;
+      this_move = abs( game_move_list[j] );
+      side_to_move = (game_move_list[j] > 0) ? BLACKSQ : WHITESQ;
+      if ( !generate_specific( this_move, side_to_move ) )
+	fatal_error( "%s: %d\n", BOOK_INVALID_MOVE, this_move );
+      (void) make_move_no_hash( side_to_move, this_move );
+    }
+    if ( last_move_number > 0 )
+      side_to_move = OPP( side_to_move );
+
+    /* The position at the cutoff is always solved exactly */
+
+    this_node = visited_node[last_move_number];
+    if ( last_move_number == batch->move_count[i] ) {  /* No cutoff */
+      black_count = disc_count( BLACKSQ );
+      white_count = disc_count( WHITESQ );
+      if ( black_count > white_count )
+	outcome = 64 - 2 * white_count;
+      else if ( white_count > black_count )
+	outcome = 2 * black_count - 64;
+      else
+	outcome = 0;
+      store_solved_score( this_node, outcome, TRUE );
+    }
+    else if ( !(node[this_node].flags & FULL_SOLVED) )
+      queue_learn_job( batch, this_node, i, last_move_number,
+		       side_to_move, LEARN_FULL_SOLVE );
+    undo_import_game( game_move_list, last_move_number );
+
+    /* The positions on the path are solved or evaluated depending
+       on the number of empty squares */
+
+    for ( j = 0; j < last_move_number; j++ ) {
+      this_node = visited_node[j];
+      if ( node[this_node].flags & PRIVATE_NODE )
+	node[this_node].flags ^= PRIVATE_NODE;
+      side_to_move = (game_move_list[j] > 0) ? BLACKSQ : WHITESQ;
+      if ( j >= 60 - max_full_solve ) {
+	if ( !(node[this_node].flags & FULL_SOLVED) )
+	  queue_learn_job( batch, this_node, i, j, side_to_move,
+			   LEARN_FULL_SOLVE );
+      }
+      else if ( j >= 60 - max_wld_solve ) {
+	if ( !(node[this_node].flags & WLD_SOLVED) )
+	  queue_learn_job( batch, this_node, i, j, side_to_move,
+			   LEARN_WLD_SOLVE );
+      }
+      else {
+	force_eval = (j >= first_new_node - 1) ||
+	  (node[this_node].best_alternative_move ==
+	   abs( game_move_list[j] ));
+	if ( force_eval )
+	  clear_node_depth( this_node );
+	queue_learn_job( batch, this_node, i, j, side_to_move,
+			 LEARN_EVALUATE );
+      }
+    }
+  }
+
+  /* Search each node once, and only evaluate the nodes
+     evaluate_node() wouldn't skip */
+
+  qsort( batch->job, batch->job_count, sizeof( LearnJob ),
+	 learn_job_compare );
+  for ( i = 0, j = 0; i < batch->job_count; i++ ) {
+    job = &batch->job[i];
+    if ( (i > 0) && (job->index == batch->job[i - 1].index) )
+      continue;
+    if ( (job->kind == LEARN_EVALUATE) &&
+	 !node_needs_evaluation( job->index ) )
+      continue;
+    batch->job[j++] = *job;
+  }
+  batch->job_count = j;
+
+  /* Pass 2: Perform the searches in parallel */
+
+  if ( batch->job_count > 0 ) {
+    *batch->next_job = 0;
+    failed = run_workers( MIN( book_workers, batch->job_count ),
+			  learn_worker, NULL, batch );
+    if ( failed > 0 )
+      fatal_error( "%d %s\n", failed, LEARN_WORKER_ERROR );
+  }
+
+  for ( i = 0; i < batch->job_count; i++ ) {
+    job = &batch->job[i];
+    if ( job->kind == LEARN_EVALUATE ) {
+      node[job->index].best_alternative_move = job->best_alternative_move;
+      node[job->index].alternative_score = job->alternative_score;
+      if ( job->best_alternative_move == POSITION_EXHAUSTED )
+	exhausted_node_count++;
+      else
+	evaluated_count++;
+      clear_node_depth( job->index );
+      set_node_depth( job->index, search_depth );
+    }
+    else
+      store_solved_score( job->index, job->outcome,
+			  job->kind == LEARN_FULL_SOLVE );
+  }
+
+  /* Pass 3: Update the minimax values along the game paths */
+
+  for ( i = 0; i < batch->game_count; i++ ) {
+    game_move_list = batch->move_buffer + 60 * i;
+    visited_node = batch->visited_node + 61 * i;
+    last_move_number = batch->last_move_number[i];
+
+    prepare_tree_traversal();
+    for ( j = 0; j < last_move_number; j++ ) {
+      this_move = abs( game_move_list[j] );
+      side_to_move = (game_move_list[j] > 0) ? BLACKSQ : WHITESQ;
+      (void) generate_specific( this_move, side_to_move );
+      (void) make_move( side_to_move, this_move, TRUE );
+    }
+    for ( j = last_move_number - 1; j >= 0; j-- ) {
+      side_to_move = (game_move_list[j] > 0) ? BLACKSQ : WHITESQ;
+      unmake_move( side_to_move, abs( game_move_list[j] ) );
+      this_node = visited_node[j];
+      node[this_node].flags |= NOT_TRAVERSED;
+      do_minimax( this_node, &dummy_black_score, &dummy_white_score );
+      if ( !(node[this_node].flags & WLD_SOLVED) &&
+	   (node[this_node].best_alternative_move == NO_MOVE) &&
+	   (node[this_node].alternative_score == NO_SCORE) ) {
+	/* Minimax discovered that the node hasn't got a deviation
+	   any longer because that move has been played. */
+	generate_all( side_to_move );
+	determine_hash_values( side_to_move, board );
+	evaluate_node( this_node );
+	do_minimax( this_node, &dummy_black_score, &dummy_white_score );
+      }
+    }
+  }
+  total_game_count += batch->game_count;
+
+  return book_node_count - start_node_count;
+}
+
+
+/*
+   LEARN_GAME_LIST
+   Reads games from the file pointed to by FILE_NAME and learns
+   them as public games like add_new_game() does, BATCH_SIZE games
+   at a time using the worker pool. If BOOK_FILE_NAME isn't NULL,
+   the book is saved to that file (in binary if BINARY_BOOK is set)
+   after every batch.
+*/
+
+void
+learn_game_list( const char *file_name, int batch_size,
+		 int min_empties, int max_full_solve, int max_wld_solve,
+		 const char *book_file_name, int binary_book ) {
+  LearnBatch batch;
+  char line_buffer[1000];
+  double start_time, stop_time;
+  int stored_echo;
+  int games_learned;
+  int search_count;
+  int new_node_count;
+  int diff;
+  FILE *stream;
+
+  batch_size = MAX( batch_size, 1 );
+
+#ifdef TEXT_BASED
+  printf( "Learning game list in batches of %d games using %d workers...\n",
+	  batch_size, book_workers );
+  fflush( stdout );
+#endif
+
+  stream = fopen( file_name, "r" );
+  if ( stream == NULL )
+    fatal_error( "%s '%s'\n", NO_GAME_FILE_ERROR, file_name );
+
+  stored_echo = echo;
+  echo = FALSE;
+  toggle_event_status( FALSE );
+
+  batch.move_buffer =
+    (short *) safe_malloc( 60 * batch_size * sizeof( short ) );
+  batch.move_count = (short *) safe_malloc( batch_size * sizeof( short ) );
+  batch.last_move_number =
+    (short *) safe_malloc( batch_size * sizeof( short ) );
+  batch.visited_node = (int *) safe_malloc( 61 * batch_size * sizeof( int ) );
+  batch.job = (LearnJob *)
+    shared_malloc( 61 * batch_size * sizeof( LearnJob ) );
+  batch.next_job = (volatile int *) shared_malloc( sizeof( int ) );
+
+  start_time = get_real_timer();
+
+  games_learned = 0;
+  search_count = 0;
+  new_node_count = 0;
+  batch.game_count = 0;
+  for ( ; ; ) {
+    if ( fgets( line_buffer, 998, stream ) != NULL ) {
+      diff = 0;
+      batch.move_count[batch.game_count] =
+	parse_game_line( line_buffer,
+			 batch.move_buffer + 60 * batch.game_count, &diff );
+      if ( batch.move_count[batch.game_count] > 0 )
+	batch.game_count++;
+      if ( batch.game_count < batch_size )
+	continue;
+    }
+    if ( batch.game_count == 0 )
+      break;
+
+    new_node_count += learn_batch( &batch, min_empties,
+				   max_full_solve, max_wld_solve );
+    games_learned += batch.game_count;
+    search_count += batch.job_count;
+    batch.game_count = 0;
+
+    if ( book_file_name != NULL ) {
+      if ( binary_book )
+	write_binary_database( book_file_name );
+      else
+	write_text_database( book_file_name );
+    }
+
+#ifdef TEXT_BASED
+    stop_time = get_real_timer();
+    printf( " --- %d games, %d new nodes, %d searches (%.2f games/s) ---\n",
+	    games_learned, new_node_count, search_count,
+	    games_learned / MAX( stop_time - start_time, 0.001 ) );
+    fflush( stdout );
+#endif
+  }
+
+  stop_time = get_real_timer();
+
+  fclose( stream );
+  free( batch.move_buffer );
+  free( batch.move_count );
+  free( batch.last_move_number );
+  free( batch.visited_node );
+  shared_free( batch.job, 61 * batch_size * sizeof( LearnJob ) );
+  shared_free( (void *) batch.next_job, sizeof( int ) );
+
+  toggle_event_status( TRUE );
+  echo = stored_echo;
+
+#ifdef TEXT_BASED
+  printf( "done (took %.1f s)\n", stop_time - start_time );
+  printf( "%d games learned; %d new nodes; %d searches",
+	  games_learned, new_node_count, search_count );
+  if ( stop_time > start_time )
+    printf( " (%.2f games/s)", games_learned / (stop_time - start_time) );
+  puts( "" );
+  puts( "" );
+#endif
+}
+
+#endif
+
+
+
 /*
    READ_TEXT_DATABASE
    Reads an existing ASCII database file.
@@ -109,6 +109,17 @@ void
 build_tree( const char *file_name, int max_game_count,
 	    int max_diff, int min_empties );
 
+#ifdef INCLUDE_BOOKTOOL
+void
+bulk_build_tree( const char *file_name, int max_game_count,
+		 int max_diff, int min_empties );
+
+void
+learn_game_list( const char *file_name, int batch_size,
+		 int min_empties, int max_full_solve, int max_wld_solve,
+		 const char *book_file_name, int binary_book );
+#endif
+
 void
 read_text_database( const char *file_name );
 
@@ -160,6 +171,12 @@ clear_tree( int low, int high, int flags );
 void
 set_output_script_name( const char *script_name );
 
+void
+set_book_workers( int worker_count );
+
+void
+set_correction_checkpoint( const char *file_name );
+
 void
 correct_tree( int max_empty, int full_solve );
 
@@ -0,0 +1,171 @@
+/*
+   File:          parallel.c
+
+   Created:       October 18, 2026
+
+   Modified:
+
+   Contents:      A simple process-based worker pool. Each worker is
+                  a forked copy of the calling process and hence owns
+                  a private copy of the board, the hash table and all
+                  other search state; jobs are handed out through a
+                  counter in shared memory.
+*/
+
+
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "error.h"
+#include "macros.h"
+#include "parallel.h"
+#include "texts.h"
+
+
+
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS             MAP_ANON
+#endif
+
+
+
+/*
+   GET_PROCESSOR_COUNT
+   Returns the number of online processors, or 1 if this
+   can't be determined.
+*/
+
+int
+get_processor_count( void ) {
+  long count = 1;
+
+#ifdef _SC_NPROCESSORS_ONLN
+  count = sysconf( _SC_NPROCESSORS_ONLN );
+#endif
+  if ( count < 1 )
+    count = 1;
+
+  return MIN( (int) count, MAX_WORKER_COUNT );
+}
+
+
+/*
+   SHARED_MALLOC
+   Allocates a zero-filled block which is shared between the
+   calling process and all workers started afterwards.
+*/
+
+void *
+shared_malloc( size_t size ) {
+  void *block;
+
+  block = mmap( NULL, MAX( size, 1 ), PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_ANONYMOUS, -1, 0 );
+  if ( block == MAP_FAILED )
+    fatal_error( "%s %lu\n", SHARED_MEMORY_ERROR, (unsigned long) size );
+
+  return block;
+}
+
+
+/*
+   SHARED_FREE
+   Releases a block allocated with shared_malloc().
+*/
+
+void
+shared_free( void *block, size_t size ) {
+  if ( block != NULL )
+    munmap( block, MAX( size, 1 ) );
+}
+
+
+/*
+   CLAIM_NEXT_JOB
+   Atomically increments the shared job counter and returns
+   its previous value.
+*/
+
+int
+claim_next_job( volatile int *next_job ) {
+  return __sync_fetch_and_add( next_job, 1 );
+}
+
+
+/*
+   RUN_WORKERS
+   Starts WORKER_COUNT processes which each call WORKER and then
+   terminate. While waiting for them, PROGRESS (if non-NULL) is
+   called regularly in the parent process, and once more after all
+   workers have finished.
+   Returns the number of workers which terminated abnormally.
+*/
+
+int
+run_workers( int worker_count, WorkerFunction worker,
+	     ProgressFunction progress, void *context ) {
+  int i;
+  int status;
+  int running, failed;
+  pid_t pid;
+  pid_t worker_pid[MAX_WORKER_COUNT];
+  struct timeval poll_delay;
+
+  worker_count = MAX( 1, MIN( worker_count, MAX_WORKER_COUNT ) );
+
+  /* Pending output would otherwise be written once by every worker */
+  fflush( stdout );
+  fflush( stderr );
+
+  running = 0;
+  failed = 0;
+  for ( i = 0; i < worker_count; i++ ) {
+    pid = fork();
+    if ( pid == 0 ) {
+      worker( i, context );
+      fflush( stdout );
+      _exit( EXIT_SUCCESS );
+    }
+    if ( pid < 0 ) {
+      fprintf( stderr, "%s: %s\n", WORKER_START_ERROR, strerror( errno ) );
+      failed++;
+      continue;
+    }
+    worker_pid[running++] = pid;
+  }
+
+  while ( running > 0 ) {
+    pid = waitpid( -1, &status, WNOHANG );
+    if ( pid > 0 ) {
+      for ( i = 0; i < running; i++ )
+	if ( worker_pid[i] == pid ) {
+	  worker_pid[i] = worker_pid[--running];
+	  if ( !WIFEXITED( status ) || (WEXITSTATUS( status ) != 0) )
+	    failed++;
+	  break;
+	}
+      continue;
+    }
+    if ( (pid < 0) && (errno != EINTR) )
+      break;
+    if ( progress != NULL )
+      progress( context );
+    poll_delay.tv_sec = (long) WORKER_POLL_INTERVAL;
+    poll_delay.tv_usec =
+      (long) (1000000.0 * (WORKER_POLL_INTERVAL - poll_delay.tv_sec));
+    select( 0, NULL, NULL, NULL, &poll_delay );
+  }
+
+  if ( progress != NULL )
+    progress( context );
+
+  return failed;
+}
@@ -0,0 +1,71 @@
+/*
+   File:          parallel.h
+
+   Created:       October 18, 2026
+
+   Modified:
+
+   Contents:      The interface to the worker pool used by the
+                  offline tools (book correction, learning etc.).
+                  The engine keeps its search state in global
+                  variables, so the workers are separate processes
+                  that share job queues and results through
+                  anonymous shared memory.
+*/
+
+
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+
+
+#include <stdlib.h>
+
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/* The worker count used when nothing else is specified */
+#define DEFAULT_WORKER_COUNT      1
+#define MAX_WORKER_COUNT          256
+
+/* The number of seconds between calls to the progress function */
+#define WORKER_POLL_INTERVAL      0.25
+
+
+
+typedef void (*WorkerFunction)( int worker_index, void *context );
+typedef void (*ProgressFunction)( void *context );
+
+
+
+int
+get_processor_count( void );
+
+void *
+shared_malloc( size_t size );
+
+void
+shared_free( void *block, size_t size );
+
+int
+claim_next_job( volatile int *next_job );
+
+int
+run_workers( int worker_count, WorkerFunction worker,
+	     ProgressFunction progress, void *context );
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+
+#endif  /* PARALLEL_H */
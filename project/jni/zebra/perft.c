@@ -0,0 +1,522 @@
+/*
+   File:         perft.c
+
+   Created:      October 19, 2026
+
+   Modified:
+
+   Contents:     Counts the leaf nodes of the game tree to a fixed
+                 depth from the initial position or from random
+                 positions. The count is made with each move generator
+                 and flip function in turn, the results are checked
+                 against each other and the speed of each combination
+                 is reported. With -check every node is also verified
+                 move by move.
+*/
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bitbmob.h"
+#include "bitboard.h"
+#include "bitbtest.h"
+#include "constant.h"
+#include "globals.h"
+#include "hash.h"
+#include "macros.h"
+#include "moves.h"
+#include "myrandom.h"
+#include "search.h"
+#include "timer.h"
+#include "unflip.h"
+
+
+
+#define MAX_PERFT_DEPTH       20
+#define DEFAULT_RANDOM_DISKS  20
+#define PERFT_HASH_BITS       10
+
+/* The known counts from the initial position, a pass counting
+   as a move and a finished game as a leaf */
+#define KNOWN_DEPTHS          11
+
+static const long long known_count[KNOWN_DEPTHS + 1] = {
+  1LL, 4LL, 12LL, 56LL, 244LL, 1396LL, 8200LL, 55092LL, 390216LL,
+  3005288LL, 24571284LL, 212258800LL
+};
+
+typedef enum {
+  GENERATE_ALL_HASH,
+  GENERATE_ALL_NO_HASH,
+  BITBOARD_GENERATION,
+  BITBOARD_FLIPS,
+  KERNEL_COUNT
+} Kernel;
+
+static const char *kernel_name[KERNEL_COUNT] = {
+  "generate_all + make_move (DoFlips_hash)",
+  "generate_all + make_move_no_hash (DoFlips_no_hash)",
+  "bitboard_move_generation + make_move_no_hash",
+  "bitboard_moves + TestFlips_bitboard"
+};
+
+static long long check_failures;
+
+
+
+/*
+   SETUP_INITIAL_POSITION
+   Clears the board and the flip stack and puts the four center
+   discs on the board.
+*/
+
+static void
+setup_initial_position( void ) {
+  int i, j, pos;
+
+  for ( i = 0; i < 10; i++ )
+    for ( j = 0; j < 10; j++ ) {
+      pos = 10 * i + j;
+      if ( (i == 0) || (i == 9) || (j == 0) || (j == 9) )
+	board[pos] = OUTSIDE;
+      else
+	board[pos] = EMPTY;
+    }
+  board[45] = board[54] = BLACKSQ;
+  board[44] = board[55] = WHITESQ;
+  init_flip_stack();
+
+  disks_played = 0;
+  piece_count[BLACKSQ][0] = 2;
+  piece_count[WHITESQ][0] = 2;
+}
+
+
+
+/*
+   SETUP_RANDOM_POSITION
+   Plays DISKS random moves from the initial position and
+   returns the side to move, or -1 if the game ended first.
+*/
+
+static int
+setup_random_position( int disks ) {
+  int side_to_move;
+
+  setup_initial_position();
+  side_to_move = BLACKSQ;
+  while ( disks_played < disks ) {
+    generate_all( side_to_move );
+    if ( move_count[disks_played] == 0 ) {
+      side_to_move = OPP( side_to_move );
+      generate_all( side_to_move );
+      if ( move_count[disks_played] == 0 )
+	return -1;
+    }
+    (void) make_move( side_to_move,
+		      move_list[disks_played][(my_random() >> 4) %
+					      move_count[disks_played]],
+		      TRUE );
+    side_to_move = OPP( side_to_move );
+  }
+
+  return side_to_move;
+}
+
+
+
+/*
+   GENERATE_MAILBOX
+   Fills the move list for the current position with one of
+   the two mailbox move generators.
+*/
+
+static void
+generate_mailbox( Kernel kernel, int side_to_move ) {
+  if ( kernel == BITBOARD_GENERATION )
+    bitboard_move_generation( side_to_move );
+  else
+    generate_all( side_to_move );
+}
+
+
+
+/*
+   MAILBOX_PERFT
+   Counts the leaves DEPTH moves below the position on the board
+   using board[], the move lists and the flip stack.
+*/
+
+static long long
+mailbox_perft( Kernel kernel, int side_to_move, int depth ) {
+  int i, move;
+  long long count;
+
+  if ( depth == 0 )
+    return 1;
+
+  generate_mailbox( kernel, side_to_move );
+  if ( move_count[disks_played] == 0 ) {
+    generate_mailbox( kernel, OPP( side_to_move ) );
+    if ( move_count[disks_played] == 0 )
+      return 1;
+    return mailbox_perft( kernel, OPP( side_to_move ), depth - 1 );
+  }
+
+  count = 0;
+  for ( i = 0; i < move_count[disks_played]; i++ ) {
+    move = move_list[disks_played][i];
+    if ( kernel == GENERATE_ALL_HASH ) {
+      (void) make_move( side_to_move, move, TRUE );
+      count += mailbox_perft( kernel, OPP( side_to_move ), depth - 1 );
+      unmake_move( side_to_move, move );
+    }
+    else {
+      (void) make_move_no_hash( side_to_move, move );
+      count += mailbox_perft( kernel, OPP( side_to_move ), depth - 1 );
+      unmake_move_no_hash( side_to_move, move );
+    }
+  }
+
+  return count;
+}
+
+
+
+/*
+   BITBOARD_PERFT
+   Counts the leaves DEPTH moves below the position given by the
+   discs of the player to move and the opponent.
+*/
+
+static long long
+bitboard_perft( BitBoard my_bits, BitBoard opp_bits, int depth ) {
+  int pos;
+  long long count;
+  BitBoard moves, new_opp_bits;
+
+  if ( depth == 0 )
+    return 1;
+
+  moves = bitboard_moves( my_bits, opp_bits );
+  if ( (moves.high | moves.low) == 0 ) {
+    moves = bitboard_moves( opp_bits, my_bits );
+    if ( (moves.high | moves.low) == 0 )
+      return 1;
+    return bitboard_perft( opp_bits, my_bits, depth - 1 );
+  }
+
+  count = 0;
+  for ( pos = 11; pos <= 88; pos++ )
+    if ( (moves.high & square_mask[pos].high) |
+	 (moves.low & square_mask[pos].low) ) {
+      (void) TestFlips_bitboard[pos - 11]( my_bits.high, my_bits.low,
+					   opp_bits.high, opp_bits.low );
+      FULL_ANDNOT( new_opp_bits, opp_bits, bb_flips );
+      count += bitboard_perft( new_opp_bits, bb_flips, depth - 1 );
+    }
+
+  return count;
+}
+
+
+
+/*
+   REPORT_FAILURE
+   Describes a disagreement found by CHECKED_PERFT in the position
+   given by MY_BITS and OPP_BITS, which is printed a1-h8 in the
+   format of the scrzebra test suites.
+*/
+
+static void
+report_failure( const char *description, int side_to_move, int move,
+		BitBoard my_bits, BitBoard opp_bits ) {
+  int i, j, pos;
+  int my_color, opp_color;
+
+  check_failures++;
+  if ( check_failures <= 10 ) {
+    /* A failed move has already been made on the board */
+    printf( "Check failed: %s (%s to move, %d disks played",
+	    description, (side_to_move == BLACKSQ) ? "black" : "white",
+	    (move == PASS) ? disks_played : disks_played - 1 );
+    if ( move != PASS )
+      printf( ", move %c%c", 'a' + move % 10 - 1, '0' + move / 10 );
+    printf( ")\n  " );
+    my_color = (side_to_move == BLACKSQ) ? 'X' : 'O';
+    opp_color = (side_to_move == BLACKSQ) ? 'O' : 'X';
+    for ( i = 1; i <= 8; i++ )
+      for ( j = 1; j <= 8; j++ ) {
+	pos = 10 * i + j;
+	if ( (my_bits.high & square_mask[pos].high) |
+	     (my_bits.low & square_mask[pos].low) )
+	  putchar( my_color );
+	else if ( (opp_bits.high & square_mask[pos].high) |
+		  (opp_bits.low & square_mask[pos].low) )
+	  putchar( opp_color );
+	else
+	  putchar( '-' );
+      }
+    printf( " %c\n", my_color );
+  }
+}
+
+
+
+/*
+   CHECKED_PERFT
+   Counts the leaves like MAILBOX_PERFT and checks every node:
+   both mailbox generators must give the same move list, which
+   must match the bitboard mobility, and every move must flip
+   the same discs with DoFlips_hash, DoFlips_no_hash and
+   TestFlips_bitboard, leaving the same incremental hash codes
+   as a calculation from scratch.
+*/
+
+static long long
+checked_perft( int side_to_move, int depth ) {
+  int i, move;
+  int flipped, flipped_no_hash, bitboard_flipped;
+  int list[64], count_all;
+  unsigned int new_hash1, new_hash2;
+  long long count;
+  BitBoard my_bits, opp_bits, moves, bits, new_my_bits, new_opp_bits;
+
+  if ( depth == 0 )
+    return 1;
+
+  set_bitboards( board, side_to_move, &my_bits, &opp_bits );
+  moves = bitboard_moves( my_bits, opp_bits );
+  generate_all( side_to_move );
+  count_all = move_count[disks_played];
+  memcpy( list, move_list[disks_played], (count_all + 1) * sizeof( int ) );
+  bitboard_move_generation( side_to_move );
+  if ( (move_count[disks_played] != count_all) ||
+       memcmp( list, move_list[disks_played],
+	       (count_all + 1) * sizeof( int ) ) )
+    report_failure( "generate_all and bitboard_move_generation differ",
+		    side_to_move, PASS, my_bits, opp_bits );
+  CLEAR( bits );
+  for ( i = 0; i < count_all; i++ ) {
+    APPLY_OR( bits, square_mask[list[i]] );
+  }
+  if ( (bits.high != moves.high) || (bits.low != moves.low) )
+    report_failure( "generate_all and bitboard_moves differ",
+		    side_to_move, PASS, my_bits, opp_bits );
+
+  if ( count_all == 0 ) {
+    generate_all( OPP( side_to_move ) );
+    if ( move_count[disks_played] == 0 )
+      return 1;
+    hash1 ^= hash_flip_color1;
+    hash2 ^= hash_flip_color2;
+    count = checked_perft( OPP( side_to_move ), depth - 1 );
+    hash1 ^= hash_flip_color1;
+    hash2 ^= hash_flip_color2;
+    return count;
+  }
+
+  count = 0;
+  for ( i = 0; i < count_all; i++ ) {
+    move = list[i];
+
+    bitboard_flipped =
+      TestFlips_bitboard[move - 11]( my_bits.high, my_bits.low,
+				     opp_bits.high, opp_bits.low );
+    new_my_bits = bb_flips;
+
+    flipped_no_hash = make_move_no_hash( side_to_move, move );
+    set_bitboards( board, side_to_move, &bits, &new_opp_bits );
+    unmake_move_no_hash( side_to_move, move );
+
+    flipped = make_move( side_to_move, move, TRUE );
+    if ( (flipped != flipped_no_hash) || (flipped != bitboard_flipped) )
+      report_failure( "the flip counts differ", side_to_move, move,
+		      my_bits, opp_bits );
+    if ( (bits.high != new_my_bits.high) || (bits.low != new_my_bits.low) )
+      report_failure( "DoFlips_no_hash and TestFlips_bitboard differ",
+		      side_to_move, move, my_bits, opp_bits );
+    set_bitboards( board, side_to_move, &bits, &new_opp_bits );
+    if ( (bits.high != new_my_bits.high) || (bits.low != new_my_bits.low) )
+      report_failure( "DoFlips_hash and TestFlips_bitboard differ",
+		      side_to_move, move, my_bits, opp_bits );
+
+    new_hash1 = hash1;
+    new_hash2 = hash2;
+    determine_hash_values( OPP( side_to_move ), board );
+    if ( (hash1 != new_hash1) || (hash2 != new_hash2) )
+      report_failure( "the incremental hash codes are wrong",
+		      side_to_move, move, my_bits, opp_bits );
+    hash1 = new_hash1;
+    hash2 = new_hash2;
+
+    count += checked_perft( OPP( side_to_move ), depth - 1 );
+    unmake_move( side_to_move, move );
+  }
+
+  return count;
+}
+
+
+
+/*
+   RUN_KERNEL
+   Counts the leaves from the position on the board with KERNEL
+   and adds the time it took to *ELAPSED.
+*/
+
+static long long
+run_kernel( Kernel kernel, int side_to_move, int depth, double *elapsed ) {
+  long long count;
+  BitBoard my_bits, opp_bits;
+
+  reset_real_timer();
+  if ( kernel == BITBOARD_FLIPS ) {
+    set_bitboards( board, side_to_move, &my_bits, &opp_bits );
+    count = bitboard_perft( my_bits, opp_bits, depth );
+  }
+  else
+    count = mailbox_perft( kernel, side_to_move, depth );
+  *elapsed += get_real_timer();
+
+  return count;
+}
+
+
+
+static void
+usage( void ) {
+  fputs( "Usage: perft <depth> [options]\n", stderr );
+  fputs( "  -random <count> <seed> Count from random positions instead "
+	 "of the initial one\n", stderr );
+  fputs( "  -disks <n>             Random moves played before counting "
+	 "(default 20)\n", stderr );
+  fputs( "  -check                 Verify every node move by move\n",
+	 stderr );
+  exit( EXIT_FAILURE );
+}
+
+
+int
+main( int argc, char *argv[] ) {
+  int i, k;
+  int depth, side_to_move;
+  int random_count, seed, random_disks, check;
+  int position_count, valid_count, failed;
+  long long count[KERNEL_COUNT];
+  long long checked_count;
+  double elapsed[KERNEL_COUNT];
+
+  if ( argc < 2 )
+    usage();
+  depth = atoi( argv[1] );
+  if ( (depth < 1) || (depth > MAX_PERFT_DEPTH) ) {
+    fprintf( stderr, "The depth must be between 1 and %d.\n",
+	     MAX_PERFT_DEPTH );
+    exit( EXIT_FAILURE );
+  }
+
+  random_count = 0;
+  seed = 1;
+  random_disks = DEFAULT_RANDOM_DISKS;
+  check = FALSE;
+  for ( i = 2; i < argc; i++ ) {
+    if ( !strcmp( argv[i], "-random" ) && (i + 2 < argc) ) {
+      random_count = atoi( argv[++i] );
+      seed = atoi( argv[++i] );
+    }
+    else if ( !strcmp( argv[i], "-disks" ) && (i + 1 < argc) )
+      random_disks = atoi( argv[++i] );
+    else if ( !strcmp( argv[i], "-check" ) )
+      check = TRUE;
+    else
+      usage();
+  }
+  if ( (random_disks < 0) || (random_disks > 60) ) {
+    fputs( "The number of random disks must be between 0 and 60.\n",
+	   stderr );
+    exit( EXIT_FAILURE );
+  }
+
+  init_hash( PERFT_HASH_BITS );
+  init_bitboard();
+  init_moves();
+  init_timer();
+  setup_search();
+  my_srandom( seed );
+
+  for ( k = 0; k < KERNEL_COUNT; k++ ) {
+    count[k] = 0;
+    elapsed[k] = 0.0;
+  }
+  checked_count = 0;
+  check_failures = 0;
+
+  /* Every kernel counts the same positions; a random position is
+     set up again for each of them since the mailbox kernels leave
+     their move lists behind */
+
+  position_count = 0;
+  valid_count = 0;
+  do {
+    for ( k = 0; k < KERNEL_COUNT; k++ ) {
+      if ( random_count > 0 ) {
+	my_srandom( seed + position_count );
+	side_to_move = setup_random_position( random_disks );
+      }
+      else {
+	setup_initial_position();
+	side_to_move = BLACKSQ;
+      }
+      if ( side_to_move == -1 )
+	break;
+      if ( (k == 0) && check ) {
+	determine_hash_values( side_to_move, board );
+	checked_count += checked_perft( side_to_move, depth );
+      }
+      count[k] += run_kernel( k, side_to_move, depth, &elapsed[k] );
+    }
+    if ( side_to_move != -1 )
+      valid_count++;
+    position_count++;
+  } while ( position_count < random_count );
+
+  if ( random_count > 0 )
+    printf( "perft %d from %d random positions with %d disks\n",
+	    depth, valid_count, random_disks );
+  else
+    printf( "perft %d from the initial position\n", depth );
+
+  failed = FALSE;
+  for ( k = 0; k < KERNEL_COUNT; k++ ) {
+    printf( "%-52s %12lld leaves  %7.2f s", kernel_name[k], count[k],
+	    elapsed[k] );
+    if ( elapsed[k] > 0.0 )
+      printf( "  %12.0f leaves/s", count[k] / elapsed[k] );
+    puts( "" );
+    if ( count[k] != count[0] )
+      failed = TRUE;
+  }
+  if ( failed )
+    puts( "The kernels disagree." );
+
+  if ( (random_count == 0) && (depth <= KNOWN_DEPTHS) &&
+       (count[0] != known_count[depth]) ) {
+    printf( "The count should be %lld.\n", known_count[depth] );
+    failed = TRUE;
+  }
+
+  if ( check ) {
+    printf( "%lld leaves checked, %lld failures\n", checked_count,
+	    check_failures );
+    if ( (checked_count != count[0]) || (check_failures > 0) )
+      failed = TRUE;
+  }
+
+  free_hash();
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
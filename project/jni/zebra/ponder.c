@@ -0,0 +1,404 @@
+/*
+   File:          ponder.c
+
+   Created:       October 19, 2026
+
+   Modified:
+
+   Contents:      Background pondering. START_PONDER runs PONDER_MOVE
+                  on a worker thread, which searches the replies to
+                  the opponent's likely moves on the opponent's time.
+                  When the opponent's move arrives and it is the one
+                  being searched, that search goes on with its hash
+                  table and iteration state intact, now under the
+                  normal time control; replies already searched to
+                  completion are returned at once.
+
+                  The worker owns the board and all search state
+                  while it runs, so the front-end must leave them
+                  alone until FINISH_PONDER has returned.
+*/
+
+
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "constant.h"
+#include "display.h"
+#include "error.h"
+#include "game.h"
+#include "globals.h"
+#include "macros.h"
+#include "midgame.h"
+#include "moves.h"
+#include "ponder.h"
+#include "search.h"
+#include "timer.h"
+
+
+
+/* The number of seconds between calls to the wait handler */
+#define PONDER_POLL_INTERVAL      0.1
+
+
+
+typedef struct {
+  int side_to_move;
+  int book;
+  int mid, exact, wld;
+  int timed_depth;
+  int reply_disks;  /* DISKS_PLAYED at the root of the reply search */
+} PonderJob;
+
+
+
+/* Local variables */
+
+static pthread_t ponder_thread;
+static PonderJob ponder_job;
+static int pondering = FALSE;
+static int stored_echo;
+static PonderWaitHandler wait_handler = NULL;
+
+/* The opponent's move and clock, posted by FINISH_PONDER, the
+   worker's state and any stop requested by the front-end. These are
+   protected by PONDER_MUTEX. */
+static pthread_mutex_t ponder_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ponder_cond = PTHREAD_COND_INITIALIZER;
+static int hit_posted;
+static int hit_move;
+static double hit_time_left;
+static double hit_increment;
+static int worker_done;
+static int stop_requested;
+
+/* Only accessed by the worker until it has been joined */
+static int hit_handled;
+static int live_move;
+static int ponder_abort;
+static int ponder_failed;
+static char ponder_error[1024];
+
+/* The replies found so far, indexed by the opponent's move */
+static int result_valid[100];
+static EvaluatedMove result[100];
+
+
+
+/*
+   LEAVE_WORKER
+   Tells FINISH_PONDER that the worker is about to terminate.
+*/
+
+static void
+leave_worker( void ) {
+  pthread_mutex_lock( &ponder_mutex );
+  worker_done = TRUE;
+  pthread_cond_signal( &ponder_cond );
+  pthread_mutex_unlock( &ponder_mutex );
+}
+
+
+/*
+   PONDER_MAIN
+   The worker thread.
+*/
+
+static void *
+ponder_main( void *arg ) {
+  PonderJob *job = (PonderJob *) arg;
+
+  ponder_move( job->side_to_move, job->book, job->mid, job->exact,
+	       job->wld, job->timed_depth );
+  leave_worker();
+
+  return NULL;
+}
+
+
+/*
+   WAIT_FOR_WORKER
+   Waits until the worker has terminated, calling the wait handler
+   every PONDER_POLL_INTERVAL seconds meanwhile.
+*/
+
+static void
+wait_for_worker( void ) {
+  struct timespec deadline;
+  int done;
+
+  pthread_mutex_lock( &ponder_mutex );
+  done = worker_done;
+  pthread_mutex_unlock( &ponder_mutex );
+
+  while ( !done ) {
+    if ( wait_handler != NULL )
+      wait_handler();
+
+    clock_gettime( CLOCK_REALTIME, &deadline );
+    deadline.tv_nsec += (long) (PONDER_POLL_INTERVAL * 1.0e9);
+    if ( deadline.tv_nsec >= 1000000000L ) {
+      deadline.tv_sec++;
+      deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock( &ponder_mutex );
+    if ( !worker_done )
+      (void) pthread_cond_timedwait( &ponder_cond, &ponder_mutex,
+				     &deadline );
+    done = worker_done;
+    pthread_mutex_unlock( &ponder_mutex );
+  }
+
+  pthread_join( ponder_thread, NULL );
+  if ( wait_handler != NULL )
+    wait_handler();
+}
+
+
+/*
+   SET_PONDER_WAIT_HANDLER
+   Specifies a function which FINISH_PONDER calls periodically on
+   the front-end's thread while it waits for the worker, e.g. to pass
+   on the messages the worker's search has produced.
+*/
+
+void
+set_ponder_wait_handler( PonderWaitHandler handler ) {
+  wait_handler = handler;
+}
+
+
+/*
+   START_PONDER
+   Starts pondering on the position with SIDE_TO_MOVE - the opponent -
+   to move. The parameters are those the reply will later be computed
+   with. Returns TRUE if the worker thread was started.
+*/
+
+int
+start_ponder( int side_to_move, int book, int mid, int exact, int wld,
+	      int timed_depth ) {
+  int i;
+
+  if ( pondering )
+    return FALSE;
+
+  for ( i = 0; i < 100; i++ )
+    result_valid[i] = FALSE;
+  hit_posted = FALSE;
+  hit_move = PASS;
+  worker_done = FALSE;
+  hit_handled = FALSE;
+  live_move = PASS;
+  ponder_abort = FALSE;
+  ponder_failed = FALSE;
+  pthread_mutex_lock( &ponder_mutex );
+  stop_requested = force_return;
+  pthread_mutex_unlock( &ponder_mutex );
+
+  ponder_job.side_to_move = side_to_move;
+  ponder_job.book = book;
+  ponder_job.mid = mid;
+  ponder_job.exact = exact;
+  ponder_job.wld = wld;
+  ponder_job.timed_depth = timed_depth;
+  ponder_job.reply_disks = disks_played + 1;
+
+  stored_echo = echo;
+  echo = FALSE;
+  pondering = TRUE;
+  if ( pthread_create( &ponder_thread, NULL, ponder_main,
+		       &ponder_job ) != 0 ) {
+    pondering = FALSE;
+    echo = stored_echo;
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+
+/*
+   FINISH_PONDER
+   Tells the worker that the opponent played MOVE, with TIME_LEFT and
+   INCREMENT on the clock of the side to reply, and waits for it.
+   On a ponder hit the reply and its evaluation are returned, with the
+   principal variation in PV[0]; otherwise PASS is returned and the
+   reply must be computed as usual. MOVE=PASS cancels pondering.
+   A stop requested through REQUEST_STOP while pondering is left
+   pending for the caller; if it interrupted the search of the reply
+   to MOVE, the best reply found so far is returned.
+*/
+
+int
+finish_ponder( int move, double time_left, double increment,
+	       EvaluationType *eval_info ) {
+  int i;
+
+  if ( !pondering )
+    return PASS;
+
+  pthread_mutex_lock( &ponder_mutex );
+  hit_move = move;
+  hit_time_left = time_left;
+  hit_increment = increment;
+  hit_posted = TRUE;
+  pthread_mutex_unlock( &ponder_mutex );
+
+  wait_for_worker();
+  pondering = FALSE;
+  echo = stored_echo;
+
+  /* Only undo the abort the worker caused itself */
+
+  if ( ponder_abort ) {
+    pthread_mutex_lock( &ponder_mutex );
+    force_return = stop_requested;
+    pthread_mutex_unlock( &ponder_mutex );
+  }
+
+  if ( ponder_failed )
+    fatal_error( "%s", ponder_error );
+
+  if ( (move < 0) || (move > 99) )
+    return PASS;
+
+  if ( !result_valid[move] ) {
+    /* The time spent on MOVE is credited to the coming search */
+    adjust_current_ponder_time( move );
+    return PASS;
+  }
+
+  *eval_info = result[move].eval;
+  pv_depth[0] = result[move].pv_depth;
+  for ( i = 0; i < result[move].pv_depth; i++ )
+    pv[0][i] = result[move].pv[i];
+
+  return result[move].move;
+}
+
+
+/*
+   FAIL_PONDER
+   Called on the worker thread by a front-end which can't report
+   errors from there. The worker terminates and FINISH_PONDER raises
+   the error on the front-end's thread.
+*/
+
+void
+fail_ponder( const char *message ) {
+  strncpy( ponder_error, message, sizeof( ponder_error ) - 1 );
+  ponder_error[sizeof( ponder_error ) - 1] = 0;
+  ponder_failed = TRUE;
+  leave_worker();
+  pthread_exit( NULL );
+}
+
+
+/*
+   REQUEST_STOP
+   Stops the current search; front-ends may call this on any
+   thread. While pondering the request is also remembered, so that
+   FINISH_PONDER leaves it pending even when the worker has aborted
+   its own search in the meantime.
+*/
+
+void
+request_stop( void ) {
+  pthread_mutex_lock( &ponder_mutex );
+  stop_requested = TRUE;
+  force_return = TRUE;
+  pthread_mutex_unlock( &ponder_mutex );
+}
+
+
+/*
+   PONDER_HIT_POSTED
+   Returns TRUE once the opponent's move has been posted; the worker
+   then stops after the current reply.
+*/
+
+int
+ponder_hit_posted( void ) {
+  int posted;
+
+  pthread_mutex_lock( &ponder_mutex );
+  posted = hit_posted;
+  pthread_mutex_unlock( &ponder_mutex );
+
+  return posted;
+}
+
+
+/*
+   CHECK_PONDER_HIT
+   Called periodically by the searches on the worker thread.
+   If the opponent played the move being pondered, the search is put
+   on the clock and allowed to continue; any other move aborts it.
+*/
+
+void
+check_ponder_hit( void ) {
+  int move;
+  double time_left, increment;
+
+  if ( !pondering || hit_handled )
+    return;
+
+  pthread_mutex_lock( &ponder_mutex );
+  if ( !hit_posted ) {
+    pthread_mutex_unlock( &ponder_mutex );
+    return;
+  }
+  move = hit_move;
+  time_left = hit_time_left;
+  increment = hit_increment;
+  pthread_mutex_unlock( &ponder_mutex );
+
+  hit_handled = TRUE;
+  if ( (move == PASS) || (move != get_ponder_move()) ) {
+    ponder_abort = TRUE;
+    force_return = TRUE;
+    return;
+  }
+
+  /* From now on this is the real search for the reply */
+
+  live_move = move;
+  echo = stored_echo;
+  if ( ponder_job.timed_depth ) {
+    start_move( time_left, increment, ponder_job.reply_disks + 4 );
+    determine_move_time( time_left, increment, ponder_job.reply_disks + 4 );
+    toggle_abort_check( TRUE );
+    toggle_midgame_abort_check( TRUE );
+  }
+}
+
+
+/*
+   STORE_PONDER_RESULT
+   Remembers REPLY, found by SIDE_TO_MOVE after the opponent's MOVE.
+   The principal variation is taken from PV[0]. Aborted searches are
+   ignored unless they are the real search for the reply, which was
+   then stopped by the front-end.
+*/
+
+void
+store_ponder_result( int move, int side_to_move, int reply,
+		     EvaluationType eval_info ) {
+  int i;
+
+  if ( force_return && (move != live_move) )
+    return;
+
+  result[move].eval = eval_info;
+  result[move].side_to_move = side_to_move;
+  result[move].move = reply;
+  result[move].pv_depth = MIN( pv_depth[0], 60 );
+  for ( i = 0; i < result[move].pv_depth; i++ )
+    result[move].pv[i] = pv[0][i];
+  result_valid[move] = TRUE;
+}
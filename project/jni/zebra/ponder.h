@@ -0,0 +1,72 @@
+/*
+   File:          ponder.h
+
+   Created:       October 19, 2026
+
+   Modified:
+
+   Contents:      The interface to background pondering. While the
+                  opponent is thinking, PONDER_MOVE runs on a worker
+                  thread; the front-end hands it the opponent's move
+                  with FINISH_PONDER and gets the reply back at once
+                  if it has already been found.
+*/
+
+
+
+#ifndef PONDER_H
+#define PONDER_H
+
+
+
+#include "search.h"
+
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/* Called on the front-end's thread while it waits for the worker */
+typedef void (*PonderWaitHandler)( void );
+
+
+
+void
+set_ponder_wait_handler( PonderWaitHandler handler );
+
+int
+start_ponder( int side_to_move, int book, int mid, int exact, int wld,
+	      int timed_depth );
+
+int
+finish_ponder( int move, double time_left, double increment,
+	       EvaluationType *eval_info );
+
+void
+fail_ponder( const char *message );
+
+void
+request_stop( void );
+
+int
+ponder_hit_posted( void );
+
+void
+check_ponder_hit( void );
+
+void
+store_ponder_result( int move, int side_to_move, int reply,
+		     EvaluationType eval_info );
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+
+#endif  /* PONDER_H */
@@ -15,11 +15,28 @@
 #include "porting.h"
 
 #include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "constant.h"
 #include "epcstat.h"
+#include "error.h"
 #include "pcstat.h"
 #include "probcut.h"
+#include "texts.h"
+
+
+
+/* The largest number of cut pairs in a profile */
+#define MAX_CUT_PAIRS              64
+
+
+
+typedef struct {
+  int depth;    /* Midgame: search depth, endgame: #empty */
+  int shallow;
+} CutPair;
 
 
 
@@ -28,6 +45,31 @@
 int use_end_cut[61];
 int end_mpc_depth[61][4];
 DepthInfo mpc_cut[MAX_CUT_DEPTH + 1];
+double end_mpc_scale = 1.0;
+
+
+
+/* Local variables */
+
+static const CutPair default_mid_pairs[] = {
+  { 3, 1 }, { 4, 2 }, { 5, 1 }, { 6, 2 }, { 7, 3 }, { 8, 4 }, { 9, 3 },
+  { 10, 4 }, { 10, 6 }, { 11, 3 }, { 11, 5 }, { 12, 4 }, { 12, 6 },
+  { 13, 5 }, { 13, 7 }, { 14, 6 }, { 14, 8 }, { 15, 5 }, { 15, 7 },
+  { 16, 6 }, { 16, 8 }, { 17, 5 }, { 17, 7 }, { 18, 6 }, { 18, 8 },
+  { 20, 8 }
+};
+
+static const CutPair default_end_pairs[] = {
+  { 13, 1 }, { 14, 1 }, { 15, 2 }, { 16, 2 }, { 17, 2 }, { 18, 2 },
+  { 19, 3 }, { 20, 3 }, { 21, 4 }, { 22, 4 }, { 23, 4 }, { 24, 4 },
+  { 25, 4 }, { 26, 4 }, { 27, 4 }
+};
+
+/* The cut pairs and window scale of the active profile */
+static CutPair mid_pairs[MAX_CUT_PAIRS];
+static CutPair end_pairs[MAX_CUT_PAIRS];
+static int mid_pair_count, end_pair_count;
+static double mid_mpc_scale = 1.0;
 
 
 
@@ -49,8 +91,9 @@ set_probcut( int depth, int shallow ) {
       floor( 128.0 * (mid_corr[i][shallow].const_base +
 		      mid_corr[i][shallow].const_slope * shallow) );
     mpc_cut[depth].window[this_try][i] =
-      floor( 128.0 * (mid_corr[i][shallow].sigma_base +
-		      mid_corr[i][shallow].sigma_slope * shallow) );
+      floor( 128.0 * mid_mpc_scale * (mid_corr[i][shallow].sigma_base +
+				      mid_corr[i][shallow].sigma_slope *
+				      shallow) );
   }
   mpc_cut[depth].cut_tries++;
 }
@@ -67,20 +110,20 @@ set_end_probcut( int empty, int shallow_depth ) {
   int stage;
 
   stage = 60 - empty;
-  if ( shallow_depth <= MAX_CORR_DEPTH )
+  if ( shallow_depth <= MAX_END_CORR_DEPTH )
     if ( end_stats_available[stage][shallow_depth] )
       end_mpc_depth[stage][use_end_cut[stage]++] = shallow_depth;
 }
 
 
 /*
-   INIT_PROBCUT
-   Clears the tables with MPC information and chooses some
-   reasonable cut pairs.
+   BUILD_CUT_TABLES
+   Clears the tables with MPC information and fills them
+   using the cut pairs of the active profile.
 */
 
-void
-init_probcut( void ) {
+static void
+build_cut_tables( void ) {
   int i;
 
   for ( i = 0; i <= MAX_CUT_DEPTH; i++ )
@@ -89,45 +132,248 @@ init_probcut( void ) {
   for ( i = 0; i <= 60; i++ )
     use_end_cut[i] = 0;
 
-  set_probcut( 3, 1 );
-  set_probcut( 4, 2 );
-  set_probcut( 5, 1 );
-  set_probcut( 6, 2 );
-  set_probcut( 7, 3 );
-  set_probcut( 8, 4 );
-  set_probcut( 9, 3 );
-  set_probcut( 10, 4 );
-  set_probcut( 10, 6 );
-  set_probcut( 11, 3 );
-  set_probcut( 11, 5 );
-  set_probcut( 12, 4 );
-  set_probcut( 12, 6 );
-  set_probcut( 13, 5 );
-  set_probcut( 13, 7 );
-  set_probcut( 14, 6 );
-  set_probcut( 14, 8 );
-  set_probcut( 15, 5 );
-  set_probcut( 15, 7 );
-  set_probcut( 16, 6 );
-  set_probcut( 16, 8 );
-  set_probcut( 17, 5 );
-  set_probcut( 17, 7 );
-  set_probcut( 18, 6 );
-  set_probcut( 18, 8 );
-  set_probcut( 20, 8 );
-  set_end_probcut( 13, 1 );
-  set_end_probcut( 14, 1 );
-  set_end_probcut( 15, 2 );
-  set_end_probcut( 16, 2 );
-  set_end_probcut( 17, 2 );
-  set_end_probcut( 18, 2 );
-  set_end_probcut( 19, 3 );
-  set_end_probcut( 20, 3 );
-  set_end_probcut( 21, 4 );
-  set_end_probcut( 22, 4 );
-  set_end_probcut( 23, 4 );
-  set_end_probcut( 24, 4 );
-  set_end_probcut( 25, 4 );
-  set_end_probcut( 26, 4 );
-  set_end_probcut( 27, 4 );
+  for ( i = 0; i < mid_pair_count; i++ )
+    set_probcut( mid_pairs[i].depth, mid_pairs[i].shallow );
+  for ( i = 0; i < end_pair_count; i++ )
+    set_end_probcut( end_pairs[i].depth, end_pairs[i].shallow );
+}
+
+
+/*
+   INIT_PROBCUT
+   Selects the compiled-in profile, which uses the compiled-in
+   statistics and some reasonable cut pairs.
+*/
+
+void
+init_probcut( void ) {
+  mid_pair_count = sizeof( default_mid_pairs ) / sizeof( CutPair );
+  memcpy( mid_pairs, default_mid_pairs, sizeof( default_mid_pairs ) );
+  end_pair_count = sizeof( default_end_pairs ) / sizeof( CutPair );
+  memcpy( end_pairs, default_end_pairs, sizeof( default_end_pairs ) );
+  mid_mpc_scale = 1.0;
+  end_mpc_scale = 1.0;
+
+  build_cut_tables();
+}
+
+
+/*
+   LOAD_PROBCUT_STATISTICS
+   Reads Multi-ProbCut statistics created by mpcstat and lets them
+   replace the corresponding compiled-in values. Each line is either
+
+     mid <disks> <shallow depth> <mean> <sigma>
+     end <disks> <shallow depth> <mean> <sigma>
+
+   where <mean> and <sigma> are the mean and standard deviation,
+   in discs, of the shallow score minus the deep (midgame) or
+   exact (endgame) score. Anything after <sigma>, as well as lines
+   starting with '#', is ignored. Cells not mentioned in the file
+   keep their old values.
+   Returns the number of cells read, or -1 if the file can't be opened.
+*/
+
+int
+load_probcut_statistics( const char *file_name ) {
+  char buffer[256];
+  char kind[8];
+  int line, cell_count;
+  int disks, depth;
+  double mean, sigma;
+  FILE *stream;
+
+  stream = fopen( file_name, "r" );
+  if ( stream == NULL )
+    return -1;
+
+  line = 0;
+  cell_count = 0;
+  while ( fgets( buffer, sizeof buffer, stream ) != NULL ) {
+    line++;
+    if ( (buffer[0] == '#') || (strspn( buffer, " \t\r\n" ) ==
+				strlen( buffer )) )
+      continue;
+    if ( (sscanf( buffer, "%7s %d %d %lf %lf",
+		  kind, &disks, &depth, &mean, &sigma ) != 5) ||
+	 (disks < 0) || (disks > 60) || (depth < 1) || (sigma < 0.0) )
+      fatal_error( "%s '%s', line %d\n", PROBCUT_FILE_ERROR,
+		   file_name, line );
+    if ( !strcmp( kind, "mid" ) && (depth <= MAX_SHALLOW_DEPTH) ) {
+      mid_corr[disks][depth].const_base = mean;
+      mid_corr[disks][depth].const_slope = 0.0;
+      mid_corr[disks][depth].sigma_base = sigma;
+      mid_corr[disks][depth].sigma_slope = 0.0;
+    }
+    else if ( !strcmp( kind, "end" ) && (depth <= MAX_END_CORR_DEPTH) ) {
+      end_mean[disks][depth] = mean;
+      end_sigma[disks][depth] = sigma;
+      end_stats_available[disks][depth] = TRUE;
+    }
+    else
+      fatal_error( "%s '%s', line %d\n", PROBCUT_FILE_ERROR,
+		   file_name, line );
+    cell_count++;
+  }
+  fclose( stream );
+
+  /* The cut tables are derived from the statistics */
+
+  build_cut_tables();
+
+  return cell_count;
+}
+
+
+/*
+   ADD_CUT_PAIR
+   Adds a pair to a profile after checking that it fits in the
+   cut tables. COUNT is the number of pairs already in the list.
+   Returns FALSE if the pair is invalid.
+*/
+
+static int
+add_cut_pair( CutPair *pairs, int count, int is_endgame,
+	      int depth, int shallow ) {
+  int i;
+  int same_depth;
+
+  if ( (count == MAX_CUT_PAIRS) || (shallow < 1) || (shallow >= depth) )
+    return FALSE;
+  if ( is_endgame ) {
+    if ( (depth > 60) || (shallow > MAX_END_CORR_DEPTH) )
+      return FALSE;
+  }
+  else if ( (depth > MAX_CUT_DEPTH) || (shallow > MAX_SHALLOW_DEPTH) )
+    return FALSE;
+
+  same_depth = 0;
+  for ( i = 0; i < count; i++ )
+    if ( pairs[i].depth == depth )
+      same_depth++;
+  if ( same_depth == (is_endgame ? 4 : 2) )
+    return FALSE;
+
+  pairs[count].depth = depth;
+  pairs[count].shallow = shallow;
+
+  return TRUE;
+}
+
+
+/*
+   LOAD_PROBCUT_PROFILE
+   Activates the profile PROFILE_NAME from a Multi-ProbCut
+   parameter file. The first line which isn't a comment must be
+   "version <n>"; the profiles follow, each starting with
+   "profile <name>" and containing any of
+
+     statistics <file>        Statistics created by mpcstat
+     midgame-window <scale>   Multiplies the midgame cut windows
+     endgame-window <scale>   Multiplies the endgame cut windows
+     mid <depth> <shallow>    Midgame cut pair
+     end <#empty> <shallow>   Endgame cut pair
+
+   A profile without "mid" (or "end") lines keeps the compiled-in
+   midgame (or endgame) cut pairs. Lines starting with '#' are ignored.
+   Returns 1 if the profile was activated, 0 if the file has no
+   such profile and -1 if the file can't be opened.
+*/
+
+int
+load_probcut_profile( const char *file_name, const char *profile_name ) {
+  char buffer[256];
+  char keyword[32], argument[200];
+  int line, version;
+  int in_profile, found;
+  int depth, shallow;
+  int new_mid_count, new_end_count;
+  double scale;
+  double new_mid_scale, new_end_scale;
+  CutPair new_mid_pairs[MAX_CUT_PAIRS];
+  CutPair new_end_pairs[MAX_CUT_PAIRS];
+  FILE *stream;
+
+  stream = fopen( file_name, "r" );
+  if ( stream == NULL )
+    return -1;
+
+  line = 0;
+  version = 0;
+  in_profile = FALSE;
+  found = FALSE;
+  new_mid_count = new_end_count = 0;
+  new_mid_scale = new_end_scale = 1.0;
+  while ( fgets( buffer, sizeof buffer, stream ) != NULL ) {
+    line++;
+    if ( (buffer[0] == '#') ||
+	 (sscanf( buffer, "%31s", keyword ) != 1) )
+      continue;
+    if ( version == 0 ) {
+      if ( strcmp( keyword, "version" ) ||
+	   (sscanf( buffer, "%*s %d", &version ) != 1) || (version < 1) )
+	fatal_error( "%s '%s'\n", PROBCUT_VERSION_ERROR, file_name );
+      if ( version > PROBCUT_FILE_VERSION )
+	fatal_error( "%s '%s' (%d > %d)\n", PROBCUT_VERSION_ERROR,
+		     file_name, version, PROBCUT_FILE_VERSION );
+      continue;
+    }
+    if ( !strcmp( keyword, "profile" ) ) {
+      if ( sscanf( buffer, "%*s %199s", argument ) != 1 )
+	fatal_error( "%s '%s', line %d\n", PROBCUT_PROFILE_ERROR,
+		     file_name, line );
+      if ( found )
+	break;
+      in_profile = !strcmp( argument, profile_name );
+      found = in_profile;
+      continue;
+    }
+    if ( !in_profile )
+      continue;
+
+    if ( !strcmp( keyword, "statistics" ) &&
+	 (sscanf( buffer, "%*s %199s", argument ) == 1) ) {
+      if ( load_probcut_statistics( argument ) < 0 )
+	fatal_error( "%s '%s', line %d\n", PROBCUT_PROFILE_ERROR,
+		     file_name, line );
+    }
+    else if ( !strcmp( keyword, "midgame-window" ) &&
+	      (sscanf( buffer, "%*s %lf", &scale ) == 1) && (scale > 0.0) )
+      new_mid_scale = scale;
+    else if ( !strcmp( keyword, "endgame-window" ) &&
+	      (sscanf( buffer, "%*s %lf", &scale ) == 1) && (scale > 0.0) )
+      new_end_scale = scale;
+    else if ( !strcmp( keyword, "mid" ) &&
+	      (sscanf( buffer, "%*s %d %d", &depth, &shallow ) == 2) &&
+	      add_cut_pair( new_mid_pairs, new_mid_count, FALSE,
+			    depth, shallow ) )
+      new_mid_count++;
+    else if ( !strcmp( keyword, "end" ) &&
+	      (sscanf( buffer, "%*s %d %d", &depth, &shallow ) == 2) &&
+	      add_cut_pair( new_end_pairs, new_end_count, TRUE,
+			    depth, shallow ) )
+      new_end_count++;
+    else
+      fatal_error( "%s '%s', line %d\n", PROBCUT_PROFILE_ERROR,
+		   file_name, line );
+  }
+  fclose( stream );
+
+  if ( !found )
+    return 0;
+
+  init_probcut();
+  if ( new_mid_count > 0 ) {
+    memcpy( mid_pairs, new_mid_pairs, new_mid_count * sizeof( CutPair ) );
+    mid_pair_count = new_mid_count;
+  }
+  if ( new_end_count > 0 ) {
+    memcpy( end_pairs, new_end_pairs, new_end_count * sizeof( CutPair ) );
+    end_pair_count = new_end_count;
+  }
+  mid_mpc_scale = new_mid_scale;
+  end_mpc_scale = new_end_scale;
+  build_cut_tables();
+
+  return 1;
 }
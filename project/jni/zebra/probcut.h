@@ -26,6 +26,9 @@
 
 #define MAX_CUT_DEPTH              22
 
+/* The newest profile file version understood */
+#define PROBCUT_FILE_VERSION       1
+
 
 
 typedef struct {
@@ -40,12 +43,19 @@ typedef struct {
 extern int use_end_cut[61];
 extern int end_mpc_depth[61][4];
 extern DepthInfo mpc_cut[MAX_CUT_DEPTH + 1];
+extern double end_mpc_scale;
 
 
 
 void
 init_probcut( void );
 
+int
+load_probcut_statistics( const char *file_name );
+
+int
+load_probcut_profile( const char *file_name, const char *profile_name );
+
 
 
 #endif  /* PROBCUT_H */
@@ -66,6 +66,13 @@ int position_list[100] = {
 static int pondered_move = 0;
 static int negate_eval;
 static EvaluationType last_eval;
+static SearchInfoHandler search_info_handler = NULL;
+static int multi_pv = 1;
+static int root_line_count = 0;
+static int root_line_score[MAX_MULTI_PV];
+static EvaluatedMove root_line[MAX_MULTI_PV];
+static int multi_pv_count = 0;
+static EvaluatedMove multi_pv_line[MAX_MULTI_PV];
 
 
 
@@ -572,3 +579,164 @@ void
 negate_current_eval( int negate ) {
   negate_eval = negate;
 }
+
+
+/*
+  SET_SEARCH_INFO_HANDLER
+  SEND_SEARCH_INFO
+  Lets a front-end follow the search: the handler, if any, is
+  called with the depth and the score of each iteration finished.
+*/
+
+void
+set_search_info_handler( SearchInfoHandler handler ) {
+  search_info_handler = handler;
+}
+
+void
+send_search_info( int depth, EvaluationType eval_info ) {
+  if ( search_info_handler != NULL )
+    search_info_handler( depth, eval_info );
+}
+
+
+/*
+  SET_MULTI_PV
+  GET_MULTI_PV
+  The number of root moves for which the root searches determine
+  exact scores and principal variations. With a count above one,
+  the midgame and endgame root searches keep the best COUNT moves
+  instead of just the best one. Setting the count discards the
+  lines of the previous search.
+*/
+
+void
+set_multi_pv( int count ) {
+  multi_pv = MAX( 1, MIN( count, MAX_MULTI_PV ) );
+  multi_pv_count = 0;
+}
+
+int
+get_multi_pv( void ) {
+  return multi_pv;
+}
+
+
+/*
+  CLEAR_ROOT_LINES
+  Empties the list of root moves; called when a root search starts.
+*/
+
+void
+clear_root_lines( void ) {
+  root_line_count = 0;
+}
+
+
+/*
+  ROOT_LINE_BOUND
+  Returns the score a root move must beat to enter the list of
+  the best moves: ALPHA until the list is full, after that the
+  score of the worst move kept (unless ALPHA is higher).
+*/
+
+int
+root_line_bound( int alpha ) {
+  if ( root_line_count < multi_pv )
+    return alpha;
+  else
+    return MAX( alpha, root_line_score[multi_pv - 1] );
+}
+
+
+/*
+  ADD_ROOT_LINE
+  Inserts MOVE with the search score SCORE into the list of the
+  best root moves, dropping the worst move if the list is full.
+  The rest of the line is taken from the PV of the ply below the
+  root, which must hold the variation just searched.
+*/
+
+void
+add_root_line( int side_to_move, int move, int score ) {
+  int i, pos;
+  EvaluatedMove *line;
+
+  if ( (root_line_count == multi_pv) &&
+       (score <= root_line_score[multi_pv - 1]) )
+    return;
+
+  if ( root_line_count < multi_pv )
+    pos = root_line_count++;
+  else
+    pos = multi_pv - 1;
+  while ( (pos > 0) && (score > root_line_score[pos - 1]) ) {
+    root_line_score[pos] = root_line_score[pos - 1];
+    root_line[pos] = root_line[pos - 1];
+    pos--;
+  }
+
+  root_line_score[pos] = score;
+  line = &root_line[pos];
+  line->eval = create_eval_info( UNDEFINED_EVAL, UNSOLVED_POSITION,
+				 0, 0.0, 0, FALSE );
+  line->side_to_move = side_to_move;
+  line->move = move;
+  line->pv_depth = MAX( 1, MIN( pv_depth[1], 60 ) );
+  line->pv[0] = move;
+  for ( i = 1; i < line->pv_depth; i++ )
+    line->pv[i] = pv[1][i];
+}
+
+
+/*
+  GET_ROOT_LINE_COUNT
+  GET_ROOT_LINE_SCORE
+  SET_ROOT_LINE_EVAL
+  PUBLISH_ROOT_LINES
+  Once a root search has completed, its driver converts the raw
+  scores of the root moves into evaluations and publishes them;
+  aborted searches thereby never overwrite a complete list.
+*/
+
+int
+get_root_line_count( void ) {
+  return root_line_count;
+}
+
+int
+get_root_line_score( int index ) {
+  return root_line_score[index];
+}
+
+void
+set_root_line_eval( int index, EvaluationType eval ) {
+  root_line[index].eval = eval;
+}
+
+void
+publish_root_lines( void ) {
+  int i;
+
+  for ( i = 0; i < root_line_count; i++ )
+    multi_pv_line[i] = root_line[i];
+  multi_pv_count = root_line_count;
+}
+
+
+/*
+  GET_MULTI_PV_COUNT
+  GET_MULTI_PV_LINE
+  The best root moves found by the last completed root search,
+  best first.
+*/
+
+int
+get_multi_pv_count( void ) {
+  return multi_pv_count;
+}
+
+EvaluatedMove
+get_multi_pv_line( int index ) {
+  return multi_pv_line[index];
+}
@@ -37,6 +37,9 @@ extern "C" {
 
 #define INFINITE_EVAL           12345678
 
+/* The largest number of root moves kept in multi-PV mode */
+#define MAX_MULTI_PV            16
+
 
 
 typedef enum { MIDGAME_EVAL, EXACT_EVAL, WLD_EVAL, SELECTIVE_EVAL,
@@ -55,6 +58,19 @@ typedef struct {
   int is_book;
 } EvaluationType;
 
+/* Receives the result of every completed search iteration; the
+   principal variation is in PV[0]. */
+typedef void (*SearchInfoHandler)( int depth, EvaluationType eval_info );
+
+/* A root move together with its score and principal variation. */
+typedef struct {
+  EvaluationType eval;
+  int side_to_move;
+  int move;
+  int pv_depth;
+  int pv[60];
+} EvaluatedMove;
+
 
 
 /* The time spent searching during the game. */
@@ -157,6 +173,45 @@ get_current_eval( void );
 void
 negate_current_eval( int negate );
 
+void
+set_search_info_handler( SearchInfoHandler handler );
+
+void
+send_search_info( int depth, EvaluationType eval_info );
+
+void
+set_multi_pv( int count );
+
+int
+get_multi_pv( void );
+
+void
+clear_root_lines( void );
+
+int
+root_line_bound( int alpha );
+
+void
+add_root_line( int side_to_move, int move, int score );
+
+int
+get_root_line_count( void );
+
+int
+get_root_line_score( int index );
+
+void
+set_root_line_eval( int index, EvaluationType eval );
+
+void
+publish_root_lines( void );
+
+int
+get_multi_pv_count( void );
+
+EvaluatedMove
+get_multi_pv_line( int index );
+
 
 
 #ifdef __cplusplus
@@ -0,0 +1,160 @@
+/*
+   File:          searchstat.c
+
+   Created:       October 19, 2026
+
+   Modified:
+
+   Contents:      Search statistics: node histograms and counters for
+                  the hash table, Multi-ProbCut, stability and ETC
+                  cutoffs, reported as one JSON record per search.
+*/
+
+
+
+#include <stdio.h>
+#include <string.h>
+#include "constant.h"
+#include "macros.h"
+#include "searchstat.h"
+
+
+
+/* Bumped whenever the JSON layout changes */
+#define REPORT_VERSION            2
+
+
+
+/* Global variables */
+
+SearchStatistics search_stats;
+
+
+
+/*
+   RESET_SEARCH_STATS
+   Clears all counters. Called at the start of every search that
+   is to be reported on its own.
+*/
+
+void
+reset_search_stats( void ) {
+  memset( &search_stats, 0, sizeof( search_stats ) );
+}
+
+
+/*
+   GET_SEARCH_STATS
+   Copies the counters accumulated since the last reset.
+*/
+
+void
+get_search_stats( SearchStatistics *stats ) {
+  *stats = search_stats;
+}
+
+
+/*
+   WRITE_RATIO
+   Writes a JSON member with a ratio; null if undefined.
+*/
+
+static void
+write_ratio( FILE *stream, const char *name, StatCounter num,
+	     StatCounter denom ) {
+  if ( denom == 0 )
+    fprintf( stream, ", \"%s\": null", name );
+  else
+    fprintf( stream, ", \"%s\": %.4f", name,
+	     (double) num / (double) denom );
+}
+
+
+/*
+   WRITE_HISTOGRAM
+   Writes a histogram as a JSON array, omitting the empty tail.
+*/
+
+static void
+write_histogram( FILE *stream, const char *name, const StatCounter *count ) {
+  int i, size;
+
+  size = MAX_STAT_DEPTH;
+  while ( (size > 0) && (count[size - 1] == 0) )
+    size--;
+  fprintf( stream, ", \"%s\": [", name );
+  for ( i = 0; i < size; i++ )
+    fprintf( stream, "%s%llu", (i > 0) ? ", " : "", count[i] );
+  fprintf( stream, "]" );
+}
+
+
+/*
+   WRITE_SEARCH_STATS
+   Writes the counters since the last reset as a JSON record on a
+   line of its own, so that a file holds one record per search.
+   SEARCH_NUMBER counts the searches from 1; DISKS_PLAYED,
+   SIDE_TO_MOVE and MOVE describe the search. Without SEARCH_STATS
+   only the "enabled" member is meaningful.
+*/
+
+void
+write_search_stats( FILE *stream, int search_number, int disks_played,
+		    int side_to_move, int move ) {
+  const SearchStatistics *s = &search_stats;
+  StatCounter mid_total, end_total;
+  int i;
+
+  mid_total = end_total = 0;
+  for ( i = 0; i < MAX_STAT_DEPTH; i++ ) {
+    mid_total += s->mid_nodes[i];
+    end_total += s->end_nodes[i];
+  }
+
+  fprintf( stream, "{\"report\": \"zebra-search-stats\"" );
+  fprintf( stream, ", \"version\": %d", REPORT_VERSION );
+  fprintf( stream, ", \"enabled\": %s",
+	   SEARCH_STATS_ENABLED ? "true" : "false" );
+  fprintf( stream, ", \"search\": %d", search_number );
+  fprintf( stream, ", \"disks_played\": %d", disks_played );
+  fprintf( stream, ", \"side_to_move\": \"%s\"",
+	   (side_to_move == BLACKSQ) ? "black" : "white" );
+  if ( (move >= 11) && (move <= 88) )
+    fprintf( stream, ", \"move\": \"%c%c\"", TO_SQUARE( move ) );
+  else
+    fprintf( stream, ", \"move\": \"pass\"" );
+  fprintf( stream, ", \"mid_nodes\": %llu", mid_total );
+  fprintf( stream, ", \"end_nodes\": %llu", end_total );
+  write_histogram( stream, "mid_nodes_by_depth", s->mid_nodes );
+  write_histogram( stream, "end_nodes_by_empties", s->end_nodes );
+  fprintf( stream, ", \"hash_probes\": %llu", s->hash_probes );
+  fprintf( stream, ", \"hash_hits\": %llu", s->hash_hits );
+  fprintf( stream, ", \"hash_misses\": %llu",
+	   s->hash_probes - s->hash_hits );
+  fprintf( stream, ", \"hash_collisions\": %llu", s->hash_collisions );
+  write_ratio( stream, "hash_hit_rate", s->hash_hits, s->hash_probes );
+  write_ratio( stream, "hash_collision_rate", s->hash_collisions,
+	       s->hash_probes );
+  fprintf( stream, ", \"mid_hash_cutoffs\": %llu", s->mid_hash_cutoffs );
+  fprintf( stream, ", \"end_hash_cutoffs\": %llu", s->end_hash_cutoffs );
+  fprintf( stream, ", \"mid_mpc_tries\": %llu", s->mid_mpc_tries );
+  fprintf( stream, ", \"mid_mpc_cuts\": %llu", s->mid_mpc_cuts );
+  write_ratio( stream, "mid_mpc_cut_rate", s->mid_mpc_cuts,
+	       s->mid_mpc_tries );
+  fprintf( stream, ", \"end_mpc_tries\": %llu", s->end_mpc_tries );
+  fprintf( stream, ", \"end_mpc_cuts\": %llu", s->end_mpc_cuts );
+  write_ratio( stream, "end_mpc_cut_rate", s->end_mpc_cuts,
+	       s->end_mpc_tries );
+  fprintf( stream, ", \"stability_cutoffs\": %llu", s->stability_cutoffs );
+  fprintf( stream, ", \"mid_fail_highs\": %llu", s->mid_fail_highs );
+  write_ratio( stream, "mid_first_move_fail_high_rate",
+	       s->mid_first_fail_highs, s->mid_fail_highs );
+  fprintf( stream, ", \"end_fail_highs\": %llu", s->end_fail_highs );
+  write_ratio( stream, "end_first_move_fail_high_rate",
+	       s->end_first_fail_highs, s->end_fail_highs );
+  fprintf( stream, ", \"etc_probes\": %llu", s->etc_probes );
+  fprintf( stream, ", \"etc_hits\": %llu", s->etc_hits );
+  write_ratio( stream, "etc_hit_rate", s->etc_hits, s->etc_probes );
+  fprintf( stream, "}\n" );
+  fflush( stream );
+}
@@ -0,0 +1,113 @@
+/*
+   File:          searchstat.h
+
+   Created:       October 19, 2026
+
+   Modified:
+
+   Contents:      The interface to the search statistics. The counters
+                  are only maintained when Zebra is compiled with
+                  SEARCH_STATS defined (see the Makefile); otherwise
+                  the STAT_* macros expand to nothing and the search
+                  runs at full speed.
+*/
+
+
+
+#ifndef SEARCHSTAT_H
+#define SEARCHSTAT_H
+
+
+
+#include <stdio.h>
+
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/* The per-depth and per-empties histograms are truncated here */
+#define MAX_STAT_DEPTH            64
+
+#ifdef SEARCH_STATS
+#define SEARCH_STATS_ENABLED      TRUE
+#else
+#define SEARCH_STATS_ENABLED      FALSE
+#endif
+
+
+
+typedef unsigned long long StatCounter;
+
+typedef struct {
+  /* Midgame nodes by remaining depth, endgame nodes by #empty */
+  StatCounter mid_nodes[MAX_STAT_DEPTH];
+  StatCounter end_nodes[MAX_STAT_DEPTH];
+  /* Hash table probes; a collision is a miss where the primary
+     slot holds another position */
+  StatCounter hash_probes;
+  StatCounter hash_hits;
+  StatCounter hash_collisions;
+  StatCounter mid_hash_cutoffs;
+  StatCounter end_hash_cutoffs;
+  /* Multi-ProbCut shallow searches and the cutoffs they gave */
+  StatCounter mid_mpc_tries;
+  StatCounter mid_mpc_cuts;
+  StatCounter end_mpc_tries;
+  StatCounter end_mpc_cuts;
+  StatCounter stability_cutoffs;
+  /* Beta cutoffs in the PVS searches, and those from the first move */
+  StatCounter mid_fail_highs;
+  StatCounter mid_first_fail_highs;
+  StatCounter end_fail_highs;
+  StatCounter end_first_fail_highs;
+  /* Enhanced transposition cutoff probes and hits */
+  StatCounter etc_probes;
+  StatCounter etc_hits;
+} SearchStatistics;
+
+
+
+extern SearchStatistics search_stats;
+
+
+
+#ifdef SEARCH_STATS
+#define STAT_INCREMENT( field )      search_stats.field++
+#define STAT_INCREMENT_IF( cond, field ) \
+  search_stats.field += ((cond) != 0)
+#define STAT_MID_NODE( depth ) \
+  search_stats.mid_nodes[MIN( depth, MAX_STAT_DEPTH - 1 )]++
+#define STAT_END_NODE( empties ) \
+  search_stats.end_nodes[MIN( empties, MAX_STAT_DEPTH - 1 )]++
+#else
+#define STAT_INCREMENT( field )
+#define STAT_INCREMENT_IF( cond, field )
+#define STAT_MID_NODE( depth )
+#define STAT_END_NODE( empties )
+#endif
+
+
+
+void
+reset_search_stats( void );
+
+void
+get_search_stats( SearchStatistics *stats );
+
+void
+write_search_stats( FILE *stream, int search_number, int disks_played,
+		    int side_to_move, int move );
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+
+#endif  /* SEARCHSTAT_H */
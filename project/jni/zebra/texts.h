@@ -95,6 +95,11 @@
 #define  FILE_ERROR            "Unable to open coefficient file"
 #define  CHECKSUM_ERROR        "Wrong checksum in , might be an old version"
 
+/* Error messages in probcut.c */
+#define  PROBCUT_FILE_ERROR    "Bad line in Multi-ProbCut statistics file"
+#define  PROBCUT_VERSION_ERROR "Unsupported version of Multi-ProbCut file"
+#define  PROBCUT_PROFILE_ERROR "Bad line in Multi-ProbCut profile file"
+
 /* Prompts in moves.c */
 #define  BLACK_PROMPT          "Black move"
 #define  WHITE_PROMPT          "White move"
@@ -107,6 +112,12 @@
 #define  NO_DB_FILE_ERROR      "Could not open database file"
 #define  BOOK_CHECKSUM_ERROR   "Wrong checksum, might be an old version"
 #define  DB_WRITE_ERROR        "Could not create database file"
+#define  IMPORT_WORKER_ERROR   "import workers failed"
+#define  LEARN_WORKER_ERROR    "learning workers failed"
+
+/* Error messages in parallel.c */
+#define  SHARED_MEMORY_ERROR   "Shared memory: Failed to allocate"
+#define  WORKER_START_ERROR    "Could not start worker process"
 
 /* Error message in safemem.c */
 #define  SAFEMEM_FAILURE       "Memory allocation failure when allocating"
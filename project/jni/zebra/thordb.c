@@ -19,6 +19,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef __linux__
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 #include "bitboard.h"
 #include "constant.h"
 #include "error.h"
@@ -47,22 +54,45 @@
 #define  OPENING_MATCH               1
 #define  OPENING_MISMATCH            2
 
+/* The maximum number of threads used when searching and the
+   smallest number of games worth giving a thread of its own */
+#define  MAX_THOR_THREADS            16
+#define  MIN_THREAD_GAMES            2048
+
 /* The default and maximum number of criteria to use when sorting
    the set of matching games. */
 #define  DEFAULT_SORT_CRITERIA       5
 
 #define  MAX_SORT_CRITERIA           10
 
+/* The sizes of the prolog and of a game record in a Thor file */
+#define  PROLOG_SIZE                 16
+#define  GAME_RECORD_SIZE            68
 
+/* Identification of the player and tournament order cache files */
+#define  ORDER_CACHE_MAGIC           0x5a544f52
+
+/* Identification of the position index file format */
+#define  THOR_INDEX_MAGIC            0x5a544958
+#define  THOR_INDEX_VERSION          1
 
-/* Type definitions */
 
 
-typedef char int_8;
+/* Type definitions */
+
 
-typedef short int_16;
+typedef struct {
+  const unsigned char *data;
+  size_t size;
+  int mapped;
+} ThorFileType;
 
-typedef int int_32;
+typedef struct {
+  int board[100];
+  int side_to_move;
+  int row_pattern[8];
+  int col_pattern[8];
+} ThorBoardType;
 
 typedef struct {
   int creation_century;
@@ -124,7 +154,6 @@ typedef struct {
   short perfect_black_score;
   char moves[60];
   short move_count;
-  char black_disc_count[61];
   ThorOpeningNode *opening;
   struct DatabaseType_ *database;
   unsigned int shape_hi, shape_lo;
@@ -139,6 +168,7 @@ typedef struct DatabaseType_ {
   PrologType prolog;
   GameType *games;
   int count;
+  int prepared;
   struct DatabaseType_ *next;
 } DatabaseType;
 
@@ -155,6 +185,40 @@ typedef struct {
   GameType **match_list;
 } SearchResultType;
 
+typedef struct {
+  unsigned int hash;
+  int game;
+} PositionIndexEntry;
+
+typedef struct {
+  int valid;
+  int count;
+  PositionIndexEntry *entry;
+  GameType **game_table;
+} PositionIndexType;
+
+typedef struct {
+  int first_game;
+  int last_game;
+} ThorFilterType;
+
+typedef struct {
+  ThorBoardType state;
+  int first_entry;
+  int last_entry;
+  int move_count;
+  int side_to_move;
+  int scatter;
+  unsigned int *shape_lo, *shape_hi;
+  unsigned int corner_mask;
+  unsigned int hash1, hash2;
+  GameType **match_list;
+  int match_count;
+  int frequency[65];
+  int next_move_frequency[100];
+  double next_move_score[100];
+} ThorScanType;
+
 typedef struct {
   int game_categories;
   int first_year;
@@ -167,12 +231,12 @@ typedef struct {
 /* Local variables */
 
 static int thor_game_count, thor_database_count;
-static int thor_side_to_move;
 static int thor_sort_criteria_count;
 static int thor_games_sorted;
 static int thor_games_filtered;
-static int thor_row_pattern[8], thor_col_pattern[8];
-static int thor_board[100];
+static int thor_thread_count;
+static ThorBoardType thor_state;
+static ThorScanType thor_scan[MAX_THOR_THREADS];
 static int b1_b1_map[100], g1_b1_map[100], g8_b1_map[100], b8_b1_map[100];
 static int a2_b1_map[100], a7_b1_map[100], h7_b1_map[100], h2_b1_map[100];
 static unsigned int primary_hash[8][6561], secondary_hash[8][6561];
@@ -183,6 +247,7 @@ static DatabaseType *database_head;
 static PlayerDatabaseType players;
 static SearchResultType thor_search;
 static TournamentDatabaseType tournaments;
+static PositionIndexType position_index;
 static ThorOpeningNode *root_node;
 static int default_sort_order[DEFAULT_SORT_CRITERIA] = {
   SORT_BY_BLACK_NAME,
@@ -201,13 +266,13 @@ static FilterType filter;
 */
 
 static void
-clear_thor_board( void ) {
+clear_thor_board( ThorBoardType *state ) {
   int pos;
 
   for ( pos = 11; pos <= 88; pos++ )
-    thor_board[pos] = EMPTY;
-  thor_board[45] = thor_board[54] = BLACKSQ;
-  thor_board[44] = thor_board[55] = WHITESQ;
+    state->board[pos] = EMPTY;
+  state->board[45] = state->board[54] = BLACKSQ;
+  state->board[44] = state->board[55] = WHITESQ;
 }
 
 
@@ -224,7 +289,7 @@ prepare_thor_board( void ) {
   for ( i = 0; i < 10; i++ )
     for ( j = 0, pos = 10 * i; j < 10; j++, pos++ )
       if ( (i == 0) || (i == 9) || (j == 0) || (j == 9) )
-	thor_board[pos] = OUTSIDE;
+	thor_state.board[pos] = OUTSIDE;
 }
 
 
@@ -235,25 +300,26 @@ prepare_thor_board( void ) {
 */
 
 INLINE static int
-directional_flip_count( int sq, int inc, int color, int oppcol ) {
+directional_flip_count( ThorBoardType *state, int sq, int inc,
+			int color, int oppcol ) {
   int count = 1;
   int pt = sq + inc;
 
-  if ( thor_board[pt] == oppcol) {
+  if ( state->board[pt] == oppcol) {
     pt += inc;
-    if ( thor_board[pt] == oppcol ) {
+    if ( state->board[pt] == oppcol ) {
       count++;
       pt += inc;
-      if ( thor_board[pt] == oppcol ) {
+      if ( state->board[pt] == oppcol ) {
 	count++;
 	pt += inc;
-	if ( thor_board[pt] == oppcol ) {
+	if ( state->board[pt] == oppcol ) {
 	  count++;
 	  pt += inc;
-	  if ( thor_board[pt] == oppcol ) {
+	  if ( state->board[pt] == oppcol ) {
 	    count++;
 	    pt += inc;
-	    if ( thor_board[pt] == oppcol ) {
+	    if ( state->board[pt] == oppcol ) {
 	      count++;
 	      pt += inc;
 	    }
@@ -261,11 +327,11 @@ directional_flip_count( int sq, int inc, int color, int oppcol ) {
 	}
       }
     }
-    if ( thor_board[pt] == color ) {
+    if ( state->board[pt] == color ) {
       int g = count;
       do {
 	pt -= inc;
-	thor_board[pt] = color;
+	state->board[pt] = color;
       } while( --g );
       return count;
     }
@@ -281,30 +347,31 @@ directional_flip_count( int sq, int inc, int color, int oppcol ) {
 */
 
 INLINE static int
-directional_flip_any( int sq, int inc, int color, int oppcol ) {
+directional_flip_any( ThorBoardType *state, int sq, int inc,
+		      int color, int oppcol ) {
   int pt = sq + inc;
 
-  if ( thor_board[pt] == oppcol) {
+  if ( state->board[pt] == oppcol) {
     pt += inc;
-    if ( thor_board[pt] == oppcol ) {
+    if ( state->board[pt] == oppcol ) {
       pt += inc;
-      if ( thor_board[pt] == oppcol ) {
+      if ( state->board[pt] == oppcol ) {
 	pt += inc;
-	if ( thor_board[pt] == oppcol ) {
+	if ( state->board[pt] == oppcol ) {
 	  pt += inc;
-	  if ( thor_board[pt] == oppcol ) {
+	  if ( state->board[pt] == oppcol ) {
 	    pt += inc;
-	    if ( thor_board[pt] == oppcol ) {
+	    if ( state->board[pt] == oppcol ) {
 	      pt += inc;
 	    }
 	  }
 	}
       }
     }
-    if ( thor_board[pt] == color ) {
+    if ( state->board[pt] == color ) {
       pt -= inc;
       do {
-	thor_board[pt] = color;
+	state->board[pt] = color;
 	pt -= inc;
       } while ( pt != sq );
       return TRUE;
@@ -321,28 +388,28 @@ directional_flip_any( int sq, int inc, int color, int oppcol ) {
 */
 
 INLINE static int
-count_flips( int sqnum, int color, int oppcol ) {
+count_flips( ThorBoardType *state, int sqnum, int color, int oppcol ) {
   int count;
   int mask;
 
   count = 0;
   mask = dir_mask[sqnum];
   if ( mask & 128 )
-    count += directional_flip_count( sqnum, -11, color, oppcol );
+    count += directional_flip_count( state, sqnum, -11, color, oppcol );
   if ( mask & 64 )
-    count += directional_flip_count( sqnum, 11, color, oppcol );
+    count += directional_flip_count( state, sqnum, 11, color, oppcol );
   if ( mask & 32 )
-    count += directional_flip_count( sqnum, -10, color, oppcol );
+    count += directional_flip_count( state, sqnum, -10, color, oppcol );
   if ( mask & 16 )
-    count += directional_flip_count( sqnum, 10, color, oppcol );
+    count += directional_flip_count( state, sqnum, 10, color, oppcol );
   if ( mask & 8 )
-    count += directional_flip_count( sqnum, -9, color, oppcol );
+    count += directional_flip_count( state, sqnum, -9, color, oppcol );
   if ( mask & 4 )
-    count += directional_flip_count( sqnum, 9, color, oppcol );
+    count += directional_flip_count( state, sqnum, 9, color, oppcol );
   if ( mask & 2 )
-    count += directional_flip_count( sqnum, -1, color, oppcol );
+    count += directional_flip_count( state, sqnum, -1, color, oppcol );
   if ( mask & 1 )
-    count += directional_flip_count( sqnum, 1, color, oppcol );
+    count += directional_flip_count( state, sqnum, 1, color, oppcol );
 
   return count;
 }
@@ -355,28 +422,28 @@ count_flips( int sqnum, int color, int oppcol ) {
 */
 
 INLINE static int
-any_flips( int sqnum, int color, int oppcol ) {
+any_flips( ThorBoardType *state, int sqnum, int color, int oppcol ) {
   int count;
   int mask;
 
   count = FALSE;
   mask = dir_mask[sqnum];
   if ( mask & 128 )
-    count |= directional_flip_any( sqnum, -11, color, oppcol );
+    count |= directional_flip_any( state, sqnum, -11, color, oppcol );
   if ( mask & 64 )
-    count |= directional_flip_any( sqnum, 11, color, oppcol );
+    count |= directional_flip_any( state, sqnum, 11, color, oppcol );
   if ( mask & 32 )
-    count |= directional_flip_any( sqnum, -10, color, oppcol );
+    count |= directional_flip_any( state, sqnum, -10, color, oppcol );
   if ( mask & 16 )
-    count |= directional_flip_any( sqnum, 10, color, oppcol );
+    count |= directional_flip_any( state, sqnum, 10, color, oppcol );
   if ( mask & 8 )
-    count |= directional_flip_any( sqnum, -9, color, oppcol );
+    count |= directional_flip_any( state, sqnum, -9, color, oppcol );
   if ( mask & 4 )
-    count |= directional_flip_any( sqnum, 9, color, oppcol );
+    count |= directional_flip_any( state, sqnum, 9, color, oppcol );
   if ( mask & 2 )
-    count |= directional_flip_any( sqnum, -1, color, oppcol );
+    count |= directional_flip_any( state, sqnum, -1, color, oppcol );
   if ( mask & 1 )
-    count |= directional_flip_any( sqnum, 1, color, oppcol );
+    count |= directional_flip_any( state, sqnum, 1, color, oppcol );
 
   return count;
 }
@@ -389,19 +456,19 @@ any_flips( int sqnum, int color, int oppcol ) {
 */
 
 INLINE static void
-compute_thor_patterns( int *in_board ) {
+compute_thor_patterns( ThorBoardType *state, int *in_board ) {
   int i, j;
   int pos;
 
   for ( i = 0; i < 8; i++ ) {
-    thor_row_pattern[i] = 0;
-    thor_col_pattern[i] = 0;
+    state->row_pattern[i] = 0;
+    state->col_pattern[i] = 0;
   }
 
   for ( i = 0; i < 8; i++ )
     for ( j = 0, pos = 10 * i + 11; j < 8; j++, pos++ ) {
-      thor_row_pattern[i] += pow3[j] * in_board[pos];
-      thor_col_pattern[j] += pow3[i] * in_board[pos];
+      state->row_pattern[i] += pow3[j] * in_board[pos];
+      state->col_pattern[j] += pow3[i] * in_board[pos];
     }
 }
 
@@ -483,32 +550,34 @@ get_corner_mask( int disc_a1, int disc_a8, int disc_h1, int disc_h8 ) {
 
 /*
   PLAY_THROUGH_GAME
-  Play the MAX_MOVES first moves of GAME and update THOR_BOARD
-  and THOR_SIDE_TO_MOVE to represent the position after those moves.
+  Play the MAX_MOVES first moves of GAME and update the board and
+  side to move in STATE to represent the position after those moves.
 */
 
 static int
-play_through_game( GameType *game, int max_moves ) {
+play_through_game( ThorBoardType *state, GameType *game, int max_moves ) {
   int i;
   int move;
   int flipped;
 
-  clear_thor_board();
-  thor_side_to_move = BLACKSQ;
+  clear_thor_board( state );
+  state->side_to_move = BLACKSQ;
 
   for ( i = 0; i < max_moves; i++ ) {
     move = abs( game->moves[i] );
-    flipped = any_flips( move, thor_side_to_move, OPP( thor_side_to_move ) );
+    flipped = any_flips( state, move, state->side_to_move,
+			 OPP( state->side_to_move ) );
     if ( flipped ) {
-      thor_board[move] = thor_side_to_move;
-      thor_side_to_move = OPP( thor_side_to_move );
+      state->board[move] = state->side_to_move;
+      state->side_to_move = OPP( state->side_to_move );
     }
     else {
-      thor_side_to_move = OPP( thor_side_to_move );
-      flipped = any_flips( move, thor_side_to_move, OPP( thor_side_to_move ) );
+      state->side_to_move = OPP( state->side_to_move );
+      flipped = any_flips( state, move, state->side_to_move,
+			   OPP( state->side_to_move ) );
       if ( flipped ) {
-	thor_board[move] = thor_side_to_move;
-	thor_side_to_move = OPP( thor_side_to_move );
+	state->board[move] = state->side_to_move;
+	state->side_to_move = OPP( state->side_to_move );
       }
       else
 	return FALSE;
@@ -522,8 +591,9 @@ play_through_game( GameType *game, int max_moves ) {
 /*
   PREPARE_GAME
   Performs off-line analysis of GAME to speed up subsequent requests.
-  The main result is that the number of black discs on the board after
-  each of the moves is stored.
+  The main results are the number of moves actually played, the signs
+  of the white moves and the corner descriptor; the positions themselves
+  are located through the position index built by BUILD_THOR_INDEX.
 */
 
 static void
@@ -534,51 +604,41 @@ prepare_game( GameType *game ) {
   int flipped;
   int opening_match;
   int moves_played;
-  int disc_count[3];
   unsigned int corner_descriptor;
   ThorOpeningNode *opening, *child;
 
-  /* Play through the game and count the number of black discs
-     at each stage. */
+  /* Play through the game to find the side to move at each stage. */
 
-  clear_thor_board();
-  disc_count[BLACKSQ] = disc_count[WHITESQ] = 2;
-  thor_side_to_move = BLACKSQ;
+  clear_thor_board( &thor_state );
+  thor_state.side_to_move = BLACKSQ;
 
   corner_descriptor = 0;
 
   moves_played = 0;
   done = FALSE;
   do {
-    /* Store the number of black discs. */
-
-    game->black_disc_count[moves_played] = disc_count[BLACKSQ];
-
-    /* Make the move, update the board and disc count,
-       and change the sign for white moves */
+    /* Make the move, update the board and change the sign
+       for white moves */
 
     move = game->moves[moves_played];
-    flipped = count_flips( move, thor_side_to_move, OPP( thor_side_to_move ) );
+    flipped = count_flips( &thor_state, move, thor_state.side_to_move,
+			   OPP( thor_state.side_to_move ) );
     if ( flipped ) {
-      thor_board[move] = thor_side_to_move;
-      disc_count[thor_side_to_move] += flipped + 1;
-      disc_count[OPP( thor_side_to_move )] -= flipped;
-      if ( thor_side_to_move == WHITESQ )
+      thor_state.board[move] = thor_state.side_to_move;
+      if ( thor_state.side_to_move == WHITESQ )
 	game->moves[moves_played] = -game->moves[moves_played];
-      thor_side_to_move = OPP( thor_side_to_move );
+      thor_state.side_to_move = OPP( thor_state.side_to_move );
       moves_played++;
     }
     else {
-      thor_side_to_move = OPP( thor_side_to_move );
-      flipped = count_flips( move, thor_side_to_move,
-			     OPP( thor_side_to_move ) );
+      thor_state.side_to_move = OPP( thor_state.side_to_move );
+      flipped = count_flips( &thor_state, move, thor_state.side_to_move,
+			     OPP( thor_state.side_to_move ) );
       if ( flipped ) {
-	thor_board[move] = thor_side_to_move;
-	disc_count[thor_side_to_move] += flipped + 1;
-	disc_count[OPP( thor_side_to_move )] -= flipped;
-	if ( thor_side_to_move == WHITESQ )
+	thor_state.board[move] = thor_state.side_to_move;
+	if ( thor_state.side_to_move == WHITESQ )
 	  game->moves[moves_played] = -game->moves[moves_played];
-	thor_side_to_move = OPP( thor_side_to_move );
+	thor_state.side_to_move = OPP( thor_state.side_to_move );
 	moves_played++;
       }
       else
@@ -589,15 +649,12 @@ prepare_game( GameType *game ) {
 
     if ( (move == 11) || (move == 18) || (move == 81) || (move == 88) )
       corner_descriptor |=
-	get_corner_mask( thor_board[11], thor_board[81],
-			 thor_board[18], thor_board[88] );
+	get_corner_mask( thor_state.board[11], thor_state.board[81],
+			 thor_state.board[18], thor_state.board[88] );
 
   } while ( !done && (moves_played < 60) );
 
-  game->black_disc_count[moves_played] = disc_count[BLACKSQ];
   game->move_count = moves_played;
-  for ( i = moves_played + 1; i <= 60; i++ )
-    game->black_disc_count[i] = -1;
 
   /* Find the longest opening which coincides with the game */
 
@@ -635,49 +692,176 @@ prepare_game( GameType *game ) {
 
 /*
   GET_INT_8
-  Reads an 8-bit signed integer from STREAM. Returns TRUE upon
-  success, FALSE otherwise.
+  GET_INT_16
+  GET_INT_32
+  Decode little-endian signed integers of 8, 16 and 32 bits
+  stored at BUFFER.
 */
 
 INLINE static int
-get_int_8( FILE *stream, int_8 *value ) {
-  int actually_read;
+get_int_8( const unsigned char *buffer ) {
+  return (signed char) buffer[0];
+}
 
-  actually_read = fread( value, sizeof( int_8 ), 1, stream );
+INLINE static int
+get_int_16( const unsigned char *buffer ) {
+  return (short) (buffer[0] | (buffer[1] << 8));
+}
 
-  return (actually_read == 1);
+INLINE static int
+get_int_32( const unsigned char *buffer ) {
+  return (int) (buffer[0] | (buffer[1] << 8) | (buffer[2] << 16) |
+		((unsigned int) buffer[3] << 24));
 }
 
 
 /*
-  GET_INT_16
-  Reads a 16-bit signed integer from STREAM. Returns TRUE upon
-  success, FALSE otherwise.
+  OPEN_THOR_FILE
+  Makes the contents of FILE_NAME available in FILE. Where possible
+  the file is mapped into memory, otherwise it is read into a buffer.
+  Returns TRUE upon success, otherwise FALSE.
 */
 
-INLINE static int
-get_int_16( FILE *stream, int_16 *value ) {
-  int actually_read;
+static int
+open_thor_file( const char *file_name, ThorFileType *file ) {
+#ifdef __linux__
+  int fd;
+  struct stat file_status;
+  void *block;
+
+  fd = open( file_name, O_RDONLY );
+  if ( fd == -1 )
+    return FALSE;
+  if ( (fstat( fd, &file_status ) == 0) && (file_status.st_size > 0) ) {
+    block = mmap( NULL, file_status.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    if ( block != MAP_FAILED ) {
+      close( fd );
+      file->data = (const unsigned char *) block;
+      file->size = file_status.st_size;
+      file->mapped = TRUE;
+      return TRUE;
+    }
+  }
+  close( fd );
+#endif
+  {
+    FILE *stream;
+    long size;
+    unsigned char *buffer;
 
-  actually_read = fread( value, sizeof( int_16 ), 1, stream );
+    stream = fopen( file_name, "rb" );
+    if ( stream == NULL )
+      return FALSE;
+    fseek( stream, 0, SEEK_END );
+    size = ftell( stream );
+    rewind( stream );
+    if ( size < 0 ) {
+      fclose( stream );
+      return FALSE;
+    }
+    buffer = (unsigned char *) safe_malloc( size + 1 );
+    file->size = fread( buffer, 1, size, stream );
+    fclose( stream );
+    file->data = buffer;
+    file->mapped = FALSE;
+  }
 
-  return (actually_read == 1);
+  return TRUE;
 }
 
 
 /*
-  GET_INT_32
-  Reads a 32-bit signed integer from STREAM. Returns TRUE upon
-  success, FALSE otherwise.
+  CLOSE_THOR_FILE
+  Releases the memory associated with FILE.
 */
 
-INLINE static int
-get_int_32( FILE *stream, int_32 *value ) {
-  int actually_read;
+static void
+close_thor_file( ThorFileType *file ) {
+#ifdef __linux__
+  if ( file->mapped ) {
+    munmap( (void *) file->data, file->size );
+    return;
+  }
+#endif
+  free( (void *) file->data );
+}
+
+
+/*
+  GET_NAME_CHECKSUM
+  Computes a checksum of the COUNT bytes of names in NAME_BUFFER.
+*/
+
+static unsigned int
+get_name_checksum( const char *name_buffer, int count ) {
+  int i;
+  unsigned int checksum;
 
-  actually_read = fread( value, sizeof( int_32 ), 1, stream );
+  checksum = 0;
+  for ( i = 0; i < count; i++ )
+    checksum = 31 * checksum + (unsigned char) name_buffer[i];
 
-  return (actually_read == 1);
+  return checksum;
+}
+
+
+/*
+  READ_ORDER_CACHE
+  WRITE_ORDER_CACHE
+  The lexicographical order of the players or tournaments in FILE_NAME
+  is stored in FILE_NAME with the suffix ".ord" so that the names only
+  have to be sorted once. The cached order is only used if it was
+  computed from the same COUNT names as those in NAME_BUFFER.
+*/
+
+static int
+read_order_cache( const char *file_name, const char *name_buffer,
+		  int buffer_size, int count, int *lex_order ) {
+  char cache_name[FILENAME_MAX];
+  int i;
+  int success;
+  int header[4];
+  FILE *stream;
+
+  sprintf( cache_name, "%.*s.ord", FILENAME_MAX - 5, file_name );
+  stream = fopen( cache_name, "rb" );
+  if ( stream == NULL )
+    return FALSE;
+
+  success = (fread( header, sizeof( int ), 4, stream ) == 4) &&
+    (header[0] == ORDER_CACHE_MAGIC) &&
+    (header[1] == count) &&
+    ((unsigned int) header[2] ==
+     get_name_checksum( name_buffer, buffer_size )) &&
+    (fread( lex_order, sizeof( int ), count, stream ) == (size_t) count);
+  for ( i = 0; success && (i < count); i++ )
+    if ( (lex_order[i] < 0) || (lex_order[i] >= count) )
+      success = FALSE;
+
+  fclose( stream );
+
+  return success;
+}
+
+static void
+write_order_cache( const char *file_name, const char *name_buffer,
+		   int buffer_size, int count, int *lex_order ) {
+  char cache_name[FILENAME_MAX];
+  int header[4];
+  FILE *stream;
+
+  sprintf( cache_name, "%.*s.ord", FILENAME_MAX - 5, file_name );
+  stream = fopen( cache_name, "wb" );
+  if ( stream == NULL )  /* The cache is optional */
+    return;
+
+  header[0] = ORDER_CACHE_MAGIC;
+  header[1] = count;
+  header[2] = (int) get_name_checksum( name_buffer, buffer_size );
+  header[3] = 0;
+  fwrite( header, sizeof( int ), 4, stream );
+  fwrite( lex_order, sizeof( int ), count, stream );
+  fclose( stream );
 }
 
 
@@ -754,44 +938,22 @@ player_lex_order( int index ) {
 
 /*
   READ_PROLOG
-  Reads the prolog from STREAM into PROLOG. As the prolog is common
-  for all the three database types (game, player, tournament) also
-  values which aren't used are read.
-  Returns TRUE upon success, otherwise FALSE.
+  Decodes the prolog stored at BUFFER into PROLOG. As the prolog is
+  common for all the three database types (game, player, tournament)
+  also values which aren't used are read. The caller must make sure
+  that PROLOG_SIZE bytes are available.
 */
 
-static int
-read_prolog( FILE *stream, PrologType *prolog ) {
-  int success;
-  int_8 byte_val;
-  int_16 word_val;
-  int_32 longint_val;
-
-  success = get_int_8( stream, &byte_val );
-  prolog->creation_century = byte_val;
-
-  success = success && get_int_8( stream, &byte_val );
-  prolog->creation_year = byte_val;
-
-  success = success && get_int_8( stream, &byte_val );
-  prolog->creation_month = byte_val;
-
-  success = success && get_int_8( stream, &byte_val );
-  prolog->creation_day = byte_val;
-
-  success = success && get_int_32( stream, &longint_val );
-  prolog->game_count = longint_val;
-
-  success = success && get_int_16( stream, &word_val );
-  prolog->item_count = word_val;
-
-  success = success && get_int_16( stream, &word_val );
-  prolog->origin_year = word_val;
-
-  success = success && get_int_32( stream, &longint_val );
-  prolog->reserved = longint_val;
-
-  return success;
+static void
+read_prolog( const unsigned char *buffer, PrologType *prolog ) {
+  prolog->creation_century = get_int_8( buffer );
+  prolog->creation_year = get_int_8( buffer + 1 );
+  prolog->creation_month = get_int_8( buffer + 2 );
+  prolog->creation_day = get_int_8( buffer + 3 );
+  prolog->game_count = get_int_32( buffer + 4 );
+  prolog->item_count = get_int_16( buffer + 8 );
+  prolog->origin_year = get_int_16( buffer + 10 );
+  prolog->reserved = get_int_32( buffer + 12 );
 }
 
 
@@ -816,13 +978,26 @@ thor_compare_tournaments( const void *t1, const void *t2 ) {
 
 /*
   SORT_TOURNAMENT_DATABASE
-  Computes the lexicographic order of all tournaments in the database.
+  Computes the lexicographic order of all tournaments in the database,
+  unless it is available from the order cache for FILE_NAME.
 */
 
 static void
-sort_tournament_database( void ) {
+sort_tournament_database( const char *file_name ) {
   TournamentType **tournament_buffer;
   int i;
+  int buffer_size;
+  int *lex_order;
+
+  buffer_size = TOURNAMENT_NAME_LENGTH * tournaments.count;
+  lex_order = (int *) safe_malloc( (tournaments.count + 1) * sizeof( int ) );
+  if ( read_order_cache( file_name, tournaments.name_buffer, buffer_size,
+			 tournaments.count, lex_order ) ) {
+    for ( i = 0; i < tournaments.count; i++ )
+      tournaments.tournament_list[i].lex_order = lex_order[i];
+    free( lex_order );
+    return;
+  }
 
   tournament_buffer =
     (TournamentType **)
@@ -834,6 +1009,12 @@ sort_tournament_database( void ) {
   for ( i = 0; i < tournaments.count; i++ )
     tournament_buffer[i]->lex_order = i;
   free( tournament_buffer );
+
+  for ( i = 0; i < tournaments.count; i++ )
+    lex_order[i] = tournaments.tournament_list[i].lex_order;
+  write_order_cache( file_name, tournaments.name_buffer, buffer_size,
+		     tournaments.count, lex_order );
+  free( lex_order );
 }
 
 
@@ -845,27 +1026,28 @@ sort_tournament_database( void ) {
 
 int
 read_tournament_database( const char *file_name ) {
-  FILE *stream;
+  ThorFileType file;
   int i;
   int success;
-  int actually_read;
   int buffer_size;
 
-  stream = fopen( file_name, "rb" );
-  if ( stream == NULL )
+  if ( !open_thor_file( file_name, &file ) )
     return FALSE;
-  if ( !read_prolog( stream, &tournaments.prolog ) ) {
-    fclose( stream );
+  if ( file.size < PROLOG_SIZE ) {
+    close_thor_file( &file );
     return FALSE;
   }
+  read_prolog( file.data, &tournaments.prolog );
   tournaments.count = tournaments.prolog.item_count;
   buffer_size = TOURNAMENT_NAME_LENGTH * tournaments.prolog.item_count;
-  tournaments.name_buffer =
-    (char *) safe_realloc( tournaments.name_buffer,  buffer_size );
-  actually_read = fread( tournaments.name_buffer, 1, buffer_size, stream );
-  success = (actually_read == buffer_size);
+  success = (buffer_size >= 0) && (file.size >= PROLOG_SIZE + buffer_size);
+  if ( success ) {
+    tournaments.name_buffer =
+      (char *) safe_realloc( tournaments.name_buffer, buffer_size + 1 );
+    memcpy( tournaments.name_buffer, file.data + PROLOG_SIZE, buffer_size );
+  }
 
-  fclose( stream );
+  close_thor_file( &file );
 
   if ( success ) {
     tournaments.tournament_list = (TournamentType *)
@@ -875,7 +1057,7 @@ read_tournament_database( const char *file_name ) {
       tournaments.tournament_list[i].name = tournament_name( i );
       tournaments.tournament_list[i].selected = TRUE;
     }
-    sort_tournament_database();
+    sort_tournament_database( file_name );
     thor_games_sorted = FALSE;
     thor_games_filtered = FALSE;
   }
@@ -953,13 +1135,26 @@ thor_compare_players( const void *p1, const void *p2 ) {
 
 /*
   SORT_PLAYER_DATABASE
-  Computes the lexicographic order of all players in the database.
+  Computes the lexicographic order of all players in the database,
+  unless it is available from the order cache for FILE_NAME.
 */
 
 static void
-sort_player_database( void ) {
+sort_player_database( const char *file_name ) {
   PlayerType **player_buffer;
   int i;
+  int buffer_size;
+  int *lex_order;
+
+  buffer_size = PLAYER_NAME_LENGTH * players.count;
+  lex_order = (int *) safe_malloc( (players.count + 1) * sizeof( int ) );
+  if ( read_order_cache( file_name, players.name_buffer, buffer_size,
+			 players.count, lex_order ) ) {
+    for ( i = 0; i < players.count; i++ )
+      players.player_list[i].lex_order = lex_order[i];
+    free( lex_order );
+    return;
+  }
 
   player_buffer =
     (PlayerType **) safe_malloc( players.count * sizeof( PlayerType * ) );
@@ -970,6 +1165,12 @@ sort_player_database( void ) {
   for ( i = 0; i < players.count; i++ )
     player_buffer[i]->lex_order = i;
   free( player_buffer );
+
+  for ( i = 0; i < players.count; i++ )
+    lex_order[i] = players.player_list[i].lex_order;
+  write_order_cache( file_name, players.name_buffer, buffer_size,
+		     players.count, lex_order );
+  free( lex_order );
 }
 
 
@@ -981,27 +1182,28 @@ sort_player_database( void ) {
 
 int
 read_player_database( const char *file_name ) {
-  FILE *stream;
+  ThorFileType file;
   int i;
   int success;
-  int actually_read;
   int buffer_size;
 
-  stream = fopen( file_name, "rb" );
-  if ( stream == NULL )
+  if ( !open_thor_file( file_name, &file ) )
     return FALSE;
-  if ( !read_prolog( stream, &players.prolog ) ) {
-    fclose( stream );
+  if ( file.size < PROLOG_SIZE ) {
+    close_thor_file( &file );
     return FALSE;
   }
+  read_prolog( file.data, &players.prolog );
   players.count = players.prolog.item_count;
   buffer_size = PLAYER_NAME_LENGTH * players.count;
-  players.name_buffer =
-    (char *) safe_realloc( players.name_buffer, buffer_size );
-  actually_read = fread( players.name_buffer, 1, buffer_size, stream );
-  success = (actually_read == buffer_size);
+  success = (buffer_size >= 0) && (file.size >= PROLOG_SIZE + buffer_size);
+  if ( success ) {
+    players.name_buffer =
+      (char *) safe_realloc( players.name_buffer, buffer_size + 1 );
+    memcpy( players.name_buffer, file.data + PROLOG_SIZE, buffer_size );
+  }
 
-  fclose( stream );
+  close_thor_file( &file );
 
   if ( success ) {
     players.player_list = (PlayerType *)
@@ -1018,7 +1220,7 @@ read_player_database( const char *file_name ) {
 	players.player_list[i].is_program = FALSE;
       players.player_list[i].selected = TRUE;
     }
-    sort_player_database();
+    sort_player_database( file_name );
     thor_games_sorted = FALSE;
     thor_games_filtered = FALSE;
   }
@@ -1029,37 +1231,19 @@ read_player_database( const char *file_name ) {
 
 /*
   READ_GAME
-  Reads a game from STREAM in GAME and prepares the game
-  for database questions. Returns TRUE upon success,
-  otherwise FALSE.
+  Decodes the game record stored at BUFFER into GAME. The analysis
+  of the moves is postponed until the game is first searched,
+  see PREPARE_ALL_DATABASES.
 */
 
-static int
-read_game( FILE *stream, GameType *game ) {
-  int success;
-  int actually_read;
-  int_8 byte_val;
-  int_16 word_val;
-
-  success = get_int_16( stream, &word_val );
-  game->tournament_no = word_val;
-
-  success = success && get_int_16( stream, &word_val );
-  game->black_no = word_val;
-
-  success = success && get_int_16( stream, &word_val );
-  game->white_no = word_val;
-
-  success = success && get_int_8( stream, &byte_val );
-  game->actual_black_score = byte_val;
-
-  success = success && get_int_8( stream, &byte_val );
-  game->perfect_black_score = byte_val;
-
-  actually_read = fread( &game->moves, 1, 60, stream );
-  prepare_game( game );
-
-  return success && (actually_read == 60);
+static void
+read_game( const unsigned char *buffer, GameType *game ) {
+  game->tournament_no = get_int_16( buffer );
+  game->black_no = get_int_16( buffer + 2 );
+  game->white_no = get_int_16( buffer + 4 );
+  game->actual_black_score = get_int_8( buffer + 6 );
+  game->perfect_black_score = get_int_8( buffer + 7 );
+  memcpy( game->moves, buffer + 8, 60 );
 }
 
 
@@ -1071,44 +1255,79 @@ read_game( FILE *stream, GameType *game ) {
 
 int
 read_game_database( const char *file_name ) {
-  FILE *stream;
+  ThorFileType file;
   int i;
   int success;
-  DatabaseType *old_database_head;
+  int available;
+  DatabaseType *new_database;
 
-  stream = fopen( file_name, "rb" );
-  if ( stream == NULL )
+  if ( !open_thor_file( file_name, &file ) )
     return FALSE;
-
-  old_database_head = database_head;
-  database_head = (DatabaseType *) safe_malloc( sizeof( DatabaseType ) );
-  database_head->next = old_database_head;
-
-  if ( !read_prolog( stream, &database_head->prolog ) ) {
-    fclose( stream );
+  if ( file.size < PROLOG_SIZE ) {
+    close_thor_file( &file );
     return FALSE;
   }
 
-  success = TRUE;
-  database_head->count = database_head->prolog.game_count;
-  database_head->games =
-    (GameType *) safe_malloc( database_head->count * sizeof( GameType ) );
-  for ( i = 0; i < database_head->count; i++ ) {
-    success = success && read_game( stream, &database_head->games[i] );
-    database_head->games[i].database = database_head;
+  new_database = (DatabaseType *) safe_malloc( sizeof( DatabaseType ) );
+  read_prolog( file.data, &new_database->prolog );
+
+  /* Only keep the games actually present in the file */
+
+  available = (file.size - PROLOG_SIZE) / GAME_RECORD_SIZE;
+  success = (new_database->prolog.game_count >= 0) &&
+    (new_database->prolog.game_count <= available);
+  if ( success )
+    new_database->count = new_database->prolog.game_count;
+  else
+    new_database->count = MAX( 0, MIN( new_database->prolog.game_count,
+				       available ) );
+
+  new_database->games =
+    (GameType *) safe_malloc( (new_database->count + 1) * sizeof( GameType ) );
+  for ( i = 0; i < new_database->count; i++ ) {
+    read_game( file.data + PROLOG_SIZE + GAME_RECORD_SIZE * i,
+	       &new_database->games[i] );
+    new_database->games[i].database = new_database;
   }
+  new_database->prepared = FALSE;
+
+  close_thor_file( &file );
+
+  new_database->next = database_head;
+  database_head = new_database;
 
   thor_database_count++;
   thor_game_count += database_head->count;
   thor_games_sorted = FALSE;
   thor_games_filtered = FALSE;
-
-  fclose( stream );
+  position_index.valid = FALSE;
 
   return success;
 }
 
 
+/*
+  PREPARE_ALL_DATABASES
+  Analyzes the games in all databases which haven't been searched yet.
+*/
+
+static void
+prepare_all_databases( void ) {
+  int i;
+  DatabaseType *current_db;
+
+  current_db = database_head;
+  while ( current_db != NULL ) {
+    if ( !current_db->prepared ) {
+      for ( i = 0; i < current_db->count; i++ )
+	prepare_game( &current_db->games[i] );
+      current_db->prepared = TRUE;
+    }
+    current_db = current_db->next;
+  }
+}
+
+
 /*
   GAME_DATABASE_ALREADY_LOADED
   Checks if the game database in FILE_NAME already exists in memory
@@ -1121,18 +1340,21 @@ game_database_already_loaded( const char *file_name ) {
   FILE *stream;
   DatabaseType *current_db;
   PrologType new_prolog;
+  unsigned char buffer[PROLOG_SIZE];
 
   stream = fopen( file_name, "rb" );
   if ( stream == NULL )
     return FALSE;
 
-  if ( !read_prolog( stream, &new_prolog ) ) {
+  if ( fread( buffer, 1, PROLOG_SIZE, stream ) != PROLOG_SIZE ) {
     fclose( stream );
     return FALSE;
   }
 
   fclose( stream );
 
+  read_prolog( buffer, &new_prolog );
+
   current_db = database_head;
   while ( current_db != NULL ) {
     if ( (current_db->prolog.creation_century == new_prolog.creation_century)
@@ -1239,15 +1461,16 @@ print_game( FILE *stream, GameType *game, int display_moves ) {
 */
 
 static void
-compute_partial_hash( unsigned int *hash_val1, unsigned int *hash_val2 ) {
+compute_partial_hash( ThorBoardType *state,
+		      unsigned int *hash_val1, unsigned int *hash_val2 ) {
   int i;
 
   *hash_val1 = 0;
   *hash_val2 = 0;
 
   for ( i = 0; i < 8; i++ ) {
-    *hash_val1 ^= primary_hash[i][thor_row_pattern[i]];
-    *hash_val2 ^= secondary_hash[i][thor_row_pattern[i]];
+    *hash_val1 ^= primary_hash[i][state->row_pattern[i]];
+    *hash_val2 ^= secondary_hash[i][state->row_pattern[i]];
   }
 }
 
@@ -1262,20 +1485,20 @@ compute_partial_hash( unsigned int *hash_val1, unsigned int *hash_val2 ) {
 */
 
 static void
-compute_full_primary_hash( unsigned int *hash_val ) {
+compute_full_primary_hash( ThorBoardType *state, unsigned int *hash_val ) {
   int i;
 
   for ( i = 0; i < 4; i++ )
     hash_val[i] = 0;
   for ( i = 0; i < 8; i++ ) {
     /* b1 -> b1 */
-    hash_val[0] ^= primary_hash[i][thor_row_pattern[i]];
+    hash_val[0] ^= primary_hash[i][state->row_pattern[i]];
     /* b8 -> b1 */
-    hash_val[1] ^= primary_hash[i][thor_row_pattern[7 - i]];
+    hash_val[1] ^= primary_hash[i][state->row_pattern[7 - i]];
     /* a2 -> b1 */
-    hash_val[2] ^= primary_hash[i][thor_col_pattern[i]];
+    hash_val[2] ^= primary_hash[i][state->col_pattern[i]];
     /* h2 -> b1 */
-    hash_val[3] ^= primary_hash[i][thor_col_pattern[7 - i]];
+    hash_val[3] ^= primary_hash[i][state->col_pattern[7 - i]];
   }
   /* g1 -> b1 */
   hash_val[4] = bit_reverse_32( hash_val[0] );
@@ -1288,20 +1511,20 @@ compute_full_primary_hash( unsigned int *hash_val ) {
 }
 
 static void
-compute_full_secondary_hash( unsigned int *hash_val ) {
+compute_full_secondary_hash( ThorBoardType *state, unsigned int *hash_val ) {
   int i;
 
   for ( i = 0; i < 4; i++ )
     hash_val[i] = 0;
   for ( i = 0; i < 8; i++ ) {
     /* b1 -> b1 */
-    hash_val[0] ^= secondary_hash[i][thor_row_pattern[i]];
+    hash_val[0] ^= secondary_hash[i][state->row_pattern[i]];
     /* b8 -> b1 */
-    hash_val[1] ^= secondary_hash[i][thor_row_pattern[7 - i]];
+    hash_val[1] ^= secondary_hash[i][state->row_pattern[7 - i]];
     /* a2 -> b1 */
-    hash_val[2] ^= secondary_hash[i][thor_col_pattern[i]];
+    hash_val[2] ^= secondary_hash[i][state->col_pattern[i]];
     /* h2 -> b1 */
-    hash_val[3] ^= secondary_hash[i][thor_col_pattern[7 - i]];
+    hash_val[3] ^= secondary_hash[i][state->col_pattern[7 - i]];
   }
   /* g1 -> b1 */
   hash_val[4] = bit_reverse_32( hash_val[0] );
@@ -1316,17 +1539,17 @@ compute_full_secondary_hash( unsigned int *hash_val ) {
 
 /*
   PRIMARY_HASH_LOOKUP
-  Checks if any of the rotations of the current pattern set
+  Checks if any of the rotations of the pattern set in STATE
   match the primary hash code TARGET_HASH.
 */
 
 static int
-primary_hash_lookup( unsigned int target_hash ) {
+primary_hash_lookup( ThorBoardType *state, unsigned int target_hash ) {
   int i;
   int hit_mask;
   unsigned int hash_val[8];
 
-  compute_full_primary_hash( hash_val );
+  compute_full_primary_hash( state, hash_val );
 
   hit_mask = 0;
   for ( i = 0; i < 8; i++ )
@@ -1339,17 +1562,17 @@ primary_hash_lookup( unsigned int target_hash ) {
 
 /*
   SECONDARY_HASH_LOOKUP
-  Checks if any of the rotations of the current pattern set
+  Checks if any of the rotations of the pattern set in STATE
   match the secondary hash code TARGET_HASH.
 */
 
 static int
-secondary_hash_lookup( unsigned int target_hash ) {
+secondary_hash_lookup( ThorBoardType *state, unsigned int target_hash ) {
   int i;
   int hit_mask;
   unsigned int hash_val[8];
 
-  compute_full_secondary_hash( hash_val );
+  compute_full_secondary_hash( state, hash_val );
 
   hit_mask = 0;
   for ( i = 0; i < 8; i++ )
@@ -1420,20 +1643,66 @@ thor_compare( const void *g1, const void *g2 ) {
 
 
 /*
-  FILTER_DATABASE
-  Applies the current filter rules to the database DB.
+  GET_THOR_TASK_COUNT
+  Returns the number of threads to use for processing WORK_COUNT
+  games; each thread is given at least MIN_THREAD_GAMES games.
+*/
+
+static int
+get_thor_task_count( int work_count ) {
+  return MAX( 1, MIN( thor_thread_count, work_count / MIN_THREAD_GAMES ) );
+}
+
+
+/*
+  RUN_THOR_THREADS
+  Calls FUNCTION for each of the TASK_COUNT tasks, of size TASK_SIZE,
+  stored at TASKS. The first task is handled by the calling thread and
+  the others by separate threads where threads are available.
 */
 
 static void
-filter_database( DatabaseType *db ) {
+run_thor_threads( void *(*function)( void * ), void *tasks,
+		  size_t task_size, int task_count ) {
+  int i;
+  char *task_list = (char *) tasks;
+#ifdef __linux__
+  int started[MAX_THOR_THREADS];
+  pthread_t thread[MAX_THOR_THREADS];
+
+  for ( i = 1; i < task_count; i++ )
+    started[i] = (pthread_create( &thread[i], NULL, function,
+				  task_list + i * task_size ) == 0);
+  (void) function( task_list );
+  for ( i = 1; i < task_count; i++ )
+    if ( started[i] )
+      pthread_join( thread[i], NULL );
+    else
+      (void) function( task_list + i * task_size );
+#else
+  for ( i = 0; i < task_count; i++ )
+    (void) function( task_list + i * task_size );
+#endif
+}
+
+
+/*
+  FILTER_GAMES
+  Applies the current filter rules to the games in the part of the
+  game table given by TASK. Each thread is given a separate part.
+*/
+
+static void *
+filter_games( void *task ) {
   int i;
   int category;
   int passes_filter;
   int year;
   GameType *game;
+  ThorFilterType *filter_task = (ThorFilterType *) task;
 
-  for ( i = 0; i < db->count; i++ ) {
-    game = &db->games[i];
+  for ( i = filter_task->first_game; i < filter_task->last_game; i++ ) {
+    game = position_index.game_table[i];
     passes_filter = TRUE;
 
     /* Apply the tournament filter */
@@ -1497,23 +1766,33 @@ filter_database( DatabaseType *db ) {
     }
     game->passes_filter = passes_filter;
   }
+
+  return NULL;
 }
 
 
 /*
   FILTER_ALL_DATABASES
   Applies the current filter rules to all databases.
+  The position index must be up to date.
 */
 
 static void
 filter_all_databases( void ) {
-  DatabaseType *current_db;
-
-  current_db = database_head;
-  while ( current_db != NULL ) {
-    filter_database( current_db );
-    current_db = current_db->next;
+  int i;
+  int task_count;
+  ThorFilterType filter_task[MAX_THOR_THREADS];
+
+  task_count = get_thor_task_count( thor_game_count );
+  for ( i = 0; i < task_count; i++ ) {
+    filter_task[i].first_game =
+      (int) (((double) thor_game_count * i) / task_count);
+    filter_task[i].last_game =
+      (int) (((double) thor_game_count * (i + 1)) / task_count);
   }
+
+  run_thor_threads( filter_games, filter_task, sizeof( ThorFilterType ),
+		    task_count );
 }
 
 
@@ -1715,8 +1994,8 @@ opening_scan( int moves_played ) {
   unsigned int primary_hash[8];
   unsigned int secondary_hash[8];
 
-  compute_full_primary_hash( primary_hash );
-  compute_full_secondary_hash( secondary_hash );
+  compute_full_primary_hash( &thor_state, primary_hash );
+  compute_full_secondary_hash( &thor_state, secondary_hash );
 
   recursive_opening_scan( root_node, 0, moves_played,
 			  primary_hash, secondary_hash );
@@ -1820,10 +2099,10 @@ choose_thor_opening_move( int *in_board, int side_to_move, int echo ) {
 
   /* Calculate frequencies for all moves */
 
-  compute_thor_patterns( in_board );
+  compute_thor_patterns( &thor_state, in_board );
 
-  compute_full_primary_hash( primary_hash );
-  compute_full_secondary_hash( secondary_hash );
+  compute_full_primary_hash( &thor_state, primary_hash );
+  compute_full_secondary_hash( &thor_state, secondary_hash );
 
   recursive_frequency_count( root_node, freq_count, 0, disc_count - 4,
 			     symmetries, primary_hash, secondary_hash );
@@ -1893,7 +2172,8 @@ choose_thor_opening_move( int *in_board, int side_to_move, int echo ) {
 */
 
 static int
-position_match( GameType *game, int move_count, int side_to_move,
+position_match( ThorBoardType *state, GameType *game,
+		int move_count, int side_to_move,
 		unsigned int *shape_lo, unsigned int *shape_hi,
 		unsigned int corner_mask,
 		unsigned int in_hash1, unsigned int in_hash2 ) {
@@ -1978,11 +2258,11 @@ position_match( GameType *game, int move_count, int side_to_move,
      functions match the given hash values for at least one
      rotation (common to the two hash functions). */
 
-  if ( play_through_game( game, move_count ) ) {
-    compute_thor_patterns( thor_board );
-    primary_hit_mask = primary_hash_lookup( in_hash1 );
+  if ( play_through_game( state, game, move_count ) ) {
+    compute_thor_patterns( state, state->board );
+    primary_hit_mask = primary_hash_lookup( state, in_hash1 );
     if ( primary_hit_mask ) {
-      secondary_hit_mask = secondary_hash_lookup( in_hash2 );
+      secondary_hit_mask = secondary_hash_lookup( state, in_hash2 );
       if ( primary_hit_mask & secondary_hit_mask )
 	for ( i = 0; i < 8; i++ )
 	  if ( (primary_hit_mask & secondary_hit_mask) & (1 << i) ) {
@@ -1996,6 +2276,416 @@ position_match( GameType *game, int move_count, int side_to_move,
 }
 
 
+/*
+  COMPUTE_CANONICAL_HASH
+  Returns the smallest of the primary hash codes of the rotations
+  of the pattern set in STATE. As the eight hash codes are permuted
+  by the symmetries of the board, the value is the same for all
+  positions equivalent under rotation and reflection.
+*/
+
+static unsigned int
+compute_canonical_hash( ThorBoardType *state ) {
+  int i;
+  unsigned int canonical;
+  unsigned int hash_val[8];
+
+  compute_full_primary_hash( state, hash_val );
+
+  canonical = hash_val[0];
+  for ( i = 1; i < 8; i++ )
+    canonical = MIN( canonical, hash_val[i] );
+
+  return canonical;
+}
+
+
+/*
+  INDEX_COMPARE
+  Orders index entries by canonical hash code and then by game.
+  Only to be called by QSORT.
+*/
+
+#ifdef _WIN32_WCE
+static int CE_CDECL
+#else
+static int
+#endif
+index_compare( const void *e1, const void *e2 ) {
+  const PositionIndexEntry *entry1 = (const PositionIndexEntry *) e1;
+  const PositionIndexEntry *entry2 = (const PositionIndexEntry *) e2;
+
+  if ( entry1->hash != entry2->hash )
+    return (entry1->hash < entry2->hash) ? -1 : 1;
+  else
+    return entry1->game - entry2->game;
+}
+
+
+/*
+  SORT_ORDER_COMPARE
+  Orders a list of pointers to games according to the SORT_ORDER
+  fields set by DATABASE_SEARCH. Only to be called by QSORT.
+*/
+
+#ifdef _WIN32_WCE
+static int CE_CDECL
+#else
+static int
+#endif
+sort_order_compare( const void *g1, const void *g2 ) {
+  GameType *game1 = (GameType *) *((GameType **) g1);
+  GameType *game2 = (GameType *) *((GameType **) g2);
+
+  return game1->sort_order - game2->sort_order;
+}
+
+
+/*
+  FILL_GAME_TABLE
+  Enumerates all loaded games; the position in the table is the
+  game ID used by the position index.
+*/
+
+static void
+fill_game_table( void ) {
+  int i, j;
+  DatabaseType *current_db;
+
+  if ( position_index.game_table != NULL )
+    free( position_index.game_table );
+  position_index.game_table =
+    (GameType **) safe_malloc( (thor_game_count + 1) * sizeof( GameType * ) );
+
+  current_db = database_head;
+  i = 0;
+  while ( current_db != NULL ) {
+    for ( j = 0; j < current_db->count; j++ ) {
+      position_index.game_table[i] = &current_db->games[j];
+      i++;
+    }
+    current_db = current_db->next;
+  }
+}
+
+
+/*
+  COLLECT_INDEX_ENTRIES
+  Plays through all games and stores the canonical hash code of
+  every position reached together with the ID of the game.
+  Returns the number of entries stored.
+*/
+
+static int
+collect_index_entries( void ) {
+  int i, j;
+  int count;
+  int move;
+  int color;
+  GameType *game;
+
+  count = 0;
+  for ( i = 0; i < thor_game_count; i++ ) {
+    game = position_index.game_table[i];
+    clear_thor_board( &thor_state );
+    for ( j = 0; ; j++ ) {
+      compute_thor_patterns( &thor_state, thor_state.board );
+      position_index.entry[count].hash = compute_canonical_hash( &thor_state );
+      position_index.entry[count].game = i;
+      count++;
+      if ( j == game->move_count )
+	break;
+      move = abs( (int) game->moves[j] );
+      color = (game->moves[j] > 0) ? BLACKSQ : WHITESQ;
+      (void) count_flips( &thor_state, move, color, OPP( color ) );
+      thor_state.board[move] = color;
+    }
+  }
+
+  /* Sort the entries and remove duplicate (hash, game) pairs which
+     could otherwise make one game match a position twice. */
+
+  qsort( position_index.entry, count, sizeof( PositionIndexEntry ),
+	 index_compare );
+  if ( count > 0 ) {
+    j = 0;
+    for ( i = 1; i < count; i++ )
+      if ( index_compare( &position_index.entry[i],
+			  &position_index.entry[j] ) != 0 ) {
+	j++;
+	position_index.entry[j] = position_index.entry[i];
+      }
+    count = j + 1;
+  }
+
+  return count;
+}
+
+
+/*
+  WRITE_INDEX_HEADER
+  CHECK_INDEX_HEADER
+  The index file starts with a header which identifies the set of
+  game databases from which it was built. An index is only reused
+  if all databases coincide, in the same order.
+*/
+
+static int
+write_index_header( FILE *stream ) {
+  int header[6];
+  DatabaseType *current_db;
+
+  header[0] = THOR_INDEX_MAGIC;
+  header[1] = THOR_INDEX_VERSION;
+  header[2] = thor_database_count;
+  header[3] = thor_game_count;
+  if ( fwrite( header, sizeof( int ), 4, stream ) != 4 )
+    return FALSE;
+
+  current_db = database_head;
+  while ( current_db != NULL ) {
+    header[0] = current_db->prolog.creation_century;
+    header[1] = current_db->prolog.creation_year;
+    header[2] = current_db->prolog.creation_month;
+    header[3] = current_db->prolog.creation_day;
+    header[4] = current_db->prolog.origin_year;
+    header[5] = current_db->count;
+    if ( fwrite( header, sizeof( int ), 6, stream ) != 6 )
+      return FALSE;
+    current_db = current_db->next;
+  }
+
+  return TRUE;
+}
+
+static int
+check_index_header( FILE *stream ) {
+  int header[6];
+  DatabaseType *current_db;
+
+  if ( fread( header, sizeof( int ), 4, stream ) != 4 )
+    return FALSE;
+  if ( (header[0] != THOR_INDEX_MAGIC) || (header[1] != THOR_INDEX_VERSION) ||
+       (header[2] != thor_database_count) || (header[3] != thor_game_count) )
+    return FALSE;
+
+  current_db = database_head;
+  while ( current_db != NULL ) {
+    if ( fread( header, sizeof( int ), 6, stream ) != 6 )
+      return FALSE;
+    if ( (header[0] != current_db->prolog.creation_century) ||
+	 (header[1] != current_db->prolog.creation_year) ||
+	 (header[2] != current_db->prolog.creation_month) ||
+	 (header[3] != current_db->prolog.creation_day) ||
+	 (header[4] != current_db->prolog.origin_year) ||
+	 (header[5] != current_db->count) )
+      return FALSE;
+    current_db = current_db->next;
+  }
+
+  return TRUE;
+}
+
+
+/*
+  READ_THOR_INDEX
+  Tries to read the position index from FILE_NAME.
+  Returns TRUE if a valid index for the loaded databases was found.
+*/
+
+static int
+read_thor_index( const char *file_name ) {
+  FILE *stream;
+  int i;
+  int count;
+  int success;
+
+  stream = fopen( file_name, "rb" );
+  if ( stream == NULL )
+    return FALSE;
+
+  success = check_index_header( stream ) &&
+    (fread( &count, sizeof( int ), 1, stream ) == 1) &&
+    (count >= 0) && (count <= 61 * thor_game_count);
+  if ( success ) {
+    position_index.entry = (PositionIndexEntry *)
+      safe_malloc( (count + 1) * sizeof( PositionIndexEntry ) );
+    success =
+      (fread( position_index.entry, sizeof( PositionIndexEntry ), count,
+	      stream ) == (size_t) count);
+    for ( i = 0; success && (i < count); i++ )
+      if ( (position_index.entry[i].game < 0) ||
+	   (position_index.entry[i].game >= thor_game_count) )
+	success = FALSE;
+    if ( success )
+      position_index.count = count;
+    else {
+      free( position_index.entry );
+      position_index.entry = NULL;
+    }
+  }
+
+  fclose( stream );
+
+  return success;
+}
+
+
+/*
+  WRITE_THOR_INDEX
+  Saves the position index to FILE_NAME.
+  Returns TRUE upon success, otherwise FALSE.
+*/
+
+static int
+write_thor_index( const char *file_name ) {
+  FILE *stream;
+  int success;
+
+  stream = fopen( file_name, "wb" );
+  if ( stream == NULL )
+    return FALSE;
+
+  success = write_index_header( stream ) &&
+    (fwrite( &position_index.count, sizeof( int ), 1, stream ) == 1) &&
+    (fwrite( position_index.entry, sizeof( PositionIndexEntry ),
+	     position_index.count, stream ) ==
+     (size_t) position_index.count);
+
+  if ( fclose( stream ) != 0 )
+    success = FALSE;
+
+  return success;
+}
+
+
+/*
+  BUILD_THOR_INDEX
+  Creates the index from symmetry-canonical position hash codes to
+  the games in which the positions occur. If FILE_NAME is not NULL,
+  the index is read from that file when it was built from the
+  databases currently loaded; otherwise it is computed and saved there.
+  Returns TRUE if the index was read from or saved to FILE_NAME.
+*/
+
+int
+build_thor_index( const char *file_name ) {
+  int success;
+
+  if ( position_index.entry != NULL ) {
+    free( position_index.entry );
+    position_index.entry = NULL;
+  }
+  position_index.count = 0;
+
+  prepare_all_databases();
+  fill_game_table();
+
+  success = FALSE;
+  if ( file_name != NULL )
+    success = read_thor_index( file_name );
+  if ( !success ) {
+    position_index.entry = (PositionIndexEntry *)
+      safe_malloc( (61 * thor_game_count + 1) *
+		   sizeof( PositionIndexEntry ) );
+    position_index.count = collect_index_entries();
+    position_index.entry = (PositionIndexEntry *)
+      safe_realloc( position_index.entry, (position_index.count + 1) *
+		    sizeof( PositionIndexEntry ) );
+    if ( file_name != NULL )
+      success = write_thor_index( file_name );
+  }
+
+  position_index.valid = TRUE;
+
+  return success;
+}
+
+
+/*
+  FIND_INDEX_ENTRY
+  Returns the index of the first entry with a hash code larger than
+  HASH_VAL, or larger than or equal to HASH_VAL if INCLUSIVE is set.
+*/
+
+static int
+find_index_entry( unsigned int hash_val, int inclusive ) {
+  int low, high, mid;
+
+  low = 0;
+  high = position_index.count;
+  while ( low < high ) {
+    mid = low + (high - low) / 2;
+    if ( (position_index.entry[mid].hash < hash_val) ||
+	 (!inclusive && (position_index.entry[mid].hash == hash_val)) )
+      low = mid + 1;
+    else
+      high = mid;
+  }
+
+  return low;
+}
+
+
+/*
+  SCAN_CANDIDATES
+  Examines the games referenced by the index entries in the part of
+  the index given by TASK and collects the matching games and partial
+  statistics in TASK. Each thread is given a separate part.
+*/
+
+static void *
+scan_candidates( void *task ) {
+  int i;
+  int symmetry, next_move;
+  GameType *game;
+  ThorScanType *scan = (ThorScanType *) task;
+
+  scan->match_count = 0;
+
+  for ( i = 0; i <= 64; i++ )
+    scan->frequency[i] = 0;
+
+  for ( i = 0; i < 100; i++ ) {
+    scan->next_move_frequency[i] = 0;
+    scan->next_move_score[i] = 0.0;
+  }
+
+  for ( i = scan->first_entry; i < scan->last_entry; i++ ) {
+    game = position_index.game_table[position_index.entry[i].game];
+    if ( game->passes_filter )
+      if ( position_match( &scan->state, game, scan->move_count,
+			   scan->side_to_move, scan->shape_lo, scan->shape_hi,
+			   scan->corner_mask, scan->hash1, scan->hash2 ) ) {
+	if ( scan->scatter )
+	  thor_search.match_list[game->sort_order] = game;
+	else
+	  scan->match_list[scan->match_count] = game;
+	symmetry = game->matching_symmetry;
+	if ( scan->move_count < game->move_count ) {
+	  next_move =
+	    symmetry_map[symmetry][abs( (int) game->moves[scan->move_count])];
+	  scan->next_move_frequency[next_move]++;
+	  if ( game->actual_black_score == 32 )
+	    scan->next_move_score[next_move] += 0.5;
+	  else if ( game->actual_black_score > 32 ) {
+	    if ( scan->side_to_move == BLACKSQ )
+	      scan->next_move_score[next_move] += 1.0;
+	  }
+	  else {
+	    if ( scan->side_to_move == WHITESQ )
+	      scan->next_move_score[next_move] += 1.0;
+	  }
+	}
+	scan->frequency[game->actual_black_score]++;
+	scan->match_count++;
+      }
+  }
+
+  return NULL;
+}
+
+
 /*
   DATABASE_SEARCH
   Determines what positions in the Thor database match the position
@@ -2010,14 +2700,17 @@ database_search( int *in_board,
   int pos;
   int sum;
   int move_count;
-  int symmetry, next_move;
+  int first_entry, last_entry;
+  int scatter;
+  int task, task_count;
   int disc_count[3];
   int frequency[65], cumulative[65];
   unsigned int target_hash1, target_hash2;
+  unsigned int canonical_hash;
   unsigned int corner_mask;
   unsigned int shape_lo[8], shape_hi[8];
   DatabaseType *current_db;
-  GameType *game;
+  ThorScanType *scan;
 
   /* We need a player and a tournament database. */
 
@@ -2041,6 +2734,11 @@ database_search( int *in_board,
     thor_search.allocation = thor_game_count;
   }
 
+  /* If necessary, index the positions of all games */
+
+  if ( !position_index.valid )
+    (void) build_thor_index( NULL );
+
   /* If necessary, filter all games in the database */
 
   if ( !thor_games_filtered ) {
@@ -2081,8 +2779,9 @@ database_search( int *in_board,
 	disc_count[WHITESQ]++;
 
   move_count = disc_count[BLACKSQ] + disc_count[WHITESQ] - 4;
-  compute_thor_patterns( in_board );
-  compute_partial_hash( &target_hash1, &target_hash2 );
+  compute_thor_patterns( &thor_state, in_board );
+  compute_partial_hash( &thor_state, &target_hash1, &target_hash2 );
+  canonical_hash = compute_canonical_hash( &thor_state );
   opening_scan( move_count );
 
   /* Determine the shape masks */
@@ -2141,18 +2840,54 @@ database_search( int *in_board,
   corner_mask = get_corner_mask( in_board[11], in_board[81],
 				 in_board[18], in_board[88] );
 
-  /* Query the database about all positions in all databases.
-     Only games which pass the currently applied filter are scanned.
+  /* Query the position index for the games in which a position with
+     the same canonical hash code occurs; only these games, and only
+     those which pass the currently applied filter, are examined.
      Also compute the frequency table and the next move table.
-     To speed up sorting the games, the match table is first filled
-     with NULLs and when a matching game is found, a pointer to it is
-     inserted at a position determined by the field SORT_ORDER
-     in the game. As this index is unique, no over-write
-     can occur. */
+     When a large part of the games are candidates, the match table
+     is first filled with NULLs and a pointer to each matching game
+     is inserted at the position determined by its (unique) field
+     SORT_ORDER; otherwise the matches are stored consecutively
+     and sorted afterwards.
+     Large sets of candidates are split between several threads whose
+     partial results are merged in a fixed order, so the result does
+     not depend on the number of threads. */
+
+  first_entry = find_index_entry( canonical_hash, TRUE );
+  last_entry = find_index_entry( canonical_hash, FALSE );
+  scatter = (8 * (last_entry - first_entry) > thor_game_count);
+
+  if ( scatter )
+    for ( i = 0; i < thor_game_count; i++ )
+      thor_search.match_list[i] = NULL;
+
+  task_count = get_thor_task_count( last_entry - first_entry );
+  for ( task = 0; task < task_count; task++ ) {
+    scan = &thor_scan[task];
+    scan->state = thor_state;
+    scan->first_entry = first_entry +
+      (int) (((double) (last_entry - first_entry) * task) / task_count);
+    scan->last_entry = first_entry +
+      (int) (((double) (last_entry - first_entry) * (task + 1)) /
+	     task_count);
+    scan->move_count = move_count;
+    scan->side_to_move = side_to_move;
+    scan->scatter = scatter;
+    scan->shape_lo = shape_lo;
+    scan->shape_hi = shape_hi;
+    scan->corner_mask = corner_mask;
+    scan->hash1 = target_hash1;
+    scan->hash2 = target_hash2;
+    scan->match_list =
+      thor_search.match_list + (scan->first_entry - first_entry);
+  }
+
+  run_thor_threads( scan_candidates, thor_scan, sizeof( ThorScanType ),
+		    task_count );
+
+  /* Merge the partial results */
 
   thor_search.match_count = 0;
-  for ( i = 0; i < thor_game_count; i++ )
-    thor_search.match_list[i] = NULL;
 
   for ( i = 0; i <= 64; i++ )
     frequency[i] = 0;
@@ -2162,55 +2897,40 @@ database_search( int *in_board,
     thor_search.next_move_score[i] = 0.0;
   }
 
-  current_db = database_head;
-  while ( current_db != NULL ) {
-    for ( i = 0; i < current_db->count; i++ ) {
-      game = &current_db->games[i];
-      if ( game->passes_filter ) {
-	if ( disc_count[BLACKSQ] == game->black_disc_count[move_count] )
-	  if ( position_match( game, move_count, side_to_move, shape_lo,
-			       shape_hi, corner_mask, target_hash1,
-			       target_hash2 ) ) {
-	    thor_search.match_list[game->sort_order] = game;
-	    symmetry = game->matching_symmetry;
-	    if ( move_count < game->move_count ) {
-	      next_move =
-		symmetry_map[symmetry][abs( (int) game->moves[move_count])];
-	      thor_search.next_move_frequency[next_move]++;
-	      if ( game->actual_black_score == 32 )
-		thor_search.next_move_score[next_move] += 0.5;
-	      else if ( game->actual_black_score > 32 ) {
-		if ( side_to_move == BLACKSQ )
-		  thor_search.next_move_score[next_move] += 1.0;
-	      }
-	      else {
-		if ( side_to_move == WHITESQ )
-		  thor_search.next_move_score[next_move] += 1.0;
-	      }
-	    }
-	    frequency[game->actual_black_score]++;
-	    thor_search.match_count++;
-	  }
-      }
+  for ( task = 0; task < task_count; task++ ) {
+    scan = &thor_scan[task];
+    if ( !scatter )
+      memmove( thor_search.match_list + thor_search.match_count,
+	       scan->match_list, scan->match_count * sizeof( GameType * ) );
+    thor_search.match_count += scan->match_count;
+    for ( i = 0; i <= 64; i++ )
+      frequency[i] += scan->frequency[i];
+    for ( i = 0; i < 100; i++ ) {
+      thor_search.next_move_frequency[i] += scan->next_move_frequency[i];
+      thor_search.next_move_score[i] += scan->next_move_score[i];
     }
-    current_db = current_db->next;
   }
 
-  /* Remove the NULLs from the list of matching games if there are any.
-     This gives a sorted list. */
-
-  if ( (thor_search.match_count > 0) &&
-       (thor_search.match_count < thor_game_count) ) {
-    i = 0;
-    j = 0;
-    while ( i < thor_search.match_count ) {
-      if ( thor_search.match_list[j] != NULL ) {
-	thor_search.match_list[i] = thor_search.match_list[j];
-	i++;
+  /* Put the matching games in the order given by the field SORT_ORDER;
+     in scatter mode this amounts to removing the NULLs from the list. */
+
+  if ( scatter ) {
+    if ( (thor_search.match_count > 0) &&
+	 (thor_search.match_count < thor_game_count) ) {
+      i = 0;
+      j = 0;
+      while ( i < thor_search.match_count ) {
+	if ( thor_search.match_list[j] != NULL ) {
+	  thor_search.match_list[i] = thor_search.match_list[j];
+	  i++;
+	}
+	j++;
       }
-      j++;
     }
   }
+  else if ( thor_search.match_count > 1 )
+    qsort( thor_search.match_list, thor_search.match_count,
+	   sizeof( GameType * ), sort_order_compare );
 
   /* Count the number of black wins, draws and white wins.
      Also determine the average score. */
@@ -2665,9 +3385,9 @@ build_thor_opening_tree( void ) {
   /* Create the root node and compute its hash value */
 
   root_node = new_thor_opening_node( NULL );
-  clear_thor_board();
-  compute_thor_patterns( thor_board );
-  compute_partial_hash( &hash1, &hash2 );
+  clear_thor_board( &thor_state );
+  compute_thor_patterns( &thor_state, thor_state.board );
+  compute_partial_hash( &thor_state, &hash1, &hash2 );
   root_node->hash1 = hash1;
   root_node->hash2 = hash2;
   node_list[0] = root_node;
@@ -2685,23 +3405,24 @@ build_thor_opening_tree( void ) {
     /* Play through the moves common with the previous line
        and the first deviation */
 
-    clear_thor_board();
-    thor_side_to_move = BLACKSQ;
+    clear_thor_board( &thor_state );
+    thor_state.side_to_move = BLACKSQ;
 
     for ( j = 0; j <= branch_depth; j++ ) {
       move = thor_move_list[j];
-      flipped = any_flips( move, thor_side_to_move, OPP( thor_side_to_move ) );
+      flipped = any_flips( &thor_state, move, thor_state.side_to_move,
+			   OPP( thor_state.side_to_move ) );
       if ( flipped ) {
-	thor_board[move] = thor_side_to_move;
-	thor_side_to_move = OPP( thor_side_to_move );
+	thor_state.board[move] = thor_state.side_to_move;
+	thor_state.side_to_move = OPP( thor_state.side_to_move );
       }
       else {
-	thor_side_to_move = OPP( thor_side_to_move );
-	flipped = any_flips( move, thor_side_to_move,
-			     OPP( thor_side_to_move ) );
+	thor_state.side_to_move = OPP( thor_state.side_to_move );
+	flipped = any_flips( &thor_state, move, thor_state.side_to_move,
+			     OPP( thor_state.side_to_move ) );
 	if ( flipped ) {
-	  thor_board[move] = thor_side_to_move;
-	  thor_side_to_move = OPP( thor_side_to_move );
+	  thor_state.board[move] = thor_state.side_to_move;
+	  thor_state.side_to_move = OPP( thor_state.side_to_move );
 	}
 	else {
 #ifdef TEXT_BASED
@@ -2715,8 +3436,8 @@ build_thor_opening_tree( void ) {
 
     parent = node_list[branch_depth];
     new_child = new_thor_opening_node( parent );
-    compute_thor_patterns( thor_board );
-    compute_partial_hash( &hash1, &hash2 );
+    compute_thor_patterns( &thor_state, thor_state.board );
+    compute_partial_hash( &thor_state, &hash1, &hash2 );
     new_child->hash1 = hash1;
     new_child->hash2 = hash2;
     if ( parent->child_node == NULL ) {
@@ -2737,18 +3458,19 @@ build_thor_opening_tree( void ) {
 
     for ( j = branch_depth + 1; j < end_depth; j++ ) {
       move = thor_move_list[j];
-      flipped = any_flips( move, thor_side_to_move, OPP( thor_side_to_move ) );
+      flipped = any_flips( &thor_state, move, thor_state.side_to_move,
+			   OPP( thor_state.side_to_move ) );
       if ( flipped ) {
-	thor_board[move] = thor_side_to_move;
-	thor_side_to_move = OPP( thor_side_to_move );
+	thor_state.board[move] = thor_state.side_to_move;
+	thor_state.side_to_move = OPP( thor_state.side_to_move );
       }
       else {
-	thor_side_to_move = OPP( thor_side_to_move );
-	flipped = any_flips( move, thor_side_to_move,
-			     OPP( thor_side_to_move ) );
+	thor_state.side_to_move = OPP( thor_state.side_to_move );
+	flipped = any_flips( &thor_state, move, thor_state.side_to_move,
+			     OPP( thor_state.side_to_move ) );
 	if ( flipped ) {
-	  thor_board[move] = thor_side_to_move;
-	  thor_side_to_move = OPP( thor_side_to_move );
+	  thor_state.board[move] = thor_state.side_to_move;
+	  thor_state.side_to_move = OPP( thor_state.side_to_move );
 	}
 	else {
 #ifdef TEXT_BASED
@@ -2758,8 +3480,8 @@ build_thor_opening_tree( void ) {
       }
       parent = new_child;
       new_child = new_thor_opening_node( parent );
-      compute_thor_patterns( thor_board );
-      compute_partial_hash( &hash1, &hash2 );
+      compute_thor_patterns( &thor_state, thor_state.board );
+      compute_partial_hash( &thor_state, &hash1, &hash2 );
       new_child->hash1 = hash1;
       new_child->hash2 = hash2;
       parent->child_node = new_child;
@@ -2775,6 +3497,42 @@ build_thor_opening_tree( void ) {
 }
 
 
+/*
+  GET_THOR_OPENING_COUNT
+  Returns the number of lines in THOR_OPENING_LIST.
+*/
+
+int
+get_thor_opening_count( void ) {
+  return THOR_LINE_COUNT;
+}
+
+
+/*
+  GET_THOR_OPENING_LINE
+  Stores the moves of line INDEX in THOR_OPENING_LIST in MOVES
+  and returns the number of moves.
+*/
+
+int
+get_thor_opening_line( int index, int *moves ) {
+  int i, j;
+  int branch_depth, end_depth;
+
+  end_depth = 0;
+  for ( i = 0; (i <= index) && (i < THOR_LINE_COUNT); i++ ) {
+    branch_depth = thor_opening_list[i].first_unique;
+    end_depth = branch_depth + strlen( thor_opening_list[i].move_str ) / 2;
+    for ( j = 0; j < end_depth - branch_depth; j++ )
+      moves[branch_depth + j] =
+	10 * (thor_opening_list[i].move_str[2 * j + 1] - '0') +
+	( thor_opening_list[i].move_str[2 * j] - 'a' + 1 );
+  }
+
+  return end_depth;
+}
+
+
 /*
   PRINT_THOR_OPENING_TREE
 */
@@ -2891,6 +3649,8 @@ frequency_analysis( int game_count ) {
 
   list = (MoveListType *) safe_malloc( game_count * sizeof( MoveListType ) );
 
+  prepare_all_databases();
+
   current_db = database_head;
   game_index = 0;
   while ( current_db != NULL ) {
@@ -2929,6 +3689,18 @@ get_thor_game_size( void ) {
 }
 
 
+/*
+  SET_THOR_THREAD_COUNT
+  Specifies the maximum number of threads used to filter and
+  search the games.
+*/
+
+void
+set_thor_thread_count( int thread_count ) {
+  thor_thread_count = MAX( 1, MIN( thread_count, MAX_THOR_THREADS ) );
+}
+
+
 /*
   INIT_THOR_DATABASE
   Performs the basic initializations of the Thor database interface.
@@ -2958,6 +3730,11 @@ init_thor_database( void ) {
 
   database_head = NULL;
 
+  position_index.valid = FALSE;
+  position_index.count = 0;
+  position_index.entry = NULL;
+  position_index.game_table = NULL;
+
   players.name_buffer = NULL;
   players.player_list = NULL;
   players.count = 0;
@@ -2969,6 +3746,12 @@ init_thor_database( void ) {
   thor_games_sorted = FALSE;
   thor_games_filtered = FALSE;
 
+#ifdef __linux__
+  set_thor_thread_count( sysconf( _SC_NPROCESSORS_ONLN ) );
+#else
+  set_thor_thread_count( 1 );
+#endif
+
   init_move_masks();
 
   init_symmetry_maps();
@@ -108,6 +108,12 @@ get_database_info( DatabaseInfoType *info );
 int
 choose_thor_opening_move( int *in_board, int side_to_move, int echo );
 
+int
+get_thor_opening_count( void );
+
+int
+get_thor_opening_line( int index, int *moves );
+
 void
 set_player_filter( int *selected );
 
@@ -126,6 +132,12 @@ specify_game_categories( int categories );
 void
 database_search( int *in_board, int side_to_move );
 
+int
+build_thor_index( const char *file_name );
+
+void
+set_thor_thread_count( int thread_count );
+
 void
 init_thor_database( void );
 
@@ -13,11 +13,19 @@
 
 
 
-/* CRON_SUPPORTED should be enabled when Zebra is compiled for
-   a Unix system which supports the Cron daemon. */
+/* MONOTONIC_SUPPORTED should be enabled when Zebra is compiled for
+   a POSIX system which supports clock_gettime(CLOCK_MONOTONIC).
+   WATCHDOG_SUPPORTED additionally requires POSIX threads; a watchdog
+   thread then raises a flag when the panic time has passed so that
+   the search only has to read the flag. Android only has
+   pthread_condattr_setclock() from API level 21; older targets use
+   the polling timer. */
 
 #ifdef __linux__
-#define CRON_SUPPORTED
+#define MONOTONIC_SUPPORTED
+#if !defined( __ANDROID__ ) || (__ANDROID_API__ >= 21)
+#define WATCHDOG_SUPPORTED
+#endif
 #endif
 
 /* GTC_SUPPORTED should be enabled when Zebra is compiled for
@@ -37,8 +45,11 @@
 #include <time.h>
 #endif
 
-#ifdef CRON_SUPPORTED
-#include <sys/time.h>
+#ifdef MONOTONIC_SUPPORTED
+#include <time.h>
+#ifdef WATCHDOG_SUPPORTED
+#include <pthread.h>
+#endif
 #else
 #ifdef GTC_SUPPORTED
 
@@ -85,8 +96,8 @@ static double ponder_time[100];
 static int panic_abort;
 static int do_check_abort = TRUE;
 
-#ifdef CRON_SUPPORTED
-static struct itimerval saved_real_timer;
+#ifdef MONOTONIC_SUPPORTED
+static double init_seconds;
 #else
 #ifdef GTC_SUPPORTED
 static int init_ticks;
@@ -95,6 +106,38 @@ static time_t init_time;
 #endif
 #endif
 
+#ifdef WATCHDOG_SUPPORTED
+/* The watchdog deadline when no time control is active */
+#define NO_DEADLINE              1.0e30
+
+/* The watchdog state is protected by WATCHDOG_MUTEX except
+   TIME_EXPIRED which is only accessed atomically. */
+static pthread_mutex_t watchdog_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t watchdog_cond;
+static double watchdog_deadline = NO_DEADLINE;
+static int watchdog_running = FALSE;
+static int watchdog_failed = FALSE;
+static int watchdog_atfork = FALSE;
+static int time_expired = FALSE;
+#endif
+
+
+
+#ifdef MONOTONIC_SUPPORTED
+/*
+  MONOTONIC_SECONDS
+  Returns the time in seconds according to the monotonic clock
+  which isn't affected by changes to the system time.
+*/
+
+static double
+monotonic_seconds( void ) {
+  struct timespec t;
+
+  clock_gettime( CLOCK_MONOTONIC, &t );
+  return t.tv_sec + t.tv_nsec / 1000000000.0;
+}
+#endif
 
 
 /*
@@ -103,8 +146,8 @@ static time_t init_time;
 
 void
 reset_real_timer( void ) {
-#ifdef CRON_SUPPORTED
-  getitimer( ITIMER_REAL, &saved_real_timer );
+#ifdef MONOTONIC_SUPPORTED
+  init_seconds = monotonic_seconds();
 #else
 #ifdef GTC_SUPPORTED
   init_ticks = GetTickCount();
@@ -117,23 +160,11 @@ reset_real_timer( void ) {
 
 /*
   INIT_TIMER
-  Initializes the timer. This is really only needed when
-  CRON_SUPPORTED is defined; in this case the cron daemon
-  is used for timing.
+  Initializes the timer.
 */
 
 void
 init_timer( void ) {
-#ifdef CRON_SUPPORTED
-  struct itimerval t;
-
-  t.it_value.tv_sec  = 1000000;
-  t.it_value.tv_usec = 0;
-  t.it_interval.tv_sec  = 0;
-  t.it_interval.tv_usec = 0;
-  saved_real_timer = t;
-  setitimer( ITIMER_REAL, &t, NULL );
-#endif
   reset_real_timer();
 }
 
@@ -145,12 +176,8 @@ init_timer( void ) {
 
 double
 get_real_timer( void ) {
-#ifdef CRON_SUPPORTED
-  struct itimerval t;
-
-  getitimer( ITIMER_REAL, &t );
-  return (saved_real_timer.it_value.tv_sec  - t.it_value.tv_sec)
-    + (saved_real_timer.it_value.tv_usec - t.it_value.tv_usec) / 1000000.0;
+#ifdef MONOTONIC_SUPPORTED
+  return monotonic_seconds() - init_seconds;
 #else
 #ifdef GTC_SUPPORTED
   int ticks;
@@ -168,6 +195,163 @@ get_real_timer( void ) {
 }
 
 
+/*
+  GET_CYCLE_COUNT
+  Returns the processor's time stamp counter, or 0 where it
+  can't be read. Only meaningful as a difference between two
+  calls on the same processor.
+*/
+
+unsigned long long
+get_cycle_count( void ) {
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+  unsigned int lo, hi;
+
+  /* "=A" would only mean edx:eax on i386; on x86-64 it picks
+     one of rax and rdx */
+  asm volatile( "rdtsc" : "=a" (lo), "=d" (hi) );
+  return ((unsigned long long) hi << 32) | lo;
+#else
+  return 0;
+#endif
+}
+
+
+#ifdef WATCHDOG_SUPPORTED
+/*
+  WATCHDOG_MAIN
+  The watchdog thread. Sleeps until the deadline and then
+  raises the TIME_EXPIRED flag.
+*/
+
+static void *
+watchdog_main( void *arg ) {
+  struct timespec t;
+  double deadline;
+
+  (void) arg;
+  pthread_mutex_lock( &watchdog_mutex );
+  for ( ; ; ) {
+    deadline = watchdog_deadline;
+    if ( deadline == NO_DEADLINE )
+      pthread_cond_wait( &watchdog_cond, &watchdog_mutex );
+    else if ( monotonic_seconds() >= deadline ) {
+      __atomic_store_n( &time_expired, TRUE, __ATOMIC_RELAXED );
+      watchdog_deadline = NO_DEADLINE;
+    }
+    else {
+      t.tv_sec = (time_t) floor( deadline );
+      t.tv_nsec = (long) ((deadline - t.tv_sec) * 1000000000.0);
+      if ( t.tv_nsec > 999999999 )
+	t.tv_nsec = 999999999;
+      pthread_cond_timedwait( &watchdog_cond, &watchdog_mutex, &t );
+    }
+  }
+
+  return NULL;
+}
+
+
+/*
+  WATCHDOG_PREPARE
+  WATCHDOG_PARENT
+  WATCHDOG_CHILD
+  Fork handlers. Only the forking thread survives in the child,
+  so the child starts a watchdog of its own when it needs one.
+*/
+
+static void
+watchdog_prepare( void ) {
+  pthread_mutex_lock( &watchdog_mutex );
+}
+
+static void
+watchdog_parent( void ) {
+  pthread_mutex_unlock( &watchdog_mutex );
+}
+
+static void
+watchdog_child( void ) {
+  watchdog_running = FALSE;
+  pthread_mutex_unlock( &watchdog_mutex );
+}
+
+
+/*
+  START_WATCHDOG
+  Starts the watchdog thread unless it is already running.
+  Returns TRUE if a watchdog is running.
+*/
+
+static int
+start_watchdog( void ) {
+  pthread_condattr_t attr;
+  pthread_t thread;
+
+  if ( watchdog_running || watchdog_failed )
+    return watchdog_running;
+
+  /* The deadlines are given on the monotonic clock */
+  if ( pthread_condattr_init( &attr ) != 0 ) {
+    watchdog_failed = TRUE;
+    return FALSE;
+  }
+  if ( (pthread_condattr_setclock( &attr, CLOCK_MONOTONIC ) == 0) &&
+       (pthread_cond_init( &watchdog_cond, &attr ) == 0) ) {
+    if ( pthread_create( &thread, NULL, watchdog_main, NULL ) == 0 ) {
+      pthread_detach( thread );
+      watchdog_running = TRUE;
+    }
+    else
+      pthread_cond_destroy( &watchdog_cond );
+  }
+  pthread_condattr_destroy( &attr );
+
+  if ( !watchdog_running )
+    watchdog_failed = TRUE;
+  else if ( !watchdog_atfork ) {
+    pthread_atfork( watchdog_prepare, watchdog_parent, watchdog_child );
+    watchdog_atfork = TRUE;
+  }
+
+  return watchdog_running;
+}
+
+
+/*
+  ARM_WATCHDOG
+  Hands the current panic deadline to the watchdog. Must be called
+  whenever anything which CHECK_PANIC_ABORT depends on changes.
+*/
+
+static void
+arm_watchdog( void ) {
+  double now, deadline;
+
+  if ( !start_watchdog() )
+    return;
+
+  now = monotonic_seconds();
+  if ( do_check_abort )
+    deadline = init_seconds + start_time + panic_value * total_move_time;
+  else
+    deadline = NO_DEADLINE;
+
+  pthread_mutex_lock( &watchdog_mutex );
+  if ( now >= deadline ) {
+    __atomic_store_n( &time_expired, TRUE, __ATOMIC_RELAXED );
+    watchdog_deadline = NO_DEADLINE;
+  }
+  else {
+    __atomic_store_n( &time_expired, FALSE, __ATOMIC_RELAXED );
+    watchdog_deadline = deadline;
+  }
+  pthread_cond_signal( &watchdog_cond );
+  pthread_mutex_unlock( &watchdog_mutex );
+}
+#endif
+
+
 /*
   SET_DEFAULT_PANIC
   Sets the panic timeout when search immediately must stop.
@@ -176,6 +360,9 @@ get_real_timer( void ) {
 void
 set_default_panic( void ) {
   panic_value = time_per_move * PANIC_FACTOR / total_move_time;
+#ifdef WATCHDOG_SUPPORTED
+  arm_watchdog();
+#endif
 }
 
 
@@ -236,6 +423,9 @@ start_move( double in_total_time, double increment, int discs ) {
   total_move_time = MAX( in_total_time - SAFETY_MARGIN, 0.1 );
   panic_abort = FALSE;
   start_time = get_real_timer();
+#ifdef WATCHDOG_SUPPORTED
+  arm_watchdog();
+#endif
 }
 
 
@@ -248,13 +438,17 @@ start_move( double in_total_time, double increment, int discs ) {
 void
 set_panic_threshold( double value ) {
   panic_value = value;
+#ifdef WATCHDOG_SUPPORTED
+  arm_watchdog();
+#endif
 }
 
 
 /*
   CHECK_PANIC_ABORT
   Checks if the alotted time has been used up and in this case
-  sets the PANIC_ABORT flags.
+  sets the PANIC_ABORT flags. When the watchdog is running this
+  only amounts to reading the flag it raises.
 */
 
 void
@@ -262,6 +456,14 @@ check_panic_abort( void ) {
   double curr_time;
   double adjusted_total_time;
 
+#ifdef WATCHDOG_SUPPORTED
+  if ( watchdog_running ) {
+    if ( __atomic_load_n( &time_expired, __ATOMIC_RELAXED ) )
+      panic_abort = TRUE;
+    return;
+  }
+#endif
+
   curr_time = get_elapsed_time();
   adjusted_total_time = total_move_time;
 
@@ -298,6 +500,9 @@ check_threshold( double threshold ) {
 void
 toggle_abort_check( int enable ) {
   do_check_abort = enable;
+#ifdef WATCHDOG_SUPPORTED
+  arm_watchdog();
+#endif
 }
 
 
@@ -69,6 +69,9 @@ get_real_timer( void );
 void
 reset_real_timer( void );
 
+unsigned long long
+get_cycle_count( void );
+
 double
 get_elapsed_time( void );
 
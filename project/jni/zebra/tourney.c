@@ -0,0 +1,975 @@
+/*
+   File:         tourney.c
+
+   Created:      October 19, 2026
+
+   Modified:
+
+   Contents:     A self-play tournament between two engine
+                 configurations, A and B, which may differ in search
+                 depths, coefficient file and Multi-ProbCut profile.
+                 Every opening is played twice with colors reversed.
+                 Several games are played at the same time; each game
+                 is played by one worker process per engine, and the
+                 two processes take turns through shared memory.
+                 The result is reported as a score, an Elo difference
+                 and a disc difference, optionally with a sequential
+                 probability ratio test which stops the tournament
+                 as soon as it is decided.
+*/
+
+
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/select.h>
+#include <sys/time.h>
+
+#include "constant.h"
+#include "counter.h"
+#include "display.h"
+#include "game.h"
+#include "getcoeff.h"
+#include "globals.h"
+#include "hash.h"
+#include "macros.h"
+#include "midgame.h"
+#include "moves.h"
+#include "myrandom.h"
+#include "parallel.h"
+#include "probcut.h"
+#include "safemem.h"
+#include "search.h"
+#include "thordb.h"
+#include "timer.h"
+
+
+
+#define DEFAULT_MID_DEPTH     6
+#define DEFAULT_EXACT_DEPTH   14
+#define DEFAULT_WLD_DEPTH     16
+#define DEFAULT_THOR_MOVES    8
+#define DEFAULT_HASH_BITS     18
+
+#define MAX_OPENINGS          10000
+
+/* Each game needs one worker process per engine */
+#define MAX_CONCURRENCY       (MAX_WORKER_COUNT / 2)
+
+/* The delay (in microseconds) between checks for a worker's turn */
+#define TURN_POLL_DELAY       200
+
+/* The side to move when neither side has a legal move */
+#define GAME_OVER             -2
+
+#define ENGINE_A              0
+#define ENGINE_B              1
+#define SLOT_CLOSED           2
+
+#define GAME_PENDING          0
+#define GAME_FINISHED         1
+
+
+
+typedef struct {
+  int mid;
+  int exact;
+  int wld;
+  const char *eval_file;
+  const char *probcut_file;
+  const char *probcut_profile;
+} EngineConfig;
+
+/* A game of the tournament. Even games have engine A as black. */
+typedef struct {
+  int opening;
+  int disc_diff;
+  int move_count;
+  volatile int state;
+  short moves[60];
+} TourneyGame;
+
+/* The game currently played by a pair of workers. TURN is the
+   engine to move or SLOT_CLOSED when there are no more games. */
+typedef struct {
+  volatile int turn;
+  int game;
+  int move_count;
+  short moves[60];
+} GameSlot;
+
+/* The search effort of a worker */
+typedef struct {
+  int move_count;
+  double nodes;
+  double time;
+} EngineStatistics;
+
+typedef struct {
+  int wins, draws, losses;
+  int game_count;
+  double disc_sum, disc_square_sum;
+} Result;
+
+/* The tournament. GAME, SLOT, STATISTICS, NEXT_GAME and STOP
+   live in shared memory. */
+typedef struct {
+  EngineConfig engine[2];
+  int slot_count;
+  int game_count;
+  TourneyGame *game;
+  GameSlot *slot;
+  EngineStatistics *statistics;
+  volatile int *next_game;
+  volatile int *stop;
+  int use_sprt;
+  double elo0, elo1;
+  double alpha, beta;
+  int reported_count;
+  int written_count;
+  FILE *log_stream;
+} Tourney;
+
+
+
+static int opening_count = 0;
+static short (*opening_move)[60] = NULL;
+static int *opening_length = NULL;
+
+
+
+/*
+   SIDE_WITH_MOVES
+   Returns SIDE_TO_MOVE if it has a legal move, otherwise its
+   opponent if that side can move, otherwise GAME_OVER.
+*/
+
+static int
+side_with_moves( int side_to_move ) {
+  generate_all( side_to_move );
+  if ( move_count[disks_played] > 0 )
+    return side_to_move;
+  generate_all( OPP( side_to_move ) );
+  if ( move_count[disks_played] > 0 )
+    return OPP( side_to_move );
+  return GAME_OVER;
+}
+
+
+/*
+   REPLAY_GAME
+   Plays the first MOVE_COUNT moves of GAME_MOVES from the initial
+   position, passing when a side has no legal move. Returns the side
+   to move afterwards, GAME_OVER if neither side can move or ILLEGAL
+   if one of the moves is illegal.
+*/
+
+static int
+replay_game( const short *game_moves, int move_count ) {
+  int i;
+  int side_to_move;
+
+  game_init( NULL, &side_to_move );
+  for ( i = 0; ; i++ ) {
+    side_to_move = side_with_moves( side_to_move );
+    if ( i == move_count )
+      return side_to_move;
+    if ( (side_to_move == GAME_OVER) ||
+	 !valid_move( game_moves[i], side_to_move ) )
+      return ILLEGAL;
+    (void) make_move( side_to_move, game_moves[i], TRUE );
+    side_to_move = OPP( side_to_move );
+  }
+}
+
+
+/*
+   PARSE_MOVE_STRING
+   Converts a move string such as f5d6C3 to a move list.
+   Returns the number of moves, or -1 if the string is invalid.
+*/
+
+static int
+parse_move_string( const char *move_string, short *moves ) {
+  int count;
+  int col, row;
+
+  count = 0;
+  while ( isalnum( move_string[2 * count] ) ) {
+    if ( count == 60 )
+      return -1;
+    col = tolower( move_string[2 * count] ) - 'a' + 1;
+    row = move_string[2 * count + 1] - '0';
+    if ( (col < 1) || (col > 8) || (row < 1) || (row > 8) )
+      return -1;
+    moves[count++] = 10 * row + col;
+  }
+
+  return count;
+}
+
+
+/*
+   ADD_OPENING
+   Adds an opening unless it is illegal, ends the game or
+   already is in the list.
+*/
+
+static void
+add_opening( const short *moves, int length ) {
+  int i;
+  int side_to_move;
+
+  side_to_move = replay_game( moves, length );
+  if ( (side_to_move == ILLEGAL) || (side_to_move == GAME_OVER) )
+    return;
+  for ( i = 0; i < opening_count; i++ )
+    if ( (opening_length[i] == length) &&
+	 !memcmp( opening_move[i], moves, length * sizeof( short ) ) )
+      return;
+  if ( opening_count == MAX_OPENINGS )
+    return;
+  memcpy( opening_move[opening_count], moves, length * sizeof( short ) );
+  opening_length[opening_count] = length;
+  opening_count++;
+}
+
+
+/*
+   READ_OPENING_FILE
+   Reads openings from a file where each line starts with a move
+   string, such as openings.txt. Other lines are ignored.
+*/
+
+static void
+read_opening_file( const char *file_name ) {
+  char buffer[1000];
+  int length;
+  short moves[60];
+  FILE *stream;
+
+  stream = fopen( file_name, "r" );
+  if ( stream == NULL ) {
+    fprintf( stderr, "Cannot open %s for reading.\n", file_name );
+    exit( EXIT_FAILURE );
+  }
+  while ( fgets( buffer, sizeof buffer, stream ) != NULL ) {
+    length = parse_move_string( buffer, moves );
+    if ( length > 0 )
+      add_opening( moves, length );
+  }
+  fclose( stream );
+}
+
+
+/*
+   READ_THOR_OPENINGS
+   Uses the first LENGTH moves of the lines in the opening tree
+   of the Thor module which have at least that many moves.
+*/
+
+static void
+read_thor_openings( int length ) {
+  int i, j;
+  int line_length;
+  int line[60];
+  short moves[60];
+
+  for ( i = 0; i < get_thor_opening_count(); i++ ) {
+    line_length = get_thor_opening_line( i, line );
+    if ( line_length < length )
+      continue;
+    for ( j = 0; j < length; j++ )
+      moves[j] = line[j];
+    add_opening( moves, length );
+  }
+}
+
+
+/*
+   SHUFFLE_OPENINGS
+   Puts the openings in a random order determined by the seed.
+*/
+
+static void
+shuffle_openings( int seed ) {
+  int i, j;
+  int length;
+  short moves[60];
+
+  my_srandom( seed );
+  for ( i = opening_count - 1; i > 0; i-- ) {
+    j = (my_random() >> 4) % (i + 1);
+    memcpy( moves, opening_move[i], sizeof moves );
+    memcpy( opening_move[i], opening_move[j], sizeof moves );
+    memcpy( opening_move[j], moves, sizeof moves );
+    length = opening_length[i];
+    opening_length[i] = opening_length[j];
+    opening_length[j] = length;
+  }
+}
+
+
+/*
+   CLAIM_GAME
+   Assigns the next game of the tournament to SLOT.
+   Returns FALSE if there are no more games to play.
+*/
+
+static int
+claim_game( Tourney *tourney, GameSlot *slot ) {
+  int game;
+  int opening;
+
+  if ( *tourney->stop )
+    return FALSE;
+  game = claim_next_job( tourney->next_game );
+  if ( game >= tourney->game_count )
+    return FALSE;
+
+  opening = tourney->game[game].opening;
+  slot->game = game;
+  slot->move_count = opening_length[opening];
+  memcpy( slot->moves, opening_move[opening],
+	  opening_length[opening] * sizeof( short ) );
+
+  return TRUE;
+}
+
+
+/*
+   FINISH_GAME
+   Records the result of the game in SLOT, which has just been
+   replayed to its final position.
+*/
+
+static void
+finish_game( Tourney *tourney, GameSlot *slot ) {
+  TourneyGame *game = &tourney->game[slot->game];
+  int disc_diff;
+
+  disc_diff = disc_count( BLACKSQ ) - disc_count( WHITESQ );
+  if ( slot->game % 2 == 1 )
+    disc_diff = -disc_diff;
+  game->disc_diff = disc_diff;
+  game->move_count = slot->move_count;
+  memcpy( game->moves, slot->moves, slot->move_count * sizeof( short ) );
+  __sync_synchronize();
+  game->state = GAME_FINISHED;
+}
+
+
+/*
+   ADVANCE_SLOT
+   Hands SLOT to the engine to move. Games which are over are
+   recorded and replaced by new games.
+*/
+
+static void
+advance_slot( Tourney *tourney, GameSlot *slot ) {
+  int side_to_move;
+  int a_is_black;
+
+  for ( ; ; ) {
+    side_to_move = replay_game( slot->moves, slot->move_count );
+    if ( side_to_move != GAME_OVER )
+      break;
+    finish_game( tourney, slot );
+    if ( !claim_game( tourney, slot ) ) {
+      __sync_synchronize();
+      slot->turn = SLOT_CLOSED;
+      return;
+    }
+  }
+
+  a_is_black = (slot->game % 2 == 0);
+  __sync_synchronize();
+  if ( (side_to_move == BLACKSQ) == a_is_black )
+    slot->turn = ENGINE_A;
+  else
+    slot->turn = ENGINE_B;
+}
+
+
+/*
+   SETUP_ENGINE
+   Applies the coefficient file and the Multi-ProbCut profile
+   of an engine configuration.
+*/
+
+static void
+setup_engine( const EngineConfig *config ) {
+  if ( config->eval_file != NULL ) {
+    set_coeff_file_name( config->eval_file );
+    init_coeffs();
+  }
+  if ( config->probcut_file != NULL )
+    (void) load_probcut_profile( config->probcut_file,
+				 config->probcut_profile );
+}
+
+
+/*
+   WAIT_FOR_TURN
+   Sleeps briefly while the other engine is thinking.
+*/
+
+static void
+wait_for_turn( void ) {
+  struct timeval delay;
+
+  delay.tv_sec = 0;
+  delay.tv_usec = TURN_POLL_DELAY;
+  select( 0, NULL, NULL, NULL, &delay );
+}
+
+
+/*
+   ENGINE_WORKER
+   Plays the moves of one engine in one game slot. The first
+   SLOT_COUNT workers are engine A, the others engine B.
+*/
+
+static void
+engine_worker( int worker_index, void *context ) {
+  Tourney *tourney = (Tourney *) context;
+  EngineConfig *config;
+  EngineStatistics *statistics;
+  EvaluationType eval_info;
+  GameSlot *slot;
+  int engine;
+  int turn;
+  int move;
+  int side_to_move;
+  int current_game;
+
+  engine = (worker_index < tourney->slot_count) ? ENGINE_A : ENGINE_B;
+  slot = &tourney->slot[worker_index % tourney->slot_count];
+  config = &tourney->engine[engine];
+  statistics = &tourney->statistics[worker_index];
+
+  /* Interval timers aren't inherited by the worker processes */
+
+  init_timer();
+  setup_engine( config );
+
+  current_game = -1;
+  for ( ; ; ) {
+    while ( ((turn = slot->turn) != engine) && (turn != SLOT_CLOSED) )
+      wait_for_turn();
+    if ( turn == SLOT_CLOSED )
+      break;
+    __sync_synchronize();
+
+    if ( slot->game != current_game ) {
+      setup_hash( TRUE );
+      current_game = slot->game;
+    }
+    side_to_move = replay_game( slot->moves, slot->move_count );
+
+    start_move( 100000, 0, disks_played + 4 );
+    move = compute_move( side_to_move, TRUE, 100000, 0, FALSE, FALSE,
+			 config->mid, config->exact, config->wld, FALSE,
+			 &eval_info );
+    statistics->time += total_time;
+    statistics->nodes += counter_value( &total_nodes );
+    statistics->move_count++;
+
+    slot->moves[slot->move_count++] = move;
+    advance_slot( tourney, slot );
+  }
+}
+
+
+/*
+   GATHER_RESULTS
+   Sums up the finished games from engine A's point of view.
+   Only games with engine A as black (COLOR = BLACKSQ), as white
+   (COLOR = WHITESQ) or all games (COLOR = EMPTY) are included.
+*/
+
+static void
+gather_results( const Tourney *tourney, int color, Result *result ) {
+  const TourneyGame *game;
+  int i;
+
+  memset( result, 0, sizeof( Result ) );
+  for ( i = 0; i < tourney->game_count; i++ ) {
+    game = &tourney->game[i];
+    if ( game->state != GAME_FINISHED )
+      continue;
+    if ( ((color == BLACKSQ) && (i % 2 == 1)) ||
+	 ((color == WHITESQ) && (i % 2 == 0)) )
+      continue;
+    if ( game->disc_diff > 0 )
+      result->wins++;
+    else if ( game->disc_diff == 0 )
+      result->draws++;
+    else
+      result->losses++;
+    result->disc_sum += game->disc_diff;
+    result->disc_square_sum += (double) game->disc_diff * game->disc_diff;
+    result->game_count++;
+  }
+}
+
+
+/*
+   GET_SCORE
+   Returns the score fraction of a result and the variance of
+   the score of a single game.
+*/
+
+static double
+get_score( const Result *result, double *variance ) {
+  double score;
+  int n = result->game_count;
+
+  if ( n == 0 ) {
+    *variance = 0.0;
+    return 0.5;
+  }
+  score = (result->wins + 0.5 * result->draws) / n;
+  *variance = (result->wins * (1.0 - score) * (1.0 - score) +
+	       result->draws * (0.5 - score) * (0.5 - score) +
+	       result->losses * score * score) / n;
+
+  return score;
+}
+
+
+/*
+   SCORE_TO_ELO
+   Converts a score fraction to an Elo difference.
+*/
+
+static double
+score_to_elo( double score ) {
+  score = MIN( MAX( score, 0.001 ), 0.999 );
+  return -400.0 * log10( 1.0 / score - 1.0 );
+}
+
+
+/*
+   ELO_TO_SCORE
+   Converts an Elo difference to the expected score fraction.
+*/
+
+static double
+elo_to_score( double elo ) {
+  return 1.0 / (1.0 + pow( 10.0, -elo / 400.0 ));
+}
+
+
+/*
+   GET_LLR
+   Returns the log-likelihood ratio of the hypotheses Elo = ELO1
+   and Elo = ELO0, using the normal approximation of the score.
+*/
+
+static double
+get_llr( const Result *result, double elo0, double elo1 ) {
+  double score, variance;
+  double score0, score1;
+
+  score = get_score( result, &variance );
+  if ( variance <= 0.0 )
+    return 0.0;
+  score0 = elo_to_score( elo0 );
+  score1 = elo_to_score( elo1 );
+
+  return result->game_count * (score1 - score0) *
+    (2.0 * score - score0 - score1) / (2.0 * variance);
+}
+
+
+/*
+   REPORT_PROGRESS
+   Called regularly by the worker pool. Writes finished games
+   to the log in tournament order, shows the standings and stops
+   the tournament when the SPRT is decided.
+*/
+
+static void
+report_progress( void *context ) {
+  Tourney *tourney = (Tourney *) context;
+  TourneyGame *game;
+  Result result;
+  double score, variance;
+  double llr;
+  double lower_bound, upper_bound;
+  int i;
+
+  while ( (tourney->written_count < tourney->game_count) &&
+	  (tourney->game[tourney->written_count].state == GAME_FINISHED) ) {
+    game = &tourney->game[tourney->written_count];
+    if ( tourney->log_stream != NULL ) {
+      for ( i = 0; i < game->move_count; i++ )
+	fprintf( tourney->log_stream, "%c%c", TO_SQUARE( game->moves[i] ) );
+      fprintf( tourney->log_stream, " %s %+d\n",
+	       (tourney->written_count % 2 == 0) ? "A-B" : "B-A",
+	       (tourney->written_count % 2 == 0) ?
+	       game->disc_diff : -game->disc_diff );
+    }
+    tourney->written_count++;
+  }
+  if ( tourney->log_stream != NULL )
+    fflush( tourney->log_stream );
+
+  gather_results( tourney, EMPTY, &result );
+  if ( result.game_count == tourney->reported_count )
+    return;
+  tourney->reported_count = result.game_count;
+
+  score = get_score( &result, &variance );
+  fprintf( stderr, "\r%d games: %d-%d-%d  %.1f%%  Elo %+.1f",
+	   result.game_count, result.wins, result.draws, result.losses,
+	   100.0 * score, score_to_elo( score ) );
+  if ( tourney->use_sprt ) {
+    llr = get_llr( &result, tourney->elo0, tourney->elo1 );
+    lower_bound = log( tourney->beta / (1.0 - tourney->alpha) );
+    upper_bound = log( (1.0 - tourney->beta) / tourney->alpha );
+    fprintf( stderr, "  LLR %.2f [%.2f, %.2f]", llr, lower_bound,
+	     upper_bound );
+    if ( ((llr <= lower_bound) || (llr >= upper_bound)) && !*tourney->stop )
+      *tourney->stop = TRUE;
+  }
+  fputs( "   ", stderr );
+}
+
+
+/*
+   DESCRIBE_ENGINE
+   Prints an engine configuration.
+*/
+
+static void
+describe_engine( const char *name, const EngineConfig *config ) {
+  printf( "Engine %s: depth %d, exact %d, WLD %d", name,
+	  config->mid, config->exact, config->wld );
+  if ( config->eval_file != NULL )
+    printf( ", eval %s", config->eval_file );
+  if ( config->probcut_file != NULL )
+    printf( ", MPC %s:%s", config->probcut_file, config->probcut_profile );
+  puts( "" );
+}
+
+
+/*
+   PRINT_RESULTS
+   Prints the final standings.
+*/
+
+static void
+print_results( const Tourney *tourney ) {
+  Result result, color_result;
+  EngineStatistics total[2];
+  double score, variance;
+  double margin, mean, deviation;
+  double llr;
+  int i;
+
+  gather_results( tourney, EMPTY, &result );
+  score = get_score( &result, &variance );
+  margin = (result.game_count > 0) ?
+    1.96 * sqrt( variance / result.game_count ) : 0.0;
+
+  puts( "" );
+  puts( "" );
+  describe_engine( "A", &tourney->engine[ENGINE_A] );
+  describe_engine( "B", &tourney->engine[ENGINE_B] );
+  puts( "" );
+  printf( "Games:            %d (A: %d wins, %d draws, %d losses)\n",
+	  result.game_count, result.wins, result.draws, result.losses );
+  printf( "Score of A:       %.1f%% +- %.1f%%\n", 100.0 * score,
+	  100.0 * margin );
+  printf( "Elo difference:   %+.1f [%+.1f, %+.1f]\n", score_to_elo( score ),
+	  score_to_elo( score - margin ), score_to_elo( score + margin ) );
+  if ( result.game_count > 0 ) {
+    mean = result.disc_sum / result.game_count;
+    deviation = sqrt( MAX( result.disc_square_sum / result.game_count -
+			   mean * mean, 0.0 ) );
+    printf( "Disc difference:  %+.2f +- %.2f (sd %.2f)\n", mean,
+	    1.96 * deviation / sqrt( result.game_count ), deviation );
+  }
+  gather_results( tourney, BLACKSQ, &color_result );
+  printf( "A as black:       %d-%d-%d\n", color_result.wins,
+	  color_result.draws, color_result.losses );
+  gather_results( tourney, WHITESQ, &color_result );
+  printf( "A as white:       %d-%d-%d\n", color_result.wins,
+	  color_result.draws, color_result.losses );
+
+  memset( total, 0, sizeof total );
+  for ( i = 0; i < 2 * tourney->slot_count; i++ ) {
+    EngineStatistics *statistics = &total[i / tourney->slot_count];
+
+    statistics->move_count += tourney->statistics[i].move_count;
+    statistics->nodes += tourney->statistics[i].nodes;
+    statistics->time += tourney->statistics[i].time;
+  }
+  for ( i = ENGINE_A; i <= ENGINE_B; i++ )
+    printf( "Engine %c:         %d moves, %.0f nodes, %.1f s "
+	    "(%.0f nodes/s)\n", (i == ENGINE_A) ? 'A' : 'B',
+	    total[i].move_count, total[i].nodes, total[i].time,
+	    total[i].nodes / MAX( total[i].time, 0.001 ) );
+
+  if ( tourney->use_sprt ) {
+    llr = get_llr( &result, tourney->elo0, tourney->elo1 );
+    printf( "SPRT (Elo %g vs %g, alpha %g, beta %g): LLR %.2f, ",
+	    tourney->elo0, tourney->elo1, tourney->alpha, tourney->beta,
+	    llr );
+    if ( llr >= log( (1.0 - tourney->beta) / tourney->alpha ) )
+      puts( "H1 accepted" );
+    else if ( llr <= log( tourney->beta / (1.0 - tourney->alpha) ) )
+      puts( "H0 accepted" );
+    else
+      puts( "undecided" );
+  }
+}
+
+
+/*
+   CHECK_ENGINE
+   Makes sure that the files of an engine configuration can
+   be used before any workers are started.
+*/
+
+static void
+check_engine( const char *name, const EngineConfig *config ) {
+  FILE *stream;
+
+  if ( config->eval_file != NULL ) {
+    stream = fopen( config->eval_file, "rb" );
+    if ( stream == NULL ) {
+      fprintf( stderr, "Engine %s: Cannot open %s for reading.\n", name,
+	       config->eval_file );
+      exit( EXIT_FAILURE );
+    }
+    fclose( stream );
+  }
+  if ( config->probcut_file != NULL ) {
+    if ( load_probcut_profile( config->probcut_file,
+			       config->probcut_profile ) <= 0 ) {
+      fprintf( stderr, "Engine %s: Cannot load profile %s from %s.\n",
+	       name, config->probcut_profile, config->probcut_file );
+      exit( EXIT_FAILURE );
+    }
+    init_probcut();
+  }
+}
+
+
+static void
+usage( void ) {
+  fputs( "Usage:\n"
+	 "  tourney [-a <depth> <exact> <wld>] [-b <depth> <exact> <wld>]\n"
+	 "          [-aeval <file>] [-beval <file>]\n"
+	 "          [-ampc <file> <profile>] [-bmpc <file> <profile>]\n"
+	 "          [-openings <file> | -thor <#moves>] [-games <n>]\n"
+	 "          [-workers <n>] [-hash <bits>] [-seed <s>]\n"
+	 "          [-sprt <elo0> <elo1> <alpha> <beta>] [-log <file>]\n\n",
+	 stderr );
+  fprintf( stderr, "  -a/-b      Search depths of engine A/B "
+	   "(default %d %d %d).\n", DEFAULT_MID_DEPTH, DEFAULT_EXACT_DEPTH,
+	   DEFAULT_WLD_DEPTH );
+  fputs( "  -aeval/-beval  Coefficient file of engine A/B "
+	 "(default coeffs2.bin).\n", stderr );
+  fputs( "  -ampc/-bmpc    Multi-ProbCut profile of engine A/B "
+	 "(see probcut.txt).\n", stderr );
+  fputs( "  -openings  Read the openings from a file such as "
+	 "openings.txt.\n", stderr );
+  fprintf( stderr, "  -thor      Use the first <#moves> moves of the Thor "
+	   "opening lines (default %d).\n", DEFAULT_THOR_MOVES );
+  fputs( "  -games     Number of games (default: each opening played "
+	 "once with each color).\n", stderr );
+  fputs( "  -workers   Number of games played at the same time "
+	 "(default: #CPUs).\n", stderr );
+  fprintf( stderr, "  -hash      Hash table size of each engine "
+	   "(default 2^%d).\n", DEFAULT_HASH_BITS );
+  fputs( "  -seed      Seed for the order of the openings (default 1).\n",
+	 stderr );
+  fputs( "  -sprt      Stop when the Elo difference of A over B is known "
+	 "to be\n             <elo0> or <elo1> with error rates "
+	 "<alpha> and <beta>.\n", stderr );
+  fputs( "  -log       Write each game as <moves> <black-white> "
+	 "<black disc difference>.\n", stderr );
+  exit( EXIT_FAILURE );
+}
+
+
+
+int
+main( int argc, char *argv[] ) {
+  Tourney tourney;
+  const char *opening_file;
+  const char *log_file;
+  int i;
+  int thor_moves;
+  int game_count;
+  int worker_count;
+  int hash_bits;
+  int seed;
+  int failed;
+
+  for ( i = ENGINE_A; i <= ENGINE_B; i++ ) {
+    tourney.engine[i].mid = DEFAULT_MID_DEPTH;
+    tourney.engine[i].exact = DEFAULT_EXACT_DEPTH;
+    tourney.engine[i].wld = DEFAULT_WLD_DEPTH;
+    tourney.engine[i].eval_file = NULL;
+    tourney.engine[i].probcut_file = NULL;
+    tourney.engine[i].probcut_profile = NULL;
+  }
+  tourney.use_sprt = FALSE;
+  tourney.elo0 = tourney.elo1 = 0.0;
+  tourney.alpha = tourney.beta = 0.05;
+  opening_file = NULL;
+  log_file = NULL;
+  thor_moves = DEFAULT_THOR_MOVES;
+  game_count = 0;
+  worker_count = get_processor_count();
+  hash_bits = DEFAULT_HASH_BITS;
+  seed = 1;
+
+  for ( i = 1; i < argc; i++ ) {
+    int engine = strncmp( argv[i], "-a", 2 ) ? ENGINE_B : ENGINE_A;
+
+    if ( (!strcmp( argv[i], "-a" ) || !strcmp( argv[i], "-b" )) &&
+	 (i + 3 < argc) ) {
+      tourney.engine[engine].mid = atoi( argv[++i] );
+      tourney.engine[engine].exact = atoi( argv[++i] );
+      tourney.engine[engine].wld = atoi( argv[++i] );
+    }
+    else if ( (!strcmp( argv[i], "-aeval" ) || !strcmp( argv[i], "-beval" )) &&
+	      (i + 1 < argc) )
+      tourney.engine[engine].eval_file = argv[++i];
+    else if ( (!strcmp( argv[i], "-ampc" ) || !strcmp( argv[i], "-bmpc" )) &&
+	      (i + 2 < argc) ) {
+      tourney.engine[engine].probcut_file = argv[++i];
+      tourney.engine[engine].probcut_profile = argv[++i];
+    }
+    else if ( !strcmp( argv[i], "-openings" ) && (i + 1 < argc) )
+      opening_file = argv[++i];
+    else if ( !strcmp( argv[i], "-thor" ) && (i + 1 < argc) )
+      thor_moves = atoi( argv[++i] );
+    else if ( !strcmp( argv[i], "-games" ) && (i + 1 < argc) )
+      game_count = atoi( argv[++i] );
+    else if ( !strcmp( argv[i], "-workers" ) && (i + 1 < argc) )
+      worker_count = atoi( argv[++i] );
+    else if ( !strcmp( argv[i], "-hash" ) && (i + 1 < argc) )
+      hash_bits = atoi( argv[++i] );
+    else if ( !strcmp( argv[i], "-seed" ) && (i + 1 < argc) )
+      seed = atoi( argv[++i] );
+    else if ( !strcmp( argv[i], "-sprt" ) && (i + 4 < argc) ) {
+      tourney.use_sprt = TRUE;
+      tourney.elo0 = atof( argv[++i] );
+      tourney.elo1 = atof( argv[++i] );
+      tourney.alpha = atof( argv[++i] );
+      tourney.beta = atof( argv[++i] );
+    }
+    else if ( !strcmp( argv[i], "-log" ) && (i + 1 < argc) )
+      log_file = argv[++i];
+    else
+      usage();
+  }
+  if ( tourney.use_sprt &&
+       ((tourney.elo1 <= tourney.elo0) ||
+	(tourney.alpha <= 0.0) || (tourney.alpha >= 0.5) ||
+	(tourney.beta <= 0.0) || (tourney.beta >= 0.5)) ) {
+    fputs( "-sprt needs elo0 < elo1 and error rates between 0 and 0.5.\n",
+	   stderr );
+    exit( EXIT_FAILURE );
+  }
+
+  toggle_status_log( FALSE );
+  global_setup( 0, hash_bits );
+  toggle_abort_check( FALSE );
+  toggle_perturbation_usage( FALSE );
+  echo = FALSE;
+
+  check_engine( "A", &tourney.engine[ENGINE_A] );
+  check_engine( "B", &tourney.engine[ENGINE_B] );
+
+  /* Collect and shuffle the openings */
+
+  opening_move = (short (*)[60])
+    safe_malloc( MAX_OPENINGS * 60 * sizeof( short ) );
+  opening_length = (int *) safe_malloc( MAX_OPENINGS * sizeof( int ) );
+  if ( opening_file != NULL )
+    read_opening_file( opening_file );
+  else
+    read_thor_openings( thor_moves );
+  if ( opening_count == 0 ) {
+    fputs( "No openings found.\n", stderr );
+    exit( EXIT_FAILURE );
+  }
+  shuffle_openings( seed );
+
+  if ( game_count <= 0 )
+    game_count = 2 * opening_count;
+  worker_count = MAX( 1, MIN( worker_count, MAX_CONCURRENCY ) );
+  worker_count = MIN( worker_count, game_count );
+  fprintf( stderr, "%d openings, %d games, %d at a time\n",
+	   opening_count, game_count, worker_count );
+
+  tourney.game_count = game_count;
+  tourney.slot_count = worker_count;
+  tourney.game = (TourneyGame *)
+    shared_malloc( game_count * sizeof( TourneyGame ) );
+  tourney.slot = (GameSlot *)
+    shared_malloc( worker_count * sizeof( GameSlot ) );
+  tourney.statistics = (EngineStatistics *)
+    shared_malloc( 2 * worker_count * sizeof( EngineStatistics ) );
+  tourney.next_game = (volatile int *) shared_malloc( sizeof( int ) );
+  tourney.stop = (volatile int *) shared_malloc( sizeof( int ) );
+  tourney.reported_count = 0;
+  tourney.written_count = 0;
+  tourney.log_stream = NULL;
+  if ( log_file != NULL ) {
+    tourney.log_stream = fopen( log_file, "w" );
+    if ( tourney.log_stream == NULL ) {
+      fprintf( stderr, "Cannot open %s for writing.\n", log_file );
+      exit( EXIT_FAILURE );
+    }
+  }
+
+  /* Game 2k and 2k+1 use the same opening with colors reversed */
+
+  for ( i = 0; i < game_count; i++ ) {
+    tourney.game[i].opening = (i / 2) % opening_count;
+    tourney.game[i].state = GAME_PENDING;
+  }
+  *tourney.next_game = 0;
+  *tourney.stop = FALSE;
+  for ( i = 0; i < worker_count; i++ ) {
+    if ( claim_game( &tourney, &tourney.slot[i] ) )
+      advance_slot( &tourney, &tourney.slot[i] );
+    else
+      tourney.slot[i].turn = SLOT_CLOSED;
+  }
+
+  failed = run_workers( 2 * worker_count, engine_worker, report_progress,
+			&tourney );
+  if ( failed > 0 ) {
+    fprintf( stderr, "\n%d workers failed\n", failed );
+    exit( EXIT_FAILURE );
+  }
+
+  print_results( &tourney );
+
+  if ( tourney.log_stream != NULL )
+    fclose( tourney.log_stream );
+  shared_free( (void *) tourney.stop, sizeof( int ) );
+  shared_free( (void *) tourney.next_game, sizeof( int ) );
+  shared_free( tourney.statistics,
+	       2 * worker_count * sizeof( EngineStatistics ) );
+  shared_free( tourney.slot, worker_count * sizeof( GameSlot ) );
+  shared_free( tourney.game, game_count * sizeof( TourneyGame ) );
+  free( opening_move );
+  free( opening_length );
+  global_terminate();
+
+  return EXIT_SUCCESS;
+}
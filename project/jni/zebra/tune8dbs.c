@@ -19,6 +19,15 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <zlib.h>
+#ifdef __linux__
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#endif
 
 
 /* Define the inline directive when available */
@@ -57,6 +66,51 @@
 #define DEFAULT_MAX_POSITIONS    10000
 #define DEFAULT_BUFFER_SIZE      1000
 
+/* Binary position files */
+#define POSITION_FILE_MAGIC      0x5a545053
+#define POSITION_FILE_VERSION    1
+#define CONVERSION_CHUNK         65536
+
+/* The positions are split into SLICE_COUNT slices with separate
+   partial sums; the slices are shared among at most MAX_THREAD_COUNT
+   threads and the partial sums are added in slice order, so the
+   result does not depend on the number of threads. */
+#define SLICE_COUNT              32
+#define MAX_THREAD_COUNT         SLICE_COUNT
+
+/* Offsets of the different features in the partial sum vectors */
+#define CONSTANT_OFFSET          0
+#define PARITY_OFFSET            1
+#define AFILE_OFFSET             2
+#define AFILE2X_OFFSET           (AFILE_OFFSET + 6561)
+#define BFILE_OFFSET             (AFILE2X_OFFSET + 59049)
+#define CFILE_OFFSET             (BFILE_OFFSET + 6561)
+#define DFILE_OFFSET             (CFILE_OFFSET + 6561)
+#define CORNER52_OFFSET          (DFILE_OFFSET + 6561)
+#define DIAG8_OFFSET             (CORNER52_OFFSET + 59049)
+#define DIAG7_OFFSET             (DIAG8_OFFSET + 6561)
+#define DIAG6_OFFSET             (DIAG7_OFFSET + 2187)
+#define DIAG5_OFFSET             (DIAG6_OFFSET + 729)
+#define DIAG4_OFFSET             (DIAG5_OFFSET + 243)
+#define CORNER33_OFFSET          (DIAG4_OFFSET + 81)
+#define FEATURE_COUNT            (CORNER33_OFFSET + 19683)
+
+/* The number of pattern instances in a position */
+#define MAX_FEATURE_INSTANCES    46
+
+/* What the feature sums of a pass over the positions contain */
+#define NO_FEATURES              0
+#define FEATURE_FREQUENCIES      1
+#define FEATURE_GRADIENTS        2
+
+/* Coefficient file magic numbers (from magic.h) */
+#define EVAL_MAGIC1              5358
+#define EVAL_MAGIC2              9793
+
+/* The number of positions per stage written for checking
+   the coefficient file against the engine */
+#define CHECK_POSITIONS          1000
+
 /* Side-to-move values (from constant.h) */
 
 #define BLACKSQ                 0
@@ -66,6 +120,7 @@
 /* Macros */
 
 #define MIN(a,b)                ((a < b) ? a : b)
+#define MAX(a,b)                ((a > b) ? a : b)
 #define SQR(a)                  ((a) * (a))
 
 
@@ -88,7 +143,58 @@ typedef struct {
   short score;
   short stage;
 } CompactPosition;
-   
+
+/* The header of a binary position file. It is followed by
+   POSITION_COUNT CompactPosition records in native byte order. */
+
+typedef struct {
+  int magic;
+  int version;
+  int record_size;
+  int position_count;
+} PositionFileHeader;
+
+/* The board and its line patterns for the position being examined
+   by one thread. */
+
+typedef struct {
+  int board[100];
+  int row_pattern[8];
+  int col_pattern[8];
+  int diag1_pattern[15];
+  int diag2_pattern[15];
+} PositionState;
+
+/* The sums accumulated over one slice of the positions. */
+
+typedef struct {
+  double *feature;
+  double objective;
+  double abs_error_sum;
+  double total_weight;
+  double quad_coeff, lin_coeff, const_coeff;
+  int node_count, relevant_count;
+  int cached_first, cached_count;
+} PartialSums;
+
+/* The pattern indices of all relevant positions, stored once so
+   that the iterations don't have to recompute them. Instance #K
+   of position #I is INDEX[K][I] in the feature set at OFFSET[K].
+   All pattern sets have fewer than 65536 configurations. */
+
+typedef struct {
+  int position_count;
+  int instance_count;
+  int offset[MAX_FEATURE_INSTANCES];
+  unsigned short *index[MAX_FEATURE_INSTANCES];
+  unsigned char *stage;
+  short *score;
+  double *error;
+  double *step;
+} FeatureCache;
+
+typedef void (*PositionFunction)( PositionState *, PartialSums *, int );
+typedef void (*CachedFunction)( PartialSums * );
 
 double objective;
 double abs_error_sum;
@@ -104,9 +210,15 @@ int last_active;
 int max_positions, position_count;
 int max_diff;
 int relevant_count, node_count, interval;
+int thread_count;
+int use_feature_cache;
+int next_slice;
+int progress_count;
+int pass_mode;
 int buffer_size, node_buffer_pos, short_buffer_pos;
 int node_allocations, short_allocations;
 int stage[64];
+int bucket_first[62];
 int active[61];
 int compact[1048576];
 int mirror[6561];
@@ -120,12 +232,6 @@ int mirror82x[59049];
 int identity10[59049];
 int flip33[19683];
 int mirror33[19683];
-int board[100];
-
-int row_pattern[8];
-int col_pattern[8];
-int diag1_pattern[15];
-int diag2_pattern[15];
 int row_no[100];
 int row_index[100];
 int col_no[100];
@@ -137,6 +243,7 @@ int diag2_index[100];
 
 short *short_buffer;
 CompactPosition *position_list;
+int *position_index = NULL;
 InfoItem constant;
 InfoItem parity;
 InfoItem afile[6561], bfile[6561], cfile[6561], dfile[6561];
@@ -144,6 +251,15 @@ InfoItem corner52[59049];
 InfoItem diag8[6561], diag7[2187], diag6[729], diag5[243], diag4[81];
 InfoItem corner33[19683];
 InfoItem afile2x[59049];
+PartialSums partial_sums[SLICE_COUNT];
+PositionFunction pass_function;
+CachedFunction pass_cached_function;
+FeatureCache feature_cache;
+double feature_solution[FEATURE_COUNT];
+double feature_direction[FEATURE_COUNT];
+#ifdef __linux__
+pthread_mutex_t progress_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
 
 int inverse4[81];
 int inverse5[243];
@@ -222,7 +338,7 @@ int pack_position( char *buffer, int index ) {
 */
 
 
-void unpack_position( int index ) {
+void unpack_position( PositionState *state, int index ) {
   int i, j, pos;
   int mask;
 
@@ -232,7 +348,7 @@ void unpack_position( int index ) {
   for ( i = 0; i < 8; i++ ) {
     mask = position_list[index].row_bit_vec[i];
     for ( j = 0, pos = 10 * (i + 1) + 8; j < 8; j++, pos-- ) {
-      board[pos] = mask & 3;
+      state->board[pos] = mask & 3;
       mask >>= 2;
     }
   }
@@ -244,14 +360,14 @@ void unpack_position( int index ) {
   Provides a crude position dump.
 */
 
-void display_board( int index ) {
+void display_board( PositionState *state, int index ) {
   int i, j;
 
   puts("");
   for (i = 1; i <= 8; i++) {
     printf("      ");
     for (j = 1; j <= 8; j++)
-      switch (board[10 * i + j]) {
+      switch (state->board[10 * i + j]) {
       case EMPTY:
 	printf(" ");
 	break;
@@ -274,14 +390,114 @@ void display_board( int index ) {
 }
 
 
+/*
+   READ_POSITION_HEADER
+   Reads the header of a binary position file from STREAM.
+   Returns TRUE if the file is a valid binary position file.
+*/
+
+int read_position_header( FILE *stream, PositionFileHeader *header ) {
+  if ( fread( header, sizeof( PositionFileHeader ), 1, stream ) != 1 )
+    return FALSE;
+  if ( header->magic != POSITION_FILE_MAGIC )
+    return FALSE;
+  if ( (header->version != POSITION_FILE_VERSION) ||
+       (header->record_size != sizeof( CompactPosition )) ||
+       (header->position_count < 0) ) {
+    printf( "Unsupported binary position file\n" );
+    exit( EXIT_FAILURE );
+  }
+  return TRUE;
+}
+
+
+/*
+   MAP_POSITION_FILE
+   Makes the positions in the binary position file FILE_NAME
+   available in POSITION_LIST. The file is mapped into memory
+   where possible so that it is paged in as the positions are
+   processed rather than read up front.
+*/
+
+void map_position_file( char *file_name, PositionFileHeader *header ) {
+  size_t size;
+#ifdef __linux__
+  int fd;
+  struct stat file_stat;
+  void *mapping;
+#else
+  FILE *stream;
+#endif
+
+  size = sizeof( PositionFileHeader ) +
+    (size_t) header->position_count * sizeof( CompactPosition );
+
+#ifdef __linux__
+  fd = open( file_name, O_RDONLY );
+  if ( (fd < 0) || (fstat( fd, &file_stat ) != 0) ||
+       ((size_t) file_stat.st_size < size) ) {
+    printf( "Could not map position file '%s'\n", file_name );
+    exit( EXIT_FAILURE );
+  }
+  mapping = mmap( NULL, size, PROT_READ, MAP_SHARED, fd, 0 );
+  close( fd );
+  if ( mapping == MAP_FAILED ) {
+    printf( "Could not map position file '%s'\n", file_name );
+    exit( EXIT_FAILURE );
+  }
+  position_list =
+    (CompactPosition *) ((char *) mapping + sizeof( PositionFileHeader ));
+#else
+  position_list = malloc( size - sizeof( PositionFileHeader ) );
+  if ( position_list == NULL ) {
+    printf( "Couldn't allocate space for %d positions\n",
+	    header->position_count );
+    exit( EXIT_FAILURE );
+  }
+  stream = fopen( file_name, "rb" );
+  if ( (stream == NULL) ||
+       (fseek( stream, sizeof( PositionFileHeader ), SEEK_SET ) != 0) ||
+       (fread( position_list, sizeof( CompactPosition ),
+	       header->position_count, stream ) !=
+	(size_t) header->position_count) ) {
+    printf( "Could not read position file '%s'\n", file_name );
+    exit( EXIT_FAILURE );
+  }
+  fclose( stream );
+#endif
+
+  position_count = header->position_count;
+  if ( (max_positions > 0) && (position_count > max_positions) )
+    position_count = max_positions;
+}
+
+
 /*
    READ_POSITION_FILE
    Reads a game database and creates a game tree containing its games.
+   Binary position files are mapped, text files are parsed.
 */   
 
 void read_position_file(char *file_name) {
   FILE *stream;
   char buffer[100];
+  PositionFileHeader header;
+
+  stream = fopen( file_name, "rb" );
+  if ( stream == NULL ) {
+    printf( "Could not open game file '%s'\n", file_name );
+    exit( EXIT_FAILURE );
+  }
+  if ( read_position_header( stream, &header ) ) {
+    fclose( stream );
+    map_position_file( file_name, &header );
+    printf( "%d positions mapped\n", position_count );
+    return;
+  }
+  fclose( stream );
+
+  if ( max_positions <= 0 )
+    max_positions = DEFAULT_MAX_POSITIONS;
 
   position_list = malloc( max_positions * sizeof( CompactPosition ) );
   if ( position_list == NULL ) {
@@ -309,38 +525,103 @@ void read_position_file(char *file_name) {
 
   /*
   for ( int i = 0; i < position_count; i++ ) {
-    unpack_position( i );
-    display_board( i );
+    unpack_position( &state, i );
+    display_board( &state, i );
   }
   */
 }
 
 
+/*
+   CONVERT_POSITION_FILE
+   Converts the text position file TEXT_FILE to the binary position
+   file BINARY_FILE. The positions are converted in chunks so the
+   text file doesn't have to fit in memory.
+*/
+
+void convert_position_file( char *text_file, char *binary_file ) {
+  FILE *in_stream, *out_stream;
+  char buffer[100];
+  int chunk_count;
+  PositionFileHeader header;
+
+  position_list = malloc( CONVERSION_CHUNK * sizeof( CompactPosition ) );
+  if ( position_list == NULL ) {
+    printf( "Couldn't allocate space for %d positions\n",
+	    CONVERSION_CHUNK );
+    exit( EXIT_FAILURE );
+  }
+
+  in_stream = fopen( text_file, "r" );
+  if ( in_stream == NULL ) {
+    printf( "Could not open game file '%s'\n", text_file );
+    exit( EXIT_FAILURE );
+  }
+  out_stream = fopen( binary_file, "wb" );
+  if ( out_stream == NULL ) {
+    printf( "Error creating '%s'\n", binary_file );
+    exit( EXIT_FAILURE );
+  }
+
+  header.magic = POSITION_FILE_MAGIC;
+  header.version = POSITION_FILE_VERSION;
+  header.record_size = sizeof( CompactPosition );
+  header.position_count = 0;
+  fwrite( &header, sizeof( PositionFileHeader ), 1, out_stream );
+
+  chunk_count = 0;
+  while ( fgets( buffer, 100, in_stream ) != NULL ) {
+    if ( pack_position( buffer, chunk_count ) )
+      chunk_count++;
+    if ( chunk_count == CONVERSION_CHUNK ) {
+      fwrite( position_list, sizeof( CompactPosition ), chunk_count,
+	      out_stream );
+      header.position_count += chunk_count;
+      chunk_count = 0;
+    }
+  }
+  fwrite( position_list, sizeof( CompactPosition ), chunk_count,
+	  out_stream );
+  header.position_count += chunk_count;
+
+  fseek( out_stream, 0, SEEK_SET );
+  fwrite( &header, sizeof( PositionFileHeader ), 1, out_stream );
+  if ( fclose( out_stream ) != 0 ) {
+    printf( "Error writing '%s'\n", binary_file );
+    exit( EXIT_FAILURE );
+  }
+  fclose( in_stream );
+  free( position_list );
+
+  printf( "%d positions converted\n", header.position_count );
+}
+
+
 /*
   COMPUTE_PATTERNS
   Computes the board patterns corresponding to rows, columns
   and diagonals.
 */
 
-void compute_patterns( void ) {
+void compute_patterns( PositionState *state ) {
   int i, j, pos;
 
   for ( i = 0; i < 8; i++ ) {
-    row_pattern[i] = 0;
-    col_pattern[i] = 0;
+    state->row_pattern[i] = 0;
+    state->col_pattern[i] = 0;
   }
   for ( i = 0; i < 15; i++ ) {
-    diag1_pattern[i] = 0;
-    diag2_pattern[i] = 0;
+    state->diag1_pattern[i] = 0;
+    state->diag2_pattern[i] = 0;
   }
 
   for ( i = 1; i <= 8; i++ )
     for ( j = 1; j <= 8; j++ ) {
       pos = 10 * i + j;
-      row_pattern[row_no[pos]] += board[pos] << (row_index[pos] << 1);
-      col_pattern[col_no[pos]] += board[pos] << (col_index[pos] << 1);
-      diag1_pattern[diag1_no[pos]] += board[pos] << (diag1_index[pos] << 1);
-      diag2_pattern[diag2_no[pos]] += board[pos] << (diag2_index[pos] << 1);
+      state->row_pattern[row_no[pos]] += state->board[pos] << (row_index[pos] << 1);
+      state->col_pattern[col_no[pos]] += state->board[pos] << (col_index[pos] << 1);
+      state->diag1_pattern[diag1_no[pos]] += state->board[pos] << (diag1_index[pos] << 1);
+      state->diag2_pattern[diag2_no[pos]] += state->board[pos] << (diag2_index[pos] << 1);
     }
 }
 
@@ -375,7 +656,8 @@ void sort( int *vec, int count ) {
    active features
 */
 
-void determine_features( int side_to_move, int stage, int *global_parity,
+void determine_features( PositionState *state,
+			 int side_to_move, int stage, int *global_parity,
 			 int *buffer_a, int *buffer_b,
 			 int *buffer_c, int *buffer_d,
 			 int *buffer_52, int *buffer_33,
@@ -383,7 +665,7 @@ void determine_features( int side_to_move, int stage, int *global_parity,
 			 int *buffer_5, int *buffer_4 ) {
   int config52, config33;
 
-  compute_patterns();
+  compute_patterns( state );
 
    /* Non-pattern measures */
 
@@ -398,30 +680,30 @@ void determine_features( int side_to_move, int stage, int *global_parity,
 
   if ( USE_A_FILE ) {
     if ( side_to_move == BLACKSQ ) {
-      buffer_a[0] = mirror[compact[row_pattern[0]]];
-      buffer_a[1] = mirror[compact[row_pattern[7]]];
-      buffer_a[2] = mirror[compact[col_pattern[0]]];
-      buffer_a[3] = mirror[compact[col_pattern[7]]];
+      buffer_a[0] = mirror[compact[state->row_pattern[0]]];
+      buffer_a[1] = mirror[compact[state->row_pattern[7]]];
+      buffer_a[2] = mirror[compact[state->col_pattern[0]]];
+      buffer_a[3] = mirror[compact[state->col_pattern[7]]];
     }
     else {
-      buffer_a[0] = mirror[inverse8[compact[row_pattern[0]]]];
-      buffer_a[1] = mirror[inverse8[compact[row_pattern[7]]]];
-      buffer_a[2] = mirror[inverse8[compact[col_pattern[0]]]];
-      buffer_a[3] = mirror[inverse8[compact[col_pattern[7]]]];
+      buffer_a[0] = mirror[inverse8[compact[state->row_pattern[0]]]];
+      buffer_a[1] = mirror[inverse8[compact[state->row_pattern[7]]]];
+      buffer_a[2] = mirror[inverse8[compact[state->col_pattern[0]]]];
+      buffer_a[3] = mirror[inverse8[compact[state->col_pattern[7]]]];
     }
   }
   else if ( USE_A_FILE2X ) {
     if ( side_to_move == BLACKSQ ) {
-      buffer_a[0] = mirror82x[compact[row_pattern[0]] + 6561 * board[22] + 19683 * board[27]];
-      buffer_a[1] = mirror82x[compact[row_pattern[7]] + 6561 * board[72] + 19683 * board[77]];
-      buffer_a[2] = mirror82x[compact[col_pattern[0]] + 6561 * board[22] + 19683 * board[72]];
-      buffer_a[3] = mirror82x[compact[col_pattern[7]] + 6561 * board[27] + 19683 * board[77]];
+      buffer_a[0] = mirror82x[compact[state->row_pattern[0]] + 6561 * state->board[22] + 19683 * state->board[27]];
+      buffer_a[1] = mirror82x[compact[state->row_pattern[7]] + 6561 * state->board[72] + 19683 * state->board[77]];
+      buffer_a[2] = mirror82x[compact[state->col_pattern[0]] + 6561 * state->board[22] + 19683 * state->board[72]];
+      buffer_a[3] = mirror82x[compact[state->col_pattern[7]] + 6561 * state->board[27] + 19683 * state->board[77]];
     }
     else {
-      buffer_a[0] = mirror82x[inverse10[compact[row_pattern[0]] + 6561 * board[22] + 19683 * board[27]]];
-      buffer_a[1] = mirror82x[inverse10[compact[row_pattern[7]] + 6561 * board[72] + 19683 * board[77]]];
-      buffer_a[2] = mirror82x[inverse10[compact[col_pattern[0]] + 6561 * board[22] + 19683 * board[72]]];
-      buffer_a[3] = mirror82x[inverse10[compact[col_pattern[7]] + 6561 * board[27] + 19683 * board[77]]];
+      buffer_a[0] = mirror82x[inverse10[compact[state->row_pattern[0]] + 6561 * state->board[22] + 19683 * state->board[27]]];
+      buffer_a[1] = mirror82x[inverse10[compact[state->row_pattern[7]] + 6561 * state->board[72] + 19683 * state->board[77]]];
+      buffer_a[2] = mirror82x[inverse10[compact[state->col_pattern[0]] + 6561 * state->board[22] + 19683 * state->board[72]]];
+      buffer_a[3] = mirror82x[inverse10[compact[state->col_pattern[7]] + 6561 * state->board[27] + 19683 * state->board[77]]];
     }
   }
 
@@ -429,16 +711,16 @@ void determine_features( int side_to_move, int stage, int *global_parity,
 
   if ( USE_B_FILE ) {
     if ( side_to_move == BLACKSQ ) {
-      buffer_b[0] = mirror[compact[row_pattern[1]]];
-      buffer_b[1] = mirror[compact[row_pattern[6]]];
-      buffer_b[2] = mirror[compact[col_pattern[1]]];
-      buffer_b[3] = mirror[compact[col_pattern[6]]];
+      buffer_b[0] = mirror[compact[state->row_pattern[1]]];
+      buffer_b[1] = mirror[compact[state->row_pattern[6]]];
+      buffer_b[2] = mirror[compact[state->col_pattern[1]]];
+      buffer_b[3] = mirror[compact[state->col_pattern[6]]];
     }
     else {
-      buffer_b[0] = mirror[inverse8[compact[row_pattern[1]]]];
-      buffer_b[1] = mirror[inverse8[compact[row_pattern[6]]]];
-      buffer_b[2] = mirror[inverse8[compact[col_pattern[1]]]];
-      buffer_b[3] = mirror[inverse8[compact[col_pattern[6]]]];
+      buffer_b[0] = mirror[inverse8[compact[state->row_pattern[1]]]];
+      buffer_b[1] = mirror[inverse8[compact[state->row_pattern[6]]]];
+      buffer_b[2] = mirror[inverse8[compact[state->col_pattern[1]]]];
+      buffer_b[3] = mirror[inverse8[compact[state->col_pattern[6]]]];
     }
   }
 
@@ -446,16 +728,16 @@ void determine_features( int side_to_move, int stage, int *global_parity,
 
   if ( USE_C_FILE ) {
     if ( side_to_move == BLACKSQ ) {
-      buffer_c[0] = mirror[compact[row_pattern[2]]];
-      buffer_c[1] = mirror[compact[row_pattern[5]]];
-      buffer_c[2] = mirror[compact[col_pattern[2]]];
-      buffer_c[3] = mirror[compact[col_pattern[5]]];
+      buffer_c[0] = mirror[compact[state->row_pattern[2]]];
+      buffer_c[1] = mirror[compact[state->row_pattern[5]]];
+      buffer_c[2] = mirror[compact[state->col_pattern[2]]];
+      buffer_c[3] = mirror[compact[state->col_pattern[5]]];
     }
     else {
-      buffer_c[0] = mirror[inverse8[compact[row_pattern[2]]]];
-      buffer_c[1] = mirror[inverse8[compact[row_pattern[5]]]];
-      buffer_c[2] = mirror[inverse8[compact[col_pattern[2]]]];
-      buffer_c[3] = mirror[inverse8[compact[col_pattern[5]]]];
+      buffer_c[0] = mirror[inverse8[compact[state->row_pattern[2]]]];
+      buffer_c[1] = mirror[inverse8[compact[state->row_pattern[5]]]];
+      buffer_c[2] = mirror[inverse8[compact[state->col_pattern[2]]]];
+      buffer_c[3] = mirror[inverse8[compact[state->col_pattern[5]]]];
     }
   }
 
@@ -463,16 +745,16 @@ void determine_features( int side_to_move, int stage, int *global_parity,
 
   if ( USE_D_FILE ) {
     if ( side_to_move == BLACKSQ ) {
-      buffer_d[0] = mirror[compact[row_pattern[3]]];
-      buffer_d[1] = mirror[compact[row_pattern[4]]];
-      buffer_d[2] = mirror[compact[col_pattern[3]]];
-      buffer_d[3] = mirror[compact[col_pattern[4]]];
+      buffer_d[0] = mirror[compact[state->row_pattern[3]]];
+      buffer_d[1] = mirror[compact[state->row_pattern[4]]];
+      buffer_d[2] = mirror[compact[state->col_pattern[3]]];
+      buffer_d[3] = mirror[compact[state->col_pattern[4]]];
     }
     else {
-      buffer_d[0] = mirror[inverse8[compact[row_pattern[3]]]];
-      buffer_d[1] = mirror[inverse8[compact[row_pattern[4]]]];
-      buffer_d[2] = mirror[inverse8[compact[col_pattern[3]]]];
-      buffer_d[3] = mirror[inverse8[compact[col_pattern[4]]]];
+      buffer_d[0] = mirror[inverse8[compact[state->row_pattern[3]]]];
+      buffer_d[1] = mirror[inverse8[compact[state->row_pattern[4]]]];
+      buffer_d[2] = mirror[inverse8[compact[state->col_pattern[3]]]];
+      buffer_d[3] = mirror[inverse8[compact[state->col_pattern[4]]]];
     }
   }
 
@@ -481,54 +763,54 @@ void determine_features( int side_to_move, int stage, int *global_parity,
   if ( USE_CORNER52 ) {
     if ( side_to_move == BLACKSQ ) {
       /* a1-e1 + a2-e2 */
-      config52 = (row_pattern[0] & 1023) + ((row_pattern[1] & 1023) << 10);
+      config52 = (state->row_pattern[0] & 1023) + ((state->row_pattern[1] & 1023) << 10);
       buffer_52[0] = compact[config52];
       /* a1-a5 + b1-b5 */
-      config52 = (col_pattern[0] & 1023) + ((col_pattern[1] & 1023) << 10);
+      config52 = (state->col_pattern[0] & 1023) + ((state->col_pattern[1] & 1023) << 10);
       buffer_52[1] = compact[config52];
       /* h1-d1 + h2-d2 */
-      config52 = (row_pattern[0] >> 6) + ((row_pattern[1] >> 6) << 10);
+      config52 = (state->row_pattern[0] >> 6) + ((state->row_pattern[1] >> 6) << 10);
       buffer_52[2] = flip52[compact[config52]];
       /* h1-h5 + g1-g5 */
-      config52 = (col_pattern[7] & 1023) + ((col_pattern[6] & 1023) << 10);
+      config52 = (state->col_pattern[7] & 1023) + ((state->col_pattern[6] & 1023) << 10);
       buffer_52[3] = compact[config52];
       /* a8-e8 + a7-e7 */
-      config52 = (row_pattern[7] & 1023) + ((row_pattern[6] & 1023) << 10);
+      config52 = (state->row_pattern[7] & 1023) + ((state->row_pattern[6] & 1023) << 10);
       buffer_52[4] = compact[config52];
       /* a8-a4 + b8-b4 */
-      config52 = (col_pattern[0] >> 6) + ((col_pattern[1] >> 6) << 10);
+      config52 = (state->col_pattern[0] >> 6) + ((state->col_pattern[1] >> 6) << 10);
       buffer_52[5] = flip52[compact[config52]];
       /* h8-d8 + h7-d7 */
-      config52 = (row_pattern[7] >> 6) + ((row_pattern[6] >> 6) << 10);
+      config52 = (state->row_pattern[7] >> 6) + ((state->row_pattern[6] >> 6) << 10);
       buffer_52[6] = flip52[compact[config52]];
       /* h8-h4 + g8-g4 */
-      config52 = (col_pattern[7] >> 6) + ((col_pattern[6] >> 6) << 10);
+      config52 = (state->col_pattern[7] >> 6) + ((state->col_pattern[6] >> 6) << 10);
       buffer_52[7] = flip52[compact[config52]];
     }
     else {
       /* a1-e1 + a2-e2 */
-      config52 = (row_pattern[0] & 1023) + ((row_pattern[1] & 1023) << 10);
+      config52 = (state->row_pattern[0] & 1023) + ((state->row_pattern[1] & 1023) << 10);
       buffer_52[0] = inverse10[compact[config52]];
       /* a1-a5 + b1-b5 */
-      config52 = (col_pattern[0] & 1023) + ((col_pattern[1] & 1023) << 10);
+      config52 = (state->col_pattern[0] & 1023) + ((state->col_pattern[1] & 1023) << 10);
       buffer_52[1] = inverse10[compact[config52]];
       /* h1-d1 + h2-d2 */
-      config52 = (row_pattern[0] >> 6) + ((row_pattern[1] >> 6) << 10);
+      config52 = (state->row_pattern[0] >> 6) + ((state->row_pattern[1] >> 6) << 10);
       buffer_52[2] = inverse10[flip52[compact[config52]]];
       /* h1-h5 + g1-g5 */
-      config52 = (col_pattern[7] & 1023) + ((col_pattern[6] & 1023) << 10);
+      config52 = (state->col_pattern[7] & 1023) + ((state->col_pattern[6] & 1023) << 10);
       buffer_52[3] = inverse10[compact[config52]];
       /* a8-e8 + a7-e7 */
-      config52 = (row_pattern[7] & 1023) + ((row_pattern[6] & 1023) << 10);
+      config52 = (state->row_pattern[7] & 1023) + ((state->row_pattern[6] & 1023) << 10);
       buffer_52[4] = inverse10[compact[config52]];
       /* a8-a4 + b8-b4 */
-      config52 = (col_pattern[0] >> 6) + ((col_pattern[1] >> 6) << 10);
+      config52 = (state->col_pattern[0] >> 6) + ((state->col_pattern[1] >> 6) << 10);
       buffer_52[5] = inverse10[flip52[compact[config52]]];
       /* h8-e8 + h7-e7 */
-      config52 = (row_pattern[7] >> 6) + ((row_pattern[6] >> 6) << 10);
+      config52 = (state->row_pattern[7] >> 6) + ((state->row_pattern[6] >> 6) << 10);
       buffer_52[6] = inverse10[flip52[compact[config52]]];
       /* h8-h4 + g8-g4 */
-      config52 = (col_pattern[7] >> 6) + ((col_pattern[6] >> 6) << 10);
+      config52 = (state->col_pattern[7] >> 6) + ((state->col_pattern[6] >> 6) << 10);
       buffer_52[7] = inverse10[flip52[compact[config52]]];
     }
   }
@@ -538,46 +820,46 @@ void determine_features( int side_to_move, int stage, int *global_parity,
   if ( USE_CORNER33 ) {
     if ( side_to_move == BLACKSQ ) {
       /* a1-c1 + a2-c2 + a3-c3 */
-      config33 = (row_pattern[0] & 63) +
-	((row_pattern[1] & 63) << 6) +
-	((row_pattern[2] & 63) << 12);
+      config33 = (state->row_pattern[0] & 63) +
+	((state->row_pattern[1] & 63) << 6) +
+	((state->row_pattern[2] & 63) << 12);
       buffer_33[0] = mirror33[compact[config33]];
       /* h1-f1 + h2-f2 + h3-f3 */
-      config33 = (row_pattern[0] >> 10) +
-	((row_pattern[1] >> 10) << 6) +
-	((row_pattern[2] >> 10) << 12);
+      config33 = (state->row_pattern[0] >> 10) +
+	((state->row_pattern[1] >> 10) << 6) +
+	((state->row_pattern[2] >> 10) << 12);
       buffer_33[1] = mirror33[flip33[compact[config33]]];
       /* a8-c8 + a7-c7 + a6-c6 */
-      config33 = (row_pattern[7] & 63) +
-	((row_pattern[6] & 63) << 6) +
-	((row_pattern[5] & 63) << 12);
+      config33 = (state->row_pattern[7] & 63) +
+	((state->row_pattern[6] & 63) << 6) +
+	((state->row_pattern[5] & 63) << 12);
       buffer_33[2] = mirror33[compact[config33]];
       /* h8-f8 + h7-f7 + h6-f6 */
-      config33 = (row_pattern[7] >> 10) +
-	((row_pattern[6] >> 10) << 6) +
-	((row_pattern[5] >> 10) << 12);
+      config33 = (state->row_pattern[7] >> 10) +
+	((state->row_pattern[6] >> 10) << 6) +
+	((state->row_pattern[5] >> 10) << 12);
       buffer_33[3] = mirror33[flip33[compact[config33]]];
     }
     else {
       /* a1-c1 + a2-c2 + a3-c3 */
-      config33 = (row_pattern[0] & 63) +
-	((row_pattern[1] & 63) << 6) +
-	((row_pattern[2] & 63) << 12);
+      config33 = (state->row_pattern[0] & 63) +
+	((state->row_pattern[1] & 63) << 6) +
+	((state->row_pattern[2] & 63) << 12);
       buffer_33[0] = mirror33[inverse9[compact[config33]]];
       /* h1-f1 + h2-f2 + h3-f3 */
-      config33 = (row_pattern[0] >> 10) +
-	((row_pattern[1] >> 10) << 6) +
-	((row_pattern[2] >> 10) << 12);
+      config33 = (state->row_pattern[0] >> 10) +
+	((state->row_pattern[1] >> 10) << 6) +
+	((state->row_pattern[2] >> 10) << 12);
       buffer_33[1] = mirror33[inverse9[flip33[compact[config33]]]];
       /* a8-c8 + a7-c7 + a6-c6 */
-      config33 = (row_pattern[7] & 63) +
-	((row_pattern[6] & 63) << 6) +
-	((row_pattern[5] & 63) << 12);
+      config33 = (state->row_pattern[7] & 63) +
+	((state->row_pattern[6] & 63) << 6) +
+	((state->row_pattern[5] & 63) << 12);
       buffer_33[2] = mirror33[inverse9[compact[config33]]];
       /* h8-f8 + h7-f7 + h6-f6 */
-      config33 = (row_pattern[7] >> 10) +
-	((row_pattern[6] >> 10) << 6) +
-	((row_pattern[5] >> 10) << 12);
+      config33 = (state->row_pattern[7] >> 10) +
+	((state->row_pattern[6] >> 10) << 6) +
+	((state->row_pattern[5] >> 10) << 12);
       buffer_33[3] = mirror33[inverse9[flip33[compact[config33]]]];
     }
   }
@@ -586,12 +868,12 @@ void determine_features( int side_to_move, int stage, int *global_parity,
 
   if ( USE_DIAG8 ) {
     if ( side_to_move == BLACKSQ ) {
-      buffer_8[0] = mirror[compact[diag1_pattern[7]]];
-      buffer_8[1] = mirror[compact[diag2_pattern[7]]];
+      buffer_8[0] = mirror[compact[state->diag1_pattern[7]]];
+      buffer_8[1] = mirror[compact[state->diag2_pattern[7]]];
     }
     else {
-      buffer_8[0] = mirror[inverse8[compact[diag1_pattern[7]]]];
-      buffer_8[1] = mirror[inverse8[compact[diag2_pattern[7]]]];
+      buffer_8[0] = mirror[inverse8[compact[state->diag1_pattern[7]]]];
+      buffer_8[1] = mirror[inverse8[compact[state->diag2_pattern[7]]]];
     }
   }
 
@@ -599,16 +881,16 @@ void determine_features( int side_to_move, int stage, int *global_parity,
 
   if ( USE_DIAG7 ) {
     if ( side_to_move == BLACKSQ ) {
-      buffer_7[0] = mirror7[compact[diag1_pattern[6]]];
-      buffer_7[1] = mirror7[compact[diag1_pattern[8]]];
-      buffer_7[2] = mirror7[compact[diag2_pattern[6]]];
-      buffer_7[3] = mirror7[compact[diag2_pattern[8]]];
+      buffer_7[0] = mirror7[compact[state->diag1_pattern[6]]];
+      buffer_7[1] = mirror7[compact[state->diag1_pattern[8]]];
+      buffer_7[2] = mirror7[compact[state->diag2_pattern[6]]];
+      buffer_7[3] = mirror7[compact[state->diag2_pattern[8]]];
     }
     else {
-      buffer_7[0] = mirror7[inverse7[compact[diag1_pattern[6]]]];
-      buffer_7[1] = mirror7[inverse7[compact[diag1_pattern[8]]]];
-      buffer_7[2] = mirror7[inverse7[compact[diag2_pattern[6]]]];
-      buffer_7[3] = mirror7[inverse7[compact[diag2_pattern[8]]]];
+      buffer_7[0] = mirror7[inverse7[compact[state->diag1_pattern[6]]]];
+      buffer_7[1] = mirror7[inverse7[compact[state->diag1_pattern[8]]]];
+      buffer_7[2] = mirror7[inverse7[compact[state->diag2_pattern[6]]]];
+      buffer_7[3] = mirror7[inverse7[compact[state->diag2_pattern[8]]]];
     }
   }
 
@@ -616,16 +898,16 @@ void determine_features( int side_to_move, int stage, int *global_parity,
 
   if ( USE_DIAG6 ) {
     if ( side_to_move == BLACKSQ ) {
-      buffer_6[0] = mirror6[compact[diag1_pattern[5]]];
-      buffer_6[1] = mirror6[compact[diag1_pattern[9]]];
-      buffer_6[2] = mirror6[compact[diag2_pattern[5]]];
-      buffer_6[3] = mirror6[compact[diag2_pattern[9]]];
+      buffer_6[0] = mirror6[compact[state->diag1_pattern[5]]];
+      buffer_6[1] = mirror6[compact[state->diag1_pattern[9]]];
+      buffer_6[2] = mirror6[compact[state->diag2_pattern[5]]];
+      buffer_6[3] = mirror6[compact[state->diag2_pattern[9]]];
     }
     else {
-      buffer_6[0] = mirror6[inverse6[compact[diag1_pattern[5]]]];
-      buffer_6[1] = mirror6[inverse6[compact[diag1_pattern[9]]]];
-      buffer_6[2] = mirror6[inverse6[compact[diag2_pattern[5]]]];
-      buffer_6[3] = mirror6[inverse6[compact[diag2_pattern[9]]]];
+      buffer_6[0] = mirror6[inverse6[compact[state->diag1_pattern[5]]]];
+      buffer_6[1] = mirror6[inverse6[compact[state->diag1_pattern[9]]]];
+      buffer_6[2] = mirror6[inverse6[compact[state->diag2_pattern[5]]]];
+      buffer_6[3] = mirror6[inverse6[compact[state->diag2_pattern[9]]]];
     }
   }
 
@@ -633,16 +915,16 @@ void determine_features( int side_to_move, int stage, int *global_parity,
 
   if ( USE_DIAG5 ) {
     if ( side_to_move == BLACKSQ ) {
-      buffer_5[0] = mirror5[compact[diag1_pattern[4]]];
-      buffer_5[1] = mirror5[compact[diag1_pattern[10]]];
-      buffer_5[2] = mirror5[compact[diag2_pattern[4]]];
-      buffer_5[3] = mirror5[compact[diag2_pattern[10]]];
+      buffer_5[0] = mirror5[compact[state->diag1_pattern[4]]];
+      buffer_5[1] = mirror5[compact[state->diag1_pattern[10]]];
+      buffer_5[2] = mirror5[compact[state->diag2_pattern[4]]];
+      buffer_5[3] = mirror5[compact[state->diag2_pattern[10]]];
     }
     else {
-      buffer_5[0] = mirror5[inverse5[compact[diag1_pattern[4]]]];
-      buffer_5[1] = mirror5[inverse5[compact[diag1_pattern[10]]]];
-      buffer_5[2] = mirror5[inverse5[compact[diag2_pattern[4]]]];
-      buffer_5[3] = mirror5[inverse5[compact[diag2_pattern[10]]]];
+      buffer_5[0] = mirror5[inverse5[compact[state->diag1_pattern[4]]]];
+      buffer_5[1] = mirror5[inverse5[compact[state->diag1_pattern[10]]]];
+      buffer_5[2] = mirror5[inverse5[compact[state->diag2_pattern[4]]]];
+      buffer_5[3] = mirror5[inverse5[compact[state->diag2_pattern[10]]]];
     }
   }
 
@@ -650,16 +932,16 @@ void determine_features( int side_to_move, int stage, int *global_parity,
 
   if ( USE_DIAG4 ) {
     if (side_to_move == BLACKSQ) {
-      buffer_4[0] = mirror4[compact[diag1_pattern[3]]];
-      buffer_4[1] = mirror4[compact[diag1_pattern[11]]];
-      buffer_4[2] = mirror4[compact[diag2_pattern[3]]];
-      buffer_4[3] = mirror4[compact[diag2_pattern[11]]];
+      buffer_4[0] = mirror4[compact[state->diag1_pattern[3]]];
+      buffer_4[1] = mirror4[compact[state->diag1_pattern[11]]];
+      buffer_4[2] = mirror4[compact[state->diag2_pattern[3]]];
+      buffer_4[3] = mirror4[compact[state->diag2_pattern[11]]];
     }
     else {
-      buffer_4[0] = mirror4[inverse4[compact[diag1_pattern[3]]]];
-      buffer_4[1] = mirror4[inverse4[compact[diag1_pattern[11]]]];
-      buffer_4[2] = mirror4[inverse4[compact[diag2_pattern[3]]]];
-      buffer_4[3] = mirror4[inverse4[compact[diag2_pattern[11]]]];
+      buffer_4[0] = mirror4[inverse4[compact[state->diag1_pattern[3]]]];
+      buffer_4[1] = mirror4[inverse4[compact[state->diag1_pattern[11]]]];
+      buffer_4[2] = mirror4[inverse4[compact[state->diag2_pattern[3]]]];
+      buffer_4[3] = mirror4[inverse4[compact[state->diag2_pattern[11]]]];
     }
   }
 }
@@ -670,7 +952,7 @@ void determine_features( int side_to_move, int stage, int *global_parity,
    Updates frequency counts.
 */   
 
-void perform_analysis( int index ) {
+void perform_analysis( PositionState *state, PartialSums *sums, int index ) {
   int coeff, start, stop;
   int global_parity;
   int side_to_move, stage;
@@ -681,7 +963,7 @@ void perform_analysis( int index ) {
   side_to_move = position_list[index].side_to_move;
   stage = position_list[index].stage;
 
-  determine_features( side_to_move, stage,
+  determine_features( state, side_to_move, stage,
 		      &global_parity, buffer_a, buffer_b,
 		      buffer_c, buffer_d, buffer_52,
 		      buffer_33, buffer_8, buffer_7, buffer_6,
@@ -696,7 +978,7 @@ void perform_analysis( int index ) {
     while ( (stop < 4) && (buffer_d[stop] == buffer_d[start]) )
       stop++;
     coeff = stop - start;
-    dfile[buffer_d[start]].frequency++;
+    sums->feature[DFILE_OFFSET + buffer_d[start]]++;
     start = stop;
   } while (start < 4);
 
@@ -709,7 +991,7 @@ void perform_analysis( int index ) {
     while ( (stop < 4) && (buffer_c[stop] == buffer_c[start]) )
       stop++;
     coeff = stop - start;
-    cfile[buffer_c[start]].frequency++;
+    sums->feature[CFILE_OFFSET + buffer_c[start]]++;
     start = stop;
   } while ( start < 4 );
 
@@ -722,7 +1004,7 @@ void perform_analysis( int index ) {
     while ( (stop < 4) && (buffer_b[stop] == buffer_b[start]) )
       stop++;
     coeff = stop - start;
-    bfile[buffer_b[start]].frequency++;
+    sums->feature[BFILE_OFFSET + buffer_b[start]]++;
     start = stop;
   } while ( start < 4 );
 
@@ -736,9 +1018,9 @@ void perform_analysis( int index ) {
       stop++;
     coeff = stop - start;
     if ( USE_A_FILE )
-      afile[buffer_a[start]].frequency++;
+      sums->feature[AFILE_OFFSET + buffer_a[start]]++;
     else if ( USE_A_FILE2X )
-      afile2x[buffer_a[start]].frequency++;
+      sums->feature[AFILE2X_OFFSET + buffer_a[start]]++;
     start = stop;
   } while ( start < 4 );
 
@@ -751,7 +1033,7 @@ void perform_analysis( int index ) {
     while ( (stop < 2) && (buffer_8[stop] == buffer_8[start]) )
       stop++;
     coeff = stop - start;
-    diag8[buffer_8[start]].frequency++;
+    sums->feature[DIAG8_OFFSET + buffer_8[start]]++;
     start = stop;
   } while ( start < 2 );
 
@@ -764,7 +1046,7 @@ void perform_analysis( int index ) {
     while ( (stop < 4) && (buffer_7[stop] == buffer_7[start]) )
       stop++;
     coeff = stop - start;
-    diag7[buffer_7[start]].frequency++;
+    sums->feature[DIAG7_OFFSET + buffer_7[start]]++;
     start = stop;
   } while ( start < 4 );
 
@@ -777,7 +1059,7 @@ void perform_analysis( int index ) {
     while ( (stop < 4) && (buffer_6[stop] == buffer_6[start]) )
       stop++;
     coeff = stop - start;
-    diag6[buffer_6[start]].frequency++;
+    sums->feature[DIAG6_OFFSET + buffer_6[start]]++;
     start = stop;
   } while (start < 4 );
 
@@ -790,7 +1072,7 @@ void perform_analysis( int index ) {
     while ( (stop < 4) && (buffer_5[stop] == buffer_5[start]) )
       stop++;
     coeff = stop - start;
-    diag5[buffer_5[start]].frequency++;
+    sums->feature[DIAG5_OFFSET + buffer_5[start]]++;
     start = stop;
   } while ( start < 4 );
 
@@ -803,7 +1085,7 @@ void perform_analysis( int index ) {
     while ( (stop < 4) && (buffer_4[stop] == buffer_4[start]) )
       stop++;
     coeff = stop - start;
-    diag4[buffer_4[start]].frequency++;
+    sums->feature[DIAG4_OFFSET + buffer_4[start]]++;
     start = stop;
   } while ( start < 4 );
 
@@ -816,7 +1098,7 @@ void perform_analysis( int index ) {
     while ( (stop < 8) && (buffer_52[stop] == buffer_52[start]) )
       stop++;
     coeff = stop - start;
-    corner52[buffer_52[start]].frequency++;
+    sums->feature[CORNER52_OFFSET + buffer_52[start]]++;
     start = stop;
   } while ( start < 8 );
 
@@ -829,7 +1111,7 @@ void perform_analysis( int index ) {
     while ( (stop < 4) && (buffer_33[stop] == buffer_33[start]) )
       stop++;
     coeff = stop - start;
-    corner33[buffer_33[start]].frequency++;
+    sums->feature[CORNER33_OFFSET + buffer_33[start]]++;
     start = stop;
   } while ( start < 4 );
 }
@@ -840,7 +1122,7 @@ void perform_analysis( int index ) {
    Updates the gradient based on the position BRANCH.
 */
 
-void perform_evaluation( int index ) {
+void perform_evaluation( PositionState *state, PartialSums *sums, int index ) {
   double error;
   double grad_contrib;
   double curr_weight;
@@ -856,7 +1138,7 @@ void perform_evaluation( int index ) {
   side_to_move = position_list[index].side_to_move;
   stage = position_list[index].stage;
 
-  determine_features( side_to_move, stage,
+  determine_features( state, side_to_move, stage,
 		      &global_parity, buffer_a, buffer_b,
 		      buffer_c, buffer_d, buffer_52,
 		      buffer_33, buffer_8, buffer_7, buffer_6,
@@ -867,7 +1149,7 @@ void perform_evaluation( int index ) {
   error = -position_list[index].score;
 
   curr_weight = weight[stage];
-  total_weight += curr_weight;
+  sums->total_weight += curr_weight;
   error += constant.solution;
   if ( USE_PARITY )
     error += parity.solution * global_parity;
@@ -908,49 +1190,49 @@ void perform_evaluation( int index ) {
     for ( i = 0; i < 4; i++ )
       error += diag4[buffer_4[i]].solution;
   error *= curr_weight;
-  objective += error * error;
-  abs_error_sum += fabs(error);
+  sums->objective += error * error;
+  sums->abs_error_sum += fabs(error);
 
   grad_contrib = 2.0 * curr_weight * error;
-  constant.gradient += grad_contrib;
+  sums->feature[CONSTANT_OFFSET] += grad_contrib;
   if ( USE_PARITY )
-    parity.gradient += grad_contrib * global_parity;
+    sums->feature[PARITY_OFFSET] += grad_contrib * global_parity;
   if ( USE_A_FILE )
     for ( i = 0; i < 4; i++ )
-      afile[buffer_a[i]].gradient += grad_contrib;
+      sums->feature[AFILE_OFFSET + buffer_a[i]] += grad_contrib;
   else if ( USE_A_FILE2X )
     for ( i = 0; i < 4; i++ )
-      afile2x[buffer_a[i]].gradient += grad_contrib;
+      sums->feature[AFILE2X_OFFSET + buffer_a[i]] += grad_contrib;
   if ( USE_B_FILE )
     for ( i = 0; i < 4; i++ )
-      bfile[buffer_b[i]].gradient += grad_contrib;
+      sums->feature[BFILE_OFFSET + buffer_b[i]] += grad_contrib;
   if ( USE_C_FILE )
     for ( i = 0; i < 4; i++ )
-      cfile[buffer_c[i]].gradient += grad_contrib;
+      sums->feature[CFILE_OFFSET + buffer_c[i]] += grad_contrib;
   if ( USE_D_FILE )
     for ( i = 0; i < 4; i++ )
-      dfile[buffer_d[i]].gradient += grad_contrib;
+      sums->feature[DFILE_OFFSET + buffer_d[i]] += grad_contrib;
   if ( USE_CORNER52 )
     for (i = 0; i < 8; i++)
-      corner52[buffer_52[i]].gradient += grad_contrib;
+      sums->feature[CORNER52_OFFSET + buffer_52[i]] += grad_contrib;
   if ( USE_CORNER33 )
     for ( i = 0; i < 4; i++ )
-      corner33[buffer_33[i]].gradient += grad_contrib;
+      sums->feature[CORNER33_OFFSET + buffer_33[i]] += grad_contrib;
   if ( USE_DIAG8 )
     for ( i = 0; i < 2; i++ )
-      diag8[buffer_8[i]].gradient += grad_contrib;
+      sums->feature[DIAG8_OFFSET + buffer_8[i]] += grad_contrib;
   if ( USE_DIAG7 )
     for ( i = 0; i < 4; i++ )
-      diag7[buffer_7[i]].gradient += grad_contrib;
+      sums->feature[DIAG7_OFFSET + buffer_7[i]] += grad_contrib;
   if ( USE_DIAG6 )
     for ( i = 0; i < 4; i++ )
-      diag6[buffer_6[i]].gradient += grad_contrib;
+      sums->feature[DIAG6_OFFSET + buffer_6[i]] += grad_contrib;
   if ( USE_DIAG5 )
     for ( i = 0; i < 4; i++ )
-      diag5[buffer_5[i]].gradient += grad_contrib;
+      sums->feature[DIAG5_OFFSET + buffer_5[i]] += grad_contrib;
   if ( USE_DIAG4 )
     for ( i = 0; i < 4; i++ )
-      diag4[buffer_4[i]].gradient += grad_contrib;
+      sums->feature[DIAG4_OFFSET + buffer_4[i]] += grad_contrib;
 }
 
 
@@ -960,7 +1242,7 @@ void perform_evaluation( int index ) {
    based on the position BRANCH.
 */
 
-void perform_step_update( int index ) {
+void perform_step_update( PositionState *state, PartialSums *sums, int index ) {
   double error;
   double grad_contrib;
   double curr_weight;
@@ -976,7 +1258,7 @@ void perform_step_update( int index ) {
   side_to_move = position_list[index].side_to_move;
   stage = position_list[index].stage;
 
-  determine_features( side_to_move, stage,
+  determine_features( state, side_to_move, stage,
 		      &global_parity, buffer_a, buffer_b,
 		      buffer_c, buffer_d, buffer_52,
 		      buffer_33, buffer_8, buffer_7, buffer_6,
@@ -1059,28 +1341,312 @@ void perform_step_update( int index ) {
   grad_contrib *= curr_weight;
   grad_contrib /= total_weight;
 
-  quad_coeff += grad_contrib * grad_contrib;
-  lin_coeff += 2.0 * grad_contrib * error;
-  const_coeff += error * error;
+  sums->quad_coeff += grad_contrib * grad_contrib;
+  sums->lin_coeff += 2.0 * grad_contrib * error;
+  sums->const_coeff += error * error;
+}
+
+
+/*
+   STORE_FEATURES
+   Stores the pattern indices of position #INDEX in the feature
+   cache. The instances are stored in the same order as they are
+   summed in PERFORM_EVALUATION.
+*/
+
+void store_features( PositionState *state, PartialSums *sums, int index ) {
+  int i, k, slot;
+  int global_parity;
+  int side_to_move, stage;
+  int buffer_a[4], buffer_b[4], buffer_c[4], buffer_d[4];
+  int buffer_52[8], buffer_33[4];
+  int buffer_8[4], buffer_7[4], buffer_6[4], buffer_5[4], buffer_4[4];
+  FeatureCache *cache = &feature_cache;
+
+  side_to_move = position_list[index].side_to_move;
+  stage = position_list[index].stage;
+
+  determine_features( state, side_to_move, stage,
+		      &global_parity, buffer_a, buffer_b,
+		      buffer_c, buffer_d, buffer_52,
+		      buffer_33, buffer_8, buffer_7, buffer_6,
+		      buffer_5, buffer_4 );
+
+  slot = sums->cached_first + sums->relevant_count - 1;
+  cache->stage[slot] = stage;
+  cache->score[slot] = position_list[index].score;
+
+  k = 0;
+  if ( USE_A_FILE || USE_A_FILE2X )
+    for ( i = 0; i < 4; i++ )
+      cache->index[k++][slot] = buffer_a[i];
+  if ( USE_B_FILE )
+    for ( i = 0; i < 4; i++ )
+      cache->index[k++][slot] = buffer_b[i];
+  if ( USE_C_FILE )
+    for ( i = 0; i < 4; i++ )
+      cache->index[k++][slot] = buffer_c[i];
+  if ( USE_D_FILE )
+    for ( i = 0; i < 4; i++ )
+      cache->index[k++][slot] = buffer_d[i];
+  if ( USE_CORNER52 )
+    for ( i = 0; i < 8; i++ )
+      cache->index[k++][slot] = buffer_52[i];
+  if ( USE_CORNER33 )
+    for ( i = 0; i < 4; i++ )
+      cache->index[k++][slot] = buffer_33[i];
+  if ( USE_DIAG8 )
+    for ( i = 0; i < 2; i++ )
+      cache->index[k++][slot] = buffer_8[i];
+  if ( USE_DIAG7 )
+    for ( i = 0; i < 4; i++ )
+      cache->index[k++][slot] = buffer_7[i];
+  if ( USE_DIAG6 )
+    for ( i = 0; i < 4; i++ )
+      cache->index[k++][slot] = buffer_6[i];
+  if ( USE_DIAG5 )
+    for ( i = 0; i < 4; i++ )
+      cache->index[k++][slot] = buffer_5[i];
+  if ( USE_DIAG4 )
+    for ( i = 0; i < 4; i++ )
+      cache->index[k++][slot] = buffer_4[i];
+}
+
+
+/*
+   EVALUATE_CACHED
+   Updates the gradient based on the cached positions of the slice
+   with partial sums SUMS. The instances are handled one at a time
+   so that the index arrays are streamed through.
+*/
+
+void evaluate_cached( PartialSums *sums ) {
+  double curr_weight;
+  double parity_value;
+  int i, k;
+  int first, last;
+  unsigned short *index;
+  double *value, *gradient;
+  FeatureCache *cache = &feature_cache;
+  double *error = cache->error;
+
+  first = sums->cached_first;
+  last = first + sums->cached_count;
+
+  parity_value = feature_solution[PARITY_OFFSET];
+  for ( i = first; i < last; i++ ) {
+    error[i] = -cache->score[i];
+    error[i] += feature_solution[CONSTANT_OFFSET];
+    if ( USE_PARITY )
+      error[i] += parity_value * (cache->stage[i] % 2);
+  }
+
+  for ( k = 0; k < cache->instance_count; k++ ) {
+    index = cache->index[k];
+    value = feature_solution + cache->offset[k];
+    for ( i = first; i < last; i++ )
+      error[i] += value[index[i]];
+  }
+
+  /* Turn the errors into gradient contributions */
+
+  for ( i = first; i < last; i++ ) {
+    curr_weight = weight[cache->stage[i]];
+    sums->total_weight += curr_weight;
+    error[i] *= curr_weight;
+    sums->objective += error[i] * error[i];
+    sums->abs_error_sum += fabs( error[i] );
+    error[i] = 2.0 * curr_weight * error[i];
+    sums->feature[CONSTANT_OFFSET] += error[i];
+    if ( USE_PARITY )
+      sums->feature[PARITY_OFFSET] += error[i] * (cache->stage[i] % 2);
+  }
+
+  for ( k = 0; k < cache->instance_count; k++ ) {
+    index = cache->index[k];
+    gradient = sums->feature + cache->offset[k];
+    for ( i = first; i < last; i++ )
+      gradient[index[i]] += error[i];
+  }
+}
+
+
+/*
+   STEP_UPDATE_CACHED
+   Updates the parameters used to determine the optimal step length
+   based on the cached positions of the slice with partial sums SUMS.
+*/
+
+void step_update_cached( PartialSums *sums ) {
+  double curr_weight;
+  int i, k;
+  int first, last;
+  unsigned short *index;
+  double *value, *direction;
+  FeatureCache *cache = &feature_cache;
+  double *error = cache->error;
+  double *step = cache->step;
+
+  first = sums->cached_first;
+  last = first + sums->cached_count;
+
+  for ( i = first; i < last; i++ ) {
+    error[i] = -cache->score[i];
+    error[i] += feature_solution[CONSTANT_OFFSET];
+    step[i] = 0.0;
+    step[i] += feature_direction[CONSTANT_OFFSET];
+    if ( USE_PARITY ) {
+      error[i] += feature_solution[PARITY_OFFSET] * (cache->stage[i] % 2);
+      step[i] += feature_direction[PARITY_OFFSET] * (cache->stage[i] % 2);
+    }
+  }
+
+  for ( k = 0; k < cache->instance_count; k++ ) {
+    index = cache->index[k];
+    value = feature_solution + cache->offset[k];
+    direction = feature_direction + cache->offset[k];
+    for ( i = first; i < last; i++ ) {
+      error[i] += value[index[i]];
+      step[i] += direction[index[i]];
+    }
+  }
+
+  for ( i = first; i < last; i++ ) {
+    curr_weight = weight[cache->stage[i]];
+    error[i] *= curr_weight;
+    step[i] *= curr_weight;
+    step[i] /= total_weight;
+    sums->quad_coeff += step[i] * step[i];
+    sums->lin_coeff += 2.0 * step[i] * error[i];
+    sums->const_coeff += error[i] * error[i];
+  }
 }
 
 
 /*
    PERFORM_ACTION
    A wrapper to the function given by the function pointer BFUNC.
+   Positions from binary files haven't been filtered on score
+   when loaded, so that is done here.
 */
 
 INLINE
-void perform_action( void (*bfunc)(int), int index ) {
-  node_count++;
-  if ( active[position_list[index].stage] ) {
-    relevant_count++;
-    if ( (interval != 0) && (relevant_count % interval == 0) ) {
-      printf( " %d", relevant_count );
-      fflush( stdout );
-    }
-    unpack_position( index );
-    bfunc( index );
+void perform_action( PositionFunction bfunc, PositionState *state,
+		     PartialSums *sums, int index ) {
+  sums->node_count++;
+  if ( active[position_list[index].stage] &&
+       (abs( position_list[index].score ) <= max_diff) ) {
+    sums->relevant_count++;
+    unpack_position( state, index );
+    bfunc( state, sums, index );
+  }
+}
+
+
+/*
+   REPORT_PROGRESS
+   Adds the RELEVANT positions in a completed slice to the progress
+   count and displays it each time a multiple of INTERVAL is passed.
+*/
+
+void report_progress( int relevant ) {
+  int previous;
+
+#ifdef __linux__
+  pthread_mutex_lock( &progress_mutex );
+#endif
+  previous = progress_count;
+  progress_count += relevant;
+  if ( (interval != 0) &&
+       (progress_count / interval != previous / interval) ) {
+    printf( " %d", progress_count );
+    fflush( stdout );
+  }
+#ifdef __linux__
+  pthread_mutex_unlock( &progress_mutex );
+#endif
+}
+
+
+/*
+   PROCESS_SLICE
+   Applies the function of the current pass to the positions
+   in slice #SLICE and accumulates the result in its partial sums.
+   Passes over the feature cache handle the whole slice at once.
+*/
+
+void process_slice( PositionState *state, int slice ) {
+  int index, first, last;
+  PartialSums *sums = &partial_sums[slice];
+
+  sums->objective = 0.0;
+  sums->abs_error_sum = 0.0;
+  sums->total_weight = 0.0;
+  sums->quad_coeff = 0.0;
+  sums->lin_coeff = 0.0;
+  sums->const_coeff = 0.0;
+  sums->node_count = 0;
+  sums->relevant_count = 0;
+  if ( pass_mode != NO_FEATURES )
+    memset( sums->feature, 0, FEATURE_COUNT * sizeof( double ) );
+
+  if ( pass_cached_function != NULL ) {
+    sums->node_count = sums->cached_count;
+    sums->relevant_count = sums->cached_count;
+    pass_cached_function( sums );
+  }
+  else {
+    first = (int) ((long long) position_count * slice / SLICE_COUNT);
+    last = (int) ((long long) position_count * (slice + 1) / SLICE_COUNT);
+    for ( index = first; index < last; index++ )
+      perform_action( pass_function, state, sums,
+		      (position_index != NULL) ? position_index[index] : index );
+  }
+
+  report_progress( sums->relevant_count );
+}
+
+
+/*
+   SLICE_WORKER
+   Claims slices until there are none left.
+*/
+
+void *slice_worker( void *unused ) {
+  int slice;
+  PositionState state;
+
+  while ( (slice = __sync_fetch_and_add( &next_slice, 1 )) < SLICE_COUNT )
+    process_slice( &state, slice );
+
+  return NULL;
+}
+
+
+/*
+   REDUCE_FEATURES
+   Sums the partial feature sums for the COUNT items starting at
+   OFFSET into either the frequencies or the gradients of ITEM.
+   The slices are always added in the same order.
+*/
+
+void reduce_features( InfoItem *item, int count, int offset ) {
+  int i, slice;
+  double *feature;
+
+  for ( i = 0; i < count; i++ )
+    if ( pass_mode == FEATURE_FREQUENCIES )
+      item[i].frequency = 0;
+    else
+      item[i].gradient = 0.0;
+
+  for ( slice = 0; slice < SLICE_COUNT; slice++ ) {
+    feature = partial_sums[slice].feature + offset;
+    for ( i = 0; i < count; i++ )
+      if ( pass_mode == FEATURE_FREQUENCIES )
+	item[i].frequency += (int) feature[i];
+      else
+	item[i].gradient += feature[i];
   }
 }
 
@@ -1088,14 +1654,89 @@ void perform_action( void (*bfunc)(int), int index ) {
 /*
    ITERATE
    Applies the function BFUNC to all the (relevant)
-   positions in the position list.
+   positions in the position list, or CFUNC to the feature cache
+   if CFUNC isn't NULL. The slices are distributed among
+   THREAD_COUNT threads and the partial sums of MODE are
+   then added to the global sums.
 */
 
-void iterate( void (*bfunc)(int) ) {
-  int index;
+void iterate( PositionFunction bfunc, CachedFunction cfunc, int mode ) {
+  int i, slice;
+#ifdef __linux__
+  int started[MAX_THREAD_COUNT];
+  pthread_t thread[MAX_THREAD_COUNT];
+#endif
+
+  if ( mode != NO_FEATURES )
+    for ( slice = 0; slice < SLICE_COUNT; slice++ )
+      if ( partial_sums[slice].feature == NULL ) {
+	partial_sums[slice].feature =
+	  malloc( FEATURE_COUNT * sizeof( double ) );
+	if ( partial_sums[slice].feature == NULL ) {
+	  printf( "Couldn't allocate space for the feature sums\n" );
+	  exit( EXIT_FAILURE );
+	}
+      }
+
+  pass_function = bfunc;
+  pass_cached_function = cfunc;
+  pass_mode = mode;
+  next_slice = 0;
+  progress_count = 0;
+
+#ifdef __linux__
+  for ( i = 1; i < thread_count; i++ )
+    started[i] = (pthread_create( &thread[i], NULL, slice_worker,
+				  NULL ) == 0);
+  (void) slice_worker( NULL );
+  for ( i = 1; i < thread_count; i++ )
+    if ( started[i] )
+      pthread_join( thread[i], NULL );
+#else
+  (void) slice_worker( NULL );
+#endif
+
+  for ( slice = 0; slice < SLICE_COUNT; slice++ ) {
+    objective += partial_sums[slice].objective;
+    abs_error_sum += partial_sums[slice].abs_error_sum;
+    total_weight += partial_sums[slice].total_weight;
+    quad_coeff += partial_sums[slice].quad_coeff;
+    lin_coeff += partial_sums[slice].lin_coeff;
+    const_coeff += partial_sums[slice].const_coeff;
+    node_count += partial_sums[slice].node_count;
+    relevant_count += partial_sums[slice].relevant_count;
+  }
+
+  if ( mode == NO_FEATURES )
+    return;
 
-  for ( index = 0; index < position_count; index++ )
-    perform_action( bfunc, index );
+  reduce_features( &constant, 1, CONSTANT_OFFSET );
+  if ( USE_PARITY )
+    reduce_features( &parity, 1, PARITY_OFFSET );
+  if ( USE_A_FILE )
+    reduce_features( afile, 6561, AFILE_OFFSET );
+  else if ( USE_A_FILE2X )
+    reduce_features( afile2x, 59049, AFILE2X_OFFSET );
+  if ( USE_B_FILE )
+    reduce_features( bfile, 6561, BFILE_OFFSET );
+  if ( USE_C_FILE )
+    reduce_features( cfile, 6561, CFILE_OFFSET );
+  if ( USE_D_FILE )
+    reduce_features( dfile, 6561, DFILE_OFFSET );
+  if ( USE_DIAG8 )
+    reduce_features( diag8, 6561, DIAG8_OFFSET );
+  if ( USE_DIAG7 )
+    reduce_features( diag7, 2187, DIAG7_OFFSET );
+  if ( USE_DIAG6 )
+    reduce_features( diag6, 729, DIAG6_OFFSET );
+  if ( USE_DIAG5 )
+    reduce_features( diag5, 243, DIAG5_OFFSET );
+  if ( USE_DIAG4 )
+    reduce_features( diag4, 81, DIAG4_OFFSET );
+  if ( USE_CORNER33 )
+    reduce_features( corner33, 19683, CORNER33_OFFSET );
+  if ( USE_CORNER52 )
+    reduce_features( corner52, 59049, CORNER52_OFFSET );
 }
 
 
@@ -1108,7 +1749,60 @@ void analyze_games( void ) {
   node_count = 0;
   relevant_count = 0;
   interval = 0;
-  iterate( perform_analysis );
+  iterate( perform_analysis, NULL, FEATURE_FREQUENCIES );
+}
+
+
+/*
+   GATHER_ITEMS
+   Copies the solution and the search direction of the COUNT items
+   in ITEM to the feature vectors starting at OFFSET.
+*/
+
+void gather_items( InfoItem *item, int count, int offset ) {
+  int i;
+
+  for ( i = 0; i < count; i++ ) {
+    feature_solution[offset + i] = item[i].solution;
+    feature_direction[offset + i] = item[i].direction;
+  }
+}
+
+
+/*
+   GATHER_FEATURE_VALUES
+   Copies the current solution and search direction into the
+   dense feature vectors used with the feature cache.
+*/
+
+void gather_feature_values( void ) {
+  gather_items( &constant, 1, CONSTANT_OFFSET );
+  if ( USE_PARITY )
+    gather_items( &parity, 1, PARITY_OFFSET );
+  if ( USE_A_FILE )
+    gather_items( afile, 6561, AFILE_OFFSET );
+  else if ( USE_A_FILE2X )
+    gather_items( afile2x, 59049, AFILE2X_OFFSET );
+  if ( USE_B_FILE )
+    gather_items( bfile, 6561, BFILE_OFFSET );
+  if ( USE_C_FILE )
+    gather_items( cfile, 6561, CFILE_OFFSET );
+  if ( USE_D_FILE )
+    gather_items( dfile, 6561, DFILE_OFFSET );
+  if ( USE_DIAG8 )
+    gather_items( diag8, 6561, DIAG8_OFFSET );
+  if ( USE_DIAG7 )
+    gather_items( diag7, 2187, DIAG7_OFFSET );
+  if ( USE_DIAG6 )
+    gather_items( diag6, 729, DIAG6_OFFSET );
+  if ( USE_DIAG5 )
+    gather_items( diag5, 243, DIAG5_OFFSET );
+  if ( USE_DIAG4 )
+    gather_items( diag4, 81, DIAG4_OFFSET );
+  if ( USE_CORNER33 )
+    gather_items( corner33, 19683, CORNER33_OFFSET );
+  if ( USE_CORNER52 )
+    gather_items( corner52, 59049, CORNER52_OFFSET );
 }
 
 
@@ -1120,7 +1814,12 @@ void analyze_games( void ) {
 void evaluate_games( void ) {
   node_count = 0;
   relevant_count = 0;
-  iterate( perform_evaluation );
+  if ( use_feature_cache ) {
+    gather_feature_values();
+    iterate( NULL, evaluate_cached, FEATURE_GRADIENTS );
+  }
+  else
+    iterate( perform_evaluation, NULL, FEATURE_GRADIENTS );
 }
 
 
@@ -1132,13 +1831,101 @@ void evaluate_games( void ) {
 void determine_games( void ) {
   node_count = 0;
   relevant_count = 0;
-  iterate( perform_step_update );
+  if ( use_feature_cache ) {
+    gather_feature_values();
+    iterate( NULL, step_update_cached, NO_FEATURES );
+  }
+  else
+    iterate( perform_step_update, NULL, NO_FEATURES );
 }
 
 
 /*
-   PATTERN_SETUP
-   Creates a bunch of maps between patterns.
+   ADD_CACHED_INSTANCES
+   Adds COUNT instances of the feature set at OFFSET to the
+   feature cache.
+*/
+
+void add_cached_instances( int offset, int count ) {
+  int i;
+  FeatureCache *cache = &feature_cache;
+
+  for ( i = 0; i < count; i++ ) {
+    cache->offset[cache->instance_count] = offset;
+    cache->index[cache->instance_count] =
+      malloc( cache->position_count * sizeof( unsigned short ) );
+    if ( cache->index[cache->instance_count] == NULL ) {
+      printf( "Couldn't allocate space for the feature cache\n" );
+      exit( EXIT_FAILURE );
+    }
+    cache->instance_count++;
+  }
+}
+
+
+/*
+   BUILD_FEATURE_CACHE
+   Determines the pattern indices of all relevant positions once.
+   Each slice stores its positions after those of the previous
+   slices, using the counts from the analysis pass.
+*/
+
+void build_feature_cache( void ) {
+  int slice;
+  FeatureCache *cache = &feature_cache;
+
+  cache->position_count = 0;
+  for ( slice = 0; slice < SLICE_COUNT; slice++ ) {
+    partial_sums[slice].cached_first = cache->position_count;
+    partial_sums[slice].cached_count = partial_sums[slice].relevant_count;
+    cache->position_count += partial_sums[slice].relevant_count;
+  }
+
+  cache->instance_count = 0;
+  if ( USE_A_FILE )
+    add_cached_instances( AFILE_OFFSET, 4 );
+  else if ( USE_A_FILE2X )
+    add_cached_instances( AFILE2X_OFFSET, 4 );
+  if ( USE_B_FILE )
+    add_cached_instances( BFILE_OFFSET, 4 );
+  if ( USE_C_FILE )
+    add_cached_instances( CFILE_OFFSET, 4 );
+  if ( USE_D_FILE )
+    add_cached_instances( DFILE_OFFSET, 4 );
+  if ( USE_CORNER52 )
+    add_cached_instances( CORNER52_OFFSET, 8 );
+  if ( USE_CORNER33 )
+    add_cached_instances( CORNER33_OFFSET, 4 );
+  if ( USE_DIAG8 )
+    add_cached_instances( DIAG8_OFFSET, 2 );
+  if ( USE_DIAG7 )
+    add_cached_instances( DIAG7_OFFSET, 4 );
+  if ( USE_DIAG6 )
+    add_cached_instances( DIAG6_OFFSET, 4 );
+  if ( USE_DIAG5 )
+    add_cached_instances( DIAG5_OFFSET, 4 );
+  if ( USE_DIAG4 )
+    add_cached_instances( DIAG4_OFFSET, 4 );
+
+  cache->stage = malloc( cache->position_count * sizeof( unsigned char ) );
+  cache->score = malloc( cache->position_count * sizeof( short ) );
+  cache->error = malloc( cache->position_count * sizeof( double ) );
+  cache->step = malloc( cache->position_count * sizeof( double ) );
+  if ( (cache->stage == NULL) || (cache->score == NULL) ||
+       (cache->error == NULL) || (cache->step == NULL) ) {
+    printf( "Couldn't allocate space for the feature cache\n" );
+    exit( EXIT_FAILURE );
+  }
+
+  node_count = 0;
+  relevant_count = 0;
+  iterate( store_features, NULL, NO_FEATURES );
+}
+
+
+/*
+   PATTERN_SETUP
+   Creates a bunch of maps between patterns.
 */
 
 void pattern_setup( void ) {
@@ -1146,7 +1933,7 @@ void pattern_setup( void ) {
   int pos;
   int pattern, mirror_pattern;
   int power3;
-  int flip8[6561], flip5[81], flip3[27];
+  int flip8[6561], flip5[243], flip3[27];
   int row[10];
 
   /* The inverse patterns */
@@ -1730,64 +2517,14 @@ void update_search_direction(InfoItem *item, int count, double beta) {
 }
 
 
-int main(int argc, char *argv[]) {
-  char *game_file, *option_file;
-  char prefix[32];
-  double alpha, beta;
-  double predicted_objective;
-  double grad_sum, old_grad_sum;
-  int i;
-  int iteration, max_iterations;
-  int count;
-  time_t start_time, curr_time;
-  FILE *option_stream;
-
-  time(&start_time);
-
-  if ( (argc < 4) || (argc > 7) ) {
-    puts( "Usage:" );
-    puts( "  tune8dbs <position file> <option file> <stage>" );
-    puts( "           [<max #positions>] [<iterations>] [<max diff>]" );
-    puts( "" );
-    puts( "Gunnar Andersson, July 19, 1999" );
-    exit( EXIT_FAILURE );
-  }
-
-  game_file = argv[1];
-  option_file = argv[2];
-  analysis_stage = atoi( argv[3] );
-  if ( argc >= 5 )
-    max_positions = atoi( argv[4] );
-  else
-    max_positions = DEFAULT_MAX_POSITIONS;
-  if ( argc >= 6 )
-    max_iterations = atoi( argv[5] );
-  else
-    max_iterations = 100000000;
-  if ( argc >= 7 )
-    max_diff = atoi( argv[6] );
-  else
-    max_diff = 64;
-
-  /* Create pattern tables and reset all feature values */
-
-  printf( "Building pattern tables... " );
-  fflush( stdout );
-  pattern_setup();
-  puts( "done" );
-
-  /* Parse the option file */
+/*
+   ACTIVATE_STAGE
+   Marks the game stages used when training ANALYSIS_STAGE
+   and determines their weights.
+*/
 
-  option_stream = fopen( option_file, "r" );
-  if ( option_stream == NULL ) {
-    printf( "Unable to open option file '%s'\n", option_file );
-    exit( EXIT_FAILURE );
-  }
-  fscanf( option_stream, "%s", prefix );
-  fscanf( option_stream, "%d", &stage_count );
-  for ( i = 0; i < stage_count; i++ )
-    fscanf( option_stream, "%d", &stage[i] );
-  fclose( option_stream );
+void activate_stage( void ) {
+  int i;
 
   for ( i = 0; i <= 60; i++ )
     active[i] = FALSE;
@@ -1809,10 +2546,23 @@ int main(int argc, char *argv[]) {
     if ( active[i] )
       last_active = i;
   printf( "Last active phase: %d\n", last_active );
+}
 
-  /* Initialize the database */   
 
-  read_position_file( game_file );
+/*
+   OPTIMIZE_STAGE
+   Determines the feature values for ANALYSIS_STAGE using at most
+   MAX_ITERATIONS iterations and stores them to disc.
+*/
+
+void optimize_stage( int max_iterations, time_t start_time ) {
+  double alpha, beta;
+  double predicted_objective;
+  double grad_sum, old_grad_sum;
+  int i;
+  int iteration;
+  int count;
+  time_t curr_time;
 
   /* Determine pattern frequencies */
 
@@ -1822,6 +2572,14 @@ int main(int argc, char *argv[]) {
   printf( " done (%d relevant nodes out of %d)\n", relevant_count,
 	  node_count );
 
+  if ( use_feature_cache ) {
+    printf( "Building feature cache..." );
+    fflush( stdout );
+    build_feature_cache();
+    printf( " done (%d positions, %d instances each)\n",
+	    feature_cache.position_count, feature_cache.instance_count );
+  }
+
   interval = (((relevant_count / 5) + 9) / 10) * 10;
 
   printf( "Reading pattern values... " );
@@ -1883,43 +2641,6 @@ int main(int argc, char *argv[]) {
   max_delta = 0.0;
   average_delta = 0.0;
   for (iteration = 1; iteration <= max_iterations; iteration++) {
-    constant.gradient = 0.0;
-    if ( USE_PARITY )
-      parity.gradient = 0.0;
-    if ( USE_A_FILE2X )
-      for ( i = 0; i < 59059; i++ )
-	afile2x[i].gradient = 0.0;
-    if ( USE_CORNER52 )
-      for ( i = 0; i < 59049; i++ )
-	corner52[i].gradient = 0.0;
-    if ( USE_CORNER33 )
-      for ( i = 0; i < 19683; i++ )
-	corner33[i].gradient = 0.0;
-    for ( i = 0; i < 6561; i++ ) {
-      if ( USE_A_FILE )
-	afile[i].gradient = 0.0;
-      if ( USE_B_FILE )
-	bfile[i].gradient = 0.0;
-      if ( USE_C_FILE )
-	cfile[i].gradient = 0.0;
-      if ( USE_D_FILE )
-	dfile[i].gradient = 0.0;
-      if ( USE_DIAG8 )
-	diag8[i].gradient = 0.0;
-      }
-    if ( USE_DIAG7 )
-      for ( i = 0; i < 2187; i++ )
-	diag7[i].gradient = 0.0;
-    if ( USE_DIAG6 )
-      for ( i = 0; i < 729; i++ )
-	diag6[i].gradient = 0.0;
-    if ( USE_DIAG5 )
-      for ( i = 0; i < 243; i++ )
-	diag5[i].gradient = 0.0;
-    if ( USE_DIAG4 )
-      for ( i = 0; i < 81; i++ )
-	diag4[i].gradient = 0.0;
-      
     objective = 0.0;
     abs_error_sum = 0.0;
     printf( "\nDetermining gradient:      " );
@@ -2083,6 +2804,553 @@ int main(int argc, char *argv[]) {
     if (iteration % 10 == 0)
       write_log(iteration);
   }
+}
+
+
+/*
+   READ_OPTION_FILE
+   Reads the stages to tune from the option file FILE_NAME.
+*/
+
+void read_option_file( const char *file_name ) {
+  char prefix[32];
+  int i;
+  FILE *option_stream;
+
+  option_stream = fopen( file_name, "r" );
+  if ( option_stream == NULL ) {
+    printf( "Unable to open option file '%s'\n", file_name );
+    exit( EXIT_FAILURE );
+  }
+  fscanf( option_stream, "%s", prefix );
+  fscanf( option_stream, "%d", &stage_count );
+  for ( i = 0; i < stage_count; i++ )
+    fscanf( option_stream, "%d", &stage[i] );
+  fclose( option_stream );
+}
+
+
+/*
+   QUANTIZE
+   Converts a feature value in discs to the coefficient file
+   representation where 512 units corresponds to one disc.
+*/
+
+int quantize( double value ) {
+  double scaled = floor( 512.0 * value + 0.5 );
+
+  if ( scaled > 32767.0 )
+    return 32767;
+  else if ( scaled < -32768.0 )
+    return -32768;
+  else
+    return (int) scaled;
+}
+
+
+/*
+   ENGINE_VALUE
+   The value of a feature as seen by the engine once the
+   coefficient file has been unpacked.
+*/
+
+INLINE
+int engine_value( double value ) {
+  return quantize( value ) / 4;
+}
+
+
+/*
+   PUT_WORD
+   Writes a 16-bit signed integer to a coefficient file.
+*/
+
+void put_word( gzFile stream, int value ) {
+  gzputc( stream, (value >> 8) & 255 );
+  gzputc( stream, value & 255 );
+}
+
+
+/*
+   EMIT_BATCH
+   Writes the values of one pattern to a coefficient file.
+   Only the patterns which are their own mirror images are
+   stored; the engine recreates the others.
+*/
+
+void emit_batch( gzFile stream, InfoItem *item, int count, int *my_mirror ) {
+  int i;
+
+  for ( i = 0; i < count; i++ )
+    if ( (my_mirror == NULL) || (my_mirror[i] == i) )
+      put_word( stream, quantize( item[i].solution ) );
+}
+
+
+/*
+   LOAD_STAGE_VALUES
+   Reads the feature values stored for ANALYSIS_STAGE.
+   Features not in use are zeroed.
+*/
+
+void load_stage_values( void ) {
+  initialize_non_patterns( "main" );
+  if ( !USE_PARITY )
+    parity.solution = 0.0;
+  if ( USE_A_FILE2X )
+    initialize_solution( "afile2x", afile2x, 59049, mirror82x );
+  if ( USE_B_FILE )
+    initialize_solution( "bfile", bfile, 6561, mirror );
+  if ( USE_C_FILE )
+    initialize_solution( "cfile", cfile, 6561, mirror );
+  if ( USE_D_FILE )
+    initialize_solution( "dfile", dfile, 6561, mirror );
+  if ( USE_DIAG8 )
+    initialize_solution( "diag8", diag8, 6561, mirror );
+  if ( USE_DIAG7 )
+    initialize_solution( "diag7", diag7, 2187, mirror7 );
+  if ( USE_DIAG6 )
+    initialize_solution( "diag6", diag6, 729, mirror6 );
+  if ( USE_DIAG5 )
+    initialize_solution( "diag5", diag5, 243, mirror5 );
+  if ( USE_DIAG4 )
+    initialize_solution( "diag4", diag4, 81, mirror4 );
+  if ( USE_CORNER33 )
+    initialize_solution( "corner33", corner33, 19683, mirror33 );
+  if ( USE_CORNER52 )
+    initialize_solution( "corner52", corner52, 59049, identity10 );
+}
+
+
+/*
+   ENGINE_EVALUATION
+   Computes the score the engine should give position #INDEX
+   with the current feature values, in the engine's units
+   where 128 corresponds to one disc.
+*/
+
+int engine_evaluation( PositionState *state, int index ) {
+  int i;
+  int global_parity;
+  int side_to_move, stage;
+  int buffer_a[4], buffer_b[4], buffer_c[4], buffer_d[4];
+  int buffer_52[8], buffer_33[4];
+  int buffer_8[4], buffer_7[4], buffer_6[4], buffer_5[4], buffer_4[4];
+  short score;
+
+  side_to_move = position_list[index].side_to_move;
+  stage = position_list[index].stage;
+
+  determine_features( state, side_to_move, stage,
+		      &global_parity, buffer_a, buffer_b,
+		      buffer_c, buffer_d, buffer_52,
+		      buffer_33, buffer_8, buffer_7, buffer_6,
+		      buffer_5, buffer_4 );
+
+  score = engine_value( constant.solution );
+  if ( stage % 2 == 1 )
+    score += engine_value( parity.solution );
+  for ( i = 0; i < 4; i++ ) {
+    if ( USE_A_FILE2X )
+      score += engine_value( afile2x[buffer_a[i]].solution );
+    if ( USE_B_FILE )
+      score += engine_value( bfile[buffer_b[i]].solution );
+    if ( USE_C_FILE )
+      score += engine_value( cfile[buffer_c[i]].solution );
+    if ( USE_D_FILE )
+      score += engine_value( dfile[buffer_d[i]].solution );
+    if ( USE_CORNER33 )
+      score += engine_value( corner33[buffer_33[i]].solution );
+    if ( USE_DIAG7 )
+      score += engine_value( diag7[buffer_7[i]].solution );
+    if ( USE_DIAG6 )
+      score += engine_value( diag6[buffer_6[i]].solution );
+    if ( USE_DIAG5 )
+      score += engine_value( diag5[buffer_5[i]].solution );
+    if ( USE_DIAG4 )
+      score += engine_value( diag4[buffer_4[i]].solution );
+  }
+  if ( USE_CORNER52 )
+    for ( i = 0; i < 8; i++ )
+      score += engine_value( corner52[buffer_52[i]].solution );
+  if ( USE_DIAG8 )
+    for ( i = 0; i < 2; i++ )
+      score += engine_value( diag8[buffer_8[i]].solution );
+
+  return score;
+}
+
+
+/*
+   WRITE_CHECK_POSITIONS
+   Writes up to CHECK_POSITIONS positions with stage CHECK_STAGE together
+   with their expected engine scores to STREAM. Positions where one
+   side has been wiped out are left out as the engine doesn't use
+   the patterns for those.
+*/
+
+void write_check_positions( FILE *stream, int check_stage ) {
+  char square[3] = { 'X', '-', 'O' };
+  int i, j, k, index;
+  int written;
+  int disc_count[3];
+  PositionState state;
+
+  written = 0;
+  for ( k = 0; (k < position_count) && (written < CHECK_POSITIONS); k++ ) {
+    index = (position_index != NULL) ? position_index[k] : k;
+    if ( position_list[index].stage != check_stage )
+      continue;
+    unpack_position( &state, index );
+    disc_count[BLACKSQ] = disc_count[EMPTY] = disc_count[WHITESQ] = 0;
+    for ( i = 1; i <= 8; i++ )
+      for ( j = 1; j <= 8; j++ )
+	disc_count[state.board[10 * i + j]]++;
+    if ( (disc_count[BLACKSQ] == 0) || (disc_count[WHITESQ] == 0) )
+      continue;
+    for ( i = 1; i <= 8; i++ )
+      for ( j = 1; j <= 8; j++ )
+	fputc( square[state.board[10 * i + j]], stream );
+    fprintf( stream, " %c %d %d\n",
+	     square[position_list[index].side_to_move], check_stage,
+	     engine_evaluation( &state, index ) );
+    written++;
+  }
+}
+
+
+/*
+   EMIT_COEFFICIENTS
+   Packs the feature values of all stages in the option file
+   into a coefficient file which the engine can load. If
+   CHECK_FILE isn't NULL, positions from the position list and
+   the scores the engine should give them are written to it.
+*/
+
+void emit_coefficients( const char *file_name, const char *check_file ) {
+  int i;
+  int emitted_count;
+  gzFile stream;
+  FILE *check_stream = NULL;
+
+  emitted_count = 0;
+  for ( i = 0; i < stage_count; i++ )
+    if ( stage[i] < 60 )
+      emitted_count++;
+
+  stream = gzopen( file_name, "wb9" );
+  if ( stream == NULL ) {
+    printf( "Error creating '%s'\n", file_name );
+    exit( EXIT_FAILURE );
+  }
+  if ( check_file != NULL ) {
+    check_stream = fopen( check_file, "w" );
+    if ( check_stream == NULL ) {
+      printf( "Error creating '%s'\n", check_file );
+      exit( EXIT_FAILURE );
+    }
+  }
+
+  put_word( stream, EVAL_MAGIC1 );
+  put_word( stream, EVAL_MAGIC2 );
+  put_word( stream, emitted_count + 1 );
+  for ( i = 0; i < stage_count; i++ )
+    if ( stage[i] < 60 )
+      put_word( stream, stage[i] );
+
+  for ( analysis_stage = 0; analysis_stage < stage_count; analysis_stage++ ) {
+    if ( stage[analysis_stage] >= 60 )
+      continue;
+    load_stage_values();
+    put_word( stream, quantize( constant.solution ) );
+    put_word( stream, quantize( parity.solution ) );
+    emit_batch( stream, afile2x, 59049, mirror82x );
+    emit_batch( stream, bfile, 6561, mirror );
+    emit_batch( stream, cfile, 6561, mirror );
+    emit_batch( stream, dfile, 6561, mirror );
+    emit_batch( stream, diag8, 6561, mirror );
+    emit_batch( stream, diag7, 2187, mirror7 );
+    emit_batch( stream, diag6, 729, mirror6 );
+    emit_batch( stream, diag5, 243, mirror5 );
+    emit_batch( stream, diag4, 81, mirror4 );
+    emit_batch( stream, corner33, 19683, mirror33 );
+    emit_batch( stream, corner52, 59049, NULL );
+    if ( check_stream != NULL )
+      write_check_positions( check_stream, stage[analysis_stage] );
+  }
+
+  if ( gzclose( stream ) != Z_OK ) {
+    printf( "Error writing '%s'\n", file_name );
+    exit( EXIT_FAILURE );
+  }
+  if ( check_stream != NULL )
+    fclose( check_stream );
+
+  printf( "%d stages written to '%s'\n", emitted_count, file_name );
+}
+
+
+/*
+   BUCKET_POSITIONS
+   Sorts the indices of the positions by game stage into
+   POSITION_INDEX so that the positions needed by each training
+   stage are contiguous there; the positions themselves stay where
+   they are in the mapped file. BUCKET_FIRST[S] is the index in
+   POSITION_INDEX of the first position with stage S.
+*/
+
+void bucket_positions( void ) {
+  int i;
+  int count[61];
+  int next[61];
+
+  for ( i = 0; i <= 60; i++ )
+    count[i] = 0;
+  for ( i = 0; i < position_count; i++ )
+    if ( (position_list[i].stage >= 0) && (position_list[i].stage <= 60) )
+      count[position_list[i].stage]++;
+
+  bucket_first[0] = 0;
+  for ( i = 0; i <= 60; i++ ) {
+    next[i] = bucket_first[i];
+    bucket_first[i + 1] = bucket_first[i] + count[i];
+  }
+
+  position_index = malloc( bucket_first[61] * sizeof( int ) );
+  if ( (position_index == NULL) && (bucket_first[61] > 0) ) {
+    printf( "Couldn't allocate space for %d position indices\n",
+	    position_count );
+    exit( EXIT_FAILURE );
+  }
+  for ( i = 0; i < position_count; i++ )
+    if ( (position_list[i].stage >= 0) && (position_list[i].stage <= 60) )
+      position_index[next[position_list[i].stage]++] = i;
+
+  position_count = bucket_first[61];
+}
+
+
+/*
+   TRAIN_STAGE
+   Optimizes ANALYSIS_STAGE using only the buckets of the stages
+   it covers. The output is written to a file of its own.
+*/
+
+void train_stage( int max_iterations, time_t start_time ) {
+  char file_name[32];
+  int i;
+  int first, last;
+
+  sprintf( file_name, "output.s%d", analysis_stage );
+  if ( freopen( file_name, "w", stdout ) == NULL )
+    exit( EXIT_FAILURE );
+
+  activate_stage();
+  printf( "Using %d thread(s)\n", thread_count );
+
+  first = 61;
+  last = -1;
+  for ( i = 0; i <= 60; i++ )
+    if ( active[i] ) {
+      if ( i < first )
+	first = i;
+      last = i;
+    }
+  if ( last < first )
+    position_count = 0;
+  else {
+    position_index += bucket_first[first];
+    position_count = bucket_first[last + 1] - bucket_first[first];
+  }
+
+  optimize_stage( max_iterations, start_time );
+}
+
+
+/*
+   TRAIN_STAGES
+   Optimizes all stages in the option file. Each stage is handled
+   by a child process of its own, so that it gets a private copy of
+   the feature tables while sharing the positions; the threads are
+   divided between the stages running at the same time.
+   Returns the number of stages that failed.
+*/
+
+int train_stages( int max_iterations, time_t start_time ) {
+#ifdef __linux__
+  int i;
+  int concurrent, running, started;
+  int failures;
+  int status;
+  pid_t pid;
+  pid_t stage_pid[64];
+
+  concurrent = MIN( thread_count, stage_count );
+  thread_count = MAX( 1, thread_count / concurrent );
+  printf( "Training %d stages, %d at a time with %d thread(s) each\n",
+	  stage_count, concurrent, thread_count );
+
+  running = 0;
+  started = 0;
+  failures = 0;
+  while ( (started < stage_count) || (running > 0) ) {
+    if ( (started < stage_count) && (running < concurrent) ) {
+      fflush( stdout );
+      pid = fork();
+      if ( pid < 0 ) {
+	printf( "Couldn't start stage %d\n", started );
+	exit( EXIT_FAILURE );
+      }
+      if ( pid == 0 ) {
+	analysis_stage = started;
+	train_stage( max_iterations, start_time );
+	exit( EXIT_SUCCESS );
+      }
+      stage_pid[started] = pid;
+      printf( "Stage %d started\n", started );
+      started++;
+      running++;
+    }
+    else {
+      pid = wait( &status );
+      if ( pid < 0 )
+	break;
+      running--;
+      for ( i = 0; i < started; i++ )
+	if ( stage_pid[i] == pid ) {
+	  if ( WIFEXITED( status ) && (WEXITSTATUS( status ) == EXIT_SUCCESS) )
+	    printf( "Stage %d done\n", i );
+	  else {
+	    printf( "Stage %d failed\n", i );
+	    failures++;
+	  }
+	}
+    }
+    fflush( stdout );
+  }
+
+  return failures;
+#else
+  puts( "Training all stages at once is not supported on this platform" );
+  return stage_count;
+#endif
+}
+
+
+int main(int argc, char *argv[]) {
+  char *game_file, *option_file;
+  int max_iterations;
+  int train_all_stages;
+  time_t start_time;
+
+  time(&start_time);
+
+  if ( (argc >= 4) && (argc <= 5) && !strcmp( argv[1], "-convert" ) ) {
+    if ( argc == 5 )
+      max_diff = atoi( argv[4] );
+    else
+      max_diff = 64;
+    convert_position_file( argv[2], argv[3] );
+    return EXIT_SUCCESS;
+  }
+
+  if ( ((argc == 4) || (argc == 6)) && !strcmp( argv[1], "-emit" ) ) {
+    pattern_setup();
+    read_option_file( argv[2] );
+    if ( argc == 6 ) {
+      max_positions = 0;
+      max_diff = 64;
+      read_position_file( argv[4] );
+    }
+    emit_coefficients( argv[3], (argc == 6) ? argv[5] : NULL );
+    return EXIT_SUCCESS;
+  }
+
+  use_feature_cache = FALSE;
+  if ( (argc >= 2) && !strcmp( argv[1], "-cache" ) ) {
+    use_feature_cache = TRUE;
+    argc--;
+    argv++;
+  }
+
+  if ( (argc < 4) || (argc > 8) ) {
+    puts( "Usage:" );
+    puts( "  tune8dbs [-cache] <position file> <option file> <stage>" );
+    puts( "           [<max #positions>] [<iterations>] [<max diff>]" );
+    puts( "           [<threads>]" );
+    puts( "  tune8dbs -convert <text position file> <binary position file>" );
+    puts( "           [<max diff>]" );
+    puts( "  tune8dbs -emit <option file> <coefficient file>" );
+    puts( "           [<position file> <check file>]" );
+    puts( "" );
+    puts( "The position file is either a text file or a binary file" );
+    puts( "created with -convert. <max #positions> 0 uses all positions" );
+    puts( "in a binary file. -cache stores the pattern indices of all" );
+    puts( "relevant positions in memory instead of recomputing them." );
+    puts( "<stage> all trains every stage in the option file." );
+    puts( "-emit packs the stored values of all stages into a coefficient" );
+    puts( "file for the engine; the check file can be verified with" );
+    puts( "evalcheck." );
+    puts( "" );
+    puts( "Gunnar Andersson, July 19, 1999" );
+    exit( EXIT_FAILURE );
+  }
+
+  game_file = argv[1];
+  option_file = argv[2];
+  train_all_stages = !strcmp( argv[3], "all" );
+  analysis_stage = atoi( argv[3] );
+  if ( argc >= 5 )
+    max_positions = atoi( argv[4] );
+  else
+    max_positions = 0;
+  if ( argc >= 6 )
+    max_iterations = atoi( argv[5] );
+  else
+    max_iterations = 100000000;
+  if ( argc >= 7 )
+    max_diff = atoi( argv[6] );
+  else
+    max_diff = 64;
+  if ( argc >= 8 )
+    thread_count = atoi( argv[7] );
+  else {
+#ifdef __linux__
+    thread_count = (int) sysconf( _SC_NPROCESSORS_ONLN );
+#else
+    thread_count = 1;
+#endif
+  }
+  if ( thread_count < 1 )
+    thread_count = 1;
+  else if ( thread_count > MAX_THREAD_COUNT )
+    thread_count = MAX_THREAD_COUNT;
+
+  /* Create pattern tables and reset all feature values */
+
+  printf( "Building pattern tables... " );
+  fflush( stdout );
+  pattern_setup();
+  puts( "done" );
+
+  /* Parse the option file */
+
+  read_option_file( option_file );
+
+  /* Initialize the database */   
+
+  read_position_file( game_file );
+
+  if ( train_all_stages ) {
+    bucket_positions();
+    if ( train_stages( max_iterations, start_time ) != 0 )
+      return EXIT_FAILURE;
+  }
+  else {
+    activate_stage();
+    printf( "Using %d thread(s)\n", thread_count );
+    optimize_stage( max_iterations, start_time );
+  }
 
   return EXIT_SUCCESS;
 }
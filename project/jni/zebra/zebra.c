@@ -36,7 +36,9 @@
 #include "myrandom.h"
 #include "osfbook.h"
 #include "patterns.h"
+#include "probcut.h"
 #include "search.h"
+#include "searchstat.h"
 #include "thordb.h"
 #include "timer.h"
 
@@ -99,6 +101,8 @@ static int use_book = DEFAULT_USE_BOOK;
 static int wld_only = DEFAULT_WLD_ONLY;
 static int use_learning;
 static int use_thor;
+static FILE *stats_stream = NULL;
+static int stats_search_count = 0;
 
 
 
@@ -127,6 +131,19 @@ static void
 run_endgame_script( const char *in_file_name, const char *out_file_name,
 		    int display_line );
 
+#if SCRIPT_ONLY
+static int
+run_endgame_suite( const char *suite_file_name );
+#endif
+
+/* Search statistics */
+
+static void
+begin_search_stats( void );
+
+static void
+end_search_stats( int side_to_move, int move );
+
 /* File handling procedures */
 
 #if !SCRIPT_ONLY
@@ -151,6 +168,10 @@ main( int argc, char *argv[] ) {
   const char *game_file_name = NULL;
   const char *script_in_file;
   const char *script_out_file;
+  const char *mpc_file_name = NULL;
+  const char *profile_file_name = NULL;
+  const char *profile_name = NULL;
+  const char *stats_file_name = NULL;
 #if !SCRIPT_ONLY
   const char *move_sequence = NULL;
   const char *move_file_name = NULL;
@@ -163,8 +184,12 @@ main( int argc, char *argv[] ) {
   int repeat = 1;
 #endif
   int run_script;
+#if SCRIPT_ONLY
+  const char *suite_file_name = NULL;
+#endif
   int script_optimal_line = DEFAULT_DISPLAY_LINE;
   int komi;
+  int status = EXIT_SUCCESS;
   time_t timer;
 
 #if SCRIPT_ONLY
@@ -297,6 +322,28 @@ main( int argc, char *argv[] ) {
       }
       use_book = atoi( argv[arg_index] );
     }
+    else if ( !strcasecmp( argv[arg_index], "-mpc" ) ) {
+      if ( ++arg_index == argc ) {
+	help = TRUE;
+	continue;
+      }
+      mpc_file_name = argv[arg_index];
+    }
+    else if ( !strcasecmp( argv[arg_index], "-probcut" ) ) {
+      if ( arg_index + 2 >= argc ) {
+	help = TRUE;
+	continue;
+      }
+      profile_file_name = argv[++arg_index];
+      profile_name = argv[++arg_index];
+    }
+    else if ( !strcasecmp( argv[arg_index], "-stats" ) ) {
+      if ( ++arg_index == argc ) {
+	help = TRUE;
+	continue;
+      }
+      stats_file_name = argv[arg_index];
+    }
 #if !SCRIPT_ONLY
     else if ( !strcasecmp( argv[arg_index], "-time" ) ) {
       if ( arg_index + 4 >= argc ) {
@@ -433,6 +480,13 @@ main( int argc, char *argv[] ) {
       script_out_file = argv[arg_index];
       run_script = TRUE;
     }
+    else if ( !strcasecmp( argv[arg_index], "-suite" ) ) {
+      if ( ++arg_index == argc ) {
+	help = TRUE;
+	continue;
+      }
+      suite_file_name = argv[arg_index];
+    }
     else if ( !strcasecmp( argv[arg_index], "-komi" ) ) {
       if ( ++arg_index == argc ) {
 	help = TRUE;
@@ -448,8 +502,12 @@ main( int argc, char *argv[] ) {
   }
 
 #if SCRIPT_ONLY
-  if ( !run_script )
+  if ( !run_script && (suite_file_name == NULL) )
     help = TRUE;
+  if ( (komi != 0) && (suite_file_name != NULL) ) {
+    puts( "Komi can't be applied to the endgame suite." );
+    exit( EXIT_FAILURE );
+  }
   if ( komi != 0 ) {
     if ( !wld_only ) {
       puts( "Komi can only be applied to WLD solves." );
@@ -463,7 +521,9 @@ main( int argc, char *argv[] ) {
 #if SCRIPT_ONLY
     puts( "Usage:" );
     puts( "  scrzebra [-e ...] [-h ...] [-wld ...] [-line ...] [-b ...] "
-	  "[-komi ...] -script ..." );
+	  "[-mpc ...] [-probcut ...] [-komi ...] [-stats ...] -script ..." );
+    puts( "  scrzebra [-h ...] [-b ...] [-mpc ...] [-probcut ...] "
+	  "[-stats ...] -suite ..." );
     puts( "" );
     puts( "  -e <echo?>" );
     printf( "    Toggles screen output on/off (default %d).\n\n",
@@ -473,6 +533,11 @@ main( int argc, char *argv[] ) {
 	    DEFAULT_HASH_BITS );
     puts( "  -script <script file> <output file>" );
     puts( "    Solves all positions in script file for exact score.\n" );
+    puts( "  -suite <suite file>" );
+    puts( "    Solves all positions in suite file (e.g. endsuite.txt) for "
+	  "exact score" );
+    puts( "    and WLD, checks the known scores and reports nodes, time "
+	  "and speed.\n" );
     puts( "  -wld <only solve WLD?>" );
     printf( "    Toggles WLD only solve on/off (default %d).\n\n",
 	    DEFAULT_WLD_ONLY );
@@ -483,15 +548,26 @@ main( int argc, char *argv[] ) {
     printf( "    Toggles usage of opening book on/off (default %d).\n",
 	    DEFAULT_USE_BOOK );
     puts( "" );
+    puts( "  -mpc <statistics file>" );
+    puts( "    Multi-ProbCut statistics created by mpcstat." );
+    puts( "" );
+    puts( "  -probcut <profile file> <profile>" );
+    puts( "    Selects a Multi-ProbCut profile, e.g. probcut.txt blitz." );
+    puts( "" );
     puts( "  -komi <komi>" );
     puts( "    Number of discs that white has to win with (only WLD)." );
     puts( "" );
+    puts( "  -stats <file>" );
+    puts( "    Writes the search statistics of each move, or each script" );
+    puts( "    position, as a line of JSON to <file> (- for stdout);" );
+    puts( "    requires a build with -DSEARCH_STATS." );
+    puts( "" );
 #else    
     puts( "Usage:" );
     puts( "  zebra [-b -e -g -h -l -p -t -time -w -learn -slack -dev -log" );
     puts( "         -keepdraw -draw2black -draw2white -draw2none" );
     puts( "         -private -public -test -seq -thor -script -analyze ?" );
-    puts( "         -repeat -seqfile]" );
+    puts( "         -repeat -seqfile -mpc -probcut -stats]" );
     puts( "" );
     puts( "Flags:" );
     puts( "  ? " );
@@ -555,6 +631,17 @@ main( int argc, char *argv[] ) {
     puts( "  -log <file name>" );
     puts( "    Append all game results to the specified file." );
     puts( "" );
+    puts( "  -mpc <statistics file>" );
+    puts( "    Multi-ProbCut statistics created by mpcstat." );
+    puts( "" );
+    puts( "  -probcut <profile file> <profile>" );
+    puts( "    Selects a Multi-ProbCut profile, e.g. probcut.txt blitz." );
+    puts( "" );
+    puts( "  -stats <file>" );
+    puts( "    Writes the search statistics of each move, or each script" );
+    puts( "    position, as a line of JSON to <file> (- for stdout);" );
+    puts( "    requires a build with -DSEARCH_STATS." );
+    puts( "" );
     puts( "  -private" );
     puts( "    Treats all draws as losses for both sides." );
     puts( "" );
@@ -608,6 +695,36 @@ main( int argc, char *argv[] ) {
 
   global_setup( use_random, hash_bits );
   init_thor_database();
+  if ( stats_file_name != NULL ) {
+    if ( !SEARCH_STATS_ENABLED )
+      puts( "Search statistics are not compiled in (use -DSEARCH_STATS)." );
+    if ( !strcmp( stats_file_name, "-" ) )
+      stats_stream = stdout;
+    else {
+      stats_stream = fopen( stats_file_name, "w" );
+      if ( stats_stream == NULL ) {
+	printf( "Cannot create statistics file %s\n", stats_file_name );
+	exit( EXIT_FAILURE );
+      }
+    }
+  }
+
+  if ( (mpc_file_name != NULL) &&
+       (load_probcut_statistics( mpc_file_name ) < 0) ) {
+    printf( "Cannot open Multi-ProbCut statistics file %s\n",
+	    mpc_file_name );
+    exit( EXIT_FAILURE );
+  }
+  if ( profile_file_name != NULL )
+    switch ( load_probcut_profile( profile_file_name, profile_name ) ) {
+    case -1:
+      printf( "Cannot open Multi-ProbCut profile file %s\n",
+	      profile_file_name );
+      exit( EXIT_FAILURE );
+    case 0:
+      printf( "No profile '%s' in %s\n", profile_name, profile_file_name );
+      exit( EXIT_FAILURE );
+    }
 
   if ( use_book )
     init_learn( "book.bin", TRUE );
@@ -641,6 +758,11 @@ main( int argc, char *argv[] ) {
   if ( run_script )
     run_endgame_script( script_in_file, script_out_file,
 			script_optimal_line );
+#if SCRIPT_ONLY
+  if ( (suite_file_name != NULL) &&
+       (run_endgame_suite( suite_file_name ) != 0) )
+    status = EXIT_FAILURE;
+#endif
 #if !SCRIPT_ONLY
   else {
     if ( tournament )
@@ -654,9 +776,12 @@ main( int argc, char *argv[] ) {
   }
 #endif
 
+  if ( (stats_stream != NULL) && (stats_stream != stdout) )
+    fclose( stats_stream );
+
   global_terminate();
 
-  return EXIT_SUCCESS;
+  return status;
 }
 
 
@@ -710,7 +835,6 @@ play_tournament( const char *move_sequence ) {
 	color_score[WHITESQ] += 1.0;
       }
     }
-  adjust_counter( &tourney_nodes );
   printf( "\n\nTime:  %.1f s\nNodes: %.0f\n", tourney_time,
 	  counter_value( &tourney_nodes ) );
   puts( "\nCompetitors:" );
@@ -851,6 +975,7 @@ play_game( const char *file_name,
     (void) read_game_database( "thor\\wth_1982.wtb" );
     (void) read_game_database( "thor\\wth_1981.wtb" );
     (void) read_game_database( "thor\\wth_1980.wtb" );
+    (void) build_thor_index( "thor\\wthor.idx" );
     database_stop = get_real_timer();
 #if FULL_ANALYSIS
     frequency_analysis( get_total_game_count() );
@@ -1006,12 +1131,14 @@ play_game( const char *file_name,
 	  timed_search = (skill[side_to_move] >= 60);
 	  toggle_experimental( FALSE );
 
+	  begin_search_stats();
 	  curr_move =
 	    compute_move( side_to_move, TRUE, player_time[side_to_move],
 			  player_increment[side_to_move], timed_search,
 			  use_book, skill[side_to_move],
 			  exact_skill[side_to_move], wld_skill[side_to_move],
 			  FALSE, &eval_info );
+	  end_search_stats( side_to_move, curr_move );
 	  if ( side_to_move == BLACKSQ )
 	    set_evals( produce_compact_eval( eval_info ), 0.0 );
 	  else
@@ -1101,9 +1228,7 @@ play_game( const char *file_name,
     display_board( stdout, board, side_to_move, TRUE, use_timer, TRUE );
   }
 
-  adjust_counter( &total_nodes );
   node_val = counter_value( &total_nodes );
-  adjust_counter( &total_evaluations );
   eval_val = counter_value( &total_evaluations );
   printf( "\nBlack: %d   White: %d\n", disc_count( BLACKSQ ),
 	  disc_count( WHITESQ ) );
@@ -1284,6 +1409,7 @@ analyze_game( const char *move_string ) {
       set_hash_transformation( played_trans1, played_trans2 );
 #endif
 
+      begin_search_stats();
       curr_move = provided_move[disks_played];
       opponent = OPP( side_to_move );
       (void) make_move( side_to_move, curr_move, TRUE );
@@ -1330,6 +1456,7 @@ analyze_game( const char *move_string ) {
 		      use_book, skill[side_to_move],
 		      exact_skill[side_to_move], wld_skill[side_to_move],
 		      TRUE, &best_info2 );
+      end_search_stats( side_to_move, curr_move );
 
       if ( side_to_move == BLACKSQ )
 	set_evals( produce_compact_eval( best_info2 ), 0.0 );
@@ -1440,6 +1567,139 @@ analyze_game( const char *move_string ) {
 
 #define BUFFER_SIZE           256
 
+/*
+   SETUP_SCRIPT_POSITION
+   Resets the game state and sets up the board described by a
+   script line (64 board characters followed by the side to move).
+*/
+
+static void
+setup_script_position( const char *buffer, int line, int *side_to_move ) {
+  char board_string[BUFFER_SIZE], stm_string[BUFFER_SIZE];
+  int row, col, pos;
+  int scanned, token;
+
+  game_init( NULL, side_to_move );
+  set_slack( 0.0 );
+  toggle_human_openings( FALSE );
+  reset_book_search();
+  set_deviation_value( 0, 60, 0.0 );
+  setup_hash( TRUE );
+
+  scanned = sscanf( buffer, "%s %s", board_string, stm_string );
+  if ( scanned != 2 ) {
+    printf( "\nError parsing line %d - aborting\n\n", line );
+    exit( EXIT_FAILURE );
+  }
+
+  if ( strlen( stm_string ) != 1 ) {
+    printf( "\nAmbiguous side to move on line %d - aborting\n\n", line );
+    exit( EXIT_FAILURE );
+  }
+  switch ( stm_string[0] ) {
+  case 'O':
+  case '0':
+    *side_to_move = WHITESQ;
+    break;
+  case '*':
+  case 'X':
+    *side_to_move = BLACKSQ;
+    break;
+  default:
+    printf( "\nBad side-to-move indicator on line %d - aborting\n\n",
+	    line );
+  }
+
+  if ( strlen( board_string ) != 64 ) {
+    printf( "\nBoard on line %d doesn't contain 64 positions - aborting\n\n",
+	    line );
+    exit( EXIT_FAILURE );
+  }
+
+  token = 0;
+  for ( row = 1; row <= 8; row++ )
+    for ( col = 1; col <= 8; col++ ) {
+      pos = 10 * row + col;
+      switch ( board_string[token] ) {
+      case '*':
+      case 'X':
+      case 'x':
+	board[pos] = BLACKSQ;
+	break;
+      case 'O':
+      case '0':
+      case 'o':
+	board[pos] = WHITESQ;
+	break;
+      case '-':
+      case '.':
+	board[pos] = EMPTY;
+	break;
+      default:
+	printf( "\nBad character '%c' in board on line %d - aborting\n\n",
+		board_string[token], line );
+	break;
+      }
+      token++;
+    }
+  disks_played = disc_count( BLACKSQ ) + disc_count( WHITESQ ) - 4;
+}
+
+
+/*
+   SOLVE_SCRIPT_POSITION
+   Solves the current position to the end of the game; exact solves
+   are performed if EXACT is 60, otherwise only WLD. If the side to
+   move has to pass, *SIDE_TO_MOVE is changed to the opponent.
+   Returns the number of passes (2 if the game is over).
+*/
+
+static int
+solve_script_position( int *side_to_move, int book, int exact,
+		       EvaluationType *eval_info ) {
+  int my_time, my_incr;
+  int mid, wld;
+  int timed_search;
+  int move;
+  int pass_count;
+
+  my_time = 100000000;
+  my_incr = 0;
+  timed_search = FALSE;
+  mid = 60;
+  wld = 60;
+
+  start_move( my_time, my_incr, disks_played + 4 );
+  determine_move_time( my_time, my_incr, disks_played + 4 );
+
+  begin_search_stats();
+  pass_count = 0;
+  move = compute_move( *side_to_move, TRUE, my_time, my_incr, timed_search,
+		       book, mid, exact, wld, TRUE, eval_info );
+  if ( move == PASS ) {
+    pass_count++;
+    *side_to_move = OPP( *side_to_move );
+    move = compute_move( *side_to_move, TRUE, my_time, my_incr, timed_search,
+			 book, mid, exact, wld, TRUE, eval_info );
+    if ( move == PASS ) {  /* Both pass, game over. */
+      int my_discs = disc_count( *side_to_move );
+      int opp_discs = disc_count( OPP( *side_to_move ) );
+      if ( my_discs > opp_discs )
+	my_discs = 64 - opp_discs;
+      else if ( opp_discs > my_discs )
+	opp_discs = 64 - my_discs;
+      else
+	my_discs = opp_discs = 32;
+      eval_info->score = 128 * (my_discs - opp_discs);
+      pass_count++;
+    }
+  }
+  end_search_stats( *side_to_move, move );
+
+  return pass_count;
+}
+
+
 static void
 run_endgame_script( const char *in_file_name,
 		    const char *out_file_name,
@@ -1448,17 +1708,11 @@ run_endgame_script( const char *in_file_name,
   EvaluationType eval_info;
   char *comment;
   char buffer[BUFFER_SIZE];
-  char board_string[BUFFER_SIZE], stm_string[BUFFER_SIZE];
   double start_time, stop_time;
   double search_start, search_stop, max_search;
   int i, j;
-  int row, col, pos;
-  int book, mid, exact, wld;
-  int my_time, my_incr;
-  int side_to_move, move;
+  int side_to_move;
   int score;
-  int timed_search;
-  int scanned, token;
   int position_count;
   FILE *script_stream;
   FILE *output_stream;
@@ -1489,17 +1743,6 @@ run_endgame_script( const char *in_file_name,
     white_moves[i] = PASS;
   }
 
-  my_time = 100000000;
-  my_incr = 0;
-  timed_search = FALSE;
-  book = use_book;
-  mid = 60;
-  if ( wld_only )
-    exact = 0;
-  else
-    exact = 60;
-  wld = 60;
-
   toggle_status_log( FALSE );
 
   reset_counter( &script_nodes );
@@ -1539,72 +1782,9 @@ run_endgame_script( const char *in_file_name,
     }
 
     /* Parse the script line containing board and side to move */
-    
-    game_init( NULL, &side_to_move );
-    set_slack( 0.0 );
-    toggle_human_openings( FALSE );
-    reset_book_search();
-    set_deviation_value( 0, 60, 0.0 );
-    setup_hash( TRUE );
-    position_count++;
-
-    scanned = sscanf( buffer, "%s %s", board_string, stm_string );
-    if ( scanned != 2 ) {
-      printf( "\nError parsing line %d - aborting\n\n", i + 1 );
-      exit( EXIT_FAILURE );
-    }
-
-    if ( strlen( stm_string ) != 1 ) {
-      printf( "\nAmbiguous side to move on line %d - aborting\n\n", i + 1 );
-      exit( EXIT_FAILURE );
-    }
-    switch ( stm_string[0] ) {
-    case 'O':
-    case '0':
-      side_to_move = WHITESQ;
-      break;
-    case '*':
-    case 'X':
-      side_to_move = BLACKSQ;
-      break;
-    default:
-      printf( "\nBad side-to-move indicator on line %d - aborting\n\n",
-	      i + 1 );
-    }
-
-    if ( strlen( board_string ) != 64 ) {
-      printf( "\nBoard on line %d doesn't contain 64 positions - aborting\n\n",
-	      i + 1 );
-      exit( EXIT_FAILURE );
-    }
 
-    token = 0;
-    for ( row = 1; row <= 8; row++ )
-      for ( col = 1; col <= 8; col++ ) {
-	pos = 10 * row + col;
-	switch ( board_string[token] ) {
-	case '*':
-	case 'X':
-	case 'x':
-	  board[pos] = BLACKSQ;
-	  break;
-	case 'O':
-	case '0':
-	case 'o':
-	  board[pos] = WHITESQ;
-	  break;
-	case '-':
-	case '.':
-	  board[pos] = EMPTY;
-	  break;
-	default:
-	  printf( "\nBad character '%c' in board on line %d - aborting\n\n",
-		  board_string[token], i + 1 );
-	  break;
-	}
-	token++;
-      }
-    disks_played = disc_count( BLACKSQ ) + disc_count( WHITESQ ) - 4;
+    setup_script_position( buffer, i + 1, &side_to_move );
+    position_count++;
 
     /* Search the position */
 
@@ -1614,31 +1794,8 @@ run_endgame_script( const char *in_file_name,
     }
 
     search_start = get_real_timer();
-    start_move( my_time, my_incr, disks_played + 4 );
-    determine_move_time( my_time, my_incr, disks_played + 4 );
-
-    pass_count = 0;
-    move = compute_move( side_to_move, TRUE, my_time, my_incr, timed_search,
-			 book, mid, exact, wld, TRUE, &eval_info );
-    if ( move == PASS ) {
-      pass_count++;
-      side_to_move = OPP( side_to_move );
-      move = compute_move( side_to_move, TRUE, my_time, my_incr, timed_search,
-			   book, mid, exact, wld, TRUE, &eval_info );
-      if ( move == PASS ) {  /* Both pass, game over. */
-	int my_discs = disc_count( side_to_move );
-	int opp_discs = disc_count( OPP( side_to_move ) );
-	if ( my_discs > opp_discs )
-	  my_discs = 64 - opp_discs;
-	else if ( opp_discs > my_discs )
-	  opp_discs = 64 - my_discs;
-	else
-	  my_discs = opp_discs = 32;
-	eval_info.score = 128 * (my_discs - opp_discs);
-	pass_count++;
-      }
-    }
-
+    pass_count = solve_script_position( &side_to_move, use_book,
+					wld_only ? 0 : 60, &eval_info );
     score = eval_info.score / 128;
     search_stop = get_real_timer();
     if ( search_stop - search_start > max_search )
@@ -1717,6 +1874,211 @@ run_endgame_script( const char *in_file_name,
 }
 
 
+#if SCRIPT_ONLY
+/*
+   SUITE_SCORE
+   Solves the position set up by SETUP_SCRIPT_POSITION and returns
+   the score (exact or WLD) from the point of view of SIDE_TO_MOVE.
+   The time and nodes spent are added to *TIME and *SEARCH_NODES.
+*/
+
+static int
+suite_score( int side_to_move, int exact, double *time,
+	     CounterType *search_nodes ) {
+  EvaluationType eval_info;
+  double start_time;
+  int solve_side;
+  int score;
+
+  solve_side = side_to_move;
+  start_time = get_real_timer();
+  solve_script_position( &solve_side, FALSE, exact, &eval_info );
+  *time = get_real_timer() - start_time;
+  add_counter( search_nodes, &nodes );
+
+  score = eval_info.score / 128;
+  if ( solve_side != side_to_move )
+    score = -score;
+
+  return score;
+}
+
+
+/*
+   WLD_STRING
+   Converts a score to win/draw/loss notation.
+*/
+
+static const char *
+wld_string( int score ) {
+  if ( score > 0 )
+    return "win";
+  else if ( score == 0 )
+    return "draw";
+  else
+    return "loss";
+}
+
+
+/*
+   RUN_ENDGAME_SUITE
+   Solves all positions in a suite file for exact score and WLD,
+   compares the results with the known scores and reports nodes,
+   time and speed per position and in total. A suite line has the
+   script format followed by the known exact score for the side to
+   move, e.g.
+     O--OOOOX-OOOOOOXOOXXOOOXOOXOOOXXOOOOOOXX---OOOOX----O--X-------- X +38
+   Text after a '%' is used as the name of the position.
+   Returns the number of positions where the result didn't match.
+*/
+
+static int
+run_endgame_suite( const char *suite_file_name ) {
+  CounterType exact_nodes, wld_nodes;
+  CounterType position_exact_nodes, position_wld_nodes;
+  char buffer[BUFFER_SIZE];
+  char name[BUFFER_SIZE];
+  char *comment;
+  double exact_time, wld_time;
+  double position_exact_time, position_wld_time;
+  int i;
+  int side_to_move;
+  int known_score, exact_score, wld_score;
+  int position_count, error_count;
+  FILE *suite_stream;
+
+  suite_stream = fopen( suite_file_name, "r" );
+  if ( suite_stream == NULL ) {
+    printf( "\nCan't open suite file '%s' - aborting\n\n", suite_file_name );
+    exit( EXIT_FAILURE );
+  }
+
+  set_names( "", "" );
+  set_move_list( black_moves, white_moves, score_sheet_row );
+  set_evals( 0.0, 0.0 );
+  for ( i = 0; i < 60; i++ ) {
+    black_moves[i] = PASS;
+    white_moves[i] = PASS;
+  }
+  toggle_status_log( FALSE );
+  echo = FALSE;
+
+  reset_counter( &exact_nodes );
+  reset_counter( &wld_nodes );
+  exact_time = wld_time = 0.0;
+  position_count = 0;
+  error_count = 0;
+
+  printf( "%-14s %3s %5s  %5s %14s %8s %11s  %5s %14s %8s %11s\n",
+	  "Position", "Emp", "Known", "Exact", "Nodes", "Time", "NPS",
+	  "WLD", "Nodes", "Time", "NPS" );
+
+  for ( i = 0; fgets( buffer, BUFFER_SIZE, suite_stream ) != NULL; i++ ) {
+    if ( (buffer[0] == '%') || (buffer[0] == '#') ||
+	 (strspn( buffer, " \t\r\n" ) == strlen( buffer )) )
+      continue;
+
+    if ( sscanf( buffer, "%*s %*s %d", &known_score ) != 1 ) {
+      printf( "\nNo known score on line %d - aborting\n\n", i + 1 );
+      exit( EXIT_FAILURE );
+    }
+    comment = strchr( buffer, '%' );
+    if ( comment != NULL ) {
+      comment++;
+      comment += strspn( comment, " \t" );
+      strcpy( name, comment );
+      name[strcspn( name, "\r\n" )] = 0;
+    }
+    else
+      sprintf( name, "Line %d", i + 1 );
+    position_count++;
+
+    setup_script_position( buffer, i + 1, &side_to_move );
+    reset_counter( &position_exact_nodes );
+    exact_score = suite_score( side_to_move, 60, &position_exact_time,
+			       &position_exact_nodes );
+
+    setup_script_position( buffer, i + 1, &side_to_move );
+    reset_counter( &position_wld_nodes );
+    wld_score = suite_score( side_to_move, 0, &position_wld_time,
+			     &position_wld_nodes );
+
+    add_counter( &exact_nodes, &position_exact_nodes );
+    add_counter( &wld_nodes, &position_wld_nodes );
+    exact_time += position_exact_time;
+    wld_time += position_wld_time;
+
+    printf( "%-14.14s %3d %+5d  %+5d %14.0f %8.2f %11.0f  %5s %14.0f "
+	    "%8.2f %11.0f",
+	    name, 60 - disks_played, known_score,
+	    exact_score, counter_value( &position_exact_nodes ),
+	    position_exact_time,
+	    counter_value( &position_exact_nodes ) /
+	    MAX( position_exact_time, 0.001 ),
+	    wld_string( wld_score ), counter_value( &position_wld_nodes ),
+	    position_wld_time,
+	    counter_value( &position_wld_nodes ) /
+	    MAX( position_wld_time, 0.001 ) );
+    if ( (exact_score != known_score) ||
+	 ((wld_score > 0) != (known_score > 0)) ||
+	 ((wld_score < 0) != (known_score < 0)) ) {
+      error_count++;
+      fputs( "  WRONG", stdout );
+    }
+    puts( "" );
+    fflush( stdout );
+  }
+
+  fclose( suite_stream );
+
+  puts( "" );
+  printf( "Total positions solved:   %d\n", position_count );
+  printf( "Wrong results:            %d\n", error_count );
+  puts( "" );
+  printf( "Exact nodes:              %.0f\n", counter_value( &exact_nodes ) );
+  printf( "Exact time:               %.2f s\n", exact_time );
+  printf( "Exact speed:              %.0f nps\n",
+	  counter_value( &exact_nodes ) / MAX( exact_time, 0.001 ) );
+  puts( "" );
+  printf( "WLD nodes:                %.0f\n", counter_value( &wld_nodes ) );
+  printf( "WLD time:                 %.2f s\n", wld_time );
+  printf( "WLD speed:                %.0f nps\n",
+	  counter_value( &wld_nodes ) / MAX( wld_time, 0.001 ) );
+  puts( "" );
+  add_counter( &exact_nodes, &wld_nodes );
+  printf( "Total nodes:              %.0f\n", counter_value( &exact_nodes ) );
+  printf( "Total time:               %.2f s\n", exact_time + wld_time );
+  printf( "Total speed:              %.0f nps\n",
+	  counter_value( &exact_nodes ) / MAX( exact_time + wld_time, 0.001 ) );
+  puts( "" );
+
+  return error_count;
+}
+#endif
+
+
+/*
+   BEGIN_SEARCH_STATS
+   END_SEARCH_STATS
+   Bracket the searches for one move, or one script position, so
+   that -stats gets a record for each: the counters are cleared
+   before and written as one JSON line after.
+*/
+
+static void
+begin_search_stats( void ) {
+  reset_search_stats();
+}
+
+
+static void
+end_search_stats( int side_to_move, int move ) {
+  if ( stats_stream != NULL )
+    write_search_stats( stats_stream, ++stats_search_count, disks_played,
+			side_to_move, move );
+}
+
+
 #if !SCRIPT_ONLY
 /*
    DUMP_POSITION